@@ -0,0 +1,69 @@
+/*
+ * File: arena.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of the arena allocator.
+ * Allocating moves a cursor through the current block and goes on to the next block when it
+ * is full; rewinding moves the cursor back. Blocks only go back to the system with the arena.
+ */
+
+// Include necessary headers
+#include "arena.hpp"
+#include <new>
+
+// Releases the blocks when the object is destroyed
+Arena::~Arena()
+{
+    for (const ArenaBlock& block : blocks) ::operator delete(block.memory);
+}
+
+// Returns 'bytes' bytes of memory aligned to 'alignment'.
+void* arenaAllocate(Arena& arena, size_t bytes, size_t alignment)
+{
+    // Blocks come from operator new, so their start is aligned for any type
+    while (arena.block < arena.blocks.size()) {
+        const ArenaBlock& block = arena.blocks[arena.block];
+        size_t start = (arena.used + alignment - 1) & ~(alignment - 1);
+        if (start + bytes <= block.size) {
+            arena.used = start + bytes;
+            return block.memory + start;
+        }
+
+        // The rest of this block is skipped until the next rewind
+        ++arena.block;
+        arena.used = 0;
+    }
+
+    // Every block is full, add one
+    size_t size = bytes > ARENA_BLOCK_SIZE ? bytes : ARENA_BLOCK_SIZE;
+    arena.blocks.push_back({ static_cast<char*>(::operator new(size)), size });
+    arena.block = arena.blocks.size() - 1;
+    arena.used = bytes;
+    return arena.blocks.back().memory;
+}
+
+// Returns the current position of the arena.
+ArenaMark arenaMark(const Arena& arena)
+{
+    return { arena.block, arena.used };
+}
+
+// Frees everything allocated since 'mark' was taken.
+void arenaRewind(Arena& arena, const ArenaMark& mark)
+{
+    arena.block = mark.block;
+    arena.used = mark.used;
+}
+
+// Frees everything allocated from the arena.
+void resetArena(Arena& arena)
+{
+    arena.block = 0;
+    arena.used = 0;
+}
+
+// Returns the arena of the calling thread.
+Arena& threadArena()
+{
+    static thread_local Arena arena;
+    return arena;
+}
@@ -0,0 +1,101 @@
+/*
+ * File: arena.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of the arena allocator.
+ * An arena hands out memory from large blocks and frees all of it at once, so structures made of
+ * many small nodes (the graph of the optimizer for example) cost no call to the global allocator
+ * per node. The blocks are kept after a reset, so once an arena has grown to its working size it
+ * does not allocate at all. Every thread has its own arena, so threads never share a lock.
+ */
+
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Size of a block of an arena. Larger requests get a block of their own size.
+static const size_t ARENA_BLOCK_SIZE = 64 * 1024;
+
+// A block of memory owned by an arena
+struct ArenaBlock
+{
+	char* memory; // Start of the block
+	size_t size;  // Size of the block in bytes
+};
+
+// An arena. The blocks are released when the object is destroyed.
+struct Arena
+{
+	std::vector<ArenaBlock> blocks; // Blocks, kept from one reset to the next
+	size_t block = 0;               // Block being filled
+	size_t used = 0;                // Bytes used in that block
+
+	Arena() = default;
+	~Arena();
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+};
+
+// A position in an arena, see arenaMark() and arenaRewind()
+struct ArenaMark
+{
+	size_t block; // Block being filled
+	size_t used;  // Bytes used in that block
+};
+
+// Returns 'bytes' bytes of memory aligned to 'alignment' (a power of two, at most
+// alignof(std::max_align_t)). The memory stays valid until the arena is rewound past it.
+void* arenaAllocate(Arena& arena, size_t bytes, size_t alignment);
+
+// Returns the current position of the arena.
+ArenaMark arenaMark(const Arena& arena);
+
+// Frees everything allocated since 'mark' was taken, keeping the blocks for later.
+void arenaRewind(Arena& arena, const ArenaMark& mark);
+
+// Frees everything allocated from the arena, keeping the blocks for later.
+void resetArena(Arena& arena);
+
+// Returns the arena of the calling thread.
+Arena& threadArena();
+
+// Frees everything allocated from an arena during the lifetime of the object.
+// Scopes nest, so a function using the arena of its thread may call another one that does too.
+struct ArenaScope
+{
+	Arena& arena;
+	ArenaMark mark;
+
+	explicit ArenaScope(Arena& arena) : arena(arena), mark(arenaMark(arena)) {}
+	~ArenaScope() { arenaRewind(arena, mark); }
+	ArenaScope(const ArenaScope&) = delete;
+	ArenaScope& operator=(const ArenaScope&) = delete;
+};
+
+// Allocator for the standard containers, taking memory from an arena.
+// Freeing does nothing: the memory comes back when the arena is rewound.
+template<class T>
+struct ArenaAllocator
+{
+	typedef T value_type;
+	Arena* arena;
+
+	explicit ArenaAllocator(Arena& arena) : arena(&arena) {}
+	template<class U> ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+	T* allocate(size_t count) { return static_cast<T*>(arenaAllocate(*arena, count * sizeof(T), alignof(T))); }
+	void deallocate(T*, size_t) {}
+};
+
+template<class T, class U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena == b.arena; }
+
+template<class T, class U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena != b.arena; }
+
+// A vector whose storage comes from an arena
+template<class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif // ARENA_HPP
@@ -0,0 +1,31 @@
+/*
+ * File: batchEvaluator.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of the batch evaluation API.
+ */
+
+// Include necessary headers
+#include "batchEvaluator.hpp"
+#include "iterativeEvaluator.hpp"
+#include "threadPool.hpp"
+#include "constants.hpp"
+#include <atomic>
+
+// Evaluates 'count' expressions on up to 'threads' threads.
+size_t evaluateBatch(const char* const* expressions, size_t count, int* results, int* errorCodes, unsigned threads)
+{
+    std::atomic<size_t> failed(0);
+
+    // Every thread counts its own failures and adds them once per chunk
+    parallelFor(count, threads, BATCH_GRAIN, [&](size_t begin, size_t end) {
+        size_t chunkFailed = 0;
+        for (size_t i = begin; i < end; ++i) {
+            // The iterative evaluator cannot overflow the smaller stacks of the pool threads
+            errorCodes[i] = evaluateIterative(expressions[i], results[i]);
+            if (errorCodes[i] != ERROR::SUCCESS) ++chunkFailed;
+        }
+        if (chunkFailed) failed.fetch_add(chunkFailed, std::memory_order_relaxed);
+    });
+
+    return failed.load();
+}
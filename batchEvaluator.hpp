@@ -0,0 +1,25 @@
+/*
+ * File: batchEvaluator.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of the batch evaluation API.
+ * It evaluates many independent expressions in parallel on the work stealing thread pool.
+ */
+
+#ifndef BATCH_EVALUATOR_HPP
+#define BATCH_EVALUATOR_HPP
+
+#include <cstddef>
+
+// Number of expressions a thread takes from its share at a time.
+// Small enough for long expressions to balance, large enough to keep the stealing cheap.
+static const size_t BATCH_GRAIN = 64;
+
+// Evaluates 'count' expressions on up to 'threads' threads (0 means one per core).
+// The result and error code of expressions[i] are written to results[i] and errorCodes[i],
+// exactly as evaluate() would return them. Nothing is allocated per expression.
+// Expressions are evaluated with evaluateIterative(), so nesting deeper than DEFAULT_MAX_DEPTH
+// gives ERROR::DEPTH_EXCEEDED instead of overflowing the stack of a thread.
+// It returns the number of expressions that failed.
+size_t evaluateBatch(const char* const* expressions, size_t count, int* results, int* errorCodes, unsigned threads);
+
+#endif // BATCH_EVALUATOR_HPP
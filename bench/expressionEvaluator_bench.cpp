@@ -0,0 +1,617 @@
+/*
+ * File: expressionEvaluator_bench.cpp
+ * Author: Alex Turner
+ * Description: This file contains the benchmarks of the expression evaluator.
+ * Every workload is generated from a fixed seed, so the same build always measures the same
+ * inputs, and every number is the median of several runs, so the output is stable enough to
+ * compare between commits.
+ */
+
+ // Include necessary headers
+#include "../expressionEvaluator.hpp"
+#include "../compiledExpression.hpp"
+#include "../iterativeEvaluator.hpp"
+#include "../expressionBudget.hpp"
+#include "../batchEvaluator.hpp"
+#include "../jitCompiler.hpp"
+#include "../shapeCache.hpp"
+#include "../parallelEvaluator.hpp"
+#include "../fusedExpression.hpp"
+#include "../columnarEvaluator.hpp"
+#include "../numericEvaluator.hpp"
+#include "../optimizer.hpp"
+#include "../simdKernels.hpp"
+#include "../constants.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Options given on the command line
+struct BenchOptions
+{
+    bool quick = false;      // Smaller workloads and fewer runs, to check the benchmark works
+    bool csv = false;        // Comma separated output for regression tracking
+    const char* filter = 0;  // Only run the workloads whose name contains this text
+    unsigned maxThreads = 64; // Largest thread count of the batch scaling report
+    int simdLevel = -1;       // Level of the scanning kernels, -1 for the best one
+};
+
+// A set of generated expressions
+struct Workload
+{
+    string name;                  // Name printed in the report
+    vector<string> expressions;   // The expressions
+    vector<const char*> pointers; // Pointers to the expressions, for the batch API
+    size_t bytes = 0;             // Total length of the expressions
+};
+
+// Number of runs of every measurement, the median is reported
+static int runsPerMeasurement(const BenchOptions& options) { return options.quick ? 3 : 7; }
+
+// Finishes a workload once its expressions are generated
+static void finishWorkload(Workload& workload)
+{
+    workload.bytes = 0;
+    workload.pointers.clear();
+    for (const string& expression : workload.expressions) {
+        workload.bytes += expression.size();
+        workload.pointers.push_back(expression.c_str());
+    }
+}
+
+// Appends a random number between 0 and 'limit'
+static void appendNumber(mt19937& random, string& out, unsigned limit)
+{
+    out += to_string(random() % (limit + 1));
+}
+
+// Realistic mix: short expressions with a few operators and some parentheses
+static Workload makeRealistic(mt19937& random, size_t count)
+{
+    Workload workload;
+    workload.name = "realistic";
+    for (size_t i = 0; i < count; ++i) {
+        string expression;
+        int terms = 2 + random() % 6;
+        for (int t = 0; t < terms; ++t) {
+            if (t > 0) { expression += ' '; expression += "+-*/"[random() % 4]; expression += ' '; }
+            if (random() % 4 == 0) {
+                expression += '(';
+                appendNumber(random, expression, 999);
+                expression += " * ";
+                appendNumber(random, expression, 99);
+                expression += ')';
+            }
+            else appendNumber(random, expression, 9999);
+        }
+        workload.expressions.push_back(expression);
+    }
+    finishWorkload(workload);
+    return workload;
+}
+
+// Long '+' chains, like machine generated sums
+static Workload makeLongChains(mt19937& random, size_t count, size_t terms)
+{
+    Workload workload;
+    workload.name = "long_plus_chain";
+    for (size_t i = 0; i < count; ++i) {
+        string expression;
+        for (size_t t = 0; t < terms; ++t) {
+            if (t > 0) expression += " + ";
+            appendNumber(random, expression, 99999);
+        }
+        workload.expressions.push_back(expression);
+    }
+    finishWorkload(workload);
+    return workload;
+}
+
+// Deeply nested parentheses, (((...)))
+static Workload makeDeepNesting(mt19937& random, size_t count, size_t depth)
+{
+    Workload workload;
+    workload.name = "deep_nesting";
+    for (size_t i = 0; i < count; ++i) {
+        string expression;
+        for (size_t d = 0; d < depth; ++d) { appendNumber(random, expression, 9); expression += " + ("; }
+        appendNumber(random, expression, 9);
+        expression.append(depth, ')');
+        workload.expressions.push_back(expression);
+    }
+    finishWorkload(workload);
+    return workload;
+}
+
+// Runs of '*' and '/' with divisors that are never zero
+static Workload makeMulDivHeavy(mt19937& random, size_t count, size_t terms)
+{
+    Workload workload;
+    workload.name = "mul_div_heavy";
+    for (size_t i = 0; i < count; ++i) {
+        string expression;
+        appendNumber(random, expression, 9999);
+        for (size_t t = 1; t < terms; ++t) {
+            expression += (random() % 2) ? " * " : " / ";
+            expression += to_string(1 + random() % 9);
+        }
+        workload.expressions.push_back(expression);
+    }
+    finishWorkload(workload);
+    return workload;
+}
+
+// Whitespace padded inputs, like the ones in testData::getValidExpressions()
+static Workload makeWhitespacePadded(mt19937& random, size_t count)
+{
+    static const char spaces[] = { ' ', '\t', '\n', '\r', '\f', '\v' };
+    Workload workload;
+    workload.name = "whitespace_padded";
+    for (size_t i = 0; i < count; ++i) {
+        string expression;
+        int terms = 2 + random() % 6;
+        for (int t = 0; t < terms; ++t) {
+            expression.append(random() % 8, spaces[random() % 6]);
+            // No division here, so the measure is about whitespace and not about errors
+            if (t > 0) { expression += "+-*"[random() % 3]; expression.append(random() % 8, ' '); }
+            appendNumber(random, expression, 999);
+        }
+        expression.append(random() % 12, ' ');
+        workload.expressions.push_back(expression);
+    }
+    finishWorkload(workload);
+    return workload;
+}
+
+// Adversarial inputs: every one of them fails, at the start, in the middle or at the end
+static Workload makeInvalid(mt19937& random, size_t count)
+{
+    Workload workload;
+    workload.name = "invalid_mix";
+    for (size_t i = 0; i < count; ++i) {
+        string expression;
+        int terms = 4 + random() % 8;
+        for (int t = 0; t < terms; ++t) {
+            if (t > 0) expression += " + ";
+            appendNumber(random, expression, 999);
+        }
+        switch (random() % 4) {
+        case 0: expression += " % 3"; break;        // Invalid character at the end
+        case 1: expression = "(" + expression; break; // Unmatched parenthesis
+        case 2: expression += " / 0"; break;        // Division by zero
+        default: expression += " 7"; break;         // Trailing number
+        }
+        workload.expressions.push_back(expression);
+    }
+    finishWorkload(workload);
+    return workload;
+}
+
+// Machine generated inputs: a few templates filled with different numbers each time
+static Workload makeTemplated(mt19937& random, size_t count, size_t templates)
+{
+    Workload shapes = makeRealistic(random, templates);
+    Workload workload;
+    workload.name = "templated";
+    for (size_t i = 0; i < count; ++i) {
+        string expression;
+        const string& shape = shapes.expressions[random() % templates];
+        for (size_t c = 0; c < shape.size(); ++c) {
+            if (shape[c] < '0' || shape[c] > '9') { expression += shape[c]; continue; }
+            while (c + 1 < shape.size() && shape[c + 1] >= '0' && shape[c + 1] <= '9') ++c;
+            appendNumber(random, expression, 999);
+        }
+        workload.expressions.push_back(expression);
+    }
+    finishWorkload(workload);
+    return workload;
+}
+
+// Returns the median time in nanoseconds of several runs of 'body'
+static double medianNanoseconds(const BenchOptions& options, const function<void()>& body)
+{
+    vector<double> times;
+    for (int r = 0; r < runsPerMeasurement(options); ++r) {
+        auto start = chrono::steady_clock::now();
+        body();
+        auto stop = chrono::steady_clock::now();
+        times.push_back((double)chrono::duration_cast<chrono::nanoseconds>(stop - start).count());
+    }
+    sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// Keeps the compiler from dropping the measured work
+static volatile int sink = 0;
+
+// Prints the header of the report
+static void printHeader(const BenchOptions& options)
+{
+    if (options.csv) printf("workload,method,expressions,bytes,ns_per_expression,mb_per_second\n");
+    else printf("%-20s %-18s %12s %12s %14s %10s\n", "workload", "method", "expressions", "bytes", "ns/expression", "MB/s");
+}
+
+// Prints one line of the report
+static void printLine(const BenchOptions& options, const Workload& workload, const char* method, double nanoseconds)
+{
+    size_t count = workload.expressions.size();
+    double perExpression = nanoseconds / (double)count;
+    double megabytesPerSecond = nanoseconds > 0 ? (double)workload.bytes / nanoseconds * 1e9 / 1e6 : 0;
+    if (options.csv) {
+        printf("%s,%s,%zu,%zu,%.1f,%.1f\n", workload.name.c_str(), method, count, workload.bytes, perExpression, megabytesPerSecond);
+    }
+    else {
+        printf("%-20s %-18s %12zu %12zu %14.1f %10.1f\n", workload.name.c_str(), method, count, workload.bytes,
+            perExpression, megabytesPerSecond);
+    }
+}
+
+// Measures a workload with every evaluation method, with the phases of evaluate() on their own
+static void benchWorkload(const BenchOptions& options, const Workload& workload)
+{
+    if (options.filter && workload.name.find(options.filter) == string::npos) return;
+
+    // evaluate(), both phases together
+    printLine(options, workload, "evaluate", medianNanoseconds(options, [&] {
+        int total = 0, result = 0;
+        for (const char* expression : workload.pointers) total += evaluate(expression, result) + result;
+        sink = total;
+    }));
+
+    // The validation phase on its own
+    printLine(options, workload, "isValidExpression", medianNanoseconds(options, [&] {
+        int total = 0;
+        for (const char* expression : workload.pointers) total += isValidExpression(expression);
+        sink = total;
+    }));
+
+    // The parse phase on its own
+    printLine(options, workload, "parse", medianNanoseconds(options, [&] {
+        int total = 0, result = 0;
+        for (const char* expression : workload.pointers) {
+            const char* cur = expression;
+            total += parse(cur, result) + result;
+        }
+        sink = total;
+    }));
+
+    // evaluate() without recursion, with a reused stack
+    ParseStack stack;
+    printLine(options, workload, "evaluate_iterative", medianNanoseconds(options, [&] {
+        int total = 0, result = 0;
+        for (const char* expression : workload.pointers) total += evaluateIterative(expression, result, stack) + result;
+        sink = total;
+    }));
+
+    // The same, after the cost scan with every limit set, which replaces isValidExpression()
+    EvaluationBudget budget;
+    budget.maxBytes = 1 << 20;
+    budget.maxOperations = 1 << 20;
+    budget.deadline = chrono::steady_clock::now() + chrono::hours(1);
+    printLine(options, workload, "evaluate_budgeted", medianNanoseconds(options, [&] {
+        int total = 0, result = 0;
+        for (const char* expression : workload.pointers) total += evaluateBudgeted(expression, result, budget) + result;
+        sink = total;
+    }));
+
+    // The single pass, length-aware evaluate()
+    printLine(options, workload, "evaluate_view", medianNanoseconds(options, [&] {
+        int total = 0, result = 0;
+        for (const string& expression : workload.expressions) total += evaluate(string_view(expression), result) + result;
+        sink = total;
+    }));
+
+    // The generic evaluator: in int32_t with wrapping it is evaluate(), in int64_t checked it never overflows silently
+    printLine(options, workload, "numeric_i32_wrap", medianNanoseconds(options, [&] {
+        int total = 0, result = 0;
+        for (const char* expression : workload.pointers) total += evaluateNumeric<int32_t, WrapOverflow>(expression, result) + result;
+        sink = total;
+    }));
+    printLine(options, workload, "numeric_i64_checked", medianNanoseconds(options, [&] {
+        int64_t total = 0, result = 0;
+        for (const char* expression : workload.pointers) total += evaluateNumeric<int64_t, CheckedOverflow>(expression, result) + result;
+        sink = (int)total;
+    }));
+
+    // Compiled once, then run
+    vector<CompiledExpression> programs(workload.expressions.size());
+    for (size_t i = 0; i < programs.size(); ++i) compile(workload.pointers[i], programs[i]);
+    printLine(options, workload, "run_compiled", medianNanoseconds(options, [&] {
+        int total = 0, result = 0;
+        for (const CompiledExpression& program : programs) total += run(program, result) + result;
+        sink = total;
+    }));
+
+    // Compiled to native code, where supported
+    if (jitSupported()) {
+        JitModule natives;
+        jitCompile(programs.data(), programs.size(), natives);
+        printLine(options, workload, "run_jit", medianNanoseconds(options, [&] {
+            int total = 0, result = 0;
+            for (size_t i = 0; i < programs.size(); ++i) total += runJit(natives, i, 0, result) + result;
+            sink = total;
+        }));
+    }
+
+    // One plan per shape, the numbers read from every expression
+    ShapeCache shapes;
+    printLine(options, workload, "shape_evaluate", medianNanoseconds(options, [&] {
+        int total = 0, result = 0;
+        for (const char* expression : workload.pointers) total += shapeEvaluate(shapes, expression, result) + result;
+        sink = total;
+    }));
+
+    // The same, SHAPE_LANES expressions of a shape at a time
+    vector<int> results(workload.pointers.size()), errors(workload.pointers.size());
+    printLine(options, workload, "shape_batch", medianNanoseconds(options, [&] {
+        sink = (int)shapeEvaluateBatch(shapes, workload.pointers.data(), workload.pointers.size(), results.data(), errors.data());
+    }));
+}
+
+// Measures evaluateBatch() with 1 to maxThreads threads
+static void benchBatchScaling(const BenchOptions& options, const Workload& workload)
+{
+    if (options.filter && strstr("batch_scaling", options.filter) == 0) return;
+
+    size_t count = workload.expressions.size();
+    vector<int> results(count), errors(count);
+    double single = 0;
+    if (!options.csv) printf("\n%-20s %8s %14s %10s %8s\n", "batch_scaling", "threads", "ns/expression", "MB/s", "speedup");
+    for (unsigned threads = 1; threads <= options.maxThreads; threads *= 2) {
+        double nanoseconds = medianNanoseconds(options, [&] {
+            evaluateBatch(workload.pointers.data(), count, results.data(), errors.data(), threads);
+        });
+        if (threads == 1) single = nanoseconds;
+        double megabytesPerSecond = (double)workload.bytes / nanoseconds * 1e9 / 1e6;
+        if (options.csv) {
+            printf("%s,batch_%u_threads,%zu,%zu,%.1f,%.1f\n", workload.name.c_str(), threads, count, workload.bytes,
+                nanoseconds / (double)count, megabytesPerSecond);
+        }
+        else {
+            printf("%-20s %8u %14.1f %10.1f %8.2f\n", workload.name.c_str(), threads, nanoseconds / (double)count,
+                megabytesPerSecond, single / nanoseconds);
+        }
+    }
+}
+
+// Measures evaluateParallel() on a single long expression with 1 to maxThreads threads
+static void benchParallelScaling(const BenchOptions& options, const Workload& workload)
+{
+    if (options.filter && strstr("parallel_scaling", options.filter) == 0) return;
+
+    const string& expression = workload.expressions[0];
+    int total = 0, result = 0;
+    double single = medianNanoseconds(options, [&] { total += evaluate(expression.c_str(), result) + result; });
+    if (!options.csv) {
+        printf("\n%-20s %8s %14s %10s %8s\n", "parallel_scaling", "threads", "ms", "MB/s", "speedup");
+        printf("%-20s %8s %14.2f %10.1f %8.2f\n", workload.name.c_str(), "evaluate", single / 1e6, (double)workload.bytes / single * 1e3, 1.0);
+    }
+    for (unsigned threads = 1; threads <= options.maxThreads; threads *= 2) {
+        double nanoseconds = medianNanoseconds(options, [&] {
+            total += evaluateParallel(expression.c_str(), result, threads) + result;
+        });
+        double megabytesPerSecond = (double)workload.bytes / nanoseconds * 1e3;
+        if (options.csv) {
+            printf("%s,parallel_%u_threads,1,%zu,%.1f,%.1f\n", workload.name.c_str(), threads, workload.bytes, nanoseconds, megabytesPerSecond);
+        }
+        else {
+            printf("%-20s %8u %14.2f %10.1f %8.2f\n", workload.name.c_str(), threads, nanoseconds / 1e6, megabytesPerSecond, single / nanoseconds);
+        }
+    }
+    sink = total;
+}
+
+// Builds a random formula over the variables a to h and a pool of common subexpressions
+static string makeFormula(mt19937& random, const vector<string>& pool, int depth)
+{
+    string out;
+    int terms = 2 + random() % 4;
+    for (int t = 0; t < terms; ++t) {
+        if (t > 0) { out += ' '; out += "+-*+-*/"[random() % 7]; out += ' '; }
+        int pick = random() % 6;
+        if (pick < 3) out += "(" + pool[random() % pool.size()] + ")";
+        else if (pick == 3 && depth < 2) out += "(" + makeFormula(random, pool, depth + 1) + ")";
+        else if (pick == 4) appendNumber(random, out, 99);
+        else out += "abcdefgh"[random() % 8];
+    }
+    return out;
+}
+
+// Measures a set of related formulas evaluated on every record: one by one with evaluate() on the
+// text of the record, with run() of each compiled (and optimized) program, and fused with runFused().
+// In the comma separated output the bytes column holds the operations of the method.
+static void benchFusedSet(const BenchOptions& options, size_t formulas, size_t records)
+{
+    if (options.filter && strstr("fused_set", options.filter) == 0) return;
+
+    mt19937 random(9);
+    VariableTable variables;
+    const char* names[] = { "a", "b", "c", "d", "e", "f", "g", "h" };
+    for (const char* name : names) declareVariable(variables, name);
+    vector<string> pool, formulaText;
+    for (int i = 0; i < 24; ++i) pool.push_back(makeFormula(random, { "a + b", "c * d", "e - f" }, 1));
+    for (size_t i = 0; i < formulas; ++i) formulaText.push_back(makeFormula(random, pool, 0));
+    vector<const char*> pointers;
+    for (const string& text : formulaText) pointers.push_back(text.c_str());
+
+    // The rows, and the same formulas written out with the numbers of every row for evaluate()
+    vector<int> rows(records * 8);
+    for (int& value : rows) value = 1 + (int)(random() % 50);
+    vector<string> texts;
+    for (size_t r = 0; r < records; ++r) {
+        for (const string& formula : formulaText) {
+            string text;
+            for (char ch : formula) {
+                if (ch >= 'a' && ch <= 'h') text += to_string(rows[r * 8 + (ch - 'a')]);
+                else text += ch;
+            }
+            texts.push_back(text);
+        }
+    }
+
+    vector<CompiledExpression> programs(formulas), optimized(formulas);
+    for (size_t i = 0; i < formulas; ++i) {
+        compile(pointers[i], variables, programs[i]);
+        optimized[i] = programs[i];
+        optimize(optimized[i]);
+    }
+    FusedExpression fused;
+    compileFused(pointers.data(), formulas, variables, fused);
+    vector<int> results(formulas), errors(formulas);
+
+    int total = 0, result = 0;
+    double perRecord[4];
+    perRecord[0] = medianNanoseconds(options, [&] {
+        for (const string& text : texts) total += evaluate(text.c_str(), result) + result;
+    });
+    perRecord[1] = medianNanoseconds(options, [&] {
+        for (size_t r = 0; r < records; ++r) {
+            for (const CompiledExpression& program : programs) total += run(program, &rows[r * 8], result) + result;
+        }
+    });
+    perRecord[2] = medianNanoseconds(options, [&] {
+        for (size_t r = 0; r < records; ++r) {
+            for (const CompiledExpression& program : optimized) total += run(program, &rows[r * 8], result) + result;
+        }
+    });
+    perRecord[3] = medianNanoseconds(options, [&] {
+        for (size_t r = 0; r < records; ++r) total += (int)runFused(fused, &rows[r * 8], results.data(), errors.data()) + results[0];
+    });
+    sink = total;
+
+    const char* methods[] = { "evaluate", "run_compiled", "run_optimized", "run_fused" };
+    size_t operations[] = { fused.stats.operationsSeparate, fused.stats.operationsSeparate, fused.stats.operationsOptimized, fused.stats.operationsFused };
+    if (!options.csv) printf("\n%-20s %-18s %12s %14s %8s\n", "fused_set", "method", "operations", "ns/record", "speedup");
+    for (int m = 0; m < 4; ++m) {
+        double nanoseconds = perRecord[m] / (double)records;
+        if (options.csv) printf("fused_set,%s,%zu,%zu,%.1f,0\n", methods[m], formulas, operations[m], nanoseconds / (double)formulas);
+        else printf("%-20s %-18s %12zu %14.1f %8.2f\n", "fused_set", methods[m], operations[m], nanoseconds, perRecord[0] / perRecord[m]);
+    }
+}
+
+// Applies one formula to columns of values: evaluate() on the formula written out for every row, run()
+// of the compiled formula row by row, and runColumns() on the whole columns. Reports ns per row.
+static void benchColumnar(const BenchOptions& options, size_t rows)
+{
+    if (options.filter && strstr("columnar", options.filter) == 0) return;
+
+    const char* formulas[] = { "(a + b) * c - a * 3", "a * b - c / (b + 7) + 2 * a" };
+    VariableTable variables;
+    for (const char* name : { "a", "b", "c" }) declareVariable(variables, name);
+
+    // Columns of values, a few divisors that are 0 so the division is masked on some rows
+    mt19937 random(10);
+    vector<vector<int>> columns(3, vector<int>(rows));
+    for (vector<int>& column : columns) {
+        for (int& value : column) value = (int)(random() % 2000) - 1000;
+    }
+    const int* pointers[3] = { columns[0].data(), columns[1].data(), columns[2].data() };
+    vector<int> results(rows);
+    vector<uint64_t> errorBits(columnBitmapWords(rows));
+
+    if (!options.csv) printf("\n%-20s %-30s %-14s %14s %8s\n", "columnar", "formula", "method", "ns/row", "speedup");
+    for (const char* formula : formulas) {
+        vector<string> texts(rows);
+        for (size_t r = 0; r < rows; ++r) {
+            for (const char* ch = formula; *ch; ++ch) {
+                if (*ch >= 'a' && *ch <= 'c') texts[r] += to_string(columns[*ch - 'a'][r]);
+                else texts[r] += *ch;
+            }
+        }
+        CompiledExpression program;
+        compile(formula, variables, program);
+        optimize(program);
+
+        int total = 0, result = 0;
+        double perRun[3];
+        perRun[0] = medianNanoseconds(options, [&] {
+            for (const string& text : texts) total += evaluate(text.c_str(), result) + result;
+        });
+        perRun[1] = medianNanoseconds(options, [&] {
+            for (size_t r = 0; r < rows; ++r) {
+                int values[3] = { columns[0][r], columns[1][r], columns[2][r] };
+                total += run(program, values, result) + result;
+            }
+        });
+        perRun[2] = medianNanoseconds(options, [&] {
+            total += runColumns(program, pointers, rows, results.data(), errorBits.data()) + results[rows / 2];
+        });
+        sink = total;
+
+        const char* methods[] = { "evaluate", "run_compiled", "run_columns" };
+        for (int m = 0; m < 3; ++m) {
+            double nanoseconds = perRun[m] / (double)rows;
+            if (options.csv) printf("columnar,%s,%zu,0,%.2f,0\n", methods[m], rows, nanoseconds);
+            else printf("%-20s %-30s %-14s %14.2f %8.2f\n", "columnar", formula, methods[m], nanoseconds, perRun[0] / perRun[m]);
+        }
+    }
+}
+
+// Entry point of the benchmarks
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--quick") == 0) options.quick = true;
+        else if (strcmp(argv[i], "--csv") == 0) options.csv = true;
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) options.filter = argv[++i];
+        else if (strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc) options.maxThreads = (unsigned)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--simd") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            for (int level = SIMD_LEVEL::SCALAR; level <= SIMD_LEVEL::AVX2; ++level) {
+                if (strcmp(name, simdLevelName(level)) == 0) options.simdLevel = level;
+            }
+            if (options.simdLevel < 0) { fprintf(stderr, "Unknown SIMD level '%s'\n", name); return 2; }
+        }
+        else {
+            fprintf(stderr, "Usage: expressionEvaluator_bench [--quick] [--csv] [--filter name] [--max-threads n]"
+                " [--simd scalar|swar|sse2|avx2]\n");
+            return 2;
+        }
+    }
+
+    // Compare the scanning kernels by running the same build with each --simd level
+    if (options.simdLevel >= 0 && setSimdLevel(options.simdLevel) != options.simdLevel) {
+        fprintf(stderr, "SIMD level '%s' is not supported here\n", simdLevelName(options.simdLevel));
+        return 2;
+    }
+    if (!options.csv) printf("SIMD level: %s\n", simdLevelName(getSimdLevel()));
+
+    // Every workload has its own fixed seed, so adding one does not change the others
+    size_t scale = options.quick ? 10 : 1;
+    vector<Workload> workloads;
+    { mt19937 random(1); workloads.push_back(makeRealistic(random, 200000 / scale)); }
+    { mt19937 random(2); workloads.push_back(makeLongChains(random, 200 / scale, 5000)); }
+    { mt19937 random(3); workloads.push_back(makeDeepNesting(random, 200 / scale, 1000)); }
+    { mt19937 random(4); workloads.push_back(makeMulDivHeavy(random, 2000 / scale, 500)); }
+    { mt19937 random(5); workloads.push_back(makeWhitespacePadded(random, 200000 / scale)); }
+    { mt19937 random(6); workloads.push_back(makeInvalid(random, 100000 / scale)); }
+    { mt19937 random(7); workloads.push_back(makeTemplated(random, 200000 / scale, 32)); }
+
+    printHeader(options);
+    for (const Workload& workload : workloads) benchWorkload(options, workload);
+
+    // The scaling report uses a mix of short expressions and long chains
+    Workload mixed = workloads[0];
+    mixed.name = "realistic+chains";
+    for (const string& expression : workloads[1].expressions) mixed.expressions.push_back(expression);
+    finishWorkload(mixed);
+    benchBatchScaling(options, mixed);
+
+    // The parallel scaling report uses one expression of a million terms
+    { mt19937 random(8); Workload huge = makeLongChains(random, 1, 1000000 / scale); huge.name = "single_huge_chain"; benchParallelScaling(options, huge); }
+
+    // The fused report evaluates a set of related formulas on every record
+    benchFusedSet(options, 200, 2000 / scale);
+
+    // The columnar report applies a formula to columns of a million rows
+    benchColumnar(options, 1000000 / scale);
+    return 0;
+}
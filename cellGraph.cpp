@@ -0,0 +1,245 @@
+/*
+ * File: cellGraph.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of the cell graph.
+ * Formulas are compiled once with the cell names as variables. A change marks the changed cells
+ * and everything downstream of them, and recompute() then runs those cells in waves: a wave holds
+ * the cells whose inputs are all up to date, so the cells of a wave never read each other.
+ */
+
+// Include necessary headers
+#include "cellGraph.hpp"
+#include "constants.hpp"
+#include "threadPool.hpp"
+#include <algorithm>
+#include <cstring>
+
+// Returns true for a character that may start a cell name
+static inline bool isNameStart(char ch)
+{
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_';
+}
+
+// Returns true for a character that may continue a cell name
+static inline bool isNameChar(char ch)
+{
+    return isNameStart(ch) || (ch >= '0' && ch <= '9');
+}
+
+// Returns true if the text is a valid cell name
+static bool isValidName(const char* name)
+{
+    if (!name || !isNameStart(*name)) return false;
+    while (*++name) {
+        if (!isNameChar(*name)) return false;
+    }
+    return true;
+}
+
+// Returns the index of a cell, creating an undefined cell if there is none with that name
+static int findOrCreateCell(CellGraph& graph, const std::string& name)
+{
+    int index = declareVariable(graph.names, name.c_str());
+    if (index == (int)graph.cells.size()) {
+        graph.cells.emplace_back();
+        graph.cells.back().error = ERROR::UNKNOWN_VARIABLE;
+        graph.values.push_back(0);
+    }
+    return index;
+}
+
+// Collects the names a formula reads, each one once, in the order they first appear
+static void collectNames(const char* formula, std::vector<std::string>& names)
+{
+    const char* ch = formula;
+    while (*ch) {
+        if (isNameStart(*ch)) {
+            const char* start = ch;
+            while (isNameChar(*ch)) ++ch;
+            std::string name(start, ch - start);
+            if (std::find(names.begin(), names.end(), name) == names.end()) names.push_back(name);
+        }
+        else if (isNameChar(*ch)) {
+            // Digits, so that "2x" does not start a name in the middle of "a2x"
+            while (isNameChar(*ch)) ++ch;
+        }
+        else ++ch;
+    }
+}
+
+// Marks a cell and every cell that depends on it, directly or not
+static void markDownstream(const CellGraph& graph, int cell, std::vector<char>& marked)
+{
+    std::vector<int> pending(1, cell);
+    marked.assign(graph.cells.size(), 0);
+    marked[cell] = 1;
+    while (!pending.empty()) {
+        int current = pending.back();
+        pending.pop_back();
+        for (int dependent : graph.cells[current].dependents) {
+            if (!marked[dependent]) {
+                marked[dependent] = 1;
+                pending.push_back(dependent);
+            }
+        }
+    }
+}
+
+// Stops a cell from reading its inputs
+static void detachInputs(CellGraph& graph, int index)
+{
+    Cell& cell = graph.cells[index];
+    for (int input : cell.inputs) {
+        std::vector<int>& dependents = graph.cells[input].dependents;
+        dependents.erase(std::find(dependents.begin(), dependents.end(), index));
+    }
+    cell.inputs.clear();
+}
+
+// Sets the formula of a cell, creating the cell if needed.
+int setFormula(CellGraph& graph, const char* name, const char* formula)
+{
+    if (!isValidName(name) || !formula) return ERROR::INVALID_CHARACTER;
+
+    // A cell that does not exist yet has no dependents, so only reading itself is a cycle
+    std::vector<std::string> names;
+    collectNames(formula, names);
+    int existing = findVariable(graph.names, name, strlen(name));
+    if (existing >= 0) {
+        std::vector<char> downstream;
+        markDownstream(graph, existing, downstream);
+        for (const std::string& input : names) {
+            int index = findVariable(graph.names, input.c_str(), input.size());
+            if (index >= 0 && downstream[index]) return ERROR::CYCLE;
+        }
+    }
+    else if (std::find(names.begin(), names.end(), name) != names.end()) return ERROR::CYCLE;
+
+    // Create the cells first, so that every name of the formula has a slot
+    int index = findOrCreateCell(graph, name);
+    for (const std::string& input : names) findOrCreateCell(graph, input);
+
+    Cell& cell = graph.cells[index];
+    detachInputs(graph, index);
+    cell.formula = formula;
+    cell.defined = true;
+    cell.formulaCell = true;
+    compile(formula, graph.names, cell.program);
+
+    // The inputs are the slots the program actually loads
+    for (const Instruction& ins : cell.program.code) {
+        if (ins.opcode == OPCODE::LOAD && std::find(cell.inputs.begin(), cell.inputs.end(), ins.operand) == cell.inputs.end()) {
+            cell.inputs.push_back(ins.operand);
+            graph.cells[ins.operand].dependents.push_back(index);
+        }
+    }
+    graph.changed.push_back(index);
+    return ERROR::SUCCESS;
+}
+
+// Sets a cell to a plain value, creating the cell if needed.
+int setValue(CellGraph& graph, const char* name, int value)
+{
+    if (!isValidName(name)) return ERROR::INVALID_CHARACTER;
+
+    int index = findOrCreateCell(graph, name);
+    Cell& cell = graph.cells[index];
+    detachInputs(graph, index);
+    cell.formula.clear();
+    cell.program = CompiledExpression();
+    cell.defined = true;
+    cell.formulaCell = false;
+    graph.values[index] = value;
+    graph.changed.push_back(index);
+    return ERROR::SUCCESS;
+}
+
+// Computes the value and error code of a single cell, whose inputs are up to date
+static void computeCell(CellGraph& graph, int index)
+{
+    Cell& cell = graph.cells[index];
+    if (!cell.defined) {
+        cell.error = ERROR::UNKNOWN_VARIABLE;
+        graph.values[index] = 0;
+        return;
+    }
+    if (!cell.formulaCell) {
+        cell.error = ERROR::SUCCESS;
+        return;
+    }
+
+    // An input in error makes the formula fail with the same error code
+    for (int input : cell.inputs) {
+        if (graph.cells[input].error != ERROR::SUCCESS) {
+            cell.error = graph.cells[input].error;
+            graph.values[index] = 0;
+            return;
+        }
+    }
+    cell.error = run(cell.program, graph.values.data(), graph.values[index]);
+}
+
+// Recomputes the cells set since the last call and every cell that depends on them.
+size_t recompute(CellGraph& graph)
+{
+    // Mark the changed cells and everything downstream of them
+    std::vector<char> dirty(graph.cells.size(), 0);
+    std::vector<int> stack, affected;
+    for (int index : graph.changed) {
+        if (!dirty[index]) {
+            dirty[index] = 1;
+            stack.push_back(index);
+        }
+    }
+    graph.changed.clear();
+    while (!stack.empty()) {
+        int current = stack.back();
+        stack.pop_back();
+        affected.push_back(current);
+        for (int dependent : graph.cells[current].dependents) {
+            if (!dirty[dependent]) {
+                dirty[dependent] = 1;
+                stack.push_back(dependent);
+            }
+        }
+    }
+
+    // Count the inputs of every marked cell that still have to be recomputed
+    std::vector<int> pending(graph.cells.size(), 0);
+    std::vector<int> wave, next;
+    for (int index : affected) {
+        for (int input : graph.cells[index].inputs) pending[index] += dirty[input];
+        if (pending[index] == 0) wave.push_back(index);
+    }
+
+    // Recompute wave after wave, the cells of a wave only read cells of earlier waves
+    while (!wave.empty()) {
+        if (wave.size() >= CELL_PARALLEL_MIN && graph.threads != 1) {
+            parallelFor(wave.size(), graph.threads, 64, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) computeCell(graph, wave[i]);
+            });
+        }
+        else {
+            for (int index : wave) computeCell(graph, index);
+        }
+
+        next.clear();
+        for (int index : wave) {
+            for (int dependent : graph.cells[index].dependents) {
+                if (--pending[dependent] == 0) next.push_back(dependent);
+            }
+        }
+        wave.swap(next);
+    }
+    return affected.size();
+}
+
+// Stores the value of a cell in 'value' and returns its error code.
+int getCell(const CellGraph& graph, const char* name, int& value)
+{
+    value = 0;
+    int index = name ? findVariable(graph.names, name, strlen(name)) : -1;
+    if (index < 0) return ERROR::UNKNOWN_VARIABLE;
+    value = graph.values[index];
+    return graph.cells[index].error;
+}
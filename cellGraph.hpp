@@ -0,0 +1,71 @@
+/*
+ * File: cellGraph.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of the cell graph.
+ * A cell is a named expression that may read the values of other cells, like a spreadsheet.
+ * The graph keeps track of which cells read which, so that after a change only the cells that
+ * depend on it are recomputed, in dependency order and optionally in parallel.
+ */
+
+#ifndef CELL_GRAPH_HPP
+#define CELL_GRAPH_HPP
+
+#include "compiledExpression.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Smallest number of independent cells recomputed in parallel.
+// Below it the cells are cheaper to recompute than to hand to the thread pool.
+static const size_t CELL_PARALLEL_MIN = 256;
+
+// A cell of the graph, either a formula or a plain value
+struct Cell
+{
+	std::string formula;          // Text of the formula, empty for a plain value
+	CompiledExpression program;   // The compiled formula, reading other cells by index
+	std::vector<int> inputs;      // Cells the formula reads, in the order they first appear
+	std::vector<int> dependents;  // Cells whose formula reads this one
+	bool defined = false;         // False for a cell that was named by a formula but never set
+	bool formulaCell = false;     // True if the value comes from the formula
+	int error = 0;                // Error code of the last computation (ERROR::SUCCESS if none)
+};
+
+// A graph of cells.
+// The slot of a name in 'names' is the index of its cell, so compiled formulas read the values
+// of their inputs straight from 'values'. The graph never holds a cycle.
+struct CellGraph
+{
+	VariableTable names;         // Cell names, the slot of a name is the index of its cell
+	std::vector<Cell> cells;     // Cells, indexed like 'names'
+	std::vector<int> values;     // Values of the cells, as of the last recompute()
+	std::vector<int> changed;    // Cells set since the last recompute()
+	unsigned threads = 1;        // Threads used by recompute() (0 means one per core)
+};
+
+// Sets the formula of a cell, creating the cell if needed. Names the formula reads that are not
+// cells yet are created as undefined cells. The cell and the cells that depend on it are
+// recomputed by the next recompute().
+// It returns ERROR::INVALID_CHARACTER if the name is not a valid variable name, and ERROR::CYCLE
+// (leaving the graph unchanged) if the cell would end up reading its own value. Errors in the
+// formula itself are not returned here: they become the error code of the cell.
+int setFormula(CellGraph& graph, const char* name, const char* formula);
+
+// Sets a cell to a plain value, creating the cell if needed.
+// It returns ERROR::INVALID_CHARACTER if the name is not a valid variable name.
+int setValue(CellGraph& graph, const char* name, int value);
+
+// Recomputes the cells set since the last call and every cell that depends on them, each one
+// after all of its inputs. Cells whose inputs are all ready are recomputed in parallel when
+// there are at least CELL_PARALLEL_MIN of them and graph.threads is not 1.
+// A formula gives the same error code and value as evaluate() with its inputs written in, except
+// that a formula reading a cell in error takes the error code of that cell and the value 0.
+// A cell that was never set has the error code ERROR::UNKNOWN_VARIABLE.
+// It returns the number of cells recomputed.
+size_t recompute(CellGraph& graph);
+
+// Stores the value of a cell, as of the last recompute(), in 'value' and returns its error code.
+// It returns ERROR::UNKNOWN_VARIABLE if there is no cell with that name.
+int getCell(const CellGraph& graph, const char* name, int& value);
+
+#endif // CELL_GRAPH_HPP
@@ -0,0 +1,331 @@
+/*
+ * File: columnarEvaluator.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of the columnar evaluator.
+ * The stack holds blocks instead of values: an entry is either a constant (PUSH, never written out)
+ * or a pointer to COLUMN_BLOCK values, in a column (LOAD), a temporary or the buffer of its stack
+ * position, so loading a variable copies nothing. The kernels work on vectors of 8 values with the
+ * vector extensions of GCC and Clang, and the block runner is compiled twice, for the baseline
+ * instruction set and for AVX2, picked at run time like the scanning kernels. As in the lanes of the
+ * shape cache, a row that has divided by zero divides by 1 from then on, so it never traps on a value
+ * run() would not have reached.
+ */
+
+// Include necessary headers
+#include "columnarEvaluator.hpp"
+#include "simdKernels.hpp"
+#include "threadPool.hpp"
+#include "constants.hpp"
+#include <cstring>
+#include <vector>
+
+#if defined(__GNUC__) || defined(__clang__)
+// 8 values of 32 bits, aligned like int so a column can start anywhere
+static const size_t COLUMN_WIDTH = 8;
+typedef int ColumnVector __attribute__((vector_size(32), aligned(4)));
+#define COLUMN_INLINE inline __attribute__((always_inline))
+#else
+// Without vector extensions the same code runs one value at a time
+static const size_t COLUMN_WIDTH = 1;
+typedef int ColumnVector;
+#define COLUMN_INLINE inline
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(_M_X64))
+// The block runner compiled with a target attribute, only used when the processor supports AVX2
+#define COLUMN_HAS_AVX2 1
+#define COLUMN_AVX2 __attribute__((target("avx2")))
+#endif
+
+// Vectors in a block
+static const size_t COLUMN_VECTORS = COLUMN_BLOCK / COLUMN_WIDTH;
+
+// A value on the stack of a block
+struct ColumnEntry
+{
+    const ColumnVector* rows; // COLUMN_BLOCK values, unless the entry is a constant
+    int value;                // Value of a constant
+    bool constant;            // Same value in every row
+};
+
+// Buffers of a block runner, kept per thread
+struct ColumnScratch
+{
+    std::vector<int> stack;              // One block per stack position
+    std::vector<int> temps;              // One block per temporary
+    std::vector<int> tail;               // The columns of the last block, padded with ones
+    std::vector<int> failed;             // One value per row, nonzero once it divided by zero
+    std::vector<int> results;            // Results of the last block
+    std::vector<ColumnEntry> entries;    // The stack
+    std::vector<ColumnEntry> tempEntries; // The temporaries
+};
+
+// Fills a block with a value, which turns a constant into rows
+static COLUMN_INLINE void fillBlock(ColumnVector* out, int value)
+{
+    ColumnVector k = {};
+    k += value;
+    for (size_t v = 0; v < COLUMN_VECTORS; ++v) out[v] = k;
+}
+
+// out = -rows
+static COLUMN_INLINE void negateBlock(ColumnVector* out, const ColumnVector* rows)
+{
+    for (size_t v = 0; v < COLUMN_VECTORS; ++v) out[v] = -rows[v];
+}
+
+// out = left OP right for ADD, SUB and MUL, where 'left' is rows and 'right' rows or a constant
+template <int OP>
+static COLUMN_INLINE void arithmeticBlock(ColumnVector* out, const ColumnVector* left, const ColumnEntry& right)
+{
+    if (right.constant) {
+        ColumnVector k = {};
+        k += right.value;
+        for (size_t v = 0; v < COLUMN_VECTORS; ++v) {
+            if (OP == OPCODE::ADD) out[v] = left[v] + k;
+            else if (OP == OPCODE::SUB) out[v] = left[v] - k;
+            else out[v] = left[v] * k;
+        }
+        return;
+    }
+    const ColumnVector* rows = right.rows;
+    for (size_t v = 0; v < COLUMN_VECTORS; ++v) {
+        if (OP == OPCODE::ADD) out[v] = left[v] + rows[v];
+        else if (OP == OPCODE::SUB) out[v] = left[v] - rows[v];
+        else out[v] = left[v] * rows[v];
+    }
+}
+
+// out = left / right, masked: a row whose divisor is 0 is marked in 'failed', and a marked row divides
+// by 1. The mask is computed on whole vectors, the division itself has no vector instruction.
+static COLUMN_INLINE void divideBlock(ColumnVector* out, const ColumnVector* left, const ColumnVector* right, ColumnVector* failed)
+{
+    ColumnVector one = {};
+    one += 1;
+    for (size_t v = 0; v < COLUMN_VECTORS; ++v) {
+        ColumnVector bad = failed[v] | (right[v] == 0);
+        failed[v] = bad;
+        out[v] = left[v] / (bad ? one : right[v]);
+    }
+}
+
+// out = left / k for a constant k other than 0 and -1, which can neither fail nor trap
+static COLUMN_INLINE void divideConstantBlock(ColumnVector* out, const ColumnVector* left, int k)
+{
+    for (size_t v = 0; v < COLUMN_VECTORS; ++v) out[v] = left[v] / k;
+}
+
+// Applies a binary operator to two entries of the stack, the result going into 'left' with its rows in 'out'
+static COLUMN_INLINE void applyBlock(int opcode, ColumnEntry& left, ColumnEntry right, ColumnVector* out, ColumnVector* rightOut, ColumnVector* failed)
+{
+    // Two constants fold, wrapping like int does, unless a division by zero has to mark every row or a
+    // division by -1 could trap in rows that already failed
+    if (left.constant && right.constant && !(opcode == OPCODE::DIV && (right.value == 0 || right.value == -1))) {
+        unsigned a = (unsigned)left.value, b = (unsigned)right.value;
+        if (opcode == OPCODE::ADD) left.value = (int)(a + b);
+        else if (opcode == OPCODE::SUB) left.value = (int)(a - b);
+        else if (opcode == OPCODE::MUL) left.value = (int)(a * b);
+        else left.value = left.value / right.value;
+        return;
+    }
+
+    // A constant on the left becomes rows, a constant divisor that can fail or trap too
+    if (left.constant) {
+        fillBlock(out, left.value);
+        left.rows = out;
+        left.constant = false;
+    }
+    if (opcode == OPCODE::DIV && right.constant && (right.value == 0 || right.value == -1)) {
+        fillBlock(rightOut, right.value);
+        right.rows = rightOut;
+        right.constant = false;
+    }
+
+    if (opcode == OPCODE::ADD) arithmeticBlock<OPCODE::ADD>(out, left.rows, right);
+    else if (opcode == OPCODE::SUB) arithmeticBlock<OPCODE::SUB>(out, left.rows, right);
+    else if (opcode == OPCODE::MUL) arithmeticBlock<OPCODE::MUL>(out, left.rows, right);
+    else if (right.constant) divideConstantBlock(out, left.rows, right.value);
+    else divideBlock(out, left.rows, right.rows, failed);
+    left.rows = out;
+}
+
+// Clears the rows that failed at the first division of a block of 'count' rows. The missing rows of
+// a short block start as failed, so they never trap and are never written.
+static COLUMN_INLINE void startFailedRows(bool& divides, int* failedRows, size_t count)
+{
+    if (divides) return;
+    divides = true;
+    for (size_t i = 0; i < COLUMN_BLOCK; ++i) failedRows[i] = i < count ? 0 : -1;
+}
+
+// Runs the program on the block of 'count' rows starting at row 'first', and returns its error code.
+// A block shorter than COLUMN_BLOCK reads padded copies of its columns.
+static COLUMN_INLINE int runBlockBody(const CompiledExpression& program, const int* const* columns, size_t first, size_t count,
+    ColumnScratch& scratch, int* results, uint64_t* errorBits)
+{
+    ColumnVector* stack = (ColumnVector*)scratch.stack.data();
+    ColumnVector* temps = (ColumnVector*)scratch.temps.data();
+    ColumnVector* failed = (ColumnVector*)scratch.failed.data();
+    ColumnEntry* entries = scratch.entries.data();
+    ColumnEntry* tempEntries = scratch.tempEntries.data();
+    int* failedRows = scratch.failed.data();
+
+    // The columns of the block, padded with ones if it is the last one
+    bool partial = count < COLUMN_BLOCK;
+    if (partial) {
+        for (int s = 0; s < program.variableCount; ++s) {
+            int* tail = scratch.tail.data() + (size_t)s * COLUMN_BLOCK;
+            memcpy(tail, columns[s] + first, count * sizeof(int));
+            for (size_t i = count; i < COLUMN_BLOCK; ++i) tail[i] = 1;
+        }
+    }
+
+    // 'top' is the number of entries on the stack. The rows that failed are only tracked from the first
+    // division on, a block that never divides has no row to mask.
+    int top = 0;
+    bool divides = false;
+    int errorCode = ERROR::SUCCESS;
+    const ColumnEntry* result = 0;
+    for (const Instruction& ins : program.code) {
+        switch (ins.opcode) {
+        case OPCODE::PUSH: entries[top++] = { 0, ins.operand, true }; continue;
+        case OPCODE::LOAD: {
+            const int* rows = partial ? scratch.tail.data() + (size_t)ins.operand * COLUMN_BLOCK : columns[ins.operand] + first;
+            entries[top++] = { (const ColumnVector*)rows, 0, false };
+            continue;
+        }
+        case OPCODE::NEG: {
+            ColumnEntry& entry = entries[top - 1];
+            if (entry.constant) { entry.value = (int)(0u - (unsigned)entry.value); continue; }
+            ColumnVector* out = stack + (size_t)(top - 1) * COLUMN_VECTORS;
+            negateBlock(out, entry.rows);
+            entry.rows = out;
+            continue;
+        }
+        case OPCODE::ADD:
+        case OPCODE::SUB:
+        case OPCODE::MUL:
+        case OPCODE::DIV:
+            if (ins.opcode == OPCODE::DIV) startFailedRows(divides, failedRows, count);
+            top--;
+            applyBlock(ins.opcode, entries[top - 1], entries[top], stack + (size_t)(top - 1) * COLUMN_VECTORS,
+                stack + (size_t)top * COLUMN_VECTORS, failed);
+            continue;
+        case OPCODE::MULK:
+        case OPCODE::DIVK:
+            // The right-hand value stays on top, see parse()
+            if (ins.opcode == OPCODE::DIVK) startFailedRows(divides, failedRows, count);
+            applyBlock(ins.opcode == OPCODE::MULK ? OPCODE::MUL : OPCODE::DIV, entries[top - 2], entries[top - 1],
+                stack + (size_t)(top - 2) * COLUMN_VECTORS, stack + (size_t)(top - 1) * COLUMN_VECTORS, failed);
+            continue;
+        case OPCODE::STORE: {
+            // Every temporary is stored once, entries can point to it for the rest of the block
+            ColumnEntry entry = entries[top - 1];
+            if (!entry.constant) {
+                ColumnVector* out = temps + (size_t)ins.operand * COLUMN_VECTORS;
+                memcpy(out, entry.rows, COLUMN_BLOCK * sizeof(int));
+                entry.rows = out;
+            }
+            tempEntries[ins.operand] = entry;
+            continue;
+        }
+        case OPCODE::LOADT: entries[top++] = tempEntries[ins.operand]; continue;
+        case OPCODE::RETURN: result = &entries[top - 1]; errorCode = ins.operand; break;
+        case OPCODE::FAIL: errorCode = ins.operand; break;
+        }
+        break;
+    }
+
+    // Results, 0 for the rows that failed and for every row of a program that fails
+    int* out = partial ? scratch.results.data() : results + first;
+    ColumnVector* outRows = (ColumnVector*)out;
+    ColumnVector zero = {};
+    if (result && result->constant) {
+        ColumnVector k = zero + result->value;
+        if (divides) for (size_t v = 0; v < COLUMN_VECTORS; ++v) outRows[v] = failed[v] ? zero : k;
+        else for (size_t v = 0; v < COLUMN_VECTORS; ++v) outRows[v] = k;
+    }
+    else if (result) {
+        if (divides) for (size_t v = 0; v < COLUMN_VECTORS; ++v) outRows[v] = failed[v] ? zero : result->rows[v];
+        else memcpy(outRows, result->rows, COLUMN_BLOCK * sizeof(int));
+    }
+    else {
+        for (size_t v = 0; v < COLUMN_VECTORS; ++v) outRows[v] = zero;
+    }
+    if (partial) memcpy(results + first, out, count * sizeof(int));
+
+    // The error bitmap of the block, one word per 64 rows
+    for (size_t w = 0; w * 64 < count; ++w) {
+        uint64_t word = 0;
+        size_t rows = count - w * 64 < 64 ? count - w * 64 : 64;
+        if (divides) {
+            for (size_t i = 0; i < rows; ++i) word |= (uint64_t)(failedRows[w * 64 + i] != 0) << i;
+        }
+        errorBits[first / 64 + w] = word;
+    }
+    return errorCode;
+}
+
+// The block runner for the baseline instruction set
+static int runBlock(const CompiledExpression& program, const int* const* columns, size_t first, size_t count,
+    ColumnScratch& scratch, int* results, uint64_t* errorBits)
+{
+    return runBlockBody(program, columns, first, count, scratch, results, errorBits);
+}
+
+#ifdef COLUMN_HAS_AVX2
+// The block runner for AVX2, the same code on 8 values per instruction
+COLUMN_AVX2 static int runBlockAvx2(const CompiledExpression& program, const int* const* columns, size_t first, size_t count,
+    ColumnScratch& scratch, int* results, uint64_t* errorBits)
+{
+    return runBlockBody(program, columns, first, count, scratch, results, errorBits);
+}
+#endif
+
+// Evaluates the program over columns of variable values.
+int runColumns(const CompiledExpression& program, const int* const* columns, size_t rows, int* results, uint64_t* errorBits, unsigned threads)
+{
+    // The error code of a program depends only on its text, the one it stops with
+    int errorCode = ERROR::SUCCESS;
+    for (const Instruction& ins : program.code) {
+        if (ins.opcode == OPCODE::RETURN || ins.opcode == OPCODE::FAIL) { errorCode = ins.operand; break; }
+    }
+    if (rows == 0) return errorCode;
+
+#ifdef COLUMN_HAS_AVX2
+    bool avx2 = getSimdLevel() == SIMD_LEVEL::AVX2;
+#endif
+    size_t blocks = (rows + COLUMN_BLOCK - 1) / COLUMN_BLOCK;
+    parallelFor(blocks, threads, 1, [&](size_t begin, size_t end) {
+        thread_local ColumnScratch scratch;
+        scratch.stack.resize((size_t)(program.maxStack + 1) * COLUMN_BLOCK);
+        scratch.temps.resize((size_t)program.tempCount * COLUMN_BLOCK);
+        scratch.tail.resize((size_t)program.variableCount * COLUMN_BLOCK);
+        scratch.failed.resize(COLUMN_BLOCK);
+        scratch.results.resize(COLUMN_BLOCK);
+        scratch.entries.resize((size_t)program.maxStack + 1);
+        scratch.tempEntries.resize((size_t)program.tempCount + 1);
+
+        for (size_t b = begin; b < end; ++b) {
+            size_t first = b * COLUMN_BLOCK;
+            size_t count = rows - first < COLUMN_BLOCK ? rows - first : COLUMN_BLOCK;
+#ifdef COLUMN_HAS_AVX2
+            if (avx2) { runBlockAvx2(program, columns, first, count, scratch, results, errorBits); continue; }
+#endif
+            runBlock(program, columns, first, count, scratch, results, errorBits);
+        }
+    });
+    return errorCode;
+}
+
+// Counts the rows marked in the error bitmap.
+size_t countFailedRows(const uint64_t* errorBits, size_t rows)
+{
+    size_t failed = 0;
+    for (size_t w = 0; w < columnBitmapWords(rows); ++w) {
+        uint64_t word = errorBits[w];
+        if (rows - w * 64 < 64) word &= (1ull << (rows - w * 64)) - 1;
+        for (; word; word &= word - 1) ++failed;
+    }
+    return failed;
+}
@@ -0,0 +1,47 @@
+/*
+ * File: columnarEvaluator.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of the columnar evaluator.
+ * A compiled expression is run over whole columns of variable values (one array per variable, the
+ * structure of arrays layout) instead of one row at a time. The rows are taken COLUMN_BLOCK at a time,
+ * and every instruction of the program is one vectorized loop over the block. A division by zero only
+ * fails its own rows, which are marked in a bitmap, and the other rows of the block go on.
+ */
+
+#ifndef COLUMNAR_EVALUATOR_HPP
+#define COLUMNAR_EVALUATOR_HPP
+
+#include "compiledExpression.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Rows evaluated together. Every value on the stack of a block takes 4 KB, so the stack of a usual
+// formula stays in the level 1 or level 2 cache. A multiple of 64, so every block owns whole words
+// of the error bitmap.
+static const size_t COLUMN_BLOCK = 1024;
+
+// Returns the number of 64 bit words in the error bitmap of 'rows' rows
+static inline size_t columnBitmapWords(size_t rows)
+{
+	return (rows + 63) / 64;
+}
+
+// Returns true if the row is marked in the error bitmap, which means it divided by zero
+static inline bool columnRowFailed(const uint64_t* errorBits, size_t row)
+{
+	return (errorBits[row / 64] >> (row % 64)) & 1;
+}
+
+// Evaluates the program once per row. Variable slot s of row r is columns[s][r], so 'columns' holds
+// program.variableCount arrays of 'rows' values. The rows are spread over up to 'threads' threads
+// (0 means one per core), COLUMN_BLOCK rows at a time.
+// It returns the error code shared by every row that did not divide by zero, which depends only on the
+// text: ERROR::SUCCESS, ERROR::PARSE_ERROR (with a result, like evaluate()) or an error without one.
+// A row that divided by zero gets its bit set in 'errorBits' (columnBitmapWords(rows) words) and a
+// result of 0, so each row gets exactly the error code and result run() gives with its values.
+int runColumns(const CompiledExpression& program, const int* const* columns, size_t rows, int* results, uint64_t* errorBits, unsigned threads = 1);
+
+// Returns the number of rows marked in the error bitmap of 'rows' rows
+size_t countFailedRows(const uint64_t* errorBits, size_t rows);
+
+#endif // COLUMNAR_EVALUATOR_HPP
@@ -0,0 +1,355 @@
+/*
+ * File: compiledExpression.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of the compiled expression API.
+ * The compiler mirrors parse(), parseNext() and parseParen() step by step, but instead of
+ * computing values it emits instructions. The interpreter in run() then replays those steps.
+ */
+
+// Include necessary headers
+#include "compiledExpression.hpp"
+#include "expressionEvaluator.hpp"
+#include "constants.hpp"
+#include "simdKernels.hpp"
+#include <cstring>
+
+// Size of the value stack kept on the native stack by run().
+// Deeper programs (heavily nested parentheses) use a per-thread buffer instead.
+static const int LOCAL_STACK_SIZE = 64;
+
+// State shared by the compile functions below
+struct CompileState
+{
+    CompiledExpression& program;     // Program being written
+    const VariableTable* variables;  // Known variables, or null when names are not allowed
+    int depth;                       // Current depth of the value stack
+};
+
+// Returns true for a character that may start a variable name
+static inline bool isNameStart(char ch)
+{
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_';
+}
+
+// Returns true for a character that may continue a variable name
+static inline bool isNameChar(char ch)
+{
+    return isNameStart(ch) || (ch >= '0' && ch <= '9');
+}
+
+// Declares a variable and returns its slot.
+int declareVariable(VariableTable& variables, const char* name)
+{
+    int slot = findVariable(variables, name, strlen(name));
+    if (slot >= 0) return slot;
+
+    // New names get the next free slot
+    slot = (int)variables.names.size();
+    variables.names.push_back(name);
+    variables.slots.emplace(name, slot);
+    return slot;
+}
+
+// Returns the slot of a variable, or -1 if the name was not declared.
+int findVariable(const VariableTable& variables, const char* name, size_t length)
+{
+    // The key is reused, so looking up a long name does not allocate every time
+    static thread_local std::string key;
+    key.assign(name, length);
+    auto it = variables.slots.find(key);
+    return it == variables.slots.end() ? -1 : it->second;
+}
+
+// Checks the expression like isValidExpression() does, but also accepts variable names.
+// A name counts as a single number, whatever its length.
+static int isValidWithVariables(const char* expression)
+{
+    int openParenCount = 0, closeParenCount = 0, numCount = 0, operatorCount = 0;
+    const char* ch = expression;
+    while (*ch) {
+        if (*ch >= '0' && *ch <= '9') { numCount++; ch++; continue; }
+        if (isNameStart(*ch)) {
+            numCount++;
+            while (isNameChar(*ch)) ch++;
+            continue;
+        }
+        switch (*ch) {
+        case '+':
+        case '-':
+        case '*':
+        case '/':
+            operatorCount++;
+            [[fallthrough]];
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+        case '\f':
+        case '\v':
+            ch++;
+            continue;
+        case '(':
+            openParenCount++;
+            ch++;
+            continue;
+        case ')':
+            closeParenCount++;
+            if (closeParenCount > openParenCount) return ERROR::UNMATCHED_PAREN;
+            ch++;
+            continue;
+        default:
+            return ERROR::INVALID_CHARACTER;
+        }
+    }
+
+    if (openParenCount != closeParenCount) return ERROR::UNMATCHED_PAREN;
+    else if (numCount == 0) return ERROR::NO_NUM;
+    else if (operatorCount == 0 && numCount > 1) return ERROR::NO_OPERATOR;
+    return ERROR::SUCCESS;
+}
+
+// Appends an instruction to the program and keeps track of the stack depth it needs.
+// 'stackChange' is the number of values the instruction adds to (or removes from) the stack.
+static void emit(CompileState& state, int opcode, int operand, int stackChange)
+{
+    state.program.code.push_back({ opcode, operand });
+    state.depth += stackChange;
+    if (state.depth > state.program.maxStack) state.program.maxStack = state.depth;
+}
+
+// Emits a FAIL instruction and returns the error code so callers can simply propagate it.
+static int emitFail(CompileState& state, int errorCode)
+{
+    emit(state, OPCODE::FAIL, errorCode, 0);
+    return errorCode;
+}
+
+static int compileParse(const char*& expression, CompileState& state);
+
+// Compiles a parenthesis in the expression, see parseParen().
+static int compileParen(int sign, const char*& expression, CompileState& state)
+{
+    // Move past the opening parenthesis
+    ++expression;
+
+    // Compile the expression inside the parentheses, its value ends up on top of the stack
+    int err = compileParse(expression, state);
+    if (err) return err;
+
+    // Skip any spaces after the expression inside parentheses
+    skipSpaces(expression);
+
+    // Ensure the next character is a closing parenthesis
+    if (*expression != ')') return emitFail(state, ERROR::MISSING_PAREN);
+
+    // Move past the closing parenthesis
+    ++expression;
+
+    // Apply the sign to the value on top of the stack
+    if (sign < 0) emit(state, OPCODE::NEG, 0, 0);
+
+    return ERROR::SUCCESS;
+}
+
+// Compiles the next number, variable or parenthesis in the expression, see parseNext().
+static int compileNext(const char*& expression, CompileState& state)
+{
+    // Skip any leading spaces
+    skipSpaces(expression);
+
+    int sign = 1; // Default sign is positive
+    if (*expression == '-') { sign = -1; ++expression; skipSpaces(expression); } // Handle negative sign
+
+    if (*expression == '(') return compileParen(sign, expression, state);
+    else if (*expression == ')') return emitFail(state, ERROR::UNMATCHED_PAREN);
+    else if (state.variables && isNameStart(*expression)) {
+        // Resolve the name to its slot once, here
+        const char* name = expression;
+        while (isNameChar(*expression)) ++expression;
+        int slot = findVariable(*state.variables, name, expression - name);
+        if (slot < 0) return emitFail(state, ERROR::UNKNOWN_VARIABLE);
+
+        emit(state, OPCODE::LOAD, slot, 1);
+        if (sign < 0) emit(state, OPCODE::NEG, 0, 0);
+    }
+    else if (*expression < '0' || *expression > '9') return emitFail(state, ERROR::INVALID_CHARACTER);
+    else {
+        // Parse the number exactly like parseNext() does, so overflow behaves the same way
+        int val = parseDigits(expression);
+
+        // The sign of a literal is folded into the pushed value
+        emit(state, OPCODE::PUSH, sign * val, 1);
+    }
+
+    // After the number, skip any spaces
+    skipSpaces(expression);
+
+    return ERROR::SUCCESS;
+}
+
+// Compiles an expression, see parse().
+// The value of the expression ends up on top of the stack.
+static int compileParse(const char*& expression, CompileState& state)
+{
+    // Skip any leading spaces
+    skipSpaces(expression);
+
+    // Compile the left-hand side of the expression
+    int errorCode = compileNext(expression, state);
+    if (errorCode) return errorCode;
+
+    while (true) {
+
+        // Skip spaces before the operator
+        skipSpaces(expression);
+        char operation = *expression;
+
+        // If the next operation is not a valid operator, we break out of the loop
+        if (operation != '*' && operation != '/' && operation != '+' && operation != '-') break;
+        ++expression;
+
+        // Compile the right-hand side of the expression
+        errorCode = compileNext(expression, state);
+        if (errorCode) return errorCode;
+
+        // Multiplication and division chains, see parse().
+        // When the chain is followed by '+' or '-', parse() applies that operator to the last
+        // right-hand value once more, so the last step of such a chain keeps it on the stack.
+        while (operation == '*' || operation == '/') {
+            skipSpaces(expression);
+            char next = *expression;
+            bool keep = (next == '+' || next == '-');
+
+            if (operation == '*') emit(state, keep ? OPCODE::MULK : OPCODE::MUL, 0, keep ? 0 : -1);
+            else emit(state, keep ? OPCODE::DIVK : OPCODE::DIV, 0, keep ? 0 : -1);
+
+            operation = next;
+            if (operation != '*' && operation != '/') break;
+            ++expression;
+
+            errorCode = compileNext(expression, state);
+            if (errorCode) return errorCode;
+        }
+
+        // Now we handle addition and subtraction
+        if (operation == '+') emit(state, OPCODE::ADD, 0, -1);
+        else if (operation == '-') emit(state, OPCODE::SUB, 0, -1);
+    }
+
+    return ERROR::SUCCESS;
+}
+
+// Compiles the expression, with or without variables.
+static int compileExpression(const char* expression, const VariableTable* variables, CompiledExpression& program)
+{
+    // Reuse the storage of a previous compilation
+    program.code.clear();
+    program.maxStack = 0;
+    program.tempCount = 0;
+    program.variableCount = variables ? (int)variables->names.size() : 0;
+    CompileState state = { program, variables, 0 };
+
+    // A missing expression behaves like an empty one
+    if (expression == 0) expression = "";
+
+    // The same validation evaluate() runs before parsing
+    int errorCode = ERROR::SUCCESS;
+    if (*expression) errorCode = variables ? isValidWithVariables(expression) : isValidExpression(expression);
+    if (errorCode != ERROR::SUCCESS) {
+        program.errorCode = emitFail(state, errorCode);
+        return errorCode;
+    }
+
+    // Compile the expression, on error the FAIL instruction has already been emitted
+    const char* exprPtr = expression;
+    errorCode = compileParse(exprPtr, state);
+    if (errorCode != ERROR::SUCCESS) {
+        program.errorCode = errorCode;
+        return errorCode;
+    }
+
+    // Like evaluate(), anything left after the expression is an error, but the result is still stored
+    errorCode = (*exprPtr != '\0') ? ERROR::PARSE_ERROR : ERROR::SUCCESS;
+    emit(state, OPCODE::RETURN, errorCode, -1);
+    program.errorCode = errorCode;
+    return errorCode;
+}
+
+// Compiles the expression into a flat program.
+int compile(const char* expression, CompiledExpression& program)
+{
+    return compileExpression(expression, 0, program);
+}
+
+// Compiles an expression that may use the variables in the table.
+int compile(const char* expression, const VariableTable& variables, CompiledExpression& program)
+{
+    return compileExpression(expression, &variables, program);
+}
+
+// Runs a compiled program and stores the value in 'result'.
+int run(const CompiledExpression& program, int& result)
+{
+    return run(program, 0, result);
+}
+
+// Runs a compiled program reading the variables from 'values'.
+int run(const CompiledExpression& program, const int* values, int& result)
+{
+    return runCode(program.code.data(), program.code.size(), program.maxStack, program.tempCount, values, result);
+}
+
+// Runs a program stored anywhere in memory.
+int runCode(const Instruction* code, size_t count, int maxStack, int tempCount, const int* values, int& result)
+{
+    // Initialize the result to 0, like evaluate()
+    result = 0;
+
+    // Pick a stack large enough for the program
+    static thread_local std::vector<int> deepStack;
+    int localStack[LOCAL_STACK_SIZE];
+    int* stack = localStack;
+    if (maxStack > LOCAL_STACK_SIZE) {
+        if ((int)deepStack.size() < maxStack) deepStack.resize(maxStack);
+        stack = deepStack.data();
+    }
+
+    // Same for the temporaries of optimized programs
+    static thread_local std::vector<int> deepTemps;
+    int localTemps[LOCAL_STACK_SIZE];
+    int* temps = localTemps;
+    if (tempCount > LOCAL_STACK_SIZE) {
+        if ((int)deepTemps.size() < tempCount) deepTemps.resize(tempCount);
+        temps = deepTemps.data();
+    }
+
+    // 'top' points one past the last value on the stack
+    int* top = stack;
+    for (const Instruction* end = code + count; code != end; ++code) {
+        const Instruction& ins = *code;
+        switch (ins.opcode) {
+        case OPCODE::PUSH: *top++ = ins.operand; break;
+        case OPCODE::LOAD: *top++ = values[ins.operand]; break;
+        case OPCODE::NEG: top[-1] = -top[-1]; break;
+        case OPCODE::ADD: --top; top[-1] += top[0]; break;
+        case OPCODE::SUB: --top; top[-1] -= top[0]; break;
+        case OPCODE::MUL: --top; top[-1] *= top[0]; break;
+        case OPCODE::DIV:
+            if (top[-1] == 0) return ERROR::DIV_BY_ZERO; // Division by zero error
+            --top; top[-1] /= top[0];
+            break;
+        case OPCODE::MULK: top[-2] *= top[-1]; break;
+        case OPCODE::DIVK:
+            if (top[-1] == 0) return ERROR::DIV_BY_ZERO; // Division by zero error
+            top[-2] /= top[-1];
+            break;
+        case OPCODE::STORE: temps[ins.operand] = top[-1]; break;
+        case OPCODE::LOADT: *top++ = temps[ins.operand]; break;
+        case OPCODE::RETURN: result = top[-1]; return ins.operand;
+        case OPCODE::FAIL: return ins.operand;
+        }
+    }
+
+    // A well formed program never gets here
+    return ERROR::PARSE_ERROR;
+}
@@ -0,0 +1,96 @@
+/*
+ * File: compiledExpression.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of the compiled expression API.
+ * An expression string is compiled once into a flat postfix program that can then be
+ * run many times without inspecting a single character of the original text.
+ */
+
+#ifndef COMPILED_EXPRESSION_HPP
+#define COMPILED_EXPRESSION_HPP
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Operation codes used by the compiled program.
+// The program is executed on a small value stack, in the same left to right order as parse().
+namespace OPCODE
+{
+	static const int PUSH = 0;  // Push the operand onto the stack
+	static const int NEG = 1;   // Negate the top of the stack (signed parenthesis)
+	static const int ADD = 2;   // Pop right and left, push left + right
+	static const int SUB = 3;   // Pop right and left, push left - right
+	static const int MUL = 4;   // Pop right and left, push left * right
+	static const int DIV = 5;   // Pop right and left, push left / right (fails on zero)
+	static const int MULK = 6;  // Like MUL, but keeps right on top of the product (see parse())
+	static const int DIVK = 7;  // Like DIV, but keeps right on top of the quotient (see parse())
+	static const int RETURN = 8; // Pop the result, store it and return the operand as the error code
+	static const int FAIL = 9;   // Return the operand as the error code without storing a result
+	static const int LOAD = 10;  // Push the value of the variable in the operand slot
+	static const int STORE = 11; // Copy the top of the stack into the operand temporary, without popping it
+	static const int LOADT = 12; // Push the value of the operand temporary
+}
+
+// A single instruction of the compiled program.
+// Both fields are plain 32 bit integers so the program can be copied around as raw memory.
+struct Instruction
+{
+	int opcode;  // One of the OPCODE constants
+	int operand; // Literal for PUSH, slot for LOAD, temporary for STORE and LOADT, error code for RETURN and FAIL
+};
+
+// A compiled expression.
+// The program always ends with a RETURN or FAIL instruction.
+struct CompiledExpression
+{
+	std::vector<Instruction> code; // Flat postfix program
+	int maxStack = 0;              // Deepest value stack the program needs
+	int variableCount = 0;         // Number of variable slots the program may read
+	int tempCount = 0;             // Number of temporaries the program uses (see optimize())
+	int errorCode = 0;             // Error found while compiling (ERROR::SUCCESS if none)
+};
+
+// Variable names known to the compiler.
+// A name is an ASCII letter or '_' followed by letters, digits or '_'.
+// Each name is given an integer slot when it is declared, and compiled programs read the
+// value of a variable from that slot of the values array passed to run().
+struct VariableTable
+{
+	std::vector<std::string> names;             // Names, indexed by slot
+	std::unordered_map<std::string, int> slots; // Slot of each name
+};
+
+// Declares a variable and returns its slot.
+// Declaring a name twice returns the slot it already has.
+int declareVariable(VariableTable& variables, const char* name);
+
+// Returns the slot of a variable, or -1 if the name was not declared.
+int findVariable(const VariableTable& variables, const char* name, size_t length);
+
+// Compiles the expression into a flat program.
+// It returns the error found at compile time (ERROR::SUCCESS if the expression is well formed).
+// Even when an error is returned the program is valid: running it reproduces exactly what
+// evaluate() returns, including a division by zero that happens before a syntax error.
+int compile(const char* expression, CompiledExpression& program);
+
+// Compiles an expression that may use the variables in the table.
+// Names are resolved to slots here, so running the program never looks a name up.
+// A name that is not in the table is reported as ERROR::UNKNOWN_VARIABLE.
+int compile(const char* expression, const VariableTable& variables, CompiledExpression& program);
+
+// Runs a compiled program and stores the value in 'result'.
+// It returns the same error code and result that evaluate() returns for the compiled text.
+int run(const CompiledExpression& program, int& result);
+
+// Runs a compiled program reading the variables from 'values', indexed by slot.
+// 'values' must hold at least program.variableCount values, binding a new row is a pointer swap.
+int run(const CompiledExpression& program, const int* values, int& result);
+
+// Runs a program stored anywhere in memory, for example in a mapped file (see programFile.hpp):
+// 'count' instructions at 'code', needing 'maxStack' values on the stack and 'tempCount' temporaries.
+// The program must be well formed, run() calls it with the storage of a CompiledExpression.
+int runCode(const Instruction* code, size_t count, int maxStack, int tempCount, const int* values, int& result);
+
+#endif // COMPILED_EXPRESSION_HPP
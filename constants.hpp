@@ -6,7 +6,6 @@
 
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
-#endif
 
  // Constants for error codes used in the expression evaluator
 namespace ERROR
@@ -19,4 +18,12 @@ namespace ERROR
 	static const int MISSING_PAREN = 5; // Error code for missing closing parenthesis
 	static const int NO_NUM = 6; // Error code for no numbers found in the expression
 	static const int NO_OPERATOR = 7; // Error code for no operators found in the expressio
-}
\ No newline at end of file
+	static const int UNKNOWN_VARIABLE = 8; // Error code for a variable name that was not declared
+	static const int DEPTH_EXCEEDED = 9; // Error code for parentheses nested deeper than the allowed depth
+	static const int CYCLE = 10; // Error code for a cell that would depend on itself
+	static const int VALUE_OVERFLOW = 11; // Error code for a number or operation out of range of the value type (see numericEvaluator.hpp)
+	static const int BUDGET_EXCEEDED = 12; // Error code for an expression longer or costlier than its budget (see expressionBudget.hpp)
+	static const int DEADLINE_EXCEEDED = 13; // Error code for an evaluation still running at its deadline
+}
+
+#endif // CONSTANTS_H
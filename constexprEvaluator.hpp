@@ -0,0 +1,208 @@
+/*
+ * File: constexprEvaluator.hpp
+ * Author: Alex Turner
+ * Description: This file contains the compile-time version of the expression evaluator.
+ * evaluateConstant() can run inside a constant expression, so expressions written in the source
+ * are folded by the compiler, and CONSTANT_EXPRESSION() stops the build when one is invalid.
+ * It gives the same error codes and results as evaluate() on a buffer (see expressionEvaluator.hpp).
+ * It works like the iterative evaluator, since the compiler limits recursion in constant expressions.
+ */
+
+#ifndef CONSTEXPR_EVALUATOR_HPP
+#define CONSTEXPR_EVALUATOR_HPP
+
+#include "constants.hpp"
+#include "iterativeEvaluator.hpp"
+#include <cstddef>
+#include <string_view>
+
+// Nesting depth of a compile-time expression, deeper ones give ERROR::DEPTH_EXCEEDED
+static const int CONSTEXPR_MAX_DEPTH = 256;
+
+// Error code and result of an evaluation
+struct EvaluationResult
+{
+	int value; // Result, set like evaluate() sets it
+	int error; // One of the ERROR constants
+};
+
+// Wrapping integer arithmetic: signed overflow is not allowed in a constant expression,
+// and this is what evaluate() does at run time on every platform we build for
+constexpr int constantWrapAdd(int a, int b) { return (int)((unsigned)a + (unsigned)b); }
+constexpr int constantWrapSub(int a, int b) { return (int)((unsigned)a - (unsigned)b); }
+constexpr int constantWrapMul(int a, int b) { return (int)((unsigned)a * (unsigned)b); }
+
+// Returns the character at 'pos', or '\0' at the end of the text, like a NUL terminated string
+constexpr char constantPeek(std::string_view text, size_t pos)
+{
+	return pos < text.size() ? text[pos] : '\0';
+}
+
+// Returns true for the whitespace characters accepted by skipSpaces()
+constexpr bool constantIsSpace(char ch)
+{
+	return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\f' || ch == '\v';
+}
+
+// Skips spaces, see skipSpaces()
+constexpr void constantSkipSpaces(std::string_view text, size_t& pos)
+{
+	while (pos < text.size() && constantIsSpace(text[pos])) ++pos;
+}
+
+// The checks of isValidExpression() on the whole text. A NUL character is invalid.
+constexpr int constantValidate(std::string_view text)
+{
+	int openParenCount = 0, closeParenCount = 0, numCount = 0, operatorCount = 0;
+	for (char ch : text) {
+		if (ch >= '0' && ch <= '9') numCount++;
+		else if (ch == '+' || ch == '-' || ch == '*' || ch == '/') operatorCount++;
+		else if (ch == '(') openParenCount++;
+		else if (ch == ')') {
+			closeParenCount++;
+			if (closeParenCount > openParenCount) return ERROR::UNMATCHED_PAREN;
+		}
+		else if (!constantIsSpace(ch)) return ERROR::INVALID_CHARACTER;
+	}
+
+	if (openParenCount != closeParenCount) return ERROR::UNMATCHED_PAREN;
+	else if (numCount == 0) return ERROR::NO_NUM;
+	else if (operatorCount == 0 && numCount > 1) return ERROR::NO_OPERATOR;
+	return ERROR::SUCCESS;
+}
+
+// Parses the text from 'pos' like parseIterative() does, with the frames in a fixed array.
+constexpr int constantParse(std::string_view text, size_t& pos, int& result)
+{
+	ParseFrame frames[CONSTEXPR_MAX_DEPTH] = {};
+	int depth = 0;
+
+	// The innermost level
+	int levelSign = 1, left = 0, right = 0;
+	char operation = 0;
+	bool haveLeft = false;
+
+	while (true) {
+		// Parse the next operand, like parseNext()
+		constantSkipSpaces(text, pos);
+		int sign = 1;
+		if (constantPeek(text, pos) == '-') { sign = -1; ++pos; constantSkipSpaces(text, pos); }
+
+		char ch = constantPeek(text, pos);
+		if (ch == '(') {
+			// Open a new level
+			if (depth >= CONSTEXPR_MAX_DEPTH) return ERROR::DEPTH_EXCEEDED;
+			++pos;
+			frames[depth++] = { levelSign, left, right, operation, (char)haveLeft };
+			levelSign = sign;
+			haveLeft = false;
+			continue;
+		}
+		else if (ch == ')') return ERROR::UNMATCHED_PAREN;
+		else if (ch < '0' || ch > '9') return ERROR::INVALID_CHARACTER;
+
+		// Parse the number
+		int val = 0;
+		while (constantPeek(text, pos) >= '0' && constantPeek(text, pos) <= '9') {
+			val = constantWrapAdd(constantWrapMul(val, 10), text[pos++] - '0');
+		}
+		int value = constantWrapMul(sign, val);
+		constantSkipSpaces(text, pos);
+
+		// Hand the value to the innermost level, closing every level that is finished
+		while (true) {
+			bool needOperand = false;
+			if (!haveLeft) { left = value; haveLeft = true; }
+			else {
+				right = value;
+
+				// One step of a multiplication and division chain
+				if (operation == '*' || operation == '/') {
+					if (operation == '*') left = constantWrapMul(left, right);
+					else {
+						if (right == 0) return ERROR::DIV_BY_ZERO;
+						left /= right;
+					}
+					constantSkipSpaces(text, pos);
+					operation = constantPeek(text, pos);
+					if (operation == '*' || operation == '/') { ++pos; needOperand = true; }
+				}
+
+				// Addition and subtraction, with the operator that ended the chain if there was one
+				if (!needOperand) {
+					if (operation == '+') left = constantWrapAdd(left, right);
+					else if (operation == '-') left = constantWrapSub(left, right);
+				}
+			}
+			if (needOperand) break;
+
+			// Look for the next operator of the level
+			constantSkipSpaces(text, pos);
+			char next = constantPeek(text, pos);
+			if (next == '*' || next == '/' || next == '+' || next == '-') {
+				++pos;
+				operation = next;
+				break;
+			}
+
+			// The level is finished, the outermost one is the whole expression
+			if (depth == 0) {
+				result = left;
+				return ERROR::SUCCESS;
+			}
+
+			// Close the parenthesis and go back to the level around it
+			constantSkipSpaces(text, pos);
+			if (constantPeek(text, pos) != ')') return ERROR::MISSING_PAREN;
+			++pos;
+			value = constantWrapMul(levelSign, left);
+			const ParseFrame& outer = frames[--depth];
+			levelSign = outer.sign;
+			left = outer.left;
+			right = outer.right;
+			operation = outer.operation;
+			haveLeft = outer.phase != 0;
+		}
+	}
+}
+
+// Evaluates an expression, at compile time when used in a constant expression.
+// The error code and the result are the same as evaluate(std::string_view, int&).
+constexpr EvaluationResult evaluateConstant(std::string_view expression)
+{
+	// An empty expression skips validation in evaluate() and fails in parseNext()
+	if (expression.empty()) return { 0, ERROR::INVALID_CHARACTER };
+
+	// Validation errors come first, like in evaluate()
+	int error = constantValidate(expression);
+	if (error != ERROR::SUCCESS) return { 0, error };
+
+	size_t pos = 0;
+	int value = 0;
+	error = constantParse(expression, pos, value);
+	if (error != ERROR::SUCCESS) return { 0, error };
+
+	// Characters left after the expression are an error, but the result is still stored
+	if (pos != expression.size()) return { value, ERROR::PARSE_ERROR };
+	return { value, ERROR::SUCCESS };
+}
+
+// User-defined literal: "1 + 2"_expr is the EvaluationResult of the expression
+constexpr EvaluationResult operator""_expr(const char* text, size_t length)
+{
+	return evaluateConstant(std::string_view(text, length));
+}
+
+// The value of an expression that must be valid. An invalid expression fails the static_assert,
+// and the compiler names the error code in the instantiation, e.g. CheckedExpression<0, 4>.
+template <int Value, int Error>
+struct CheckedExpression
+{
+	static_assert(Error == ERROR::SUCCESS, "the expression is invalid, its error code is the second argument of CheckedExpression");
+	static constexpr int value = Value;
+};
+
+// Folds a literal expression to its value at compile time, or stops the build if it is invalid
+#define CONSTANT_EXPRESSION(text) (CheckedExpression<evaluateConstant(text).value, evaluateConstant(text).error>::value)
+
+#endif // CONSTEXPR_EVALUATOR_HPP
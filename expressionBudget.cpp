@@ -0,0 +1,175 @@
+/*
+ * File: expressionBudget.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of the cost estimation and the budgeted evaluation.
+ * The characters are counted by class through a table, like the counting pass of the parallel evaluator,
+ * in blocks of BUDGET_SCAN_BLOCK bytes: only parentheses, invalid characters and the NUL take a branch,
+ * and the length, operation budget and deadline are looked at between two blocks.
+ */
+
+// Include necessary headers
+#include "expressionBudget.hpp"
+#include "constants.hpp"
+#include <climits>
+#include <cstdint>
+
+// Classes of the characters counted by the scan
+namespace COST_CHAR
+{
+    static const unsigned char SPACE = 0;    // Whitespace accepted by skipSpaces()
+    static const unsigned char DIGIT = 1;    // '0' to '9'
+    static const unsigned char OPERATOR = 2; // '+', '-', '*' and '/'
+    static const unsigned char OPEN = 3;     // '('
+    static const unsigned char CLOSE = 4;    // ')'
+    static const unsigned char END = 5;      // The NUL at the end of the expression
+    static const unsigned char OTHER = 6;    // Anything else, an invalid character
+}
+
+// Results of scanning a block besides an error code
+static const int SCAN_CONTINUE = -1; // Reached the end of the block
+static const int SCAN_END = -2;      // Reached the NUL at the end of the expression
+
+// Returns the class of every character
+static const unsigned char* costClasses()
+{
+    static const struct Table {
+        unsigned char classes[256];
+        Table()
+        {
+            for (int ch = 0; ch < 256; ++ch) classes[ch] = COST_CHAR::OTHER;
+            for (unsigned char ch : { ' ', '\t', '\n', '\r', '\f', '\v' }) classes[ch] = COST_CHAR::SPACE;
+            for (int ch = '0'; ch <= '9'; ++ch) classes[ch] = COST_CHAR::DIGIT;
+            for (unsigned char ch : { '+', '-', '*', '/' }) classes[ch] = COST_CHAR::OPERATOR;
+            classes[(unsigned char)'('] = COST_CHAR::OPEN;
+            classes[(unsigned char)')'] = COST_CHAR::CLOSE;
+            classes[0] = COST_CHAR::END;
+        }
+    } table;
+    return table.classes;
+}
+
+// Counts kept while scanning
+struct CostScan
+{
+    ExpressionCost cost;        // What is counted so far
+    size_t digits = 0;          // Each digit counts as a number in isValidExpression()
+    size_t closes = 0;          // ')'
+    long depth = 0;             // Opened minus closed parentheses
+    unsigned char previous = COST_CHAR::SPACE; // Class of the last character, a run of digits is one number
+};
+
+// Counts up to 'count' characters from 'ch', stopping at the NUL. Returns an error code of
+// isValidExpression(), ERROR::DEPTH_EXCEEDED past 'maxDepth', SCAN_END at the NUL or SCAN_CONTINUE.
+static int scanBlock(CostScan& scan, const char* ch, size_t count, long maxDepth)
+{
+    static const unsigned char* classes = costClasses();
+    size_t byClass[7] = {};
+    size_t numbers = 0;
+    long depth = scan.depth, deepest = scan.cost.maxDepth;
+    unsigned char previous = scan.previous;
+    int code = SCAN_CONTINUE;
+
+    size_t i = 0;
+    for (; i < count; ++i) {
+        unsigned char kind = classes[(unsigned char)ch[i]];
+        byClass[kind]++;
+        numbers += kind == COST_CHAR::DIGIT && previous != COST_CHAR::DIGIT;
+        previous = kind;
+        if (kind < COST_CHAR::OPEN) continue;
+        if (kind == COST_CHAR::OPEN) {
+            if (++depth > deepest) deepest = depth;
+            if (depth > maxDepth) { code = ERROR::DEPTH_EXCEEDED; break; }
+        }
+        else if (kind == COST_CHAR::CLOSE) { if (--depth < 0) { code = ERROR::UNMATCHED_PAREN; break; } }
+        else if (kind == COST_CHAR::END) { code = SCAN_END; break; }
+        else { code = ERROR::INVALID_CHARACTER; break; }
+    }
+
+    // The character that stopped the scan with an error is counted, the NUL is not
+    scan.cost.bytes += code == SCAN_CONTINUE || code == SCAN_END ? i : i + 1;
+    scan.cost.numbers += numbers;
+    scan.cost.operators += byClass[COST_CHAR::OPERATOR];
+    scan.cost.parens += byClass[COST_CHAR::OPEN];
+    scan.cost.maxDepth = (int)deepest;
+    scan.digits += byClass[COST_CHAR::DIGIT];
+    scan.closes += byClass[COST_CHAR::CLOSE];
+    scan.depth = depth;
+    scan.previous = previous;
+
+    // Every number is read, every operator applied and every parenthesis level opened and closed
+    scan.cost.tokens = scan.cost.numbers + scan.cost.operators + scan.cost.parens + scan.closes;
+    scan.cost.operations = scan.cost.numbers + scan.cost.operators + scan.cost.parens;
+    return code;
+}
+
+// Scans the whole expression within the budget, and returns the error code of isValidExpression()
+// or the first limit passed
+static int scanExpression(const char* expression, CostScan& scan, const EvaluationBudget& budget)
+{
+    size_t maxBytes = budget.maxBytes ? budget.maxBytes : SIZE_MAX - 1;
+    size_t maxOperations = budget.maxOperations ? budget.maxOperations : SIZE_MAX;
+    long maxDepth = budget.maxDepth ? budget.maxDepth : LONG_MAX;
+    bool timed = budget.deadline != std::chrono::steady_clock::time_point::max();
+
+    int code = SCAN_CONTINUE;
+    while (code == SCAN_CONTINUE) {
+        // Never read more than one character past the longest expression accepted
+        size_t left = maxBytes + 1 - scan.cost.bytes;
+        code = scanBlock(scan, expression + scan.cost.bytes, left < BUDGET_SCAN_BLOCK ? left : BUDGET_SCAN_BLOCK, maxDepth);
+        if (code != SCAN_CONTINUE && code != SCAN_END) return code;
+
+        if (scan.cost.bytes > maxBytes) return ERROR::BUDGET_EXCEEDED;
+        if (scan.cost.operations > maxOperations) return ERROR::BUDGET_EXCEEDED;
+        if (timed && std::chrono::steady_clock::now() >= budget.deadline) return ERROR::DEADLINE_EXCEEDED;
+    }
+
+    // The final checks of isValidExpression(), which accepts an empty expression
+    if (scan.cost.bytes == 0) return ERROR::SUCCESS;
+    if (scan.cost.parens != scan.closes) return ERROR::UNMATCHED_PAREN;
+    else if (scan.digits == 0) return ERROR::NO_NUM;
+    else if (scan.cost.operators == 0 && scan.digits > 1) return ERROR::NO_OPERATOR;
+    return ERROR::SUCCESS;
+}
+
+// Measures the expression in a single pass, without limits.
+int estimateCost(const char* expression, ExpressionCost& cost)
+{
+    cost = ExpressionCost();
+    if (expression == 0) return ERROR::INVALID_CHARACTER;
+
+    CostScan scan;
+    EvaluationBudget unlimited;
+    unlimited.maxDepth = 0;
+    int errorCode = scanExpression(expression, scan, unlimited);
+    cost = scan.cost;
+    return errorCode;
+}
+
+// Evaluates the expression within the budget: the scan checks the limits, then parseIterative()
+// parses it with the deadline.
+int evaluateBudgeted(const char* expression, int& result, const EvaluationBudget& budget, ExpressionCost* cost)
+{
+    result = 0;
+    if (cost) *cost = ExpressionCost();
+
+    // Null is an error here, like evaluateIterative()
+    if (expression == 0) return ERROR::INVALID_CHARACTER;
+
+    // The scan replaces isValidExpression(), and stops at the first limit passed
+    CostScan scan;
+    int errorCode = scanExpression(expression, scan, budget);
+    if (cost) *cost = scan.cost;
+    if (errorCode != ERROR::SUCCESS) return errorCode;
+
+    // Parse it, the result is stored even if characters are left over
+    thread_local ParseStack stack;
+    stack.maxDepth = budget.maxDepth ? budget.maxDepth : INT_MAX;
+    stack.deadline = budget.deadline;
+    const char* cur = expression;
+    errorCode = parseIterative(cur, result, stack);
+    if (errorCode != ERROR::SUCCESS) return errorCode;
+
+    // If there are any characters left in the expression after parsing, it's an error
+    if (*cur != '\0') return ERROR::PARSE_ERROR;
+    return ERROR::SUCCESS;
+}
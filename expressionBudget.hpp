@@ -0,0 +1,56 @@
+/*
+ * File: expressionBudget.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of the cost estimation and the budgeted evaluation.
+ * estimateCost() measures an expression in a single pass over its characters, the same pass that
+ * isValidExpression() makes, without parsing it. evaluateBudgeted() makes that pass with limits on the
+ * length, the nesting depth and the number of operations, and a deadline, and stops as soon as one of
+ * them is passed, so an expression that is too expensive is turned away for about the price of reading
+ * as much of it as the budget allows.
+ */
+
+#ifndef EXPRESSION_BUDGET_HPP
+#define EXPRESSION_BUDGET_HPP
+
+#include "iterativeEvaluator.hpp"
+#include <chrono>
+#include <cstddef>
+
+// Bytes scanned between two looks at the clock and at the operation budget
+static const size_t BUDGET_SCAN_BLOCK = 1 << 16;
+
+// What an expression costs, counted in a single pass over its characters
+struct ExpressionCost
+{
+	size_t bytes = 0;      // Characters scanned, the length of the expression unless the scan stopped early
+	size_t tokens = 0;     // Numbers, operators and parentheses
+	size_t numbers = 0;    // Runs of digits
+	size_t operators = 0;  // '+', '-', '*' and '/', signs included
+	size_t parens = 0;     // '(' (each one closed by a ')')
+	int maxDepth = 0;      // Deepest nesting of parentheses
+	size_t operations = 0; // Estimated steps of the evaluation: every number, operator and parenthesis level
+};
+
+// Limits of a budgeted evaluation. A limit of 0 means no limit.
+struct EvaluationBudget
+{
+	size_t maxBytes = 0;                 // Longest expression accepted
+	int maxDepth = DEFAULT_MAX_DEPTH;    // Deepest nesting accepted
+	size_t maxOperations = 0;            // Most estimated operations accepted, see ExpressionCost
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max(); // When to give up
+};
+
+// Measures the expression into 'cost' and returns the error code of isValidExpression().
+// The scan stops at the first error, so 'cost' then describes the expression up to that error, included.
+int estimateCost(const char* expression, ExpressionCost& cost);
+
+// Evaluates the expression like evaluate() does, within the budget. It returns, with a result of 0:
+//   ERROR::BUDGET_EXCEEDED   the expression is longer than maxBytes or costs more than maxOperations
+//   ERROR::DEPTH_EXCEEDED    its parentheses are nested deeper than maxDepth
+//   ERROR::DEADLINE_EXCEEDED the deadline passed before the evaluation finished
+// The limits are checked while scanning, before any parsing, so an error of isValidExpression() earlier
+// in the text comes first and an error of the parse comes after them. Longer expressions are only
+// read up to maxBytes + 1 characters. If 'cost' is given, it receives what the scan counted.
+int evaluateBudgeted(const char* expression, int& result, const EvaluationBudget& budget, ExpressionCost* cost = 0);
+
+#endif // EXPRESSION_BUDGET_HPP
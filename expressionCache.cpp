@@ -0,0 +1,200 @@
+/*
+ * File: expressionCache.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of the expression cache.
+ */
+
+// Include necessary headers
+#include "expressionCache.hpp"
+#include "expressionEvaluator.hpp"
+#include "iterativeEvaluator.hpp"
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Default number of shards when 0 is passed to initCache()
+static const size_t DEFAULT_SHARD_COUNT = 16;
+
+// A remembered expression
+struct CacheEntry
+{
+    std::string key;         // Normalized expression, see normalizeExpression()
+    uint64_t hash = 0;       // Hash of the key
+    int result = 0;          // Result returned by evaluate()
+    int errorCode = 0;       // Error code returned by evaluate()
+    bool referenced = false; // Set on every hit, cleared when the clock hand passes
+};
+
+// One shard of the cache, everything in it is protected by its lock.
+// Shards sit on their own cache lines so their locks do not share one.
+struct alignas(64) CacheShard
+{
+    std::mutex lock;
+    std::vector<CacheEntry> entries;               // Up to shardCapacity entries
+    std::unordered_map<uint64_t, size_t> index;    // Position of each hash in 'entries'
+    size_t hand = 0;                               // Position of the clock hand
+    size_t hits = 0, misses = 0, evictions = 0;    // Counters of this shard
+};
+
+ExpressionCache::ExpressionCache() = default;
+ExpressionCache::~ExpressionCache() = default;
+
+// Returns true for the whitespace characters accepted by skipSpaces()
+static inline bool isSpace(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\f' || ch == '\v';
+}
+
+// Returns true for a digit
+static inline bool isDigit(char ch)
+{
+    return ch >= '0' && ch <= '9';
+}
+
+// Writes the key the cache uses for an expression into 'key' and returns its hash (64 bit FNV-1a).
+uint64_t normalizeExpression(const char* expression, std::string& key)
+{
+    key.clear();
+    bool sawSpace = false;
+    for (const char* ch = expression; *ch; ++ch) {
+        if (isSpace(*ch)) { sawSpace = true; continue; }
+
+        // Whitespace between two digits separates two numbers, keep a single space for it
+        if (sawSpace && isDigit(*ch) && !key.empty() && isDigit(key.back())) key += ' ';
+        sawSpace = false;
+        key += *ch;
+    }
+
+    // Whitespace only is not the same as an empty expression (NO_NUM instead of INVALID_CHARACTER)
+    if (key.empty() && sawSpace) key += ' ';
+
+    uint64_t hash = 14695981039346656037ull;
+    for (char ch : key) hash = (hash ^ (unsigned char)ch) * 1099511628211ull;
+    return hash;
+}
+
+// Sets up (or resets) the cache.
+void initCache(ExpressionCache& cache, size_t capacity, size_t shardCount)
+{
+    if (shardCount == 0) shardCount = DEFAULT_SHARD_COUNT;
+
+    // A power of two lets us pick the shard with a mask
+    size_t count = 1;
+    while (count < shardCount) count <<= 1;
+
+    cache.shards.reset(new CacheShard[count]);
+    cache.shardCount = count;
+    cache.shardCapacity = (capacity + count - 1) / count;
+    if (cache.shardCapacity == 0) cache.shardCapacity = 1;
+    for (size_t s = 0; s < count; ++s) {
+        cache.shards[s].entries.reserve(cache.shardCapacity);
+        cache.shards[s].index.reserve(cache.shardCapacity);
+    }
+}
+
+// Drops every entry of the cache and resets its counters.
+void clearCache(ExpressionCache& cache)
+{
+    for (size_t s = 0; s < cache.shardCount; ++s) {
+        CacheShard& shard = cache.shards[s];
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.entries.clear();
+        shard.index.clear();
+        shard.hand = 0;
+        shard.hits = shard.misses = shard.evictions = 0;
+    }
+}
+
+// Stores an answer in a shard, evicting an entry with the clock algorithm when it is full
+static void insertEntry(CacheShard& shard, size_t capacity, const std::string& key, uint64_t hash, int result, int errorCode)
+{
+    size_t position;
+    if (shard.entries.size() < capacity) {
+        position = shard.entries.size();
+        shard.entries.emplace_back();
+    }
+    else {
+        // Give every referenced entry a second chance, evict the first one that is not
+        while (shard.entries[shard.hand].referenced) {
+            shard.entries[shard.hand].referenced = false;
+            shard.hand = (shard.hand + 1) % capacity;
+        }
+        position = shard.hand;
+        shard.hand = (shard.hand + 1) % capacity;
+        shard.index.erase(shard.entries[position].hash);
+        ++shard.evictions;
+    }
+
+    CacheEntry& entry = shard.entries[position];
+    entry.key = key;
+    entry.hash = hash;
+    entry.result = result;
+    entry.errorCode = errorCode;
+    entry.referenced = false;
+    shard.index[hash] = position;
+}
+
+// Evaluates an expression the cache does not know, recursively or not
+static inline int evaluateMiss(const ExpressionCache& cache, const char* expression, int& result)
+{
+    return cache.iterative ? evaluateIterative(expression, result) : evaluate(expression, result);
+}
+
+// Evaluates the expression, or returns the answer remembered from an earlier call.
+int cachedEvaluate(ExpressionCache& cache, const char* expression, int& result)
+{
+    // Without shards the cache is disabled
+    if (cache.shardCount == 0) return evaluateMiss(cache, expression, result);
+
+    // The key is built in a buffer reused by every call on this thread
+    static thread_local std::string key;
+    uint64_t hash = normalizeExpression(expression, key);
+    CacheShard& shard = cache.shards[(hash >> 32) & (cache.shardCount - 1)];
+
+    {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        auto it = shard.index.find(hash);
+        if (it != shard.index.end()) {
+            CacheEntry& entry = shard.entries[it->second];
+
+            // The hash picks the entry, the key makes sure it is the same expression
+            if (entry.key == key) {
+                entry.referenced = true;
+                ++shard.hits;
+                result = entry.result;
+                return entry.errorCode;
+            }
+        }
+        ++shard.misses;
+    }
+
+    // Evaluate without holding the lock, other threads may use the shard meanwhile
+    int errorCode = evaluateMiss(cache, expression, result);
+
+    std::lock_guard<std::mutex> guard(shard.lock);
+    auto it = shard.index.find(hash);
+    if (it == shard.index.end()) insertEntry(shard, cache.shardCapacity, key, hash, result, errorCode);
+    else {
+        // Another thread inserted it first, or a different key has the same hash: keep ours
+        CacheEntry& entry = shard.entries[it->second];
+        entry.key = key;
+        entry.result = result;
+        entry.errorCode = errorCode;
+    }
+    return errorCode;
+}
+
+// Returns the counters of the cache.
+CacheStats getCacheStats(const ExpressionCache& cache)
+{
+    CacheStats stats;
+    for (size_t s = 0; s < cache.shardCount; ++s) {
+        CacheShard& shard = cache.shards[s];
+        std::lock_guard<std::mutex> guard(shard.lock);
+        stats.hits += shard.hits;
+        stats.misses += shard.misses;
+        stats.evictions += shard.evictions;
+        stats.size += shard.entries.size();
+    }
+    return stats;
+}
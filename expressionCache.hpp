@@ -0,0 +1,61 @@
+/*
+ * File: expressionCache.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of the expression cache.
+ * The cache sits in front of evaluate() and remembers the error code and result of the
+ * expressions it has seen. It is split into shards, each with its own lock, so that
+ * threads looking up different expressions rarely wait for each other.
+ */
+
+#ifndef EXPRESSION_CACHE_HPP
+#define EXPRESSION_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct CacheShard;
+
+// Counters of the cache, summed over all the shards
+struct CacheStats
+{
+	size_t hits = 0;      // Lookups answered from the cache
+	size_t misses = 0;    // Lookups that had to call evaluate()
+	size_t evictions = 0; // Entries dropped to make room for new ones
+	size_t size = 0;      // Entries currently in the cache
+};
+
+// A sharded cache of evaluated expressions.
+// Each shard evicts entries with the CLOCK algorithm (an approximation of LRU).
+struct ExpressionCache
+{
+	std::unique_ptr<CacheShard[]> shards; // The shards, selected by the hash of the expression
+	size_t shardCount = 0;                // Number of shards (a power of two)
+	size_t shardCapacity = 0;             // Entries each shard can hold
+	bool iterative = false;               // Evaluate misses with evaluateIterative(), for untrusted input on small stacks
+
+	ExpressionCache();
+	~ExpressionCache();
+};
+
+// Sets up (or resets) the cache to hold about 'capacity' expressions in 'shardCount' shards.
+// The shard count is rounded up to a power of two, 0 picks a default.
+void initCache(ExpressionCache& cache, size_t capacity, size_t shardCount);
+
+// Drops every entry of the cache and resets its counters.
+void clearCache(ExpressionCache& cache);
+
+// Evaluates the expression, or returns the answer remembered from an earlier call.
+// The error code and result are always the same as evaluate() returns.
+int cachedEvaluate(ExpressionCache& cache, const char* expression, int& result);
+
+// Returns the counters of the cache.
+CacheStats getCacheStats(const ExpressionCache& cache);
+
+// Writes the key the cache uses for an expression into 'key' and returns its hash.
+// Whitespace is dropped, since skipSpaces() makes it meaningless, except between two digits
+// ('1 2' is not '12') and for an expression made of whitespace only ('  ' is not '').
+uint64_t normalizeExpression(const char* expression, std::string& key);
+
+#endif // EXPRESSION_CACHE_HPP
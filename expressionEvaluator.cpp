@@ -9,6 +9,9 @@
 // Include necessary headers
 #include "expressionEvaluator.hpp"
 #include "constants.hpp"
+#include "simdKernels.hpp"
+#include "instrumentation.hpp"
+#include <cstring>
 
 
 // This function checks if the expression is valid.
@@ -19,93 +22,44 @@ int isValidExpression(const char* expression)
     {
         return false; // Empty expression is not valid
     }
-    
-    // We need to count the components as we parse the expression
-    int openParenCount = 0;      // Count of open parentheses
-    int closeParenCount = 0;     // Count of close parentheses
-    int numCount = 0;          // Count of numbers (digits)
-    int operatorCount = 0;       // Count of operators (arithmetic symbols)
-    const char* ch = expression; // Use const pointer for iteration
-
-    // Check for valid characters and balanced parentheses
-    // We will iterate through the expression and check for valid characters
-    while (*ch && *ch != '\0')
-    {
-        // Check for valid numbers first
-        if (*ch >= '0' && *ch <= '9')
-        {
-            numCount++; // Increment count for digits
-            ch++;     // Move to next character
-            continue; // Valid digit, continue checking
-        }
+    STATS_ADD(validateCalls, 1);
+    STATS_ADD(bytesScanned, strlen(expression));
 
-		// If we reach here, the character is not a digit, so we check for operators, 
-        // whitespace, or parentheses
-        switch (*ch)
-        {
-
-            // Check for valid operators
-        case '+':
-        case '-':
-        case '*':
-        case '/':
-            operatorCount++; // Increment count for operators
-            // allow fallthrough to check next character
-            [[fallthrough]];
-		case ' ': // Check for valid whitespaces
-        case '\t':
-        case '\n':
-        case '\r':
-        case '\f':
-        case '\v':
-            ch++;     // Move to next character
-            continue; // Valid character, continue checking
-
-            // Check for parentheses
-        case '(':
-            openParenCount++; // Increment count for open parentheses
-            ch++;             // Move to next character
-            continue;         // Valid character, continue checking
-        case ')':
-            closeParenCount++; // Increment count for close parentheses
-            if (closeParenCount > openParenCount)
-            {
-                return ERROR::UNMATCHED_PAREN; // More closing parentheses than opening ones
-            }
-            ch++;     // Move to next character
-            continue; // Valid character, continue checking
-
-            // If we encounter any other character, we return an error code
-        default:
-            return ERROR::INVALID_CHARACTER; // Invalid character found
-        }
-    }
+    // The characters are checked by the vectorized kernel of this processor,
+    // which gives exactly the same error codes as checking them one at a time
+    return validateExpression(expression);
+}
 
-    // After checking all characters, we need to ensure the expression is valid and balanced
-    if (openParenCount != closeParenCount) return ERROR::UNMATCHED_PAREN; // Unmatched parentheses
-    else if (numCount == 0) return ERROR::NO_NUM; // No numbers found in the expression
-    else if (operatorCount == 0 && numCount > 1) return ERROR::NO_OPERATOR; // More than one number without an operator
+// Returns true for the whitespace characters accepted by skipSpaces()
+static inline bool isSpace(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\f' || ch == '\v';
+}
 
-    // If we reach here, the expression is valid
-    return ERROR::SUCCESS;
+// Returns true for the digits '0' to '9'
+static inline bool isDigit(char ch)
+{
+    return ch >= '0' && ch <= '9';
 }
 
 // Skips spaces in the expression
 // This function takes a reference to a character pointer and skips any whitespace characters.
 void skipSpaces(const char*& currentChar) {
-    while (*currentChar == ' ' || *currentChar == '\t' || *currentChar == '\n' ||
-        *currentChar == '\r' || *currentChar == '\f' || *currentChar == '\v') {
-        ++currentChar; // Move to the next character
-    }
+    // Most runs are a single space, so only longer runs go to the vectorized kernel
+    if (!isSpace(*currentChar)) return;
+    if (!isSpace(*++currentChar)) return;
+    currentChar = skipSpacesRun(currentChar + 1);
 }
 
 // Parses a parenthesis in the expression.
 // This function takes a sign (1 for positive, -1 for negative), a reference to a character pointer, 
 // and an integer reference to store the result.
 int parseParen(int sign, const char*& expression, int& result) {
+    STATS_PAREN();
 
     // Move past the opening parenthesis
     ++expression;
+    STATS_ADD(tokens, 1);
 
     int parenValue = 0;
 
@@ -123,6 +77,7 @@ int parseParen(int sign, const char*& expression, int& result) {
 
     // Move past the closing parenthesis
     ++expression;
+    STATS_ADD(tokens, 1);
 
     // Set the result to the parsed value with the correct sign
     result = sign * parenValue;
@@ -140,7 +95,7 @@ int parseNext(const char*& expression, int& result) {
     skipSpaces(expression);
 
     int sign = 1; // Default sign is positive
-    if (*expression == '-') { sign = -1; ++expression; skipSpaces(expression); } // Handle negative sign
+    if (*expression == '-') { sign = -1; ++expression; skipSpaces(expression); STATS_ADD(tokens, 1); } // Handle negative sign
 
     // If the current character is an opening parenthesis, we need to parse the expression inside it.
     if (*expression == '(') return parseParen(sign, expression, result); // Parse the expression inside parentheses
@@ -152,11 +107,13 @@ int parseNext(const char*& expression, int& result) {
         // Parse the number
         int val = 0;
 
-        // This loop will parse the digits of the number, ensuring we handle multi-digit numbers correctly
-        while (*expression >= '0' && *expression <= '9') val = val * 10 + (*expression++ - '0');
+        // Single digit numbers are the most common, longer numbers are converted 8 digits at a time
+        if (!isDigit(expression[1])) val = *expression++ - '0';
+        else val = parseDigits(expression);
 
         // After parsing the number, we set the result to the value with the correct sign
         result = sign * val;
+        STATS_ADD(tokens, 1);
     }
 
     // After parsing the number, skip any spaces
@@ -169,6 +126,7 @@ int parseNext(const char*& expression, int& result) {
 // Parses the entire expression and returns the result as an integer.
 // This function takes a reference to a character pointer and returns the result of the expression.
 int parse(const char*& expression, int& result) {
+    STATS_ADD(parseCalls, 1);
 
     // Skip any leading spaces
     skipSpaces(expression);
@@ -191,6 +149,7 @@ int parse(const char*& expression, int& result) {
 
         // If we reach here, we have a valid operator, so we move to the next character
         ++expression;
+        STATS_ADD(tokens, 1);
 
         // We now need to parse the right-hand side of the expression
         int rightValue = 0, errorCode = parseNext(expression, rightValue);
@@ -216,6 +175,7 @@ int parse(const char*& expression, int& result) {
 
             // If we reach here, we have a valid operator, so we move to the next character
             ++expression;
+            STATS_ADD(tokens, 1);
 
             // We now need to parse the next right-hand side value
             errorCode = parseNext(expression, rightValue);
@@ -241,11 +201,14 @@ int evaluate(const char* expression, int& result)
 {
 	// Initialize the result to 0
 	result = 0;
+    STATS_ADD(evaluateCalls, 1);
 
     // First, lets check if the expression is valid
 	// If the expression is invalid, we will return an error code
+    STATS_TIMER(validateStart);
 	int errorCode = isValidExpression(expression);
-	if (errorCode != ERROR::SUCCESS) return errorCode;
+    STATS_PHASE(STATS_PHASE::VALIDATE, validateStart);
+	if (errorCode != ERROR::SUCCESS) return STATS_RESULT(errorCode);
 
     // Here, we set a local pointer for parsing and space skipping
     const char* exprPtr = expression;
@@ -257,15 +220,225 @@ int evaluate(const char* expression, int& result)
 	// We now have a non-space character to start with
 
     // Use parse() to parse the expression
+    STATS_TIMER(parseStart);
     errorCode = parse(exprPtr, result);
-    if (errorCode != ERROR::SUCCESS) return errorCode; // Return the error code from parsing
+    STATS_PHASE(STATS_PHASE::PARSE, parseStart);
+    if (errorCode != ERROR::SUCCESS) return STATS_RESULT(errorCode); // Return the error code from parsing
 
     // After parsing the entire expression, we should skip any remaining spaces
     skipSpaces(expression);
 
     // If there are any characters left in the expression after parsing, it's an error
-    if (*exprPtr != '\0') return ERROR::PARSE_ERROR;
+    if (*exprPtr != '\0') return STATS_RESULT(ERROR::PARSE_ERROR);
 
     // If we reach here, the expression was successfully evaluated
+    return STATS_RESULT(ERROR::SUCCESS);
+}
+
+// State of a single pass evaluation over a buffer that is not NUL terminated.
+// While parsing, we keep the same counts as isValidExpression() for every character we consume,
+// so that the characters left after the parser stops are the only ones that need a second look.
+struct ScanState
+{
+    const char* cur;         // Current character
+    const char* end;         // One past the last character of the buffer
+    int openParenCount = 0;  // Count of open parentheses consumed so far
+    int closeParenCount = 0; // Count of close parentheses consumed so far
+    int numCount = 0;        // Count of digits consumed so far
+    int operatorCount = 0;   // Count of operators (and signs) consumed so far
+};
+
+// Returns the current character, or '\0' at the end of the buffer, like a NUL terminated string
+static inline char scanPeek(const ScanState& state)
+{
+    return state.cur < state.end ? *state.cur : '\0';
+}
+
+// Skips spaces in the buffer, see skipSpaces()
+static inline void scanSkipSpaces(ScanState& state)
+{
+    if (state.cur == state.end || !isSpace(*state.cur)) return;
+    if (++state.cur == state.end || !isSpace(*state.cur)) return;
+    state.cur = skipSpacesRun(state.cur + 1, state.end);
+}
+
+static int scanParse(ScanState& state, int& result);
+
+// Parses a parenthesis in the buffer, see parseParen()
+static int scanParen(int sign, ScanState& state, int& result)
+{
+    STATS_PAREN();
+
+    // Move past the opening parenthesis
+    ++state.cur;
+    ++state.openParenCount;
+
+    // Parse the expression inside the parentheses
+    int parenValue = 0;
+    int err = scanParse(state, parenValue);
+    if (err) return err;
+
+    // Ensure the next character is a closing parenthesis
+    scanSkipSpaces(state);
+    if (scanPeek(state) != ')') return ERROR::MISSING_PAREN;
+
+    // Move past the closing parenthesis
+    ++state.cur;
+    ++state.closeParenCount;
+    STATS_ADD(tokens, 2);
+
+    result = sign * parenValue;
+    return ERROR::SUCCESS;
+}
+
+// Parses the next number or parenthesis in the buffer, see parseNext()
+static int scanNext(ScanState& state, int& result)
+{
+    scanSkipSpaces(state);
+
+    // Handle negative sign, isValidExpression() counts it as an operator
+    int sign = 1;
+    if (scanPeek(state) == '-') { sign = -1; ++state.cur; ++state.operatorCount; scanSkipSpaces(state); STATS_ADD(tokens, 1); }
+
+    char ch = scanPeek(state);
+    if (ch == '(') return scanParen(sign, state, result);
+    else if (ch == ')') return ERROR::UNMATCHED_PAREN;
+    else if (ch < '0' || ch > '9') return ERROR::INVALID_CHARACTER;
+
+    // Parse the number, counting every digit like isValidExpression() does
+    const char* start = state.cur;
+    int val = 0;
+    if (state.cur + 1 == state.end || !isDigit(state.cur[1])) val = *state.cur++ - '0';
+    else val = parseDigits(state.cur, state.end);
+    state.numCount += (int)(state.cur - start);
+    STATS_ADD(tokens, 1);
+
+    result = sign * val;
+    scanSkipSpaces(state);
     return ERROR::SUCCESS;
-}
\ No newline at end of file
+}
+
+// Parses the entire expression in the buffer, see parse()
+static int scanParse(ScanState& state, int& result)
+{
+    STATS_ADD(parseCalls, 1);
+    scanSkipSpaces(state);
+
+    int leftValue = 0, errorCode = scanNext(state, leftValue);
+    if (errorCode) return errorCode;
+
+    while (true) {
+        scanSkipSpaces(state);
+        char operation = scanPeek(state);
+        if (operation != '*' && operation != '/' && operation != '+' && operation != '-') break;
+        ++state.cur;
+        ++state.operatorCount;
+        STATS_ADD(tokens, 1);
+
+        int rightValue = 0;
+        errorCode = scanNext(state, rightValue);
+        if (errorCode) return errorCode;
+
+        // Multiplication and division chains, exactly like parse()
+        while (operation == '*' || operation == '/') {
+            if (operation == '*') leftValue *= rightValue;
+            else {
+                if (rightValue == 0) return ERROR::DIV_BY_ZERO;
+                leftValue /= rightValue;
+            }
+
+            scanSkipSpaces(state);
+            operation = scanPeek(state);
+            if (operation != '*' && operation != '/') break;
+            ++state.cur;
+            ++state.operatorCount;
+            STATS_ADD(tokens, 1);
+
+            errorCode = scanNext(state, rightValue);
+            if (errorCode) return errorCode;
+        }
+
+        if (operation == '+') leftValue += rightValue;
+        else if (operation == '-') leftValue -= rightValue;
+    }
+
+    result = leftValue;
+    return ERROR::SUCCESS;
+}
+
+// Finishes the checks of isValidExpression() on the characters the parser did not consume.
+// The parser never consumes an invalid character or an unmatched ')', so the early returns of
+// isValidExpression() can only happen here, and they happen in the same order.
+static int scanValidateRest(ScanState& state)
+{
+    for (const char* ch = state.cur; ch < state.end; ++ch) {
+        if (*ch >= '0' && *ch <= '9') { state.numCount++; continue; }
+        switch (*ch) {
+        case '+':
+        case '-':
+        case '*':
+        case '/':
+            state.operatorCount++;
+            continue;
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+        case '\f':
+        case '\v':
+            continue;
+        case '(':
+            state.openParenCount++;
+            continue;
+        case ')':
+            state.closeParenCount++;
+            if (state.closeParenCount > state.openParenCount) return ERROR::UNMATCHED_PAREN;
+            continue;
+        default:
+            return ERROR::INVALID_CHARACTER; // Includes a NUL character inside the buffer
+        }
+    }
+
+    // The same final checks as isValidExpression()
+    if (state.openParenCount != state.closeParenCount) return ERROR::UNMATCHED_PAREN;
+    else if (state.numCount == 0) return ERROR::NO_NUM;
+    else if (state.operatorCount == 0 && state.numCount > 1) return ERROR::NO_OPERATOR;
+    return ERROR::SUCCESS;
+}
+
+// Evaluates an expression stored in a buffer that does not need to be NUL terminated.
+int evaluate(std::string_view expression, int& result)
+{
+    return evaluate(expression.data(), expression.size(), result);
+}
+
+// Evaluates an expression given as a pointer and a length, in a single pass.
+int evaluate(const char* expression, size_t length, int& result)
+{
+    result = 0;
+    STATS_ADD(evaluateCalls, 1);
+
+    // An empty expression skips validation in evaluate() and fails in parseNext()
+    if (expression == 0 || length == 0) return STATS_RESULT(ERROR::INVALID_CHARACTER);
+    STATS_ADD(bytesScanned, length);
+    STATS_TIMER(scanStart);
+
+    ScanState state;
+    state.cur = expression;
+    state.end = expression + length;
+
+    // Parse first, keeping the result aside until we know the whole buffer is valid
+    int value = 0;
+    int parseError = scanParse(state, value);
+
+    // Anything left after a successful parse is an error, but the result is still stored
+    if (parseError == ERROR::SUCCESS && state.cur != state.end) parseError = ERROR::PARSE_ERROR;
+
+    // Validation errors take precedence, since evaluate() checks them before parsing
+    int errorCode = scanValidateRest(state);
+    STATS_PHASE(STATS_PHASE::SCAN, scanStart);
+    if (errorCode != ERROR::SUCCESS) return STATS_RESULT(errorCode);
+
+    if (parseError == ERROR::SUCCESS || parseError == ERROR::PARSE_ERROR) result = value;
+    return STATS_RESULT(parseError);
+}
@@ -8,7 +8,9 @@
 
 #ifndef EXPRESSION_EVALUATOR_HPP
 #define EXPRESSION_EVALUATOR_HPP
-#endif
+
+#include <cstddef>
+#include <string_view>
 
 // This function checks if the expression is valid.
 // It should return true if the expression is valid and false otherwise.
@@ -35,3 +37,13 @@ int parse(const char*& cur, int& result);
 // It returns true if the expression is valid and false otherwise.
 int evaluate(const char* expression, int& result);
 
+// Evaluates an expression stored in a buffer that does not need to be NUL terminated.
+// The buffer is walked only once: the checks of isValidExpression() are done while parsing,
+// and the error codes and result are the same as evaluate() for the same text.
+// A NUL character inside the buffer is reported as ERROR::INVALID_CHARACTER.
+int evaluate(std::string_view expression, int& result);
+
+// Same as above, for a pointer and a length.
+int evaluate(const char* expression, size_t length, int& result);
+
+#endif // EXPRESSION_EVALUATOR_HPP
@@ -0,0 +1,164 @@
+/*
+ * File: fusedExpression.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of fused expression sets.
+ * The graph is run node by node, each node writing its own value, so no value ever needs a stack.
+ * Almost every run divides by zero nowhere: the first pass computes the values alone, and only
+ * when it meets a zero divisor does a second pass follow which nodes failed, so that a division
+ * by zero fails the expressions that need it and none of the others.
+ */
+
+// Include necessary headers
+#include "fusedExpression.hpp"
+#include "constants.hpp"
+#include <utility>
+#include <vector>
+
+// Divides like run() does, except that INT_MIN / -1 wraps to INT_MIN instead of trapping. The graph
+// also computes divisions that run() never reaches, once another division of the same expression failed.
+static inline int divideNodes(int a, int b)
+{
+    return b == -1 ? (int)(0u - (unsigned)a) : a / b;
+}
+
+// Returns the number of arithmetic operations of a program
+static size_t countOperations(const CompiledExpression& program)
+{
+    size_t operations = 0;
+    for (const Instruction& ins : program.code) {
+        operations += ins.opcode >= OPCODE::NEG && ins.opcode <= OPCODE::DIVK;
+    }
+    return operations;
+}
+
+// Compiles a set of expressions together, with the variables in the table when there is one
+static size_t compileSet(const char* const* expressions, size_t count, const VariableTable* variables, FusedExpression& fused)
+{
+    fused.nodes.clear();
+    fused.outputs.assign(count, { -1, ERROR::SUCCESS, -1 });
+    fused.fallbacks.clear();
+    fused.variableCount = 0;
+    fused.stats = FusedStats();
+    fused.stats.expressions = count;
+
+    // Compile every expression on its own first
+    std::vector<CompiledExpression> programs(count);
+    size_t failures = 0;
+    for (size_t i = 0; i < count; ++i) {
+        int error = variables ? compile(expressions[i], *variables, programs[i]) : compile(expressions[i], programs[i]);
+        failures += error != ERROR::SUCCESS;
+        if (programs[i].variableCount > fused.variableCount) fused.variableCount = programs[i].variableCount;
+        fused.stats.operationsSeparate += countOperations(programs[i]);
+
+        // What optimizing them one by one would give, for comparison
+        CompiledExpression optimized = programs[i];
+        optimize(optimized);
+        fused.stats.operationsOptimized += countOperations(optimized);
+    }
+
+    // Then optimize them together
+    OptimizeStats optimizeStats;
+    std::vector<GraphRoot> roots;
+    optimizeShared(programs.data(), count, fused.nodes, roots, &optimizeStats);
+    fused.stats.shared = optimizeStats.shared;
+    for (const GraphNode& node : fused.nodes) {
+        fused.stats.operationsFused += node.opcode != OPCODE::PUSH && node.opcode != OPCODE::LOAD;
+    }
+
+    // Programs the graph could not take are run on their own
+    for (size_t i = 0; i < count; ++i) {
+        if (roots[i].node >= 0) {
+            fused.outputs[i] = { roots[i].node, roots[i].returnCode, -1 };
+            continue;
+        }
+        fused.outputs[i].fallback = (int)fused.fallbacks.size();
+        fused.stats.operationsFused += countOperations(programs[i]);
+        fused.fallbacks.push_back(std::move(programs[i]));
+    }
+    fused.stats.fallbacks = fused.fallbacks.size();
+    fused.stats.operationsSaved = fused.stats.operationsSeparate - fused.stats.operationsFused;
+    return failures;
+}
+
+// Compiles a set of expressions together.
+size_t compileFused(const char* const* expressions, size_t count, FusedExpression& fused)
+{
+    return compileSet(expressions, count, 0, fused);
+}
+
+// Compiles a set of expressions that may use variables together.
+size_t compileFused(const char* const* expressions, size_t count, const VariableTable& variables, FusedExpression& fused)
+{
+    return compileSet(expressions, count, &variables, fused);
+}
+
+// Computes the value of every node. Returns false at the first division by zero.
+static bool runNodes(const GraphNode* nodes, size_t count, const int* values, int* out)
+{
+    for (size_t n = 0; n < count; ++n) {
+        const GraphNode& node = nodes[n];
+        switch (node.opcode) {
+        case OPCODE::PUSH: out[n] = node.a; break;
+        case OPCODE::LOAD: out[n] = values[node.a]; break;
+        case OPCODE::NEG: out[n] = -out[node.a]; break;
+        case OPCODE::ADD: out[n] = out[node.a] + out[node.b]; break;
+        case OPCODE::SUB: out[n] = out[node.a] - out[node.b]; break;
+        case OPCODE::MUL: out[n] = out[node.a] * out[node.b]; break;
+        case OPCODE::DIV:
+            if (out[node.b] == 0) return false;
+            out[n] = divideNodes(out[node.a], out[node.b]);
+            break;
+        }
+    }
+    return true;
+}
+
+// Computes the value of every node, and which nodes need a division by zero.
+// A node that failed is never computed with, so nothing is divided by a value that does not exist.
+static void runNodesFailing(const GraphNode* nodes, size_t count, const int* values, int* out, char* failed)
+{
+    for (size_t n = 0; n < count; ++n) {
+        const GraphNode& node = nodes[n];
+        failed[n] = 0;
+        out[n] = 0;
+        if (node.opcode == OPCODE::PUSH) { out[n] = node.a; continue; }
+        if (node.opcode == OPCODE::LOAD) { out[n] = values[node.a]; continue; }
+        if (failed[node.a] || (node.b >= 0 && failed[node.b])) { failed[n] = 1; continue; }
+        switch (node.opcode) {
+        case OPCODE::NEG: out[n] = -out[node.a]; break;
+        case OPCODE::ADD: out[n] = out[node.a] + out[node.b]; break;
+        case OPCODE::SUB: out[n] = out[node.a] - out[node.b]; break;
+        case OPCODE::MUL: out[n] = out[node.a] * out[node.b]; break;
+        case OPCODE::DIV:
+            if (out[node.b] == 0) failed[n] = 1; // Division by zero error
+            else out[n] = divideNodes(out[node.a], out[node.b]);
+            break;
+        }
+    }
+}
+
+// Evaluates every expression of the set in one pass over the graph.
+size_t runFused(const FusedExpression& fused, const int* values, int* results, int* errorCodes)
+{
+    // The values of the nodes, kept from one run to the next
+    static thread_local std::vector<int> nodeValues;
+    static thread_local std::vector<char> nodeFailed;
+    size_t count = fused.nodes.size();
+    if (nodeValues.size() < count) nodeValues.resize(count);
+
+    bool divided = runNodes(fused.nodes.data(), count, values, nodeValues.data());
+    if (!divided) {
+        if (nodeFailed.size() < count) nodeFailed.resize(count);
+        runNodesFailing(fused.nodes.data(), count, values, nodeValues.data(), nodeFailed.data());
+    }
+
+    size_t failures = 0;
+    for (size_t i = 0; i < fused.outputs.size(); ++i) {
+        const FusedOutput& output = fused.outputs[i];
+        if (output.fallback >= 0) errorCodes[i] = run(fused.fallbacks[output.fallback], values, results[i]);
+        else if (!divided && nodeFailed[output.node]) { results[i] = 0; errorCodes[i] = ERROR::DIV_BY_ZERO; }
+        else { results[i] = nodeValues[output.node]; errorCodes[i] = output.returnCode; }
+        failures += errorCodes[i] != ERROR::SUCCESS;
+    }
+    return failures;
+}
@@ -0,0 +1,66 @@
+/*
+ * File: fusedExpression.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of fused expression sets.
+ * Related formulas evaluated on the same record often share large subexpressions. A set of
+ * expressions is compiled together into a single graph in which every shared operation is made only
+ * once, and one pass over the graph gives the result and error code of every expression of the set.
+ */
+
+#ifndef FUSED_EXPRESSION_HPP
+#define FUSED_EXPRESSION_HPP
+
+#include "compiledExpression.hpp"
+#include "optimizer.hpp"
+#include <cstddef>
+#include <vector>
+
+// What fusing a set saved, counted in arithmetic operations (NEG, ADD, SUB, MUL and DIV)
+struct FusedStats
+{
+	size_t expressions = 0;         // Expressions in the set
+	size_t fallbacks = 0;           // Expressions run on their own, see compileFused()
+	size_t operationsSeparate = 0;  // Operations of the expressions compiled one by one, what evaluate() does
+	size_t operationsOptimized = 0; // Operations of the expressions compiled and optimized one by one
+	size_t operationsFused = 0;     // Operations of the shared graph, fallbacks included
+	size_t operationsSaved = 0;     // operationsSeparate - operationsFused
+	size_t shared = 0;              // Operations found again in the graph instead of being made twice
+};
+
+// Where an expression of the set finds its result
+struct FusedOutput
+{
+	int node;       // Node of the graph holding the result, -1 for a fallback
+	int returnCode; // Error code returned with the result, unless a division by zero fails it
+	int fallback;   // Index of the program run on its own, -1 if the result is in the graph
+};
+
+// A set of expressions compiled together
+struct FusedExpression
+{
+	std::vector<GraphNode> nodes;              // Shared graph, operands first
+	std::vector<FusedOutput> outputs;          // One per expression, in the order they were given
+	std::vector<CompiledExpression> fallbacks; // Programs ending with a syntax error, run on their own
+	int variableCount = 0;                     // Number of variable slots the set may read
+	FusedStats stats;
+};
+
+// Compiles 'count' expressions together.
+// Each expression is compiled like compile() does, then the programs are optimized together with
+// optimizeShared(). An expression that does not compile cleanly but still returns a result, like
+// "1 + 2 3", stays in the graph; one that ends with a syntax error is kept as its own program.
+// It returns the number of expressions that did not compile cleanly.
+size_t compileFused(const char* const* expressions, size_t count, FusedExpression& fused);
+
+// Compiles 'count' expressions that may use the variables in the table together.
+size_t compileFused(const char* const* expressions, size_t count, const VariableTable& variables, FusedExpression& fused);
+
+// Evaluates every expression of the set in one pass over the graph, reading the variables from
+// 'values', and writes the result and error code of expression i to results[i] and errorCodes[i],
+// exactly as evaluate() (or run() with the same values) would.
+// A division by zero only fails the expressions that need it. Unlike run(), INT_MIN / -1 does not trap
+// but gives INT_MIN, since the graph also runs divisions that come after one that failed.
+// It returns the number of expressions that failed.
+size_t runFused(const FusedExpression& fused, const int* values, int* results, int* errorCodes);
+
+#endif // FUSED_EXPRESSION_HPP
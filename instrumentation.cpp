@@ -0,0 +1,98 @@
+/*
+ * File: instrumentation.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of the snapshot API of the hot path counters.
+ * Without EVALUATOR_STATS there is nothing to count, and a snapshot is all zeros.
+ */
+
+// Include necessary headers
+#include "instrumentation.hpp"
+
+// Names of the error codes in the JSON output, see constants.hpp
+static const char* const ERROR_NAMES[] = {
+    "SUCCESS", "PARSE_ERROR", "UNMATCHED_PAREN", "INVALID_CHARACTER", "DIV_BY_ZERO", "MISSING_PAREN",
+    "NO_NUM", "NO_OPERATOR", "UNKNOWN_VARIABLE", "DEPTH_EXCEEDED", "CYCLE", "VALUE_OVERFLOW",
+    "BUDGET_EXCEEDED", "DEADLINE_EXCEEDED"
+};
+static const int NUM_ERROR_NAMES = sizeof(ERROR_NAMES) / sizeof(ERROR_NAMES[0]);
+
+// Names of the phases in the JSON output
+static const char* const PHASE_NAMES[STATS_PHASE_COUNT] = { "validate", "parse", "scan" };
+
+// Returns true if the counters were compiled in.
+bool statsEnabled()
+{
+#ifdef EVALUATOR_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Adds up the counters of every thread into 'stats'.
+void getStatsSnapshot(EvaluatorStats& stats)
+{
+    stats = EvaluatorStats();
+#ifdef EVALUATOR_STATS
+    StatsRegistry& registry = statsRegistry();
+    std::lock_guard<std::mutex> guard(registry.lock);
+    stats = registry.retired;
+    for (const ThreadStats* thread : registry.threads) addThreadStats(*thread, stats);
+#endif
+}
+
+// Sets every counter of every thread back to zero.
+// A thread counting at the same time may keep part of what it counted just before.
+void resetStats()
+{
+#ifdef EVALUATOR_STATS
+    StatsRegistry& registry = statsRegistry();
+    std::lock_guard<std::mutex> guard(registry.lock);
+    registry.retired = EvaluatorStats();
+    for (ThreadStats* thread : registry.threads) {
+        thread->evaluateCalls.store(0, std::memory_order_relaxed);
+        thread->validateCalls.store(0, std::memory_order_relaxed);
+        thread->parseCalls.store(0, std::memory_order_relaxed);
+        thread->parenCalls.store(0, std::memory_order_relaxed);
+        thread->bytesScanned.store(0, std::memory_order_relaxed);
+        thread->tokens.store(0, std::memory_order_relaxed);
+        thread->maxDepth.store(0, std::memory_order_relaxed);
+        for (auto& counter : thread->errorCounts) counter.store(0, std::memory_order_relaxed);
+        for (auto& counter : thread->phaseCycles) counter.store(0, std::memory_order_relaxed);
+    }
+#endif
+}
+
+// Appends "name": value to the JSON text
+static void appendField(std::string& json, const char* name, uint64_t value, bool last = false)
+{
+    json += '"';
+    json += name;
+    json += "\": ";
+    json += std::to_string(value);
+    if (!last) json += ", ";
+}
+
+// Writes the counters as a JSON object into 'json'.
+void writeStatsJson(const EvaluatorStats& stats, std::string& json)
+{
+    json = "{";
+    appendField(json, "enabled", statsEnabled() ? 1 : 0);
+    appendField(json, "evaluateCalls", stats.evaluateCalls);
+    appendField(json, "validateCalls", stats.validateCalls);
+    appendField(json, "parseCalls", stats.parseCalls);
+    appendField(json, "parenCalls", stats.parenCalls);
+    appendField(json, "bytesScanned", stats.bytesScanned);
+    appendField(json, "tokens", stats.tokens);
+    appendField(json, "maxDepth", stats.maxDepth);
+
+    // Error codes by name, the ones without a name by number
+    json += "\"errors\": {";
+    for (int i = 0; i < STATS_ERROR_CODES; ++i) {
+        std::string name = i < NUM_ERROR_NAMES ? ERROR_NAMES[i] : std::to_string(i);
+        appendField(json, name.c_str(), stats.errorCounts[i], i == STATS_ERROR_CODES - 1);
+    }
+    json += "}, \"phaseCycles\": {";
+    for (int i = 0; i < STATS_PHASE_COUNT; ++i) appendField(json, PHASE_NAMES[i], stats.phaseCycles[i], i == STATS_PHASE_COUNT - 1);
+    json += "}}";
+}
@@ -0,0 +1,203 @@
+/*
+ * File: instrumentation.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of the hot path counters of the evaluator.
+ * They are compiled in only when EVALUATOR_STATS is defined (the EVALUATOR_STATS CMake option).
+ * Otherwise every STATS_ macro expands to nothing, so the evaluator is exactly the same code as
+ * without them. Each thread counts in its own record, and a snapshot adds up the records of
+ * every thread, including the threads that have already exited.
+ */
+
+#ifndef INSTRUMENTATION_HPP
+#define INSTRUMENTATION_HPP
+
+#include <cstdint>
+#include <string>
+
+// Phases of evaluate() whose processor cycles are counted
+namespace STATS_PHASE
+{
+	static const int VALIDATE = 0; // isValidExpression() called by evaluate()
+	static const int PARSE = 1;    // parse() called by evaluate()
+	static const int SCAN = 2;     // Single pass evaluate() on a buffer
+}
+
+// Number of phases
+static const int STATS_PHASE_COUNT = 3;
+
+// Number of error codes counted one by one, larger codes are counted in the last one
+static const int STATS_ERROR_CODES = 16;
+
+// Counters of the evaluator, added up over every thread
+struct EvaluatorStats
+{
+	uint64_t evaluateCalls = 0;                       // evaluate() calls, on strings and on buffers
+	uint64_t validateCalls = 0;                       // isValidExpression() calls
+	uint64_t parseCalls = 0;                          // parse() calls, including the ones inside parentheses
+	uint64_t parenCalls = 0;                          // Parentheses parsed
+	uint64_t bytesScanned = 0;                        // Characters checked by isValidExpression() and the buffer evaluate()
+	uint64_t tokens = 0;                              // Numbers, operators, signs and parentheses consumed by the parser
+	uint64_t maxDepth = 0;                            // Deepest nesting of parentheses seen
+	uint64_t errorCounts[STATS_ERROR_CODES] = {};     // evaluate() results by error code
+	uint64_t phaseCycles[STATS_PHASE_COUNT] = {};     // Processor cycles (or nanoseconds) spent in each phase
+};
+
+// Returns true if the counters were compiled in.
+bool statsEnabled();
+
+// Adds up the counters of every thread into 'stats'.
+// Counters keep moving while other threads evaluate, so each one is read at a slightly different time.
+void getStatsSnapshot(EvaluatorStats& stats);
+
+// Sets every counter of every thread back to zero.
+void resetStats();
+
+// Writes the counters as a JSON object into 'json'.
+void writeStatsJson(const EvaluatorStats& stats, std::string& json);
+
+#ifdef EVALUATOR_STATS
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+
+// Counters of a single thread. Only the owner thread writes them, so an increment is a plain
+// load and store, the atomics only let a snapshot read them while they move.
+struct ThreadStats
+{
+	std::atomic<uint64_t> evaluateCalls{ 0 };
+	std::atomic<uint64_t> validateCalls{ 0 };
+	std::atomic<uint64_t> parseCalls{ 0 };
+	std::atomic<uint64_t> parenCalls{ 0 };
+	std::atomic<uint64_t> bytesScanned{ 0 };
+	std::atomic<uint64_t> tokens{ 0 };
+	std::atomic<uint64_t> maxDepth{ 0 };
+	std::atomic<uint64_t> errorCounts[STATS_ERROR_CODES] = {};
+	std::atomic<uint64_t> phaseCycles[STATS_PHASE_COUNT] = {};
+	uint64_t depth = 0; // Current nesting of parentheses
+};
+
+// Records of the live threads, and the counters of the threads that have exited
+struct StatsRegistry
+{
+	std::mutex lock;
+	std::vector<ThreadStats*> threads;
+	EvaluatorStats retired;
+};
+
+// Returns the registry shared by every thread
+inline StatsRegistry& statsRegistry()
+{
+	static StatsRegistry registry;
+	return registry;
+}
+
+// Adds the counters of a thread to a snapshot
+inline void addThreadStats(const ThreadStats& from, EvaluatorStats& to)
+{
+	to.evaluateCalls += from.evaluateCalls.load(std::memory_order_relaxed);
+	to.validateCalls += from.validateCalls.load(std::memory_order_relaxed);
+	to.parseCalls += from.parseCalls.load(std::memory_order_relaxed);
+	to.parenCalls += from.parenCalls.load(std::memory_order_relaxed);
+	to.bytesScanned += from.bytesScanned.load(std::memory_order_relaxed);
+	to.tokens += from.tokens.load(std::memory_order_relaxed);
+	uint64_t depth = from.maxDepth.load(std::memory_order_relaxed);
+	if (depth > to.maxDepth) to.maxDepth = depth;
+	for (int i = 0; i < STATS_ERROR_CODES; ++i) to.errorCounts[i] += from.errorCounts[i].load(std::memory_order_relaxed);
+	for (int i = 0; i < STATS_PHASE_COUNT; ++i) to.phaseCycles[i] += from.phaseCycles[i].load(std::memory_order_relaxed);
+}
+
+// Registers the record of a thread for its lifetime, and keeps its counters when the thread exits
+struct ThreadStatsOwner
+{
+	ThreadStats stats;
+
+	ThreadStatsOwner()
+	{
+		StatsRegistry& registry = statsRegistry();
+		std::lock_guard<std::mutex> guard(registry.lock);
+		registry.threads.push_back(&stats);
+	}
+
+	~ThreadStatsOwner()
+	{
+		StatsRegistry& registry = statsRegistry();
+		std::lock_guard<std::mutex> guard(registry.lock);
+		addThreadStats(stats, registry.retired);
+		for (size_t i = 0; i < registry.threads.size(); ++i) {
+			if (registry.threads[i] == &stats) {
+				registry.threads[i] = registry.threads.back();
+				registry.threads.pop_back();
+				break;
+			}
+		}
+	}
+};
+
+// Returns the counters of the calling thread
+inline ThreadStats& threadStats()
+{
+	static thread_local ThreadStatsOwner owner;
+	return owner.stats;
+}
+
+// Adds to a counter of the calling thread
+inline void statsAdd(std::atomic<uint64_t>& counter, uint64_t count)
+{
+	counter.store(counter.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+}
+
+// Counts an evaluate() result and returns it
+inline int statsResult(int errorCode)
+{
+	int slot = (errorCode >= 0 && errorCode < STATS_ERROR_CODES) ? errorCode : STATS_ERROR_CODES - 1;
+	statsAdd(threadStats().errorCounts[slot], 1);
+	return errorCode;
+}
+
+// Returns a time stamp: processor cycles on x86, nanoseconds elsewhere
+inline uint64_t statsCycles()
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+	return __rdtsc();
+#else
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Tracks the nesting of parentheses while it is alive
+struct StatsDepthGuard
+{
+	StatsDepthGuard()
+	{
+		ThreadStats& stats = threadStats();
+		statsAdd(stats.parenCalls, 1);
+		if (++stats.depth > stats.maxDepth.load(std::memory_order_relaxed)) stats.maxDepth.store(stats.depth, std::memory_order_relaxed);
+	}
+	~StatsDepthGuard() { --threadStats().depth; }
+};
+
+#define STATS_ADD(counter, count) statsAdd(threadStats().counter, (count))
+#define STATS_RESULT(errorCode) statsResult(errorCode)
+#define STATS_PAREN() StatsDepthGuard statsDepthGuard
+#define STATS_TIMER(name) uint64_t name = statsCycles()
+#define STATS_PHASE(phase, timer) statsAdd(threadStats().phaseCycles[phase], statsCycles() - (timer))
+
+#else
+
+#define STATS_ADD(counter, count) ((void)0)
+#define STATS_RESULT(errorCode) (errorCode)
+#define STATS_PAREN() ((void)0)
+#define STATS_TIMER(name) ((void)0)
+#define STATS_PHASE(phase, timer) ((void)0)
+
+#endif // EVALUATOR_STATS
+
+#endif // INSTRUMENTATION_HPP
@@ -0,0 +1,153 @@
+/*
+ * File: iterativeEvaluator.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of the iterative expression evaluator.
+ * parse() is turned into a loop: parsing an operand either finds a number, which is handed to
+ * the innermost open level, or an opening parenthesis, which opens a new level. A level that
+ * runs out of operators is closed by its ')' and its value is handed to the level below.
+ */
+
+// Include necessary headers
+#include "iterativeEvaluator.hpp"
+#include "expressionEvaluator.hpp"
+#include "simdKernels.hpp"
+#include "constants.hpp"
+
+// Operand of a level being parsed
+namespace PHASE
+{
+    static const char LEFT = 0;  // The first operand of the level
+    static const char RIGHT = 1; // The operand after an operator
+}
+
+// Parses the expression like parse() does, with the frames kept in 'stack'.
+// The innermost level lives in local variables, and the stack only holds the levels around it.
+int parseIterative(const char*& cur, int& result, ParseStack& stack)
+{
+    std::vector<ParseFrame>& frames = stack.frames;
+    frames.clear();
+
+    // The innermost level
+    int levelSign = 1, left = 0, right = 0;
+    char operation = 0, phase = PHASE::LEFT;
+
+    // Without a deadline the clock is never read
+    bool timed = stack.deadline != std::chrono::steady_clock::time_point::max();
+    int untilCheck = DEADLINE_CHECK_INTERVAL;
+
+    while (true) {
+        // Parse the next operand, like parseNext()
+        skipSpaces(cur);
+        int sign = 1;
+        if (*cur == '-') { sign = -1; ++cur; skipSpaces(cur); } // Handle negative sign
+
+        // An opening parenthesis starts a new level, which then needs its first operand
+        if (*cur == '(') {
+            if ((int)frames.size() >= stack.maxDepth) return ERROR::DEPTH_EXCEEDED;
+            ++cur;
+            frames.push_back({ levelSign, left, right, operation, phase });
+            levelSign = sign;
+            phase = PHASE::LEFT;
+            continue;
+        }
+        else if (*cur == ')') return ERROR::UNMATCHED_PAREN;
+        else if (*cur < '0' || *cur > '9') return ERROR::INVALID_CHARACTER;
+
+        // Look at the clock now and then
+        if (timed && --untilCheck == 0) {
+            untilCheck = DEADLINE_CHECK_INTERVAL;
+            if (std::chrono::steady_clock::now() >= stack.deadline) return ERROR::DEADLINE_EXCEEDED;
+        }
+
+        // Parse the number
+        int val = 0;
+        if (cur[1] < '0' || cur[1] > '9') val = *cur++ - '0';
+        else val = parseDigits(cur);
+        int value = sign * val;
+        skipSpaces(cur);
+
+        // Hand the value to the innermost level, closing every level that is finished
+        while (true) {
+            if (phase == PHASE::LEFT) left = value;
+            else {
+                right = value;
+
+                // One step of a multiplication and division chain, exactly like parse()
+                if (operation == '*' || operation == '/') {
+                    if (operation == '*') left *= right;
+                    else {
+                        if (right == 0) return ERROR::DIV_BY_ZERO; // Division by zero error
+                        left /= right;
+                    }
+
+                    // The chain goes on, parse its next right-hand value
+                    skipSpaces(cur);
+                    operation = *cur;
+                    if (operation == '*' || operation == '/') { ++cur; break; }
+                }
+
+                // Addition and subtraction, with the operator that ended the chain if there was one
+                if (operation == '+') left += right;
+                else if (operation == '-') left -= right;
+            }
+
+            // Look for the next operator of the level
+            skipSpaces(cur);
+            char next = *cur;
+            if (next == '*' || next == '/' || next == '+' || next == '-') {
+                ++cur;
+                operation = next;
+                phase = PHASE::RIGHT;
+                break;
+            }
+
+            // The level is finished, the outermost one is the whole expression
+            if (frames.empty()) {
+                result = left;
+                return ERROR::SUCCESS;
+            }
+
+            // Close the parenthesis, see parseParen(), and go back to the level around it
+            skipSpaces(cur);
+            if (*cur != ')') return ERROR::MISSING_PAREN; // Missing closing parenthesis
+            ++cur;
+            value = levelSign * left;
+            const ParseFrame& outer = frames.back();
+            levelSign = outer.sign;
+            left = outer.left;
+            right = outer.right;
+            operation = outer.operation;
+            phase = outer.phase;
+            frames.pop_back();
+        }
+    }
+}
+
+// Evaluates the expression like evaluate() does, without recursion.
+int evaluateIterative(const char* expression, int& result, ParseStack& stack)
+{
+    result = 0;
+
+    // Null is an error here, where evaluate() would crash
+    if (expression == 0) return ERROR::INVALID_CHARACTER;
+
+    // First, check the expression is valid, like evaluate()
+    int errorCode = isValidExpression(expression);
+    if (errorCode != ERROR::SUCCESS) return errorCode;
+
+    // Parse it, the result is stored even if characters are left over
+    const char* cur = expression;
+    errorCode = parseIterative(cur, result, stack);
+    if (errorCode != ERROR::SUCCESS) return errorCode;
+
+    // If there are any characters left in the expression after parsing, it's an error
+    if (*cur != '\0') return ERROR::PARSE_ERROR;
+    return ERROR::SUCCESS;
+}
+
+// Same as above, with a stack kept per thread and the default depth limit.
+int evaluateIterative(const char* expression, int& result)
+{
+    thread_local ParseStack stack;
+    return evaluateIterative(expression, result, stack);
+}
@@ -0,0 +1,52 @@
+/*
+ * File: iterativeEvaluator.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of the iterative expression evaluator.
+ * It gives the same error codes and results as evaluate(), but keeps one frame per open
+ * parenthesis on an explicit stack instead of recursing, so deep nesting cannot overflow the
+ * native stack of the calling thread.
+ */
+
+#ifndef ITERATIVE_EVALUATOR_HPP
+#define ITERATIVE_EVALUATOR_HPP
+
+#include <chrono>
+#include <vector>
+
+// Nesting depth accepted when no other limit is given
+static const int DEFAULT_MAX_DEPTH = 1000000;
+
+// State of a parenthesis level around the one being parsed, what parse() keeps in local variables
+struct ParseFrame
+{
+	int sign;       // Sign in front of the parenthesis (1 or -1)
+	int left;       // Left-hand value of the level
+	int right;      // Last right-hand value of the level
+	char operation; // Pending operator
+	char phase;     // Which operand of the level is being parsed
+};
+
+// Numbers parsed between two looks at the clock, when a deadline is set
+static const int DEADLINE_CHECK_INTERVAL = 4096;
+
+// Stack of parse frames, meant to be reused from one evaluation to the next
+struct ParseStack
+{
+	std::vector<ParseFrame> frames;    // One frame per open parenthesis
+	int maxDepth = DEFAULT_MAX_DEPTH;  // Parentheses deeper than this give ERROR::DEPTH_EXCEEDED
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max(); // See parseIterative()
+};
+
+// Parses the expression like parse() does, with the frames kept in 'stack'.
+// Opening a parenthesis deeper than stack.maxDepth returns ERROR::DEPTH_EXCEEDED, and still parsing
+// at stack.deadline (checked every DEADLINE_CHECK_INTERVAL numbers) returns ERROR::DEADLINE_EXCEEDED.
+int parseIterative(const char*& cur, int& result, ParseStack& stack);
+
+// Evaluates the expression like evaluate() does, without recursion.
+// The stack only grows to the deepest nesting seen, so reusing it avoids allocations.
+int evaluateIterative(const char* expression, int& result, ParseStack& stack);
+
+// Same as above, with a stack kept per thread and the default depth limit.
+int evaluateIterative(const char* expression, int& result);
+
+#endif // ITERATIVE_EVALUATOR_HPP
@@ -0,0 +1,338 @@
+/*
+ * File: jitCompiler.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of the native code compiler for compiled expressions.
+ * Every postfix instruction becomes a few x86-64 instructions. The top of the value stack is kept
+ * in eax and the values below it are pushed on the native stack; temporaries live in the frame
+ * below rbp. Divisions test their divisor first and jump to a stub returning ERROR::DIV_BY_ZERO,
+ * and INT_MIN / -1 traps exactly like it does in run().
+ */
+
+// Include necessary headers
+#include "jitCompiler.hpp"
+#include "constants.hpp"
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_SUPPORTED 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Releases the native code when the object is destroyed
+JitExpression::~JitExpression()
+{
+    releaseJit(*this);
+}
+
+// Releases the native code when the object is destroyed
+JitModule::~JitModule()
+{
+    releaseJit(*this);
+}
+
+// Returns true if native code can be generated on this platform.
+bool jitSupported()
+{
+#ifdef JIT_SUPPORTED
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Releases the native code.
+void releaseJit(JitExpression& jit)
+{
+#ifdef JIT_SUPPORTED
+    if (jit.memory) munmap(jit.memory, jit.size);
+#endif
+    jit.memory = 0;
+    jit.size = 0;
+    jit.entry = 0;
+}
+
+// Releases the native code of a module.
+void releaseJit(JitModule& module)
+{
+#ifdef JIT_SUPPORTED
+    if (module.memory) munmap(module.memory, module.size);
+#endif
+    module.memory = 0;
+    module.size = 0;
+    module.entries.clear();
+}
+
+#ifdef JIT_SUPPORTED
+
+// Machine code being written
+struct CodeBuffer
+{
+    std::vector<unsigned char> bytes;  // The code
+    std::vector<size_t> divisionJumps; // Offsets of the jumps to the division by zero stub
+};
+
+// Appends bytes to the code
+static void emitBytes(CodeBuffer& code, std::initializer_list<unsigned char> bytes)
+{
+    code.bytes.insert(code.bytes.end(), bytes);
+}
+
+// Appends a 32 bit little endian value to the code
+static void emit32(CodeBuffer& code, int32_t value)
+{
+    for (int b = 0; b < 4; ++b) code.bytes.push_back((unsigned char)((uint32_t)value >> (8 * b)));
+}
+
+// Saves the top of the stack before something new is loaded into eax
+static void emitPushTop(CodeBuffer& code, int depth)
+{
+    if (depth > 0) emitBytes(code, { 0x50 });              // push rax
+}
+
+// Jumps to the division by zero stub if the divisor in eax is zero
+static void emitDivisionCheck(CodeBuffer& code)
+{
+    emitBytes(code, { 0x85, 0xC0 });                       // test eax, eax
+    emitBytes(code, { 0x0F, 0x84 });                       // jz stub
+    code.divisionJumps.push_back(code.bytes.size());
+    emit32(code, 0);                                       // Patched once the stub is written
+}
+
+// Returns the offset of a temporary from rbp
+static int32_t tempOffset(int temp)
+{
+    return -8 * (temp + 1);
+}
+
+// Writes the machine code of a program. The function follows the System V calling convention:
+// rdi holds the values and rsi the result, and eax returns the error code.
+static void generateCode(const CompiledExpression& program, CodeBuffer& code)
+{
+    // Frame for the temporaries, kept 16 byte aligned
+    int frameSize = (program.tempCount * 8 + 15) & ~15;
+    emitBytes(code, { 0x55 });                             // push rbp
+    emitBytes(code, { 0x48, 0x89, 0xE5 });                 // mov rbp, rsp
+    if (frameSize) {
+        emitBytes(code, { 0x48, 0x81, 0xEC });             // sub rsp, frameSize
+        emit32(code, frameSize);
+    }
+
+    // Number of values on the stack, the top one being in eax
+    int depth = 0;
+    for (const Instruction& ins : program.code) {
+        switch (ins.opcode) {
+        case OPCODE::PUSH:
+            emitPushTop(code, depth++);
+            emitBytes(code, { 0xB8 });                     // mov eax, imm32
+            emit32(code, ins.operand);
+            break;
+        case OPCODE::LOAD:
+            emitPushTop(code, depth++);
+            emitBytes(code, { 0x8B, 0x87 });               // mov eax, [rdi + 4 * slot]
+            emit32(code, 4 * ins.operand);
+            break;
+        case OPCODE::LOADT:
+            emitPushTop(code, depth++);
+            emitBytes(code, { 0x8B, 0x85 });               // mov eax, [rbp + offset]
+            emit32(code, tempOffset(ins.operand));
+            break;
+        case OPCODE::STORE:
+            emitBytes(code, { 0x89, 0x85 });               // mov [rbp + offset], eax
+            emit32(code, tempOffset(ins.operand));
+            break;
+        case OPCODE::NEG:
+            emitBytes(code, { 0xF7, 0xD8 });               // neg eax
+            break;
+        case OPCODE::ADD:
+        case OPCODE::SUB:
+        case OPCODE::MUL:
+            // The right value is in eax, the left one on the native stack
+            emitBytes(code, { 0x89, 0xC1 });               // mov ecx, eax
+            emitBytes(code, { 0x58 });                     // pop rax
+            if (ins.opcode == OPCODE::ADD) emitBytes(code, { 0x01, 0xC8 });            // add eax, ecx
+            else if (ins.opcode == OPCODE::SUB) emitBytes(code, { 0x29, 0xC8 });       // sub eax, ecx
+            else emitBytes(code, { 0x0F, 0xAF, 0xC1 });                                // imul eax, ecx
+            --depth;
+            break;
+        case OPCODE::DIV:
+            emitDivisionCheck(code);
+            emitBytes(code, { 0x89, 0xC1 });               // mov ecx, eax
+            emitBytes(code, { 0x58 });                     // pop rax
+            emitBytes(code, { 0x99 });                     // cdq
+            emitBytes(code, { 0xF7, 0xF9 });               // idiv ecx
+            --depth;
+            break;
+        case OPCODE::MULK:
+            // The left value is replaced in place, the right one stays on top
+            emitBytes(code, { 0x8B, 0x0C, 0x24 });         // mov ecx, [rsp]
+            emitBytes(code, { 0x0F, 0xAF, 0xC8 });         // imul ecx, eax
+            emitBytes(code, { 0x89, 0x0C, 0x24 });         // mov [rsp], ecx
+            break;
+        case OPCODE::DIVK:
+            emitDivisionCheck(code);
+            emitBytes(code, { 0x89, 0xC1 });               // mov ecx, eax
+            emitBytes(code, { 0x8B, 0x04, 0x24 });         // mov eax, [rsp]
+            emitBytes(code, { 0x99 });                     // cdq
+            emitBytes(code, { 0xF7, 0xF9 });               // idiv ecx
+            emitBytes(code, { 0x89, 0x04, 0x24 });         // mov [rsp], eax
+            emitBytes(code, { 0x89, 0xC8 });               // mov eax, ecx
+            break;
+        case OPCODE::RETURN:
+            emitBytes(code, { 0x89, 0x06 });               // mov [rsi], eax
+            [[fallthrough]];
+        case OPCODE::FAIL:
+            emitBytes(code, { 0xB8 });                     // mov eax, error code
+            emit32(code, ins.operand);
+            emitBytes(code, { 0xC9, 0xC3 });               // leave, ret
+            break;
+        }
+    }
+
+    // The division by zero stub, the result is left untouched like in run()
+    size_t stub = code.bytes.size();
+    emitBytes(code, { 0xB8 });                             // mov eax, ERROR::DIV_BY_ZERO
+    emit32(code, ERROR::DIV_BY_ZERO);
+    emitBytes(code, { 0xC9, 0xC3 });                       // leave, ret
+    for (size_t jump : code.divisionJumps) {
+        int32_t offset = (int32_t)(stub - (jump + 4));
+        memcpy(&code.bytes[jump], &offset, sizeof(offset));
+    }
+}
+
+// Returns true if a program is small enough for the native stack
+static bool fitsNativeStack(const CompiledExpression& program)
+{
+    return !program.code.empty() && program.maxStack <= JIT_MAX_STACK && program.tempCount <= JIT_MAX_STACK;
+}
+
+// Copies machine code to fresh pages, then makes them executable and no longer writable.
+// Returns null if the pages could not be mapped.
+static void* mapCode(const std::vector<unsigned char>& bytes, size_t& size)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size = (bytes.size() + page - 1) / page * page;
+    void* memory = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return 0;
+    memcpy(memory, bytes.data(), bytes.size());
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        return 0;
+    }
+    return memory;
+}
+
+#endif // JIT_SUPPORTED
+
+// Generates native code for a program, replacing any code 'jit' already held.
+bool jitCompile(const CompiledExpression& program, JitExpression& jit)
+{
+    releaseJit(jit);
+
+#ifdef JIT_SUPPORTED
+    // Programs that would need too much native stack stay with the interpreter
+    if (!fitsNativeStack(program)) return false;
+
+    CodeBuffer code;
+    code.bytes.reserve(program.code.size() * 16 + 32);
+    generateCode(program, code);
+
+    size_t size = 0;
+    void* memory = mapCode(code.bytes, size);
+    if (!memory) return false;
+    jit.memory = memory;
+    jit.size = size;
+    jit.entry = (JitFunction)memory;
+    return true;
+#else
+    (void)program;
+    return false;
+#endif
+}
+
+// Generates native code for many programs into shared pages.
+bool jitCompile(const CompiledExpression* programs, size_t count, JitModule& module)
+{
+    releaseJit(module);
+
+#ifdef JIT_SUPPORTED
+    // Every function starts on a 16 byte boundary, and its offset is kept until the pages exist
+    std::vector<unsigned char> bytes;
+    std::vector<size_t> offsets(count, SIZE_MAX);
+    CodeBuffer code;
+    for (size_t i = 0; i < count; ++i) {
+        if (!fitsNativeStack(programs[i])) continue;
+        bytes.resize((bytes.size() + 15) & ~(size_t)15, 0xCC); // int3 padding
+        code.bytes.clear();
+        code.divisionJumps.clear();
+        generateCode(programs[i], code);
+        offsets[i] = bytes.size();
+        bytes.insert(bytes.end(), code.bytes.begin(), code.bytes.end());
+    }
+
+    module.entries.assign(count, nullptr);
+    if (bytes.empty()) return true;
+    size_t size = 0;
+    void* memory = mapCode(bytes, size);
+    if (!memory) {
+        module.entries.clear();
+        return false;
+    }
+    module.memory = memory;
+    module.size = size;
+    for (size_t i = 0; i < count; ++i) {
+        if (offsets[i] != SIZE_MAX) module.entries[i] = (JitFunction)((unsigned char*)memory + offsets[i]);
+    }
+    return true;
+#else
+    (void)programs;
+    (void)count;
+    return false;
+#endif
+}
+
+// Runs native code, with the same error code and result as run() on the program it came from.
+int runJit(const JitExpression& jit, const int* values, int& result)
+{
+    // Initialize the result to 0, like run()
+    result = 0;
+    if (!jit.entry) return ERROR::PARSE_ERROR; // No code, jitCompile() failed or was not called
+    return jit.entry(values, &result);
+}
+
+// Runs the native code of a program in a module.
+int runJit(const JitModule& module, size_t index, const int* values, int& result)
+{
+    result = 0;
+    if (index >= module.entries.size() || !module.entries[index]) return ERROR::PARSE_ERROR;
+    return module.entries[index](values, &result);
+}
+
+// Runs a tiered expression, compiling it to native code once it is hot.
+int runTiered(TieredExpression& expression, const int* values, int& result)
+{
+    JitFunction native = expression.native.load(std::memory_order_acquire);
+    if (native) {
+        result = 0;
+        return native(values, &result);
+    }
+
+    // Exactly one run sees the count go past the threshold, and compiles the program.
+    // Other threads keep interpreting until the code is published.
+    unsigned runs = expression.runs.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (runs == expression.threshold + 1 && jitCompile(expression.program, expression.jit)) {
+        expression.native.store(expression.jit.entry, std::memory_order_release);
+        result = 0;
+        return expression.jit.entry(values, &result);
+    }
+    return run(expression.program, values, result);
+}
+
+// Same as above, for a program without variables.
+int runTiered(TieredExpression& expression, int& result)
+{
+    return runTiered(expression, 0, result);
+}
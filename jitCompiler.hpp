@@ -0,0 +1,99 @@
+/*
+ * File: jitCompiler.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of the native code compiler for compiled expressions.
+ * On Linux x86-64 a compiled program can be turned into machine code in executable memory,
+ * which gives the same error code and result as run() without an interpreter loop. Elsewhere
+ * (or for programs too large for it) nothing is generated and run() is used instead.
+ */
+
+#ifndef JIT_COMPILER_HPP
+#define JIT_COMPILER_HPP
+
+#include "compiledExpression.hpp"
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Number of runs after which runTiered() compiles a program to native code
+static const unsigned DEFAULT_JIT_THRESHOLD = 1000;
+
+// Largest value stack and number of temporaries of a program compiled to native code.
+// The values live on the native stack, so deeper programs stay with the interpreter.
+static const int JIT_MAX_STACK = 16384;
+
+// Signature of the generated code: it returns the error code and stores the result like run()
+typedef int (*JitFunction)(const int* values, int* result);
+
+// Native code of a compiled program, released when the object is destroyed
+struct JitExpression
+{
+	void* memory = 0;      // Executable pages holding the code
+	size_t size = 0;       // Size of the pages
+	JitFunction entry = 0; // The generated function, null if there is none
+
+	JitExpression() = default;
+	~JitExpression();
+	JitExpression(const JitExpression&) = delete;
+	JitExpression& operator=(const JitExpression&) = delete;
+};
+
+// Native code of many compiled programs packed into the same pages, released when the object
+// is destroyed. A page per program wastes memory and TLB entries when there are many small ones.
+struct JitModule
+{
+	void* memory = 0;                 // Executable pages holding the code
+	size_t size = 0;                  // Size of the pages
+	std::vector<JitFunction> entries; // The generated functions, null for the programs left to run()
+
+	JitModule() = default;
+	~JitModule();
+	JitModule(const JitModule&) = delete;
+	JitModule& operator=(const JitModule&) = delete;
+};
+
+// A compiled program that is interpreted until it is hot, then run as native code.
+// It can be run from several threads at once.
+struct TieredExpression
+{
+	CompiledExpression program;                // The program, run by the interpreter until it is hot
+	unsigned threshold = DEFAULT_JIT_THRESHOLD; // Runs interpreted before compiling to native code
+	std::atomic<unsigned> runs{ 0 };           // Runs so far, until the native code is ready
+	std::atomic<JitFunction> native{ nullptr }; // Native code once it is ready
+	JitExpression jit;                         // Owner of the native code
+};
+
+// Returns true if native code can be generated on this platform.
+bool jitSupported();
+
+// Generates native code for a program, replacing any code 'jit' already held.
+// It returns false, and leaves 'jit' empty, if the platform is not supported or the program
+// is too deep for the native stack. run() must then be used instead.
+bool jitCompile(const CompiledExpression& program, JitExpression& jit);
+
+// Releases the native code.
+void releaseJit(JitExpression& jit);
+
+// Generates native code for 'count' programs into shared pages, replacing any code 'module'
+// already held. entries[i] is null for the programs that cannot be compiled. It returns false,
+// and leaves 'module' empty, if the platform is not supported.
+bool jitCompile(const CompiledExpression* programs, size_t count, JitModule& module);
+
+// Releases the native code of a module.
+void releaseJit(JitModule& module);
+
+// Runs native code, with the same error code and result as run() on the program it came from.
+// 'values' holds the variables, indexed by slot, and may be null if the program has none.
+int runJit(const JitExpression& jit, const int* values, int& result);
+
+// Runs the native code of a program in a module, or returns ERROR::PARSE_ERROR if it has none.
+int runJit(const JitModule& module, size_t index, const int* values, int& result);
+
+// Runs a tiered expression: interpreted for the first 'threshold' runs, then compiled to native
+// code once and run natively from then on (or interpreted forever if compiling fails).
+int runTiered(TieredExpression& expression, const int* values, int& result);
+
+// Same as above, for a program without variables.
+int runTiered(TieredExpression& expression, int& result);
+
+#endif // JIT_COMPILER_HPP
@@ -0,0 +1,211 @@
+/*
+ * File: numericEvaluator.hpp
+ * Author: Alex Turner
+ * Description: This file contains the expression evaluator generic over its value type.
+ * evaluateNumeric<T, Policy>() parses like evaluate(), quirks included, but computes in T (int32_t,
+ * int64_t or, where the compiler has it, int128_t) and treats overflow as the policy says: wrap around,
+ * saturate at the limits of T, or stop with ERROR::VALUE_OVERFLOW. Both are template parameters, so every
+ * instantiation is its own specialized parser, without a single run-time test of the type or the policy.
+ * The checks of isValidExpression() and the skipping of spaces are shared with evaluate().
+ */
+
+#ifndef NUMERIC_EVALUATOR_HPP
+#define NUMERIC_EVALUATOR_HPP
+
+#include "expressionEvaluator.hpp"
+#include "constants.hpp"
+#include <cstdint>
+
+#ifdef __SIZEOF_INT128__
+// 128 bit integers, where the compiler has them
+__extension__ typedef __int128 int128_t;
+#endif
+
+// Limits of a signed integer type, computed from its size since std::numeric_limits does not
+// know __int128 in strict standard mode
+template <typename T>
+struct NumericLimits
+{
+	static constexpr T max() { return (T)(((T)1 << (sizeof(T) * 8 - 2)) - 1 + ((T)1 << (sizeof(T) * 8 - 2))); }
+	static constexpr T min() { return (T)(-max() - 1); }
+};
+
+// Overflow policy: results wrap around like unsigned arithmetic of the same width.
+// With T = int this is what evaluate() does, except for MIN / -1, which gives MIN instead of trapping.
+struct WrapOverflow
+{
+	template <typename T> static bool add(T a, T b, T& out) { __builtin_add_overflow(a, b, &out); return true; }
+	template <typename T> static bool sub(T a, T b, T& out) { __builtin_sub_overflow(a, b, &out); return true; }
+	template <typename T> static bool mul(T a, T b, T& out) { __builtin_mul_overflow(a, b, &out); return true; }
+	template <typename T> static bool div(T a, T b, T& out)
+	{
+		if (b == -1) __builtin_sub_overflow((T)0, a, &out); // MIN / -1 is the only quotient that does not fit
+		else out = a / b;
+		return true;
+	}
+};
+
+// Overflow policy: results are clamped to the limits of T, the nearest value that exists
+struct SaturateOverflow
+{
+	template <typename T> static bool add(T a, T b, T& out)
+	{
+		if (__builtin_add_overflow(a, b, &out)) out = b > 0 ? NumericLimits<T>::max() : NumericLimits<T>::min();
+		return true;
+	}
+	template <typename T> static bool sub(T a, T b, T& out)
+	{
+		if (__builtin_sub_overflow(a, b, &out)) out = b < 0 ? NumericLimits<T>::max() : NumericLimits<T>::min();
+		return true;
+	}
+	template <typename T> static bool mul(T a, T b, T& out)
+	{
+		if (__builtin_mul_overflow(a, b, &out)) out = (a < 0) != (b < 0) ? NumericLimits<T>::min() : NumericLimits<T>::max();
+		return true;
+	}
+	template <typename T> static bool div(T a, T b, T& out)
+	{
+		out = (b == -1 && a == NumericLimits<T>::min()) ? NumericLimits<T>::max() : a / b;
+		return true;
+	}
+};
+
+// Overflow policy: an operation whose exact result does not fit in T stops the evaluation with
+// ERROR::VALUE_OVERFLOW, which replaces checking the result again with wider integers afterwards
+struct CheckedOverflow
+{
+	template <typename T> static bool add(T a, T b, T& out) { return !__builtin_add_overflow(a, b, &out); }
+	template <typename T> static bool sub(T a, T b, T& out) { return !__builtin_sub_overflow(a, b, &out); }
+	template <typename T> static bool mul(T a, T b, T& out) { return !__builtin_mul_overflow(a, b, &out); }
+	template <typename T> static bool div(T a, T b, T& out)
+	{
+		if (b == -1 && a == NumericLimits<T>::min()) return false;
+		out = a / b;
+		return true;
+	}
+};
+
+template <typename T, typename Policy>
+int numericParse(const char*& cur, T& result);
+
+// Parses a parenthesis, see parseParen(). A '-' in front of it negates its value under the policy.
+template <typename T, typename Policy>
+int numericParseParen(bool negative, const char*& cur, T& result)
+{
+	// Move past the opening parenthesis and parse what is inside
+	++cur;
+	T parenValue = 0;
+	int err = numericParse<T, Policy>(cur, parenValue);
+	if (err) return err;
+
+	// Ensure the next character is a closing parenthesis
+	skipSpaces(cur);
+	if (*cur != ')') return ERROR::MISSING_PAREN;
+	++cur;
+
+	if (!negative) result = parenValue;
+	else if (!Policy::sub((T)0, parenValue, result)) return ERROR::VALUE_OVERFLOW;
+	return ERROR::SUCCESS;
+}
+
+// Parses the next number or parenthesis, see parseNext().
+// The digits of a negative number are accumulated downwards, so the smallest value of T can be written.
+template <typename T, typename Policy>
+int numericParseNext(const char*& cur, T& result)
+{
+	skipSpaces(cur);
+
+	bool negative = false;
+	if (*cur == '-') { negative = true; ++cur; skipSpaces(cur); }
+
+	if (*cur == '(') return numericParseParen<T, Policy>(negative, cur, result);
+	else if (*cur == ')') return ERROR::UNMATCHED_PAREN;
+	else if (*cur < '0' || *cur > '9') return ERROR::INVALID_CHARACTER;
+
+	T val = 0;
+	while (*cur >= '0' && *cur <= '9') {
+		T digit = (T)(*cur++ - '0');
+		if (!Policy::mul(val, (T)10, val)) return ERROR::VALUE_OVERFLOW;
+		if (!(negative ? Policy::sub(val, digit, val) : Policy::add(val, digit, val))) return ERROR::VALUE_OVERFLOW;
+	}
+	result = val;
+
+	skipSpaces(cur);
+	return ERROR::SUCCESS;
+}
+
+// Parses the entire expression, see parse(): strictly left to right, and after a '*'/'/' chain
+// followed by '+' or '-', the last right-hand value is applied once more.
+template <typename T, typename Policy>
+int numericParse(const char*& cur, T& result)
+{
+	skipSpaces(cur);
+	T leftValue = 0;
+	int errorCode = numericParseNext<T, Policy>(cur, leftValue);
+	if (errorCode) return errorCode;
+
+	while (true) {
+		skipSpaces(cur);
+		char operation = *cur;
+		if (operation != '*' && operation != '/' && operation != '+' && operation != '-') break;
+		++cur;
+
+		T rightValue = 0;
+		errorCode = numericParseNext<T, Policy>(cur, rightValue);
+		if (errorCode) return errorCode;
+
+		// Multiplication and division chains
+		while (operation == '*' || operation == '/') {
+			if (operation == '*') {
+				if (!Policy::mul(leftValue, rightValue, leftValue)) return ERROR::VALUE_OVERFLOW;
+			}
+			else {
+				if (rightValue == 0) return ERROR::DIV_BY_ZERO;
+				if (!Policy::div(leftValue, rightValue, leftValue)) return ERROR::VALUE_OVERFLOW;
+			}
+
+			skipSpaces(cur);
+			operation = *cur;
+			if (operation != '*' && operation != '/') break;
+			++cur;
+
+			errorCode = numericParseNext<T, Policy>(cur, rightValue);
+			if (errorCode) return errorCode;
+		}
+
+		// Addition and subtraction
+		if (operation == '+' && !Policy::add(leftValue, rightValue, leftValue)) return ERROR::VALUE_OVERFLOW;
+		if (operation == '-' && !Policy::sub(leftValue, rightValue, leftValue)) return ERROR::VALUE_OVERFLOW;
+	}
+
+	result = leftValue;
+	return ERROR::SUCCESS;
+}
+
+// Evaluates the expression in T under the overflow policy, and returns the result in 'result'.
+// The error codes and result are those of evaluate(), computed in T, plus ERROR::VALUE_OVERFLOW
+// (result 0) from CheckedOverflow. For example:
+//   evaluateNumeric<int64_t, CheckedOverflow>("3000000000 * 2", value)   SUCCESS, 6000000000
+//   evaluateNumeric<int32_t, CheckedOverflow>("3000000000 * 2", value)   VALUE_OVERFLOW
+//   evaluateNumeric<int32_t, SaturateOverflow>("3000000000 * 2", value)  SUCCESS, 2147483647
+template <typename T, typename Policy>
+int evaluateNumeric(const char* expression, T& result)
+{
+	result = 0;
+
+	// The same checks as evaluate(), before parsing
+	int errorCode = isValidExpression(expression);
+	if (errorCode != ERROR::SUCCESS) return errorCode;
+
+	const char* cur = expression;
+	T value = 0;
+	errorCode = numericParse<T, Policy>(cur, value);
+	if (errorCode != ERROR::SUCCESS) return errorCode;
+
+	// Characters left after the expression are an error, but the result is still stored
+	result = value;
+	skipSpaces(cur);
+	return *cur != '\0' ? ERROR::PARSE_ERROR : ERROR::SUCCESS;
+}
+
+#endif // NUMERIC_EVALUATOR_HPP
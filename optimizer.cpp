@@ -0,0 +1,362 @@
+/*
+ * File: optimizer.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of the compiled expression optimizer.
+ * The postfix program is replayed on a stack of graph nodes instead of values. Nodes are
+ * created through makeNeg() and makeBinary(), which fold, simplify and share them, and the
+ * graph is then written back as a postfix program that keeps shared results in temporaries.
+ * Everything optimize() builds lives in the arena of the calling thread, so once that arena has
+ * grown to the size of the programs being optimized, optimizing allocates no memory at all.
+ */
+
+// Include necessary headers
+#include "optimizer.hpp"
+#include "constants.hpp"
+#include "arena.hpp"
+#include <climits>
+#include <cstdint>
+#include <utility>
+
+// Kinds of graph nodes
+namespace NODE
+{
+    static const int CONSTANT = 0; // Literal value
+    static const int VARIABLE = 1; // Variable slot
+    static const int NEG = 2;      // -a
+    static const int ADD = 3;      // a + b
+    static const int SUB = 4;      // a - b
+    static const int MUL = 5;      // a * b
+    static const int DIV = 6;      // a / b
+}
+
+// A node of the graph. Children always have a smaller index than their parent.
+struct Node
+{
+    int kind;     // One of the NODE constants
+    int a, b;     // Children (-1 when unused)
+    int value;    // Literal for CONSTANT, slot for VARIABLE
+    bool mayFail; // True if computing the node may divide by zero
+};
+
+// The graph being built, with the table used to share identical nodes
+struct Graph
+{
+    ArenaVector<Node> nodes;
+    ArenaVector<int> shared; // Open addressing table of nodes by hash of (kind, a, b, value), -1 when empty
+    OptimizeStats stats;
+
+    explicit Graph(Arena& arena) : nodes(ArenaAllocator<Node>(arena)), shared(ArenaAllocator<int>(arena)) {}
+};
+
+// Wrapping integer arithmetic, matching what run() does on every platform we build for,
+// without relying on signed overflow in the optimizer itself
+static inline int wrapAdd(int a, int b) { return (int)((unsigned)a + (unsigned)b); }
+static inline int wrapSub(int a, int b) { return (int)((unsigned)a - (unsigned)b); }
+static inline int wrapMul(int a, int b) { return (int)((unsigned)a * (unsigned)b); }
+static inline int wrapNeg(int a) { return (int)(0u - (unsigned)a); }
+
+// Returns true if the node is the given constant
+static inline bool isConstant(const Graph& graph, int node, int value)
+{
+    return graph.nodes[node].kind == NODE::CONSTANT && graph.nodes[node].value == value;
+}
+
+// Returns the hash of a node
+static inline uint64_t hashNode(int kind, int a, int b, int value)
+{
+    uint64_t hash = (uint64_t)kind * 0x9E3779B97F4A7C15ull;
+    hash ^= ((uint64_t)(uint32_t)a + 0x632BE59BD9B4E019ull) * 0xBF58476D1CE4E5B9ull;
+    hash ^= ((uint64_t)(uint32_t)b + 0x8CB92BA72F3D8DD7ull) * 0x94D049BB133111EBull;
+    hash ^= (uint64_t)(uint32_t)value * 0xD6E8FEB86659FD93ull;
+    return hash ^ (hash >> 29);
+}
+
+// Sizes the sharing table for 'nodes' nodes, at most half full, and puts the existing nodes back
+static void resizeShared(Graph& graph, size_t nodes)
+{
+    size_t size = 16;
+    while (size < nodes * 2) size *= 2;
+    graph.shared.assign(size, -1);
+    for (size_t node = 0; node < graph.nodes.size(); ++node) {
+        const Node& n = graph.nodes[node];
+        size_t slot = (size_t)hashNode(n.kind, n.a, n.b, n.value) & (size - 1);
+        while (graph.shared[slot] >= 0) slot = (slot + 1) & (size - 1);
+        graph.shared[slot] = (int)node;
+    }
+}
+
+// Returns the shared node equal to (kind, a, b, value), creating it if needed
+static int internNode(Graph& graph, int kind, int a, int b, int value)
+{
+    if ((graph.nodes.size() + 1) * 2 > graph.shared.size()) resizeShared(graph, graph.nodes.size() + 1);
+
+    size_t mask = graph.shared.size() - 1;
+    size_t slot = (size_t)hashNode(kind, a, b, value) & mask;
+    for (; graph.shared[slot] >= 0; slot = (slot + 1) & mask) {
+        int node = graph.shared[slot];
+        const Node& n = graph.nodes[node];
+        if (n.kind == kind && n.a == a && n.b == b && n.value == value) {
+            if (kind != NODE::CONSTANT && kind != NODE::VARIABLE) ++graph.stats.shared;
+            return node;
+        }
+    }
+
+    // A division may fail unless its divisor is a constant other than zero
+    bool mayFail = (a >= 0 && graph.nodes[a].mayFail) || (b >= 0 && graph.nodes[b].mayFail);
+    if (kind == NODE::DIV && !(graph.nodes[b].kind == NODE::CONSTANT && graph.nodes[b].value != 0)) mayFail = true;
+
+    graph.nodes.push_back({ kind, a, b, value, mayFail });
+    graph.shared[slot] = (int)graph.nodes.size() - 1;
+    return (int)graph.nodes.size() - 1;
+}
+
+// Returns the node for a constant
+static int makeConstant(Graph& graph, int value)
+{
+    return internNode(graph, NODE::CONSTANT, -1, -1, value);
+}
+
+// Returns the node for -a, folded or simplified when possible
+static int makeNeg(Graph& graph, int a)
+{
+    const Node& n = graph.nodes[a];
+    if (n.kind == NODE::CONSTANT) { ++graph.stats.folded; return makeConstant(graph, wrapNeg(n.value)); }
+    if (n.kind == NODE::NEG) { ++graph.stats.simplified; return n.a; } // -(-x) = x
+    return internNode(graph, NODE::NEG, a, -1, 0);
+}
+
+// Returns the node for (a kind b), folded or simplified when possible.
+// An identity that drops an operand is only used when that operand cannot fail.
+static int makeBinary(Graph& graph, int kind, int a, int b)
+{
+    const Node& left = graph.nodes[a];
+    const Node& right = graph.nodes[b];
+
+    // Constant folding, except the divisions that fail or trap at run time
+    if (left.kind == NODE::CONSTANT && right.kind == NODE::CONSTANT) {
+        int x = left.value, y = right.value;
+        bool fold = true;
+        int value = 0;
+        if (kind == NODE::ADD) value = wrapAdd(x, y);
+        else if (kind == NODE::SUB) value = wrapSub(x, y);
+        else if (kind == NODE::MUL) value = wrapMul(x, y);
+        else if (y == 0 || (x == INT_MIN && y == -1)) fold = false;
+        else value = x / y; // C++ division truncates toward zero, like run()
+        if (fold) { ++graph.stats.folded; return makeConstant(graph, value); }
+    }
+
+    switch (kind) {
+    case NODE::ADD:
+        if (isConstant(graph, b, 0)) { ++graph.stats.simplified; return a; }  // x + 0 = x
+        if (isConstant(graph, a, 0)) { ++graph.stats.simplified; return b; }  // 0 + x = x
+        break;
+    case NODE::SUB:
+        if (isConstant(graph, b, 0)) { ++graph.stats.simplified; return a; }  // x - 0 = x
+        if (isConstant(graph, a, 0)) { ++graph.stats.simplified; return makeNeg(graph, b); } // 0 - x = -x
+        if (a == b && !left.mayFail) { ++graph.stats.simplified; return makeConstant(graph, 0); } // x - x = 0
+        break;
+    case NODE::MUL:
+        if (isConstant(graph, b, 1)) { ++graph.stats.simplified; return a; }  // x * 1 = x
+        if (isConstant(graph, a, 1)) { ++graph.stats.simplified; return b; }  // 1 * x = x
+        if (isConstant(graph, b, -1)) { ++graph.stats.simplified; return makeNeg(graph, a); } // x * -1 = -x
+        if (isConstant(graph, a, -1)) { ++graph.stats.simplified; return makeNeg(graph, b); } // -1 * x = -x
+        if ((isConstant(graph, b, 0) && !left.mayFail) || (isConstant(graph, a, 0) && !right.mayFail)) {
+            ++graph.stats.simplified;
+            return makeConstant(graph, 0); // x * 0 = 0
+        }
+        break;
+    case NODE::DIV:
+        // x / -1 is not rewritten as -x, since INT_MIN / -1 traps in run()
+        if (isConstant(graph, b, 1)) { ++graph.stats.simplified; return a; }  // x / 1 = x
+        break;
+    }
+    return internNode(graph, kind, a, b, 0);
+}
+
+// Appends an instruction and tracks the stack depth of the new program
+static void emitInstruction(CompiledExpression& program, int& depth, int opcode, int operand, int stackChange)
+{
+    program.code.push_back({ opcode, operand });
+    depth += stackChange;
+    if (depth > program.maxStack) program.maxStack = depth;
+}
+
+// Writes the graph below 'root' back as a postfix program.
+// Operations used more than once are computed once and kept in a temporary.
+// The walk uses an explicit stack, since long expressions make very deep graphs.
+static void emitGraph(const Graph& graph, int root, int returnCode, CompiledExpression& program, Arena& arena)
+{
+    const ArenaVector<Node>& nodes = graph.nodes;
+
+    // Count the uses of every node reachable from the root (children come before parents)
+    ArenaVector<int> uses(nodes.size(), 0, ArenaAllocator<int>(arena));
+    uses[root] = 1;
+    for (int node = root; node >= 0; --node) {
+        if (uses[node] == 0) continue;
+        if (nodes[node].a >= 0) uses[nodes[node].a]++;
+        if (nodes[node].b >= 0) uses[nodes[node].b]++;
+    }
+
+    ArenaVector<int> temp(nodes.size(), -1, ArenaAllocator<int>(arena)); // Temporary holding a node, once computed
+    program.code.clear();
+    program.maxStack = 0;
+    program.tempCount = 0;
+    int depth = 0;
+
+    // Each frame is a node and whether its children have been written already
+    ArenaVector<std::pair<int, bool>> work{ ArenaAllocator<std::pair<int, bool>>(arena) };
+    work.push_back({ root, false });
+    while (!work.empty()) {
+        int node = work.back().first;
+        bool childrenDone = work.back().second;
+        work.pop_back();
+        const Node& n = nodes[node];
+
+        if (n.kind == NODE::CONSTANT) { emitInstruction(program, depth, OPCODE::PUSH, n.value, 1); continue; }
+        if (n.kind == NODE::VARIABLE) { emitInstruction(program, depth, OPCODE::LOAD, n.value, 1); continue; }
+        if (temp[node] >= 0) { emitInstruction(program, depth, OPCODE::LOADT, temp[node], 1); continue; }
+
+        if (!childrenDone) {
+            // Write the children first, left before right
+            work.push_back({ node, true });
+            if (n.b >= 0) work.push_back({ n.b, false });
+            work.push_back({ n.a, false });
+            continue;
+        }
+
+        switch (n.kind) {
+        case NODE::NEG: emitInstruction(program, depth, OPCODE::NEG, 0, 0); break;
+        case NODE::ADD: emitInstruction(program, depth, OPCODE::ADD, 0, -1); break;
+        case NODE::SUB: emitInstruction(program, depth, OPCODE::SUB, 0, -1); break;
+        case NODE::MUL: emitInstruction(program, depth, OPCODE::MUL, 0, -1); break;
+        case NODE::DIV: emitInstruction(program, depth, OPCODE::DIV, 0, -1); break;
+        }
+
+        // Keep shared results for their next use
+        if (uses[node] > 1) {
+            temp[node] = program.tempCount++;
+            emitInstruction(program, depth, OPCODE::STORE, temp[node], 0);
+        }
+    }
+    emitInstruction(program, depth, OPCODE::RETURN, returnCode, -1);
+}
+
+// Replays a program on a stack of graph nodes, setting the node of its result and its return code.
+// Returns false for a program that cannot be replayed: one ending with a syntax error, or one
+// using temporaries, which only appear in programs that are already optimized.
+static bool replayProgram(Graph& graph, const CompiledExpression& program, ArenaVector<int>& stack, int& root, int& returnCode)
+{
+    if (program.code.empty() || program.code.back().opcode != OPCODE::RETURN) return false;
+
+    stack.clear();
+    stack.reserve(program.maxStack);
+    for (const Instruction& ins : program.code) {
+        int right = -1;
+        switch (ins.opcode) {
+        case OPCODE::PUSH: stack.push_back(makeConstant(graph, ins.operand)); break;
+        case OPCODE::LOAD: stack.push_back(internNode(graph, NODE::VARIABLE, -1, -1, ins.operand)); break;
+        case OPCODE::NEG: stack.back() = makeNeg(graph, stack.back()); break;
+        case OPCODE::ADD:
+        case OPCODE::SUB:
+        case OPCODE::MUL:
+        case OPCODE::DIV: {
+            static const int kinds[] = { NODE::ADD, NODE::SUB, NODE::MUL, NODE::DIV };
+            right = stack.back();
+            stack.pop_back();
+            stack.back() = makeBinary(graph, kinds[ins.opcode - OPCODE::ADD], stack.back(), right);
+            break;
+        }
+        case OPCODE::MULK:
+        case OPCODE::DIVK:
+            // The right-hand value stays on the stack, it is now simply a shared node
+            right = stack.back();
+            stack[stack.size() - 2] = makeBinary(graph, ins.opcode == OPCODE::MULK ? NODE::MUL : NODE::DIV,
+                stack[stack.size() - 2], right);
+            break;
+        case OPCODE::RETURN:
+            root = stack.back();
+            returnCode = ins.operand;
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+// Optimizes a compiled program in place.
+void optimize(CompiledExpression& program, OptimizeStats* stats)
+{
+    // Everything below is freed at once when the function returns
+    Arena& arena = threadArena();
+    ArenaScope scope(arena);
+    Graph graph(arena);
+    graph.stats.instructionsBefore = (int)program.code.size();
+    graph.stats.instructionsAfter = graph.stats.instructionsBefore;
+
+    // Most instructions make at most one node
+    graph.nodes.reserve(program.code.size());
+    resizeShared(graph, program.code.size());
+
+    // Programs ending with a syntax error are kept as they are
+    ArenaVector<int> stack{ ArenaAllocator<int>(arena) };
+    int root = -1, returnCode = ERROR::SUCCESS;
+    if (!replayProgram(graph, program, stack, root, returnCode)) {
+        if (stats) *stats = graph.stats;
+        return;
+    }
+
+    emitGraph(graph, root, returnCode, program, arena);
+    graph.stats.instructionsAfter = (int)program.code.size();
+    if (stats) *stats = graph.stats;
+}
+
+// Optimizes several programs together into a single graph.
+void optimizeShared(const CompiledExpression* programs, size_t count, std::vector<GraphNode>& nodes,
+    std::vector<GraphRoot>& roots, OptimizeStats* stats)
+{
+    Arena& arena = threadArena();
+    ArenaScope scope(arena);
+    Graph graph(arena);
+    size_t instructions = 0;
+    for (size_t p = 0; p < count; ++p) instructions += programs[p].code.size();
+    graph.stats.instructionsBefore = (int)instructions;
+    graph.nodes.reserve(instructions);
+    resizeShared(graph, instructions);
+
+    // Every program is replayed into the same graph, so an operation already made by an earlier
+    // program is found in the sharing table instead of being made again
+    ArenaVector<int> stack{ ArenaAllocator<int>(arena) };
+    roots.assign(count, { -1, ERROR::SUCCESS });
+    for (size_t p = 0; p < count; ++p) {
+        int root = -1, returnCode = ERROR::SUCCESS;
+        if (replayProgram(graph, programs[p], stack, root, returnCode)) roots[p] = { root, returnCode };
+    }
+
+    // Keep only the nodes some result needs, numbered in the same order, so children still come first
+    ArenaVector<int> index(graph.nodes.size(), -1, ArenaAllocator<int>(arena));
+    for (const GraphRoot& root : roots) {
+        if (root.node >= 0) index[root.node] = 0;
+    }
+    for (int node = (int)graph.nodes.size() - 1; node >= 0; --node) {
+        if (index[node] < 0) continue;
+        if (graph.nodes[node].a >= 0) index[graph.nodes[node].a] = 0;
+        if (graph.nodes[node].b >= 0) index[graph.nodes[node].b] = 0;
+    }
+
+    static const int opcodes[] = { OPCODE::PUSH, OPCODE::LOAD, OPCODE::NEG, OPCODE::ADD, OPCODE::SUB, OPCODE::MUL, OPCODE::DIV };
+    nodes.clear();
+    for (size_t node = 0; node < graph.nodes.size(); ++node) {
+        if (index[node] < 0) continue;
+        const Node& n = graph.nodes[node];
+        index[node] = (int)nodes.size();
+        if (n.kind == NODE::CONSTANT || n.kind == NODE::VARIABLE) nodes.push_back({ opcodes[n.kind], n.value, -1 });
+        else nodes.push_back({ opcodes[n.kind], index[n.a], n.b >= 0 ? index[n.b] : -1 });
+    }
+    for (GraphRoot& root : roots) {
+        if (root.node >= 0) root.node = index[root.node];
+    }
+
+    graph.stats.instructionsAfter = (int)nodes.size();
+    if (stats) *stats = graph.stats;
+}
@@ -0,0 +1,59 @@
+/*
+ * File: optimizer.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of the compiled expression optimizer.
+ * It rewrites a compiled program so it does less work on every run, without changing
+ * the error code or the result of any run.
+ */
+
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include "compiledExpression.hpp"
+#include <cstddef>
+#include <vector>
+
+// Counters describing what optimize() did
+struct OptimizeStats
+{
+	int instructionsBefore = 0; // Length of the program before optimizing
+	int instructionsAfter = 0;  // Length of the program after optimizing
+	int folded = 0;             // Operations computed at compile time
+	int simplified = 0;         // Operations removed by an algebraic identity
+	int shared = 0;             // Repeated operations computed only once
+};
+
+// Optimizes a compiled program in place.
+// The program is turned into a graph of operations in which identical operations are shared
+// (common subexpression elimination), operations on constants are computed (constant folding)
+// and safe integer identities are applied (x + 0, x * 1, x - x, ...).
+// Division by a constant zero is never folded, and operations that may divide by zero are never
+// dropped, so every run gives the same error code and the same result as before, bit for bit.
+// Programs that end with a syntax error are left as they are.
+void optimize(CompiledExpression& program, OptimizeStats* stats = 0);
+
+// A node of a shared graph, see optimizeShared().
+// Operands always come before the nodes that use them.
+struct GraphNode
+{
+	int opcode; // PUSH, LOAD, NEG, ADD, SUB, MUL or DIV
+	int a;      // Literal for PUSH, slot for LOAD, otherwise the index of the left (or only) operand
+	int b;      // Index of the right operand of ADD, SUB, MUL and DIV, -1 otherwise
+};
+
+// Where the result of a program is found in a shared graph
+struct GraphRoot
+{
+	int node;       // Node holding the result, -1 for a program that could not be replayed
+	int returnCode; // Error code returned along with the result (see OPCODE::RETURN)
+};
+
+// Optimizes several programs together into a single graph, in which an operation appearing in more
+// than one program is made only once: the same folding, identities and sharing as optimize(), across
+// the whole set. roots[i] tells where the result of programs[i] is. Programs that end with a syntax
+// error, or that are already optimized, get a root of -1 and are left to the caller.
+// In the stats, instructionsAfter is the number of nodes of the graph.
+void optimizeShared(const CompiledExpression* programs, size_t count, std::vector<GraphNode>& nodes,
+	std::vector<GraphRoot>& roots, OptimizeStats* stats = 0);
+
+#endif // OPTIMIZER_HPP
@@ -0,0 +1,279 @@
+/*
+ * File: parallelEvaluator.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of the parallel evaluator of a single expression.
+ * It runs in four steps:
+ *   1. every range of the text is counted on its own (digits, operators, parenthesis depth, first
+ *      invalid character), and the counts are added up in order to give the result of isValidExpression();
+ *   2. every range looks for the first '+' or '-' outside parentheses that follows a number or a ')'
+ *      (a binary operator, never a sign), where the next piece starts;
+ *   3. every piece is parsed like parse() does, into a list of steps of the value on its left;
+ *   4. the steps are applied in order, stopping at the first piece that stopped or failed.
+ * The top level of parse() applies, for each operator and its right-hand value t:
+ *   '+' x + t, '-' x - t, '*' x * t, '/' x / t, and after a '*'/'/' chain followed by '+' or '-', the
+ *   last t once more (see parse()). The first value of the expression is '+' t on 0.
+ * Wrapping 32 bit arithmetic is a ring, so a run of '+', '-' and '*' is exactly x * m + a.
+ */
+
+// Include necessary headers
+#include "parallelEvaluator.hpp"
+#include "expressionEvaluator.hpp"
+#include "threadPool.hpp"
+#include "constants.hpp"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// A step of a piece: an optional division of the value, then x * mul + add
+struct AffineStep
+{
+    bool divide;      // Divide by 'divisor' first
+    int divisor;      // Never 0, a division by zero fails the piece
+    uint32_t mul;     // Multiplier, wrapping like int does
+    uint32_t add;     // Addend, wrapping like int does
+};
+
+// What parsing a piece gave
+struct PieceResult
+{
+    int status = ERROR::SUCCESS;   // SUCCESS: reached its end, PARSE_ERROR: the parse stopped inside it, or an error
+    std::vector<AffineStep> steps; // Steps up to where it ended, stopped or failed
+};
+
+// Counts of a range of the text, see isValidExpression()
+struct RangeCounts
+{
+    const char* invalid = 0;  // First character that is not accepted, null if none
+    long depth = 0;           // Opened minus closed parentheses
+    long minDepth = 0;        // Lowest depth reached, counted from the start of the range
+    uint64_t digits = 0;      // Each digit counts as a number, like isValidExpression()
+    uint64_t operators = 0;   // '+', '-', '*' and '/'
+    uint64_t opens = 0;       // '('
+    uint64_t closes = 0;      // ')'
+    const char* split = 0;    // Where the next piece starts, null if the range has no place for it
+};
+
+// Returns true for the whitespace characters accepted by skipSpaces()
+static inline bool isSpace(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\f' || ch == '\v';
+}
+
+// Classes of the characters counted by countRange()
+namespace RANGE_CHAR
+{
+    static const unsigned char SPACE = 0;    // Whitespace accepted by skipSpaces()
+    static const unsigned char DIGIT = 1;    // '0' to '9'
+    static const unsigned char OPERATOR = 2; // '+', '-', '*' and '/'
+    static const unsigned char OPEN = 3;     // '('
+    static const unsigned char CLOSE = 4;    // ')'
+    static const unsigned char OTHER = 5;    // Anything else, an invalid character
+}
+
+// Returns the class of every character
+static const unsigned char* rangeClasses()
+{
+    static const struct Table {
+        unsigned char classes[256];
+        Table()
+        {
+            for (int ch = 0; ch < 256; ++ch) classes[ch] = RANGE_CHAR::OTHER;
+            for (unsigned char ch : { ' ', '\t', '\n', '\r', '\f', '\v' }) classes[ch] = RANGE_CHAR::SPACE;
+            for (int ch = '0'; ch <= '9'; ++ch) classes[ch] = RANGE_CHAR::DIGIT;
+            for (unsigned char ch : { '+', '-', '*', '/' }) classes[ch] = RANGE_CHAR::OPERATOR;
+            classes[(unsigned char)'('] = RANGE_CHAR::OPEN;
+            classes[(unsigned char)')'] = RANGE_CHAR::CLOSE;
+        }
+    } table;
+    return table.classes;
+}
+
+// Counts the characters of [begin, end).
+// Only parentheses and invalid characters need a branch, everything else is a count by class.
+static void countRange(const char* begin, const char* end, RangeCounts& counts)
+{
+    static const unsigned char* classes = rangeClasses();
+    uint64_t byClass[6] = {};
+    long depth = 0, minDepth = 0;
+    for (const unsigned char* ch = (const unsigned char*)begin; ch != (const unsigned char*)end; ++ch) {
+        unsigned char kind = classes[*ch];
+        byClass[kind]++;
+        if (kind < RANGE_CHAR::OPEN) continue;
+        if (kind == RANGE_CHAR::OPEN) depth++;
+        else if (kind == RANGE_CHAR::CLOSE) { if (--depth < minDepth) minDepth = depth; }
+        else if (!counts.invalid) counts.invalid = (const char*)ch;
+    }
+    counts.digits = byClass[RANGE_CHAR::DIGIT];
+    counts.operators = byClass[RANGE_CHAR::OPERATOR];
+    counts.opens = byClass[RANGE_CHAR::OPEN];
+    counts.closes = byClass[RANGE_CHAR::CLOSE];
+    counts.depth = depth;
+    counts.minDepth = minDepth;
+}
+
+// Returns the first error of isValidExpression() in [begin, end), which starts at 'depth', or SUCCESS
+static int firstRangeError(const char* begin, const char* end, long depth)
+{
+    for (const char* ch = begin; ch != end; ++ch) {
+        if (*ch == '(') depth++;
+        else if (*ch == ')') { if (--depth < 0) return ERROR::UNMATCHED_PAREN; }
+        else if (!(*ch >= '0' && *ch <= '9') && !isSpace(*ch) && *ch != '+' && *ch != '-' && *ch != '*' && *ch != '/') {
+            return ERROR::INVALID_CHARACTER;
+        }
+    }
+    return ERROR::SUCCESS;
+}
+
+// Finds where a piece can start in [begin, end), which starts at 'depth': a '+' or '-' outside
+// parentheses right after a number or a ')', so parse() reads it as an operator and a term before it
+// never runs past it. Returns null if there is none.
+static const char* findSplit(const char* expression, const char* begin, const char* end, long depth)
+{
+    for (const char* ch = begin; ch != end; ++ch) {
+        if (*ch == '(') { depth++; continue; }
+        if (*ch == ')') { depth--; continue; }
+        if (depth != 0 || (*ch != '+' && *ch != '-')) continue;
+        const char* before = ch;
+        while (before > expression && isSpace(before[-1])) --before;
+        if (before > expression && ((before[-1] >= '0' && before[-1] <= '9') || before[-1] == ')')) return ch;
+    }
+    return 0;
+}
+
+// Adds the operator and value to the last step of a piece
+static inline void applyOperator(std::vector<AffineStep>& steps, char operation, int value)
+{
+    AffineStep& step = steps.back();
+    if (operation == '+') step.add += (uint32_t)value;
+    else if (operation == '-') step.add -= (uint32_t)value;
+    else if (operation == '*') { step.mul *= (uint32_t)value; step.add *= (uint32_t)value; }
+    else steps.push_back({ true, value, 1, 0 });
+}
+
+// Parses the piece [begin, end) like parse() does. 'end' is where the next piece starts (its operator)
+// or the end of the expression. The first piece starts with a value, the others with their operator.
+static void parsePiece(const char* begin, const char* end, bool first, PieceResult& piece)
+{
+    piece.steps.assign(1, { false, 1, 1, 0 });
+    const char* cur = begin;
+
+    // The first value is '+' on 0
+    if (first) {
+        int value = 0;
+        piece.status = parseNext(cur, value);
+        if (piece.status) return;
+        applyOperator(piece.steps, '+', value);
+    }
+
+    while (true) {
+        skipSpaces(cur);
+        if (cur == end) { piece.status = ERROR::SUCCESS; return; }
+
+        // Anything but an operator ends the parse here, and evaluate() reports what is left
+        char operation = *cur;
+        if (operation != '*' && operation != '/' && operation != '+' && operation != '-') { piece.status = ERROR::PARSE_ERROR; return; }
+        ++cur;
+
+        int rightValue = 0;
+        piece.status = parseNext(cur, rightValue);
+        if (piece.status) return;
+
+        // Multiplication and division chains, see parse()
+        while (operation == '*' || operation == '/') {
+            if (operation == '/' && rightValue == 0) { piece.status = ERROR::DIV_BY_ZERO; return; }
+            applyOperator(piece.steps, operation, rightValue);
+
+            // At the end of the piece this reads its boundary: the operator of the next piece
+            skipSpaces(cur);
+            operation = *cur;
+            if (operation != '*' && operation != '/') break;
+            ++cur;
+
+            piece.status = parseNext(cur, rightValue);
+            if (piece.status) return;
+        }
+
+        // Addition and subtraction, after a chain the last right-hand value once more
+        if (operation == '+' || operation == '-') applyOperator(piece.steps, operation, rightValue);
+    }
+}
+
+// Applies the steps of a piece to the value on its left
+static inline int applySteps(const std::vector<AffineStep>& steps, int value)
+{
+    for (const AffineStep& step : steps) {
+        // The same division parse() does, INT_MIN / -1 included
+        if (step.divide) value /= step.divisor;
+        value = (int)((uint32_t)value * step.mul + step.add);
+    }
+    return value;
+}
+
+// Evaluates a single expression on several threads.
+int evaluateParallel(const char* expression, int& result, unsigned threads, size_t chunkSize)
+{
+    result = 0;
+    if (chunkSize == 0) chunkSize = PARALLEL_CHUNK_SIZE;
+    if (threads == 0) threads = defaultThreadCount();
+
+    // On a single thread the extra counting pass only costs time
+    size_t length = expression ? strlen(expression) : 0;
+    if (length <= chunkSize || threads == 1) return evaluate(expression, result);
+
+    // 1. Count every range, then find the first error of isValidExpression() in order
+    size_t ranges = (length + chunkSize - 1) / chunkSize;
+    std::vector<RangeCounts> counts(ranges);
+    std::vector<long> startDepth(ranges + 1, 0);
+    parallelFor(ranges, threads, 1, [&](size_t first, size_t last) {
+        for (size_t r = first; r < last; ++r) {
+            size_t end = (r + 1) * chunkSize < length ? (r + 1) * chunkSize : length;
+            countRange(expression + r * chunkSize, expression + end, counts[r]);
+        }
+    });
+    RangeCounts total;
+    for (size_t r = 0; r < ranges; ++r) {
+        const RangeCounts& range = counts[r];
+        if (range.invalid || startDepth[r] + range.minDepth < 0) {
+            size_t end = (r + 1) * chunkSize < length ? (r + 1) * chunkSize : length;
+            return firstRangeError(expression + r * chunkSize, expression + end, startDepth[r]);
+        }
+        startDepth[r + 1] = startDepth[r] + range.depth;
+        total.digits += range.digits;
+        total.operators += range.operators;
+        total.opens += range.opens;
+        total.closes += range.closes;
+    }
+    if (total.opens != total.closes) return ERROR::UNMATCHED_PAREN;
+    else if (total.digits == 0) return ERROR::NO_NUM;
+    else if (total.operators == 0 && total.digits > 1) return ERROR::NO_OPERATOR;
+
+    // 2. Where the pieces start: the first place for one in every range but the first
+    parallelFor(ranges - 1, threads, 1, [&](size_t first, size_t last) {
+        for (size_t r = first + 1; r < last + 1; ++r) {
+            size_t end = (r + 1) * chunkSize < length ? (r + 1) * chunkSize : length;
+            counts[r].split = findSplit(expression, expression + r * chunkSize, expression + end, startDepth[r]);
+        }
+    });
+    std::vector<const char*> bounds(1, expression);
+    for (size_t r = 1; r < ranges; ++r) {
+        if (counts[r].split) bounds.push_back(counts[r].split);
+    }
+    bounds.push_back(expression + length);
+
+    // 3. Parse every piece
+    size_t pieces = bounds.size() - 1;
+    std::vector<PieceResult> results(pieces);
+    parallelFor(pieces, threads, 1, [&](size_t first, size_t last) {
+        for (size_t p = first; p < last; ++p) parsePiece(bounds[p], bounds[p + 1], p == 0, results[p]);
+    });
+
+    // 4. Apply the pieces in order, up to the first one that did not reach its end
+    int value = 0;
+    for (const PieceResult& piece : results) {
+        value = applySteps(piece.steps, value);
+        if (piece.status == ERROR::PARSE_ERROR) { result = value; return ERROR::PARSE_ERROR; }
+        if (piece.status != ERROR::SUCCESS) return piece.status;
+    }
+    result = value;
+    return ERROR::SUCCESS;
+}
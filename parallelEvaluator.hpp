@@ -0,0 +1,27 @@
+/*
+ * File: parallelEvaluator.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of the parallel evaluator of a single expression.
+ * A very long expression is cut at '+' and '-' signs outside parentheses, and the pieces are parsed
+ * on several threads. Each piece folds its terms into a map of the value on its left: '+', '-' and
+ * '*' by a constant compose into x * m + a, so only a division needs the actual value. The maps are
+ * then applied in order, which gives exactly the error code and result of evaluate().
+ */
+
+#ifndef PARALLEL_EVALUATOR_HPP
+#define PARALLEL_EVALUATOR_HPP
+
+#include <cstddef>
+
+// Bytes of expression per piece when no other size is given.
+// Expressions no longer than a piece, and any expression on a single thread, are handed to evaluate().
+static const size_t PARALLEL_CHUNK_SIZE = 1 << 18;
+
+// Evaluates a single expression on up to 'threads' threads (0 means one per core), in pieces of about
+// 'chunkSize' bytes. It returns the same error code and result as evaluate(): the checks of
+// isValidExpression() come first, with the error found nearest to the start of the text, then the
+// first error of the parse, a division by zero included, in the order evaluate() meets them.
+// Like evaluate(), nesting is parsed recursively inside a piece.
+int evaluateParallel(const char* expression, int& result, unsigned threads, size_t chunkSize = PARALLEL_CHUNK_SIZE);
+
+#endif // PARALLEL_EVALUATOR_HPP
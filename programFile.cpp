@@ -0,0 +1,298 @@
+/*
+ * File: programFile.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of the compiled program file format.
+ * Writing lays the sections out one after the other. Loading maps the file, checks the header,
+ * the checksum and then every program once (operands in range, stack depth within maxStack),
+ * after which the programs are run straight from the mapped bytes by runCode().
+ */
+
+// Include necessary headers
+#include "programFile.hpp"
+#include "constants.hpp"
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Releases the file when the object is destroyed
+ProgramFile::~ProgramFile()
+{
+    releaseProgramFile(*this);
+}
+
+// Returns the checksum of a block of memory, chained from 'seed'.
+// Eight bytes are mixed at a time, which keeps checking a large file far below the cost of reading it.
+uint64_t programChecksum(const void* data, size_t size, uint64_t seed)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed ^ ((uint64_t)size * 0x9E3779B97F4A7C15ull);
+    while (size >= 8) {
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        hash = (hash ^ word) * 0xBF58476D1CE4E5B9ull;
+        hash ^= hash >> 31;
+        bytes += 8;
+        size -= 8;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, bytes, size);
+    hash = (hash ^ tail ^ size) * 0x94D049BB133111EBull;
+    return hash ^ (hash >> 29);
+}
+
+// Returns the checksum of a whole file, with its checksum field taken as zero
+static uint64_t fileChecksum(const unsigned char* data, size_t size)
+{
+    ProgramFileHeader header;
+    memcpy(&header, data, sizeof(header));
+    header.checksum = 0;
+    uint64_t hash = programChecksum(&header, sizeof(header), 0);
+    return programChecksum(data + sizeof(header), size - sizeof(header), hash);
+}
+
+// Rounds an offset up to a multiple of 8
+static inline size_t align8(size_t offset)
+{
+    return (offset + 7) & ~(size_t)7;
+}
+
+// Writes 'count' programs and the names of 'variables' into 'image', in the file format.
+void serializePrograms(const CompiledExpression* programs, size_t count, const VariableTable* variables,
+    std::vector<unsigned char>& image)
+{
+    size_t nameCount = variables ? variables->names.size() : 0;
+    size_t instructions = 0;
+    for (size_t i = 0; i < count; ++i) instructions += programs[i].code.size();
+
+    // Lay the sections out
+    ProgramFileHeader header = {};
+    memcpy(header.magic, PROGRAM_FILE_MAGIC, sizeof(header.magic));
+    header.version = PROGRAM_FILE_VERSION;
+    header.byteOrder = PROGRAM_FILE_BYTE_ORDER;
+    header.programCount = (uint32_t)count;
+    header.nameCount = (uint32_t)nameCount;
+    header.entriesOffset = (uint32_t)sizeof(ProgramFileHeader);
+    header.nameTableOffset = (uint32_t)(header.entriesOffset + count * sizeof(ProgramEntry));
+    header.codeOffset = (uint32_t)align8(header.nameTableOffset + nameCount * sizeof(uint32_t));
+    header.namesOffset = (uint32_t)(header.codeOffset + instructions * sizeof(Instruction));
+    size_t size = header.namesOffset;
+    for (size_t i = 0; i < nameCount; ++i) size += variables->names[i].size() + 1;
+    header.fileSize = size;
+    image.assign(size, 0);
+
+    // Programs and their code
+    uint32_t codeStart = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const CompiledExpression& program = programs[i];
+        ProgramEntry entry = { codeStart, (uint32_t)program.code.size(), program.maxStack, program.tempCount,
+            program.variableCount, program.errorCode };
+        memcpy(&image[header.entriesOffset + i * sizeof(ProgramEntry)], &entry, sizeof(entry));
+        if (!program.code.empty()) {
+            memcpy(&image[header.codeOffset + (size_t)codeStart * sizeof(Instruction)], program.code.data(),
+                program.code.size() * sizeof(Instruction));
+        }
+        codeStart += (uint32_t)program.code.size();
+    }
+
+    // Names and their offsets
+    size_t nameOffset = header.namesOffset;
+    for (size_t i = 0; i < nameCount; ++i) {
+        uint32_t offset = (uint32_t)nameOffset;
+        memcpy(&image[header.nameTableOffset + i * sizeof(uint32_t)], &offset, sizeof(offset));
+        const std::string& name = variables->names[i];
+        memcpy(&image[nameOffset], name.c_str(), name.size() + 1);
+        nameOffset += name.size() + 1;
+    }
+
+    memcpy(image.data(), &header, sizeof(header));
+    header.checksum = fileChecksum(image.data(), image.size());
+    memcpy(image.data(), &header, sizeof(header));
+}
+
+// Writes 'count' programs and the names of 'variables' to a file.
+int writeProgramFile(const char* path, const CompiledExpression* programs, size_t count, const VariableTable* variables)
+{
+    std::vector<unsigned char> image;
+    serializePrograms(programs, count, variables, image);
+
+    FILE* out = fopen(path, "wb");
+    if (!out) return PROGRAM_FILE::IO_ERROR;
+    bool ok = fwrite(image.data(), 1, image.size(), out) == image.size();
+    if (fclose(out) != 0) ok = false;
+    return ok ? PROGRAM_FILE::SUCCESS : PROGRAM_FILE::IO_ERROR;
+}
+
+// Returns true if a program can be run safely: every operand is in range and the stack
+// never goes below empty or above maxStack, so runCode() only touches memory it owns.
+static bool verifyProgram(const ProgramEntry& entry, const Instruction* code, uint32_t nameCount)
+{
+    // The stack and the temporaries can never be larger than the program
+    if (entry.codeLength == 0 || entry.maxStack < 0 || entry.tempCount < 0 || entry.variableCount < 0) return false;
+    if ((uint32_t)entry.maxStack > entry.codeLength || (uint32_t)entry.tempCount > entry.codeLength) return false;
+    if ((uint32_t)entry.variableCount > nameCount) return false;
+
+    int depth = 0;
+    for (uint32_t i = 0; i < entry.codeLength; ++i) {
+        const Instruction& ins = code[i];
+        int needs = 0, change = 0;
+        switch (ins.opcode) {
+        case OPCODE::PUSH: change = 1; break;
+        case OPCODE::LOAD: if (ins.operand < 0 || ins.operand >= entry.variableCount) return false; change = 1; break;
+        case OPCODE::LOADT: if (ins.operand < 0 || ins.operand >= entry.tempCount) return false; change = 1; break;
+        case OPCODE::STORE: if (ins.operand < 0 || ins.operand >= entry.tempCount) return false; needs = 1; break;
+        case OPCODE::NEG: needs = 1; break;
+        case OPCODE::ADD:
+        case OPCODE::SUB:
+        case OPCODE::MUL:
+        case OPCODE::DIV: needs = 2; change = -1; break;
+        case OPCODE::MULK:
+        case OPCODE::DIVK: needs = 2; break;
+        case OPCODE::RETURN: needs = 1; break;
+        case OPCODE::FAIL: break;
+        default: return false;
+        }
+        if (depth < needs) return false;
+        depth += change;
+        if (depth > entry.maxStack) return false;
+    }
+
+    // The last instruction returns, so run never falls off the end
+    int last = code[entry.codeLength - 1].opcode;
+    return last == OPCODE::RETURN || last == OPCODE::FAIL;
+}
+
+// Checks a program file already in memory and points 'file' at it.
+int openProgramImage(const void* data, size_t size, ProgramFile& file)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    if (size < sizeof(ProgramFileHeader) || memcmp(bytes, PROGRAM_FILE_MAGIC, sizeof(PROGRAM_FILE_MAGIC)) != 0) {
+        return PROGRAM_FILE::BAD_MAGIC;
+    }
+    const ProgramFileHeader* header = reinterpret_cast<const ProgramFileHeader*>(bytes);
+    if (header->version != PROGRAM_FILE_VERSION || header->byteOrder != PROGRAM_FILE_BYTE_ORDER) return PROGRAM_FILE::BAD_VERSION;
+    if (header->fileSize != size) return PROGRAM_FILE::MALFORMED;
+    if (fileChecksum(bytes, size) != header->checksum) return PROGRAM_FILE::BAD_CHECKSUM;
+
+    // Every section must be where the layout puts it, inside the file
+    uint64_t nameTableOffset = (uint64_t)header->entriesOffset + (uint64_t)header->programCount * sizeof(ProgramEntry);
+    uint64_t codeOffset = align8(nameTableOffset + (uint64_t)header->nameCount * sizeof(uint32_t));
+    if (header->entriesOffset != sizeof(ProgramFileHeader) || header->nameTableOffset != nameTableOffset ||
+        header->codeOffset != codeOffset || header->namesOffset < codeOffset || header->namesOffset > size ||
+        (header->namesOffset - codeOffset) % sizeof(Instruction) != 0) {
+        return PROGRAM_FILE::MALFORMED;
+    }
+
+    // Names are NUL terminated strings inside the name section
+    const uint32_t* nameTable = reinterpret_cast<const uint32_t*>(bytes + header->nameTableOffset);
+    for (uint32_t i = 0; i < header->nameCount; ++i) {
+        if (nameTable[i] < header->namesOffset || nameTable[i] >= size) return PROGRAM_FILE::MALFORMED;
+        if (!memchr(bytes + nameTable[i], '\0', size - nameTable[i])) return PROGRAM_FILE::MALFORMED;
+    }
+
+    // Every program must lie inside the code and be safe to run
+    const ProgramEntry* entries = reinterpret_cast<const ProgramEntry*>(bytes + header->entriesOffset);
+    const Instruction* code = reinterpret_cast<const Instruction*>(bytes + header->codeOffset);
+    uint64_t instructions = (header->namesOffset - codeOffset) / sizeof(Instruction);
+    for (uint32_t i = 0; i < header->programCount; ++i) {
+        const ProgramEntry& entry = entries[i];
+        if ((uint64_t)entry.codeStart + entry.codeLength > instructions) return PROGRAM_FILE::MALFORMED;
+        if (!verifyProgram(entry, code + entry.codeStart, header->nameCount)) return PROGRAM_FILE::MALFORMED;
+    }
+
+    file.data = bytes;
+    file.size = size;
+    file.header = header;
+    file.entries = entries;
+    file.code = code;
+    return PROGRAM_FILE::SUCCESS;
+}
+
+// Memory maps a program file and checks it.
+int loadProgramFile(const char* path, ProgramFile& file)
+{
+    releaseProgramFile(file);
+
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return PROGRAM_FILE::IO_ERROR;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* mapping = mmap(0, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) return PROGRAM_FILE::IO_ERROR;
+        int status = openProgramImage(mapping, (size_t)info.st_size, file);
+        if (status != PROGRAM_FILE::SUCCESS) {
+            munmap(mapping, (size_t)info.st_size);
+            releaseProgramFile(file);
+            return status;
+        }
+        file.mapping = mapping;
+        return status;
+    }
+    close(fd);
+#endif
+
+    // No mmap on this platform (or not a regular file): read it into memory aligned for the header
+    FILE* in = fopen(path, "rb");
+    if (!in) return PROGRAM_FILE::IO_ERROR;
+    std::vector<unsigned char> bytes;
+    unsigned char block[1 << 16];
+    size_t read;
+    while ((read = fread(block, 1, sizeof(block), in)) > 0) bytes.insert(bytes.end(), block, block + read);
+    bool failed = ferror(in) != 0;
+    fclose(in);
+    if (failed) return PROGRAM_FILE::IO_ERROR;
+
+    file.buffer.assign((bytes.size() + 7) / 8, 0);
+    if (!bytes.empty()) memcpy(file.buffer.data(), bytes.data(), bytes.size());
+    int status = openProgramImage(file.buffer.data(), bytes.size(), file);
+    if (status != PROGRAM_FILE::SUCCESS) releaseProgramFile(file);
+    return status;
+}
+
+// Releases the file.
+void releaseProgramFile(ProgramFile& file)
+{
+#ifndef _WIN32
+    if (file.mapping) munmap(file.mapping, file.size);
+#endif
+    file.mapping = 0;
+    file.buffer.clear();
+    file.data = 0;
+    file.size = 0;
+    file.header = 0;
+    file.entries = 0;
+    file.code = 0;
+}
+
+// Returns the number of programs of a loaded file.
+size_t programCount(const ProgramFile& file)
+{
+    return file.header ? file.header->programCount : 0;
+}
+
+// Returns the slot of a variable name in the file, or -1 if the file has no such name.
+int findProgramVariable(const ProgramFile& file, const char* name)
+{
+    if (!file.header) return -1;
+    const uint32_t* nameTable = reinterpret_cast<const uint32_t*>(file.data + file.header->nameTableOffset);
+    for (uint32_t i = 0; i < file.header->nameCount; ++i) {
+        if (strcmp(reinterpret_cast<const char*>(file.data + nameTable[i]), name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+// Runs program 'index' of the file in place.
+int runProgram(const ProgramFile& file, size_t index, const int* values, int& result)
+{
+    result = 0;
+    if (index >= programCount(file)) return ERROR::PARSE_ERROR;
+    const ProgramEntry& entry = file.entries[index];
+    return runCode(file.code + entry.codeStart, entry.codeLength, entry.maxStack, entry.tempCount, values, result);
+}
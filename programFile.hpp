@@ -0,0 +1,125 @@
+/*
+ * File: programFile.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of the compiled program file format.
+ * Many compiled expressions are written once into a single file, which is later memory mapped
+ * and run in place: loading checks the file and never copies or rebuilds a program, so a
+ * service starts in the time it takes to map and checksum its programs instead of parsing them.
+ */
+
+#ifndef PROGRAM_FILE_HPP
+#define PROGRAM_FILE_HPP
+
+#include "compiledExpression.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The file layout, every field little endian and every offset counted from the start of the file,
+// so the file can be mapped at any address:
+//   ProgramFileHeader
+//   ProgramEntry[programCount]          one per program
+//   uint32_t[nameCount]                 offset of each variable name, indexed by slot
+//   Instruction[]                       the code of every program, one after the other
+//   char[]                              the variable names, each one followed by a NUL
+// The checksum covers the whole file, with the checksum field itself taken as zero.
+static const char PROGRAM_FILE_MAGIC[8] = { 'E', 'X', 'P', 'R', 'P', 'R', 'O', 'G' };
+
+// Version of the layout. Files of another version are refused.
+static const uint32_t PROGRAM_FILE_VERSION = 1;
+
+// Written as a 32 bit integer, it reads back differently on a machine of the other byte order
+static const uint32_t PROGRAM_FILE_BYTE_ORDER = 0x01020304;
+
+// Results of reading a program file
+namespace PROGRAM_FILE
+{
+	static const int SUCCESS = 0;      // The file was loaded
+	static const int IO_ERROR = 1;     // The file could not be opened, read or written
+	static const int BAD_MAGIC = 2;    // Not a program file
+	static const int BAD_VERSION = 3;  // A program file of another version or byte order
+	static const int BAD_CHECKSUM = 4; // The content does not match its checksum
+	static const int MALFORMED = 5;    // Sizes, offsets or code that cannot be run safely
+}
+
+// Start of a program file
+struct ProgramFileHeader
+{
+	char magic[8];             // PROGRAM_FILE_MAGIC
+	uint32_t version;          // PROGRAM_FILE_VERSION
+	uint32_t byteOrder;        // PROGRAM_FILE_BYTE_ORDER
+	uint32_t programCount;     // Number of programs
+	uint32_t nameCount;        // Number of variable names
+	uint32_t entriesOffset;    // Offset of the program entries
+	uint32_t nameTableOffset;  // Offset of the name offsets
+	uint32_t codeOffset;       // Offset of the code
+	uint32_t namesOffset;      // Offset of the names
+	uint64_t fileSize;         // Size of the whole file
+	uint64_t checksum;         // See programChecksum()
+};
+
+// Description of one program of the file
+struct ProgramEntry
+{
+	uint32_t codeStart;   // First instruction, counted from the start of the code
+	uint32_t codeLength;  // Number of instructions
+	int32_t maxStack;     // See CompiledExpression
+	int32_t tempCount;    // See CompiledExpression
+	int32_t variableCount; // See CompiledExpression
+	int32_t errorCode;    // See CompiledExpression
+};
+
+// A loaded program file. The mapping is released when the object is destroyed.
+struct ProgramFile
+{
+	const unsigned char* data = 0;    // The file, mapped or read
+	size_t size = 0;                  // Size of the file
+	const ProgramFileHeader* header = 0;
+	const ProgramEntry* entries = 0;  // One per program
+	const Instruction* code = 0;      // The code of every program
+	void* mapping = 0;                // The mapping, null if the file was read into 'buffer'
+	std::vector<uint64_t> buffer;     // The file, where it cannot be mapped
+
+	ProgramFile() = default;
+	~ProgramFile();
+	ProgramFile(const ProgramFile&) = delete;
+	ProgramFile& operator=(const ProgramFile&) = delete;
+};
+
+// Returns the checksum of a block of memory, chained from 'seed'.
+uint64_t programChecksum(const void* data, size_t size, uint64_t seed);
+
+// Writes 'count' programs and the names of 'variables' (may be null) into 'image', in the file format.
+// The programs are written as they are: a program that was not built by compile() may give a file
+// that openProgramImage() refuses.
+void serializePrograms(const CompiledExpression* programs, size_t count, const VariableTable* variables,
+	std::vector<unsigned char>& image);
+
+// Writes 'count' programs and the names of 'variables' (may be null) to a file.
+// It returns PROGRAM_FILE::SUCCESS or PROGRAM_FILE::IO_ERROR.
+int writeProgramFile(const char* path, const CompiledExpression* programs, size_t count, const VariableTable* variables);
+
+// Checks a program file already in memory ('data' aligned to 8 bytes) and points 'file' at it.
+// The memory must outlive 'file'. It returns PROGRAM_FILE::SUCCESS or the reason it was refused;
+// every program of an accepted file is safe to run.
+int openProgramImage(const void* data, size_t size, ProgramFile& file);
+
+// Memory maps a program file (reads it, where mapping is not available) and checks it.
+// It returns PROGRAM_FILE::SUCCESS or the reason it was refused.
+int loadProgramFile(const char* path, ProgramFile& file);
+
+// Releases the file.
+void releaseProgramFile(ProgramFile& file);
+
+// Returns the number of programs of a loaded file.
+size_t programCount(const ProgramFile& file);
+
+// Returns the slot of a variable name in the file, or -1 if the file has no such name.
+int findProgramVariable(const ProgramFile& file, const char* name);
+
+// Runs program 'index' of the file in place, reading the variables from 'values' (indexed by slot,
+// at least as many as the file has names). It returns the same error code and result as run()
+// on the program that was written, or ERROR::PARSE_ERROR if there is no such program.
+int runProgram(const ProgramFile& file, size_t index, const int* values, int& result);
+
+#endif // PROGRAM_FILE_HPP
@@ -0,0 +1,170 @@
+/*
+ * File: evalClient.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of the client library of the evaluation server.
+ * The socket never blocks: while waiting for answers the client keeps writing its queued requests,
+ * so neither side can stall with a full socket buffer in both directions.
+ */
+
+// Include necessary headers
+#include "evalClient.hpp"
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Bytes read from the server at a time
+static const size_t CLIENT_READ_SIZE = 64 << 10;
+
+// send() flags: a server that went away must not kill the client with SIGPIPE
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+// Connects to the server listening at 'socketPath'.
+int connectEvalServer(EvalClient& client, const char* socketPath)
+{
+    closeEvalClient(client);
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    size_t length = strlen(socketPath);
+    if (length >= sizeof(address.sun_path)) return EVAL_SERVER::SOCKET_ERROR;
+    memcpy(address.sun_path, socketPath, length);
+
+    client.fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (client.fd < 0) return EVAL_SERVER::SOCKET_ERROR;
+    if (connect(client.fd, (const sockaddr*)&address, sizeof(address)) < 0) {
+        closeEvalClient(client);
+        return EVAL_SERVER::SOCKET_ERROR;
+    }
+
+    // Connected while blocking, then every read and write is non blocking
+    int flags = fcntl(client.fd, F_GETFL, 0);
+    fcntl(client.fd, F_SETFL, flags | O_NONBLOCK);
+    fcntl(client.fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(client.fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    return EVAL_SERVER::SUCCESS;
+}
+
+// Closes the connection.
+void closeEvalClient(EvalClient& client)
+{
+    if (client.fd >= 0) close(client.fd);
+    client.fd = -1;
+    client.output.clear();
+    client.written = 0;
+    client.input.clear();
+    client.consumed = 0;
+    client.inFlight = 0;
+}
+
+// Queues a request.
+int queueRequest(EvalClient& client, const char* expression, size_t length)
+{
+    if (length > EVAL_MAX_REQUEST) return EVAL_SERVER::PROTOCOL_ERROR;
+    unsigned char header[EVAL_REQUEST_HEADER_SIZE];
+    writeLittleEndian(header, (uint32_t)length);
+    client.output.append((const char*)header, EVAL_REQUEST_HEADER_SIZE);
+    client.output.append(expression, length);
+    ++client.inFlight;
+    return EVAL_SERVER::SUCCESS;
+}
+
+// Writes as much of the queued requests as the socket takes.
+int flushEvalClient(EvalClient& client)
+{
+    if (client.fd < 0) return EVAL_SERVER::SOCKET_ERROR;
+    while (client.written < client.output.size()) {
+        ssize_t sent = send(client.fd, client.output.data() + client.written, client.output.size() - client.written, SEND_FLAGS);
+        if (sent > 0) { client.written += (size_t)sent; continue; }
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        return errno == EPIPE ? EVAL_SERVER::CLOSED : EVAL_SERVER::SOCKET_ERROR;
+    }
+    if (client.written == client.output.size()) {
+        client.output.clear();
+        client.written = 0;
+    }
+    return EVAL_SERVER::SUCCESS;
+}
+
+// Reads what the server has sent so far. Returns EVAL_SERVER::SUCCESS, CLOSED or SOCKET_ERROR.
+static int readAnswers(EvalClient& client)
+{
+    if (client.consumed > 0) {
+        client.input.erase(0, client.consumed);
+        client.consumed = 0;
+    }
+    while (true) {
+        size_t size = client.input.size();
+        client.input.resize(size + CLIENT_READ_SIZE);
+        ssize_t got = read(client.fd, &client.input[size], CLIENT_READ_SIZE);
+        client.input.resize(size + (got > 0 ? (size_t)got : 0));
+        if (got > 0) continue;
+        if (got < 0 && errno == EINTR) continue;
+        if (got == 0) return EVAL_SERVER::CLOSED;
+        return errno == EAGAIN || errno == EWOULDBLOCK ? EVAL_SERVER::SUCCESS : EVAL_SERVER::SOCKET_ERROR;
+    }
+}
+
+// Waits for the answers of the next 'count' requests queued.
+int receiveAnswers(EvalClient& client, size_t count, int* results, int* errorCodes)
+{
+    if (client.fd < 0) return EVAL_SERVER::SOCKET_ERROR;
+    if (count > client.inFlight) return EVAL_SERVER::PROTOCOL_ERROR;
+    size_t received = 0;
+    while (true) {
+        // Hand out the answers already read
+        while (received < count && client.input.size() - client.consumed >= EVAL_ANSWER_SIZE) {
+            const unsigned char* answer = (const unsigned char*)client.input.data() + client.consumed;
+            errorCodes[received] = (int)readLittleEndian(answer);
+            results[received] = (int)readLittleEndian(answer + 4);
+            client.consumed += EVAL_ANSWER_SIZE;
+            --client.inFlight;
+            ++received;
+        }
+        if (received == count) return EVAL_SERVER::SUCCESS;
+
+        // Write what is queued and wait for more answers, or for room to write
+        int status = flushEvalClient(client);
+        if (status != EVAL_SERVER::SUCCESS) return status;
+        pollfd polled = { client.fd, POLLIN, 0 };
+        if (client.written < client.output.size()) polled.events |= POLLOUT;
+        if (poll(&polled, 1, -1) < 0 && errno != EINTR) return EVAL_SERVER::SOCKET_ERROR;
+        if (polled.revents & (POLLIN | POLLHUP | POLLERR)) {
+            status = readAnswers(client);
+            if (status == EVAL_SERVER::CLOSED && client.input.size() - client.consumed >= EVAL_ANSWER_SIZE) continue;
+            if (status != EVAL_SERVER::SUCCESS) return status;
+        }
+    }
+}
+
+// Evaluates one expression on the server.
+int evaluateRemote(EvalClient& client, const char* expression, int& errorCode, int& result)
+{
+    if (client.inFlight > 0) return EVAL_SERVER::PROTOCOL_ERROR;
+    int status = queueRequest(client, expression, strlen(expression));
+    if (status != EVAL_SERVER::SUCCESS) return status;
+    return receiveAnswers(client, 1, &result, &errorCode);
+}
+
+// Evaluates many expressions on the server, all of them in flight at once.
+int evaluateRemoteBatch(EvalClient& client, const char* const* expressions, size_t count, int* results, int* errorCodes)
+{
+    if (client.inFlight > 0) return EVAL_SERVER::PROTOCOL_ERROR;
+    for (size_t i = 0; i < count; ++i) {
+        int status = queueRequest(client, expressions[i], strlen(expressions[i]));
+        if (status != EVAL_SERVER::SUCCESS) return status;
+    }
+    return receiveAnswers(client, count, results, errorCodes);
+}
@@ -0,0 +1,57 @@
+/*
+ * File: evalClient.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of the client library of the evaluation server.
+ * Requests are queued and written without waiting for their answers, so many of them are in flight
+ * on one connection at a time; answers come back in the order the requests were queued.
+ */
+
+#ifndef EVAL_CLIENT_HPP
+#define EVAL_CLIENT_HPP
+
+#include "evalProtocol.hpp"
+#include <cstddef>
+#include <string>
+
+// A connection to an evaluation server.
+// A client is used by one thread at a time, give every thread its own.
+struct EvalClient
+{
+	int fd = -1;
+	std::string output;   // Requests queued, from 'written' on
+	size_t written = 0;   // Bytes of 'output' already written
+	std::string input;    // Answers read, from 'consumed' on
+	size_t consumed = 0;  // Bytes of 'input' already returned
+	size_t inFlight = 0;  // Requests queued whose answer was not returned yet
+};
+
+// Connects to the server listening at 'socketPath'.
+// Returns EVAL_SERVER::SUCCESS or EVAL_SERVER::SOCKET_ERROR.
+int connectEvalServer(EvalClient& client, const char* socketPath);
+
+// Closes the connection. The client can be connected again.
+void closeEvalClient(EvalClient& client);
+
+// Queues a request for an expression of 'length' bytes. Nothing is written until an answer is waited for
+// or flushEvalClient() is called. Returns EVAL_SERVER::PROTOCOL_ERROR if the expression is too long.
+int queueRequest(EvalClient& client, const char* expression, size_t length);
+
+// Writes as much of the queued requests as the socket takes, without waiting.
+int flushEvalClient(EvalClient& client);
+
+// Waits for the answers of the next 'count' requests queued, writing the rest of the queue meanwhile.
+// The answer of the i-th of them is written to results[i] and errorCodes[i].
+// Returns EVAL_SERVER::SUCCESS, EVAL_SERVER::CLOSED if the server went away, or EVAL_SERVER::SOCKET_ERROR.
+int receiveAnswers(EvalClient& client, size_t count, int* results, int* errorCodes);
+
+// The two calls below need a client without requests in flight, they return EVAL_SERVER::PROTOCOL_ERROR otherwise.
+
+// Evaluates one expression on the server. The answer of the server is written to 'errorCode' and
+// 'result', and the function returns EVAL_SERVER::SUCCESS or the error of the connection.
+int evaluateRemote(EvalClient& client, const char* expression, int& errorCode, int& result);
+
+// Evaluates 'count' expressions on the server, all of them in flight at once, and writes the answer for
+// expressions[i] to errorCodes[i] and results[i]. Returns EVAL_SERVER::SUCCESS or the error of the connection.
+int evaluateRemoteBatch(EvalClient& client, const char* const* expressions, size_t count, int* results, int* errorCodes);
+
+#endif // EVAL_CLIENT_HPP
@@ -0,0 +1,49 @@
+/*
+ * File: evalProtocol.hpp
+ * Author: Alex Turner
+ * Description: This file contains the wire format shared by the evaluation server and its clients.
+ * A client writes requests one after the other without waiting for the answers (pipelining), and the
+ * server answers the requests of a connection in the order they were written:
+ *   request:  uint32_t length, then 'length' bytes of expression text
+ *   answer:   int32_t error code, then int32_t result
+ * Every integer is little endian. A NUL inside the text is ERROR::INVALID_CHARACTER, as for evaluate()
+ * on a buffer.
+ */
+
+#ifndef EVAL_PROTOCOL_HPP
+#define EVAL_PROTOCOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Size of the length in front of a request
+static const size_t EVAL_REQUEST_HEADER_SIZE = 4;
+
+// Size of an answer
+static const size_t EVAL_ANSWER_SIZE = 8;
+
+// Longest expression accepted. A longer request closes the connection.
+static const uint32_t EVAL_MAX_REQUEST = 1 << 20;
+
+// Results of the server and client functions
+namespace EVAL_SERVER
+{
+	static const int SUCCESS = 0;        // Done
+	static const int SOCKET_ERROR = 1;   // The socket could not be created, bound, connected, read or written
+	static const int PROTOCOL_ERROR = 2; // The other side sent something that is not a request or an answer
+	static const int CLOSED = 3;         // The other side closed the connection
+}
+
+// Writes a 32 bit integer in little endian order
+static inline void writeLittleEndian(unsigned char* out, uint32_t value)
+{
+	for (int b = 0; b < 4; ++b) out[b] = (unsigned char)(value >> (8 * b));
+}
+
+// Reads a 32 bit integer in little endian order
+static inline uint32_t readLittleEndian(const unsigned char* in)
+{
+	return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+#endif // EVAL_PROTOCOL_HPP
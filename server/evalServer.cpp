@@ -0,0 +1,346 @@
+/*
+ * File: evalServer.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of the evaluation server.
+ * A single thread waits on every socket with poll(). Each turn of the loop reads what every client
+ * sent, takes the complete requests of all of them as one batch, evaluates the batch on the thread
+ * pool and queues the answers, which are written as fast as the clients read them. Sockets never
+ * block, and a client with SERVER_BUFFERED_BATCHES batches of answers left unread is not read again
+ * until it catches up, so a slow client only ever delays its own answers and never fills the memory.
+ * Misses of the cache are evaluated with evaluateIterative(), so a deeply nested request cannot
+ * overflow the stack of a pool thread.
+ */
+
+// Include necessary headers
+#include "evalServer.hpp"
+#include "../threadPool.hpp"
+#include "../constants.hpp"
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Requests a pool thread takes at a time
+static const size_t SERVER_GRAIN = 16;
+
+// send() flags: a client that went away must not kill the server with SIGPIPE
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+// Makes a descriptor non blocking and closed on exec
+static bool setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) return false;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    return true;
+}
+
+// Closes every descriptor of the server
+static void closeServer(EvalServer& server)
+{
+    for (ServerConnection& connection : server.connections) close(connection.fd);
+    server.connections.clear();
+    for (int& fd : server.wakeFds) {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+    if (server.listenFd >= 0) {
+        close(server.listenFd);
+        unlink(server.socketPath.c_str());
+    }
+    server.listenFd = -1;
+}
+
+// Creates the socket and gets the server ready to run.
+int startEvalServer(EvalServer& server, const char* socketPath, const EvalServerOptions& options)
+{
+    server.options = options;
+    if (server.options.maxBatch == 0) server.options.maxBatch = DEFAULT_SERVER_BATCH;
+    server.stopping = false;
+    server.stats = EvalServerStats();
+    server.socketPath = socketPath;
+    server.cache.iterative = true;
+    if (options.cacheCapacity) initCache(server.cache, options.cacheCapacity, 0);
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (server.socketPath.size() >= sizeof(address.sun_path)) return EVAL_SERVER::SOCKET_ERROR;
+    memcpy(address.sun_path, socketPath, server.socketPath.size());
+
+    // A socket left behind by a server that did not stop cleanly is replaced
+    unlink(socketPath);
+    server.listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server.listenFd < 0 || !setNonBlocking(server.listenFd) ||
+        bind(server.listenFd, (const sockaddr*)&address, sizeof(address)) < 0 || listen(server.listenFd, SOMAXCONN) < 0 ||
+        pipe(server.wakeFds) < 0 || !setNonBlocking(server.wakeFds[0]) || !setNonBlocking(server.wakeFds[1])) {
+        closeServer(server);
+        return EVAL_SERVER::SOCKET_ERROR;
+    }
+    return EVAL_SERVER::SUCCESS;
+}
+
+// Accepts every client waiting on the socket
+static void acceptClients(EvalServer& server)
+{
+    while (true) {
+        int fd = accept(server.listenFd, 0, 0);
+        if (fd < 0) return;
+        if (!setNonBlocking(fd)) { close(fd); continue; }
+        server.connections.emplace_back();
+        server.connections.back().fd = fd;
+        std::lock_guard<std::mutex> guard(server.statsLock);
+        ++server.stats.connections;
+    }
+}
+
+// Returns true if a complete request of the client is waiting
+static bool hasRequest(const ServerConnection& connection)
+{
+    size_t available = connection.input.size() - connection.consumed;
+    if (available < EVAL_REQUEST_HEADER_SIZE) return false;
+    uint32_t length = readLittleEndian((const unsigned char*)connection.input.data() + connection.consumed);
+    return length > EVAL_MAX_REQUEST || available >= EVAL_REQUEST_HEADER_SIZE + length;
+}
+
+// Returns the bytes of unwritten answers, or of requests not taken, past which a client is not read
+static size_t bufferLimit(const EvalServer& server)
+{
+    return SERVER_BUFFERED_BATCHES * server.options.maxBatch * EVAL_ANSWER_SIZE;
+}
+
+// Returns true if the client has so many answers left unread that its requests have to wait
+static bool outputFull(const EvalServer& server, const ServerConnection& connection)
+{
+    return connection.output.size() - connection.written >= bufferLimit(server);
+}
+
+// Returns true if more of what the client sent may be read. A request that is not complete yet is
+// always read, so one longer than the limit still gets in.
+static bool canRead(const EvalServer& server, const ServerConnection& connection)
+{
+    if (connection.closed || connection.broken || outputFull(server, connection)) return false;
+    return connection.input.size() - connection.consumed < bufferLimit(server) || !hasRequest(connection);
+}
+
+// Reads what a client has sent so far, until it has nothing more or the buffers are full
+static void readClient(const EvalServer& server, ServerConnection& connection)
+{
+    // Drop the requests already taken once they are half of the buffer, which moves every byte
+    // a bounded number of times however long the backlog is
+    if (connection.consumed > 0 && connection.consumed * 2 >= connection.input.size()) {
+        connection.input.erase(0, connection.consumed);
+        connection.consumed = 0;
+    }
+    while (canRead(server, connection)) {
+        size_t size = connection.input.size();
+        connection.input.resize(size + SERVER_READ_SIZE);
+        ssize_t got = read(connection.fd, &connection.input[size], SERVER_READ_SIZE);
+        connection.input.resize(size + (got > 0 ? (size_t)got : 0));
+        if (got > 0) continue;
+        if (got < 0 && errno == EINTR) continue;
+        if (got == 0) connection.closed = true;
+        else if (errno != EAGAIN && errno != EWOULDBLOCK) connection.broken = true;
+        return;
+    }
+}
+
+// Offset in the batch text of a request that holds a NUL, which is answered without being evaluated
+static const size_t INVALID_REQUEST = (size_t)-1;
+
+// Takes the complete requests of a client into the batch, while it has room.
+// Returns false if the client sent a request that is too long.
+static bool takeRequests(EvalServer& server, size_t index)
+{
+    ServerConnection& connection = server.connections[index];
+    while (server.batchOffsets.size() < server.options.maxBatch) {
+        size_t available = connection.input.size() - connection.consumed;
+        if (available < EVAL_REQUEST_HEADER_SIZE) return true;
+        const unsigned char* header = (const unsigned char*)connection.input.data() + connection.consumed;
+        uint32_t length = readLittleEndian(header);
+        if (length > EVAL_MAX_REQUEST) return false;
+        if (available < EVAL_REQUEST_HEADER_SIZE + length) return true;
+
+        const char* text = (const char*)header + EVAL_REQUEST_HEADER_SIZE;
+        server.batchConnections.push_back(index);
+        connection.consumed += EVAL_REQUEST_HEADER_SIZE + length;
+        if (memchr(text, '\0', length)) {
+            server.batchOffsets.push_back(INVALID_REQUEST);
+            continue;
+        }
+        server.batchOffsets.push_back(server.batchText.size());
+        server.batchText.append(text, length);
+        server.batchText += '\0';
+    }
+    return true;
+}
+
+// Evaluates the batch on the pool and queues every answer on its connection
+static void evaluateRequests(EvalServer& server)
+{
+    size_t count = server.batchOffsets.size();
+    if (count == 0) return;
+
+    // The text only stops growing once the batch is complete, so the pointers are taken now
+    server.batchExpressions.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        server.batchExpressions[i] = server.batchOffsets[i] == INVALID_REQUEST ? 0 : server.batchText.data() + server.batchOffsets[i];
+    }
+    server.batchResults.resize(count);
+    server.batchErrors.resize(count);
+    parallelFor(count, server.options.threads, SERVER_GRAIN, [&server](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (server.batchExpressions[i]) server.batchErrors[i] = cachedEvaluate(server.cache, server.batchExpressions[i], server.batchResults[i]);
+            else { server.batchErrors[i] = ERROR::INVALID_CHARACTER; server.batchResults[i] = 0; }
+        }
+    });
+
+    // Answers are queued in the order of the batch, which keeps the order of every connection
+    for (size_t i = 0; i < count; ++i) {
+        unsigned char answer[EVAL_ANSWER_SIZE];
+        writeLittleEndian(answer, (uint32_t)server.batchErrors[i]);
+        writeLittleEndian(answer + 4, (uint32_t)server.batchResults[i]);
+        server.connections[server.batchConnections[i]].output.append((const char*)answer, EVAL_ANSWER_SIZE);
+    }
+
+    std::lock_guard<std::mutex> guard(server.statsLock);
+    server.stats.requests += count;
+    ++server.stats.batches;
+    if (count > server.stats.largestBatch) server.stats.largestBatch = count;
+}
+
+// Writes as much of the queued answers of a client as it takes
+static void writeClient(ServerConnection& connection)
+{
+    while (connection.written < connection.output.size()) {
+        ssize_t sent = send(connection.fd, connection.output.data() + connection.written,
+            connection.output.size() - connection.written, SEND_FLAGS);
+        if (sent > 0) { connection.written += (size_t)sent; continue; }
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) connection.broken = true;
+        break;
+    }
+    if (connection.written == connection.output.size()) {
+        connection.output.clear();
+        connection.written = 0;
+    }
+    else if (connection.written * 2 >= connection.output.size()) {
+        connection.output.erase(0, connection.written);
+        connection.written = 0;
+    }
+}
+
+// Serves clients until stopEvalServer() is called.
+int runEvalServer(EvalServer& server)
+{
+    std::vector<pollfd> polled;
+    int status = EVAL_SERVER::SUCCESS;
+    bool pending = false; // Requests already read that did not fit in the last batch
+    while (!server.stopping) {
+        // Wait for the wake pipe, new clients, requests and room to write answers
+        polled.clear();
+        polled.push_back({ server.wakeFds[0], POLLIN, 0 });
+        polled.push_back({ server.listenFd, POLLIN, 0 });
+        for (const ServerConnection& connection : server.connections) {
+            short events = canRead(server, connection) ? POLLIN : 0;
+            if (connection.written < connection.output.size()) events |= POLLOUT;
+            polled.push_back({ connection.fd, events, 0 });
+        }
+        if (poll(polled.data(), polled.size(), pending ? 0 : -1) < 0) {
+            if (errno == EINTR) continue;
+            status = EVAL_SERVER::SOCKET_ERROR;
+            break;
+        }
+        if (polled[0].revents) {
+            char drain[64];
+            while (read(server.wakeFds[0], drain, sizeof(drain)) > 0) {}
+        }
+        if (polled[1].revents & POLLIN) acceptClients(server);
+
+        // Read every client, then take their requests into one batch. Clients accepted just now are
+        // read on the next turn. A client that sent too many requests for the batch, or that has too many
+        // answers left unread, keeps the rest in its buffer. The client taken first moves on every turn,
+        // so one that always has a full batch waiting cannot keep the others out.
+        server.batchText.clear();
+        server.batchOffsets.clear();
+        server.batchConnections.clear();
+        for (size_t c = 0; c + 2 < polled.size(); ++c) {
+            ServerConnection& connection = server.connections[c];
+            if (polled[c + 2].revents & (POLLIN | POLLHUP | POLLERR)) readClient(server, connection);
+        }
+        size_t clients = server.connections.size();
+        for (size_t k = 0; k < clients; ++k) {
+            size_t c = (server.firstConnection + k) % clients;
+            if (server.connections[c].broken || outputFull(server, server.connections[c]) || takeRequests(server, c)) continue;
+            server.connections[c].broken = true;
+            std::lock_guard<std::mutex> guard(server.statsLock);
+            ++server.stats.protocolErrors;
+        }
+        server.firstConnection = clients ? (server.firstConnection + 1) % clients : 0;
+        evaluateRequests(server);
+
+        // Write the answers, then drop the clients that are gone, or that closed and have nothing left to get
+        for (ServerConnection& connection : server.connections) {
+            if (!connection.broken) writeClient(connection);
+        }
+        for (size_t c = server.connections.size(); c-- > 0;) {
+            ServerConnection& connection = server.connections[c];
+            bool done = connection.closed && connection.output.empty() && !hasRequest(connection);
+            if (!connection.broken && !done) continue;
+            close(connection.fd);
+            server.connections[c] = std::move(server.connections.back());
+            server.connections.pop_back();
+        }
+
+        // What the connections hold now. Requests left over are pending only once their client has room
+        // for the answers, which writing may just have made: otherwise the next poll waits for it.
+        size_t buffered = 0;
+        pending = false;
+        for (const ServerConnection& connection : server.connections) {
+            buffered += connection.input.size() - connection.consumed + connection.output.size() - connection.written;
+            pending = pending || (!outputFull(server, connection) && hasRequest(connection));
+        }
+        std::lock_guard<std::mutex> guard(server.statsLock);
+        server.stats.bufferedBytes = buffered;
+        if (buffered > server.stats.mostBuffered) server.stats.mostBuffered = buffered;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(server.statsLock);
+        server.stats.cache = getCacheStats(server.cache);
+    }
+    closeServer(server);
+    return status;
+}
+
+// Asks a running server to stop.
+void stopEvalServer(EvalServer& server)
+{
+    server.stopping = true;
+    if (server.wakeFds[1] >= 0) {
+        char wake = 1;
+        ssize_t ignored = write(server.wakeFds[1], &wake, 1);
+        (void)ignored;
+    }
+}
+
+// Returns the counters of the server.
+EvalServerStats getEvalServerStats(const EvalServer& server)
+{
+    std::lock_guard<std::mutex> guard(server.statsLock);
+    EvalServerStats stats = server.stats;
+    if (!server.stopping) stats.cache = getCacheStats(server.cache);
+    return stats;
+}
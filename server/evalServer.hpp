@@ -0,0 +1,104 @@
+/*
+ * File: evalServer.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of the evaluation server.
+ * Processes that all evaluate the same formulas can share one server instead of each parsing them
+ * again. The server listens on a Unix domain socket, reads pipelined requests from every client (see
+ * evalProtocol.hpp), and evaluates the requests of all its clients together as one batch on the thread
+ * pool, through a single expression cache, before writing the answers back.
+ */
+
+#ifndef EVAL_SERVER_HPP
+#define EVAL_SERVER_HPP
+
+#include "evalProtocol.hpp"
+#include "../expressionCache.hpp"
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Most requests evaluated in one batch
+static const size_t DEFAULT_SERVER_BATCH = 4096;
+
+// Bytes read from a client at a time
+static const size_t SERVER_READ_SIZE = 64 << 10;
+
+// Batches of answers a client may leave unread. Past that many bytes of unwritten answers, or of requests
+// read but not taken, the server stops reading the client until it catches up.
+static const size_t SERVER_BUFFERED_BATCHES = 4;
+
+// Expressions the shared cache holds when no other size is given
+static const size_t DEFAULT_SERVER_CACHE = 1 << 16;
+
+// Settings of a server
+struct EvalServerOptions
+{
+	unsigned threads = 0;                        // Threads evaluating a batch (0 = one per core)
+	size_t maxBatch = DEFAULT_SERVER_BATCH;      // Most requests evaluated in one batch
+	size_t cacheCapacity = DEFAULT_SERVER_CACHE; // Expressions remembered by the cache, 0 for no cache
+};
+
+// Counters of a server
+struct EvalServerStats
+{
+	size_t connections = 0;   // Clients accepted
+	size_t requests = 0;      // Requests answered
+	size_t batches = 0;       // Batches evaluated
+	size_t largestBatch = 0;  // Most requests in one batch
+	size_t protocolErrors = 0; // Connections closed for sending something else than a request
+	size_t bufferedBytes = 0; // Requests read and not yet taken plus answers not yet written, after the last turn
+	size_t mostBuffered = 0;  // Most bytes buffered after a turn
+	CacheStats cache;         // Counters of the shared cache
+};
+
+// A client connection, with what was read but not yet answered and what is waiting to be written
+struct ServerConnection
+{
+	int fd = -1;
+	std::string input;        // Bytes read, from 'consumed' on
+	size_t consumed = 0;      // Bytes of 'input' already taken as requests, dropped once they are half of it
+	std::string output;       // Answers, from 'written' on
+	size_t written = 0;       // Bytes of 'output' already written, dropped once they are half of it
+	bool closed = false;      // The client closed its side: nothing more is read, what is left is still answered
+	bool broken = false;      // The socket failed or the client broke the protocol: dropped at once
+};
+
+// An evaluation server
+struct EvalServer
+{
+	int listenFd = -1;
+	int wakeFds[2] = { -1, -1 };       // Pipe written by stopEvalServer() to wake the loop
+	std::string socketPath;
+	EvalServerOptions options;
+	ExpressionCache cache;             // Shared by every client
+	std::vector<ServerConnection> connections;
+	size_t firstConnection = 0;        // Connection whose requests go first into the next batch
+	std::atomic<bool> stopping{ false };
+
+	// The batch being evaluated: every expression followed by a NUL, and who asked for it
+	std::string batchText;
+	std::vector<size_t> batchOffsets, batchConnections;
+	std::vector<const char*> batchExpressions;
+	std::vector<int> batchResults, batchErrors;
+
+	mutable std::mutex statsLock;      // Protects 'stats', read by other threads
+	EvalServerStats stats;
+};
+
+// Creates the socket at 'socketPath' (replacing a stale one) and gets the server ready to run.
+// Returns EVAL_SERVER::SUCCESS or EVAL_SERVER::SOCKET_ERROR.
+int startEvalServer(EvalServer& server, const char* socketPath, const EvalServerOptions& options);
+
+// Serves clients until stopEvalServer() is called, then closes every connection and removes the socket.
+// Returns EVAL_SERVER::SUCCESS, or EVAL_SERVER::SOCKET_ERROR if waiting for clients failed.
+int runEvalServer(EvalServer& server);
+
+// Asks a running server to stop. It may be called from any thread, or from a signal handler.
+void stopEvalServer(EvalServer& server);
+
+// Returns the counters of the server. It may be called from any thread.
+EvalServerStats getEvalServerStats(const EvalServer& server);
+
+#endif // EVAL_SERVER_HPP
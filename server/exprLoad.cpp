@@ -0,0 +1,180 @@
+/*
+ * File: exprLoad.cpp
+ * Author: Alex Turner
+ * Description: This file contains the exprLoad load generator of the evaluation server.
+ * Every connection runs on its own thread and keeps a fixed number of requests in flight, drawn from a
+ * pool of generated expressions. The latency of every request, from the moment it is queued to the
+ * moment its answer is read, is recorded, and the tool reports the throughput and the p50 and p99
+ * latencies. Every answer is checked against evaluate().
+ */
+
+// Include necessary headers
+#include "evalClient.hpp"
+#include "evalServer.hpp"
+#include "../expressionEvaluator.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+// Options given on the command line
+struct LoadOptions
+{
+    const char* socketPath = 0; // Server to load, null to start one in this process
+    unsigned connections = 4;   // Connections, one thread each
+    size_t requests = 100000;   // Requests per connection
+    size_t depth = 64;          // Requests in flight per connection
+    size_t distinct = 1000;     // Distinct expressions in the pool
+};
+
+// An expression of the pool and the answer evaluate() gives
+struct PoolEntry
+{
+    std::string text;
+    int errorCode = 0;
+    int result = 0;
+};
+
+// Prints how to use the tool
+static void printUsage()
+{
+    fprintf(stderr,
+        "Usage: exprLoad [-c connections] [-n requests] [-d depth] [-k distinct] [socket]\n"
+        "Loads the evaluation server at 'socket', or one started in this process when it is missing.\n"
+        "  -c connections  connections, one thread each (default 4)\n"
+        "  -n requests     requests per connection (default 100000)\n"
+        "  -d depth        requests in flight per connection (default 64)\n"
+        "  -k distinct     distinct expressions sent (default 1000)\n");
+}
+
+// Builds the pool of expressions: short arithmetic with a few parentheses, and now and then an error
+static std::vector<PoolEntry> makePool(size_t distinct)
+{
+    std::mt19937 random(20);
+    std::vector<PoolEntry> pool(distinct);
+    for (PoolEntry& entry : pool) {
+        int terms = 2 + random() % 8;
+        for (int t = 0; t < terms; ++t) {
+            if (t > 0) { entry.text += ' '; entry.text += "+-*/"[random() % 4]; entry.text += ' '; }
+            if (random() % 5 == 0) entry.text += "(" + std::to_string(random() % 100) + " - " + std::to_string(random() % 100) + ")";
+            else entry.text += std::to_string(random() % 1000);
+        }
+        if (random() % 50 == 0) entry.text += " )";
+        entry.errorCode = evaluate(entry.text.c_str(), entry.result);
+    }
+    return pool;
+}
+
+// Runs one connection: keeps 'depth' requests in flight until 'requests' are answered.
+// Returns the number of wrong answers, or -1 if the connection failed.
+static long runConnection(const LoadOptions& options, const char* socketPath, const std::vector<PoolEntry>& pool,
+    unsigned seed, std::vector<double>& latencies)
+{
+    typedef std::chrono::steady_clock Clock;
+    EvalClient client;
+    if (connectEvalServer(client, socketPath) != EVAL_SERVER::SUCCESS) return -1;
+
+    std::mt19937 random(seed);
+    std::vector<size_t> picked(options.depth);
+    std::vector<Clock::time_point> sent(options.depth);
+    size_t queued = 0, answered = 0;
+    long wrong = 0;
+    latencies.reserve(options.requests);
+    while (answered < options.requests) {
+        // Fill the window, the slot of a request is its number modulo the depth
+        while (queued < options.requests && queued - answered < options.depth) {
+            size_t slot = queued % options.depth;
+            picked[slot] = random() % pool.size();
+            sent[slot] = Clock::now();
+            queueRequest(client, pool[picked[slot]].text.data(), pool[picked[slot]].text.size());
+            ++queued;
+        }
+
+        int errorCode = 0, result = 0;
+        if (receiveAnswers(client, 1, &result, &errorCode) != EVAL_SERVER::SUCCESS) { closeEvalClient(client); return -1; }
+        size_t slot = answered % options.depth;
+        latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent[slot]).count());
+        const PoolEntry& entry = pool[picked[slot]];
+        if (errorCode != entry.errorCode || result != entry.result) ++wrong;
+        ++answered;
+    }
+    closeEvalClient(client);
+    return wrong;
+}
+
+// Entry point of the tool
+int main(int argc, char** argv)
+{
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) options.connections = (unsigned)atoi(argv[++i]);
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) options.requests = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) options.depth = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) options.distinct = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) { printUsage(); return 0; }
+        else if (argv[i][0] == '-') { printUsage(); return 2; }
+        else if (!options.socketPath) options.socketPath = argv[i];
+        else { printUsage(); return 2; }
+    }
+    if (options.connections == 0 || options.depth == 0 || options.distinct == 0) { printUsage(); return 2; }
+    signal(SIGPIPE, SIG_IGN);
+
+    // Without a socket, a server runs on a thread of this process
+    static EvalServer server;
+    std::thread serverThread;
+    std::string socketPath = options.socketPath ? options.socketPath : "/tmp/exprLoad." + std::to_string(getpid()) + ".sock";
+    if (!options.socketPath) {
+        if (startEvalServer(server, socketPath.c_str(), EvalServerOptions()) != EVAL_SERVER::SUCCESS) {
+            perror(socketPath.c_str());
+            return 1;
+        }
+        serverThread = std::thread([] { runEvalServer(server); });
+    }
+
+    std::vector<PoolEntry> pool = makePool(options.distinct);
+    std::vector<std::vector<double>> latencies(options.connections);
+    std::vector<long> wrong(options.connections);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned c = 0; c < options.connections; ++c) {
+        threads.emplace_back([&, c] { wrong[c] = runConnection(options, socketPath.c_str(), pool, 100 + c, latencies[c]); });
+    }
+    for (std::thread& thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!options.socketPath) {
+        stopEvalServer(server);
+        serverThread.join();
+    }
+
+    // Gather the latencies of every connection
+    std::vector<double> all;
+    long failedConnections = 0, wrongAnswers = 0;
+    for (unsigned c = 0; c < options.connections; ++c) {
+        if (wrong[c] < 0) { ++failedConnections; continue; }
+        wrongAnswers += wrong[c];
+        all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+    }
+    if (all.empty()) {
+        fprintf(stderr, "No request was answered\n");
+        return 1;
+    }
+    std::sort(all.begin(), all.end());
+    printf("connections %u, depth %zu, requests %zu, seconds %.3f, requests/s %.0f\n",
+        options.connections, options.depth, all.size(), seconds, (double)all.size() / seconds);
+    printf("latency us: p50 %.1f, p99 %.1f, max %.1f\n", all[all.size() / 2], all[all.size() * 99 / 100], all.back());
+    if (failedConnections || wrongAnswers) {
+        fprintf(stderr, "%ld connections failed, %ld wrong answers\n", failedConnections, wrongAnswers);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * File: exprServer.cpp
+ * Author: Alex Turner
+ * Description: This file contains the exprServer command line tool.
+ * It runs an evaluation server on a Unix domain socket until it is interrupted, then prints its counters.
+ */
+
+// Include necessary headers
+#include "evalServer.hpp"
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// The server stopped by the signal handler
+static EvalServer* runningServer = 0;
+
+// Stops the server on SIGINT and SIGTERM
+static void handleSignal(int)
+{
+    if (runningServer) stopEvalServer(*runningServer);
+}
+
+// Prints how to use the tool
+static void printUsage()
+{
+    fprintf(stderr,
+        "Usage: exprServer [-j threads] [-b batch] [-c capacity] socket\n"
+        "Evaluates the expressions sent to the Unix domain socket 'socket' (see evalProtocol.hpp).\n"
+        "  -j threads   evaluate batches on this many threads, 0 for one per core (default 0)\n"
+        "  -b batch     most requests evaluated in one batch (default %zu)\n"
+        "  -c capacity  expressions kept by the shared cache, 0 for no cache (default %zu)\n",
+        DEFAULT_SERVER_BATCH, DEFAULT_SERVER_CACHE);
+}
+
+// Entry point of the tool
+int main(int argc, char** argv)
+{
+    EvalServerOptions options;
+    const char* socketPath = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) options.threads = (unsigned)atoi(argv[++i]);
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) options.maxBatch = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) options.cacheCapacity = (size_t)atol(argv[++i]);
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) { printUsage(); return 0; }
+        else if (argv[i][0] == '-') { printUsage(); return 2; }
+        else if (!socketPath) socketPath = argv[i];
+        else { printUsage(); return 2; }
+    }
+    if (!socketPath) { printUsage(); return 2; }
+
+    static EvalServer server;
+    if (startEvalServer(server, socketPath, options) != EVAL_SERVER::SUCCESS) {
+        perror(socketPath);
+        return 1;
+    }
+    runningServer = &server;
+    signal(SIGINT, handleSignal);
+    signal(SIGTERM, handleSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    int status = runEvalServer(server);
+    EvalServerStats stats = getEvalServerStats(server);
+    fprintf(stderr, "%zu connections, %zu requests in %zu batches (largest %zu), %zu protocol errors, cache: %zu hits, %zu misses\n",
+        stats.connections, stats.requests, stats.batches, stats.largestBatch, stats.protocolErrors, stats.cache.hits, stats.cache.misses);
+    return status == EVAL_SERVER::SUCCESS ? 0 : 1;
+}
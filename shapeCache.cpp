@@ -0,0 +1,287 @@
+/*
+ * File: shapeCache.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of the shape cache.
+ * A shape is compiled by writing its numbers as parameter names ("# + #" becomes " _0 + _1 "), which
+ * the compiler treats exactly like numbers except in the validation, where a name is one number
+ * and "12" is two. Shapes with an operator validate the same way whatever their numbers are, so only
+ * shapes without operators are left to evaluate(). Plans have no branches: every expression of a
+ * shape runs the same instructions, and the lanes only part ways on a division by zero.
+ */
+
+// Include necessary headers
+#include "shapeCache.hpp"
+#include "expressionEvaluator.hpp"
+#include "optimizer.hpp"
+#include "constants.hpp"
+#include <cstdint>
+#include <cstring>
+
+// Classes of the characters of an expression
+namespace SHAPE_CHAR
+{
+    static const unsigned char OTHER = 0;    // Anything the shape cache does not handle
+    static const unsigned char DIGIT = 1;    // '0' to '9'
+    static const unsigned char SPACE = 2;    // Whitespace accepted by skipSpaces()
+    static const unsigned char OPERATOR = 3; // '+', '-', '*' and '/'
+    static const unsigned char PAREN = 4;    // '(' and ')'
+}
+
+// Returns the class of every character
+static const unsigned char* shapeClasses()
+{
+    static const struct Table {
+        unsigned char classes[256] = {};
+        Table()
+        {
+            for (int ch = '0'; ch <= '9'; ++ch) classes[ch] = SHAPE_CHAR::DIGIT;
+            for (unsigned char ch : { ' ', '\t', '\n', '\r', '\f', '\v' }) classes[ch] = SHAPE_CHAR::SPACE;
+            for (unsigned char ch : { '+', '-', '*', '/' }) classes[ch] = SHAPE_CHAR::OPERATOR;
+            classes[(unsigned char)'('] = classes[(unsigned char)')'] = SHAPE_CHAR::PAREN;
+        }
+    } table;
+    return table.classes;
+}
+
+// Writes the shape of the expression into 'shape' and appends its numbers to 'literals'.
+// Returns false if the expression cannot share a plan, see expressionShape().
+// This runs for every expression, so the shape is written through a pointer into a string sized once.
+static bool scanShape(const char* expression, std::string& shape, std::vector<int>& literals)
+{
+    static const unsigned char* classes = shapeClasses();
+    shape.resize(strlen(expression));
+    char* out = &shape[0];
+    char* start = out;
+    bool hasOperator = false;
+    const unsigned char* cur = (const unsigned char*)expression;
+    while (*cur) {
+        switch (classes[*cur]) {
+        case SHAPE_CHAR::DIGIT: {
+            // Read exactly like parseDigits() does: the value wraps modulo 2^32 on overflow
+            uint32_t value = 0;
+            do value = value * 10 + (uint32_t)(*cur++ - '0'); while (classes[*cur] == SHAPE_CHAR::DIGIT);
+            literals.push_back((int)value);
+            *out++ = '#';
+            break;
+        }
+        case SHAPE_CHAR::SPACE: ++cur; break;
+        case SHAPE_CHAR::OPERATOR: hasOperator = true; *out++ = (char)*cur++; break;
+        case SHAPE_CHAR::PAREN: *out++ = (char)*cur++; break;
+        default: shape.resize(out - start); return false;
+        }
+    }
+    shape.resize(out - start);
+    return hasOperator;
+}
+
+// Writes the shape of an expression and its numbers.
+bool expressionShape(const char* expression, std::string& shape, std::vector<int>& literals)
+{
+    literals.clear();
+    return scanShape(expression, shape, literals);
+}
+
+// Drops every plan of the cache.
+void initShapeCache(ShapeCache& cache, size_t capacity)
+{
+    cache.index.clear();
+    cache.seen.clear();
+    cache.plans.clear();
+    cache.capacity = capacity ? capacity : DEFAULT_SHAPE_CAPACITY;
+    cache.stats = ShapeCacheStats();
+}
+
+// Drops the plans when the cache is full. Only done between calls, so a batch can hold on to plan numbers.
+// The shapes seen once are dropped on their own too, or a stream of distinct shapes would grow them forever.
+static void makeRoom(ShapeCache& cache)
+{
+    if (cache.seen.size() >= cache.capacity) cache.seen.clear();
+    if (cache.plans.size() < cache.capacity) return;
+    cache.index.clear();
+    cache.seen.clear();
+    cache.plans.clear();
+    cache.stats.evictions++;
+}
+
+// Returned by findPlan() for a shape seen for the first time
+static const size_t NO_PLAN = (size_t)-1;
+
+// Returns the number of the plan of the shape in cache.key, compiling it if the shape was seen before
+static size_t findPlan(ShapeCache& cache)
+{
+    auto it = cache.index.find(cache.key);
+    if (it != cache.index.end()) {
+        cache.stats.hits++;
+        return it->second;
+    }
+    cache.stats.misses++;
+    if (cache.seen.insert(std::hash<std::string>()(cache.key)).second) return NO_PLAN;
+    cache.stats.compiles++;
+
+    // Write the numbers as parameters, spaces keep two of them from running into one name
+    std::string& text = cache.text;
+    text.clear();
+    int slot = 0;
+    for (char ch : cache.key) {
+        if (ch != '#') { text += ch; continue; }
+        text += " _";
+        text += std::to_string(slot++);
+        text += ' ';
+    }
+    while ((int)cache.parameters.names.size() < slot) {
+        declareVariable(cache.parameters, ("_" + std::to_string(cache.parameters.names.size())).c_str());
+    }
+
+    cache.plans.emplace_back();
+    CompiledExpression& plan = cache.plans.back();
+    compile(text.c_str(), cache.parameters, plan);
+    optimize(plan);
+
+    // The plan reads one slot per number of its shape, whatever else the table holds
+    plan.variableCount = slot;
+    cache.index.emplace(cache.key, cache.plans.size() - 1);
+    return cache.plans.size() - 1;
+}
+
+// Evaluates the expression with the plan of its shape.
+int shapeEvaluate(ShapeCache& cache, const char* expression, int& result)
+{
+    if (!expressionShape(expression, cache.key, cache.literals)) {
+        cache.stats.bypassed++;
+        return evaluate(expression, result);
+    }
+    makeRoom(cache);
+    size_t plan = findPlan(cache);
+    if (plan == NO_PLAN) return evaluate(expression, result);
+    return run(cache.plans[plan], cache.literals.data(), result);
+}
+
+// Divides every lane of 'left' by 'right'. A lane that divides by zero has failed, and a lane that
+// has failed divides by 1 from then on, so it can never trap on a value run() would not have reached.
+static inline void divideLanes(int* left, const int* right, int* failed)
+{
+    for (size_t l = 0; l < SHAPE_LANES; ++l) {
+        int bad = failed[l] | (right[l] == 0);
+        failed[l] = bad;
+        left[l] /= bad ? 1 : right[l];
+    }
+}
+
+// Runs a plan on SHAPE_LANES expressions at once, of which the first 'lanes' are real. Every stack entry,
+// temporary and parameter is a row of SHAPE_LANES values, so each instruction is a short loop the compiler
+// turns into vector code. The unused lanes start as failed, so they divide by 1 and can never trap on
+// what their padding computes to.
+static void runLanes(const CompiledExpression& plan, size_t lanes, const int* columns, int* stack, int* temps, int* results, int* errorCodes)
+{
+    const size_t L = SHAPE_LANES;
+    int failed[SHAPE_LANES];
+    for (size_t l = 0; l < L; ++l) failed[l] = l >= lanes;
+
+    // 'top' points one row past the last row on the stack
+    int* top = stack;
+    for (const Instruction& ins : plan.code) {
+        switch (ins.opcode) {
+        case OPCODE::PUSH: for (size_t l = 0; l < L; ++l) top[l] = ins.operand; top += L; break;
+        case OPCODE::LOAD: for (size_t l = 0; l < L; ++l) top[l] = columns[ins.operand * L + l]; top += L; break;
+        case OPCODE::NEG: for (size_t l = 0; l < L; ++l) top[l - L] = -top[l - L]; break;
+        case OPCODE::ADD: top -= L; for (size_t l = 0; l < L; ++l) top[l - L] += top[l]; break;
+        case OPCODE::SUB: top -= L; for (size_t l = 0; l < L; ++l) top[l - L] -= top[l]; break;
+        case OPCODE::MUL: top -= L; for (size_t l = 0; l < L; ++l) top[l - L] *= top[l]; break;
+        case OPCODE::DIV: top -= L; divideLanes(top - L, top, failed); break;
+        case OPCODE::MULK: for (size_t l = 0; l < L; ++l) top[l - 2 * L] *= top[l - L]; break;
+        case OPCODE::DIVK: divideLanes(top - 2 * L, top - L, failed); break;
+        case OPCODE::STORE: for (size_t l = 0; l < L; ++l) temps[ins.operand * L + l] = top[l - L]; break;
+        case OPCODE::LOADT: for (size_t l = 0; l < L; ++l) top[l] = temps[ins.operand * L + l]; top += L; break;
+        case OPCODE::RETURN:
+            for (size_t l = 0; l < L; ++l) {
+                results[l] = failed[l] ? 0 : top[l - L];
+                errorCodes[l] = failed[l] ? ERROR::DIV_BY_ZERO : ins.operand;
+            }
+            return;
+        case OPCODE::FAIL:
+            for (size_t l = 0; l < L; ++l) {
+                results[l] = 0;
+                errorCodes[l] = failed[l] ? ERROR::DIV_BY_ZERO : ins.operand;
+            }
+            return;
+        }
+    }
+}
+
+// Evaluates many expressions, grouped by shape.
+size_t shapeEvaluateBatch(ShapeCache& cache, const char* const* expressions, size_t count, int* results, int* errorCodes)
+{
+    makeRoom(cache);
+
+    // The shape and numbers of every expression, the ones without a plan are evaluated now
+    cache.literals.clear();
+    cache.planOfRow.assign(count, NO_PLAN);
+    cache.literalStart.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t start = cache.literals.size();
+        if (!scanShape(expressions[i], cache.key, cache.literals)) {
+            cache.literals.resize(start);
+            cache.stats.bypassed++;
+            results[i] = 0;
+            errorCodes[i] = evaluate(expressions[i], results[i]);
+            continue;
+        }
+        cache.planOfRow[i] = findPlan(cache);
+        cache.literalStart[i] = start;
+        if (cache.planOfRow[i] == NO_PLAN) {
+            cache.literals.resize(start);
+            results[i] = 0;
+            errorCodes[i] = evaluate(expressions[i], results[i]);
+        }
+    }
+
+    // Sort the rows by plan, keeping their order inside a plan
+    std::vector<size_t>& rows = cache.rows;
+    std::vector<size_t>& groupStart = cache.groupStart;
+    std::vector<size_t>& next = cache.groupNext;
+    groupStart.assign(cache.plans.size() + 1, 0);
+    for (size_t i = 0; i < count; ++i) if (cache.planOfRow[i] != NO_PLAN) groupStart[cache.planOfRow[i] + 1]++;
+    for (size_t p = 0; p < cache.plans.size(); ++p) groupStart[p + 1] += groupStart[p];
+    rows.resize(groupStart.back());
+    next.assign(groupStart.begin(), groupStart.end() - 1);
+    for (size_t i = 0; i < count; ++i) if (cache.planOfRow[i] != NO_PLAN) rows[next[cache.planOfRow[i]]++] = i;
+
+    // Run every group, SHAPE_LANES rows at a time
+    int laneResults[SHAPE_LANES], laneErrors[SHAPE_LANES];
+    for (size_t p = 0; p < cache.plans.size(); ++p) {
+        const CompiledExpression& plan = cache.plans[p];
+        if (groupStart[p] == groupStart[p + 1]) continue;
+        size_t parameters = (size_t)plan.variableCount;
+        cache.columns.resize(parameters * SHAPE_LANES);
+        if (cache.stack.size() < (size_t)plan.maxStack * SHAPE_LANES) cache.stack.resize((size_t)plan.maxStack * SHAPE_LANES);
+        if (cache.temps.size() < (size_t)plan.tempCount * SHAPE_LANES) cache.temps.resize((size_t)plan.tempCount * SHAPE_LANES);
+
+        for (size_t first = groupStart[p]; first < groupStart[p + 1]; first += SHAPE_LANES) {
+            size_t lanes = groupStart[p + 1] - first < SHAPE_LANES ? groupStart[p + 1] - first : SHAPE_LANES;
+
+            // Numbers into columns: parameter s of lane l is columns[s * SHAPE_LANES + l].
+            // Lanes past the last row compute on ones, start as failed and are dropped.
+            for (size_t l = 0; l < SHAPE_LANES; ++l) {
+                const int* literals = l < lanes ? cache.literals.data() + cache.literalStart[rows[first + l]] : 0;
+                for (size_t s = 0; s < parameters; ++s) cache.columns[s * SHAPE_LANES + l] = literals ? literals[s] : 1;
+            }
+            runLanes(plan, lanes, cache.columns.data(), cache.stack.data(), cache.temps.data(), laneResults, laneErrors);
+            for (size_t l = 0; l < lanes; ++l) {
+                results[rows[first + l]] = laneResults[l];
+                errorCodes[rows[first + l]] = laneErrors[l];
+            }
+        }
+    }
+
+    size_t failures = 0;
+    for (size_t i = 0; i < count; ++i) failures += errorCodes[i] != ERROR::SUCCESS;
+    return failures;
+}
+
+// Returns the counters of the cache.
+ShapeCacheStats getShapeCacheStats(const ShapeCache& cache)
+{
+    ShapeCacheStats stats = cache.stats;
+    stats.shapes = cache.plans.size();
+    return stats;
+}
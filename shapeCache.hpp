@@ -0,0 +1,83 @@
+/*
+ * File: shapeCache.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of the shape cache.
+ * Expressions that differ only in their numbers, like "(12 * 13) + (14 / 15)" and "(7 * 2) + (9 / 3)",
+ * have the same shape. The cache compiles one plan per shape, with every number turned into a
+ * parameter, so a new expression of a known shape is evaluated by reading its numbers and running
+ * the plan. Many expressions of the same shape can also be run together, one per lane.
+ */
+
+#ifndef SHAPE_CACHE_HPP
+#define SHAPE_CACHE_HPP
+
+#include "compiledExpression.hpp"
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Number of expressions of the same shape run together by shapeEvaluateBatch()
+static const size_t SHAPE_LANES = 16;
+
+// Default number of shapes kept by a cache
+static const size_t DEFAULT_SHAPE_CAPACITY = 4096;
+
+// Counters of a shape cache
+struct ShapeCacheStats
+{
+	size_t hits = 0;      // Expressions run with the plan of a known shape
+	size_t misses = 0;    // Expressions of a shape without a plan, handed to evaluate() or compiled
+	size_t compiles = 0;  // Plans compiled
+	size_t bypassed = 0;  // Expressions handed to evaluate(), see shapeEvaluate()
+	size_t evictions = 0; // Times the cache was full and dropped its plans
+	size_t shapes = 0;    // Shapes currently in the cache
+};
+
+// A cache of plans, by shape.
+// A cache is used by one thread at a time, give every thread its own.
+struct ShapeCache
+{
+	std::unordered_map<std::string, size_t> index; // Plan of each shape
+	std::unordered_set<size_t> seen;               // Hashes of the shapes seen once, see shapeEvaluate()
+	std::vector<CompiledExpression> plans;         // Plans, reading the numbers of the expression from their slots
+	VariableTable parameters;                      // Names the plans are compiled with, one per slot
+	size_t capacity = DEFAULT_SHAPE_CAPACITY;      // Plans, and shapes seen once, kept before they are dropped
+	ShapeCacheStats stats;
+
+	// Buffers reused from one expression to the next
+	std::string key, text;
+	std::vector<int> literals;
+	std::vector<int> columns, stack, temps;
+	std::vector<size_t> rows, planOfRow, literalStart, groupStart, groupNext;
+};
+
+// Drops every plan of the cache, resets its counters and sets how many shapes it keeps (0 picks a default).
+void initShapeCache(ShapeCache& cache, size_t capacity);
+
+// Writes the shape of an expression into 'shape': every number is replaced by '#' and whitespace is
+// dropped, since skipSpaces() makes it meaningless ("1 2" is "##", two numbers, and "12" is "#").
+// The numbers are written to 'literals', read exactly like parseNext() reads them.
+// It returns false if the expression holds anything else than numbers, whitespace, '+', '-', '*', '/'
+// and parentheses, or if it has no operator, since its answer then depends on more than its shape.
+bool expressionShape(const char* expression, std::string& shape, std::vector<int>& literals);
+
+// Evaluates the expression with the plan of its shape. The first time a shape is seen the expression is
+// handed to evaluate(), the second time its plan is compiled: a shape seen only once, which is common in
+// hand written input, is not worth a compilation.
+// The error code and result are always the same as evaluate() returns. An expression without operators
+// (where "12" is NO_OPERATOR because every digit counts as a number) or with other characters is
+// handed to evaluate() itself.
+int shapeEvaluate(ShapeCache& cache, const char* expression, int& result);
+
+// Evaluates 'count' expressions, writing the result and error code of expressions[i] to results[i]
+// and errorCodes[i], exactly as evaluate() would. Expressions are grouped by shape and every group
+// is run SHAPE_LANES expressions at a time, one instruction of the plan for all of them at once.
+// It returns the number of expressions that failed.
+size_t shapeEvaluateBatch(ShapeCache& cache, const char* const* expressions, size_t count, int* results, int* errorCodes);
+
+// Returns the counters of the cache.
+ShapeCacheStats getShapeCacheStats(const ShapeCache& cache);
+
+#endif // SHAPE_CACHE_HPP
@@ -0,0 +1,563 @@
+/*
+ * File: simdKernels.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of the vectorized scanning kernels.
+ * A block of characters is classified at once into bit masks (one bit per character for
+ * digits, operators, parentheses, NUL and valid characters), and the counts of
+ * isValidExpression() are then updated with population counts. A block that contains
+ * something the masks cannot decide on their own (an invalid character, or a ')' that could
+ * be unmatched) is handed to the scalar loop, so the error codes are always the scalar ones.
+ */
+
+// Include necessary headers
+#include "simdKernels.hpp"
+#include "constants.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SIMD_X86_64 1
+#include <emmintrin.h>
+#if defined(__GNUC__)
+// AVX2 is compiled with a target attribute and only used when the processor supports it
+#define SIMD_HAS_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// The SWAR kernels read the characters of a block from a 64 bit word, lowest byte first
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define SIMD_BIG_ENDIAN 1
+#endif
+
+// The NUL terminated kernels read whole aligned blocks, which may include a few bytes before
+// the expression or after its NUL. An aligned block never crosses a page, so this is safe,
+// but the address sanitizer cannot know that.
+#if defined(__clang__) || defined(__GNUC__)
+#define SIMD_NO_SANITIZE __attribute__((no_sanitize_address))
+#else
+#define SIMD_NO_SANITIZE
+#endif
+
+// Results of the scalar loop besides an error code
+static const int SCAN_CONTINUE = -1; // Reached the end of the range, no NUL and no error
+static const int SCAN_END = -2;      // Reached the NUL at the end of the expression, no error
+
+// Smallest page size of the platforms we build for, reads that stay inside a page cannot fault
+static const uintptr_t PAGE_SIZE = 4096;
+
+// Counts kept while validating, the same as isValidExpression()
+struct ValidateState
+{
+    int openParenCount = 0;  // Count of open parentheses
+    int closeParenCount = 0; // Count of close parentheses
+    int numCount = 0;        // Count of digits
+    int operatorCount = 0;   // Count of operators
+};
+
+// Bit masks of a block, bit i describes character i of the block
+struct BlockMasks
+{
+    uint64_t nul;   // NUL characters
+    uint64_t digit; // '0' to '9'
+    uint64_t op;    // '+', '-', '*' and '/'
+    uint64_t open;  // '('
+    uint64_t close; // ')'
+    uint64_t valid; // Digits, operators, parentheses and whitespace
+};
+
+// Returns the index of the lowest set bit, 'bits' must not be zero
+static inline int lowestBit(uint64_t bits)
+{
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return (int)index;
+#elif defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bits);
+#else
+    int index = 0;
+    while (!(bits & 1)) { bits >>= 1; ++index; }
+    return index;
+#endif
+}
+
+// Returns the number of set bits
+static inline int countBits(uint64_t bits)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(bits);
+#else
+    int count = 0;
+    for (; bits; bits &= bits - 1) ++count;
+    return count;
+#endif
+}
+
+// Returns the mask of the first 'width' bits
+static inline uint64_t lowBits(unsigned width)
+{
+    return width >= 64 ? ~0ull : (1ull << width) - 1;
+}
+
+// Returns true for the whitespace characters accepted by skipSpaces()
+static inline bool isSpace(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\f' || ch == '\v';
+}
+
+// The per character checks of isValidExpression(), from 'ch' up to 'end' (null for no limit)
+// or the first NUL. Returns an error code, SCAN_END at the NUL or SCAN_CONTINUE at 'end'.
+static int validateChars(ValidateState& state, const char* ch, const char* end)
+{
+    for (; ch != end; ++ch) {
+        if (*ch >= '0' && *ch <= '9') { state.numCount++; continue; }
+        switch (*ch) {
+        case '\0':
+            return SCAN_END;
+        case '+':
+        case '-':
+        case '*':
+        case '/':
+            state.operatorCount++;
+            continue;
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+        case '\f':
+        case '\v':
+            continue;
+        case '(':
+            state.openParenCount++;
+            continue;
+        case ')':
+            state.closeParenCount++;
+            if (state.closeParenCount > state.openParenCount) return ERROR::UNMATCHED_PAREN;
+            continue;
+        default:
+            return ERROR::INVALID_CHARACTER;
+        }
+    }
+    return SCAN_CONTINUE;
+}
+
+// The final checks of isValidExpression(), once the whole expression is counted
+static int finishValidation(const ValidateState& state)
+{
+    if (state.openParenCount != state.closeParenCount) return ERROR::UNMATCHED_PAREN;
+    else if (state.numCount == 0) return ERROR::NO_NUM;
+    else if (state.operatorCount == 0 && state.numCount > 1) return ERROR::NO_OPERATOR;
+    return ERROR::SUCCESS;
+}
+
+// Counts the characters of a classified block of 'width' characters. 'live' selects the characters
+// that belong to the expression (the first block may start before it). Returns like validateChars().
+static inline int validateBlock(ValidateState& state, const char* block, unsigned width, uint64_t live, const BlockMasks& masks)
+{
+    // Stop at the NUL
+    uint64_t nul = masks.nul & live;
+    if (nul) live &= (nul & (0 - nul)) - 1;
+
+    // Invalid characters, and ')' that could go below the count of '(' seen before the block,
+    // are left to the scalar loop, which returns the same error at the same place
+    uint64_t close = masks.close & live;
+    int closeCount = countBits(close);
+    if ((~masks.valid & live) || (close && state.openParenCount - state.closeParenCount < closeCount)) {
+        return validateChars(state, block + lowestBit(live), block + width);
+    }
+
+    state.openParenCount += countBits(masks.open & live);
+    state.closeParenCount += closeCount;
+    state.numCount += countBits(masks.digit & live);
+    state.operatorCount += countBits(masks.op & live);
+    return nul ? SCAN_END : SCAN_CONTINUE;
+}
+
+// Scalar kernels: the original one character at a time loops
+
+static int validateScalar(const char* expression)
+{
+    ValidateState state;
+    int code = validateChars(state, expression, 0);
+    return code == SCAN_END ? finishValidation(state) : code;
+}
+
+static const char* skipSpacesScalar(const char* cur)
+{
+    while (isSpace(*cur)) ++cur;
+    return cur;
+}
+
+static const char* skipSpacesScalar(const char* cur, const char* end)
+{
+    while (cur < end && isSpace(*cur)) ++cur;
+    return cur;
+}
+
+// SWAR kernels: 8 characters in a 64 bit word, every test sets the high bit of the matching bytes
+
+static const uint64_t SWAR_ONES = 0x0101010101010101ull;
+static const uint64_t SWAR_HIGH = 0x8080808080808080ull;
+
+// High bit of every byte that is zero
+static inline uint64_t swarZero(uint64_t word)
+{
+    uint64_t low = ~SWAR_HIGH;
+    return ~(((word & low) + low) | word | low);
+}
+
+// High bit of every byte equal to 'ch'
+static inline uint64_t swarEqual(uint64_t word, unsigned char ch)
+{
+    return swarZero(word ^ (SWAR_ONES * ch));
+}
+
+// High bit of every byte between 'low' and 'high' (both below 128)
+static inline uint64_t swarRange(uint64_t word, unsigned char low, unsigned char high)
+{
+    uint64_t atLeastLow = (word | SWAR_HIGH) - SWAR_ONES * low;
+    uint64_t aboveHigh = (word | SWAR_HIGH) - SWAR_ONES * (unsigned char)(high + 1);
+    return atLeastLow & ~aboveHigh & ~word & SWAR_HIGH;
+}
+
+// High bit of every whitespace byte
+static inline uint64_t swarSpace(uint64_t word)
+{
+    return swarEqual(word, ' ') | swarRange(word, '\t', '\r');
+}
+
+// Packs the high bits of the 8 bytes into 8 bits, byte i into bit i
+static inline uint64_t swarPack(uint64_t highBits)
+{
+    return ((highBits >> 7) * 0x0102040810204080ull) >> 56;
+}
+
+static inline uint64_t swarLoad(const char* block)
+{
+    uint64_t word;
+    memcpy(&word, block, sizeof(word));
+    return word;
+}
+
+static inline BlockMasks swarClassify(uint64_t word)
+{
+    BlockMasks masks;
+    uint64_t digit = swarRange(word, '0', '9');
+    uint64_t op = swarEqual(word, '+') | swarEqual(word, '-') | swarEqual(word, '*') | swarEqual(word, '/');
+    uint64_t open = swarEqual(word, '(');
+    uint64_t close = swarEqual(word, ')');
+    masks.nul = swarPack(swarZero(word));
+    masks.digit = swarPack(digit);
+    masks.op = swarPack(op);
+    masks.open = swarPack(open);
+    masks.close = swarPack(close);
+    masks.valid = swarPack(digit | op | open | close | swarSpace(word));
+    return masks;
+}
+
+SIMD_NO_SANITIZE static int validateSwar(const char* expression)
+{
+    ValidateState state;
+    const char* block = (const char*)((uintptr_t)expression & ~(uintptr_t)7);
+    uint64_t live = lowBits(8) & (~0ull << ((uintptr_t)expression & 7));
+    while (true) {
+        int code = validateBlock(state, block, 8, live, swarClassify(swarLoad(block)));
+        if (code != SCAN_CONTINUE) return code == SCAN_END ? finishValidation(state) : code;
+        block += 8;
+        live = lowBits(8);
+    }
+}
+
+SIMD_NO_SANITIZE static const char* skipSpacesSwar(const char* cur)
+{
+    const char* block = (const char*)((uintptr_t)cur & ~(uintptr_t)7);
+    uint64_t live = lowBits(8) & (~0ull << ((uintptr_t)cur & 7));
+    while (true) {
+        uint64_t stop = ~swarPack(swarSpace(swarLoad(block))) & live;
+        if (stop) return block + lowestBit(stop);
+        block += 8;
+        live = lowBits(8);
+    }
+}
+
+static const char* skipSpacesSwar(const char* cur, const char* end)
+{
+    for (; end - cur >= 8; cur += 8) {
+        uint64_t stop = ~swarPack(swarSpace(swarLoad(cur))) & lowBits(8);
+        if (stop) return cur + lowestBit(stop);
+    }
+    return skipSpacesScalar(cur, end);
+}
+
+#ifdef SIMD_X86_64
+
+// SSE2 kernels: 16 characters at a time. The compares are signed, so bytes of 128 and more
+// are negative and fall outside every range, like they do in the scalar code.
+
+static inline BlockMasks sse2Classify(__m128i chars)
+{
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+    __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8('+')), _mm_cmpeq_epi8(chars, _mm_set1_epi8('-'))),
+        _mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8('*')), _mm_cmpeq_epi8(chars, _mm_set1_epi8('/'))));
+    __m128i open = _mm_cmpeq_epi8(chars, _mm_set1_epi8('('));
+    __m128i close = _mm_cmpeq_epi8(chars, _mm_set1_epi8(')'));
+    __m128i space = _mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8(' ')),
+        _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('\t' - 1)), _mm_cmplt_epi8(chars, _mm_set1_epi8('\r' + 1))));
+    __m128i valid = _mm_or_si128(_mm_or_si128(digit, op), _mm_or_si128(_mm_or_si128(open, close), space));
+
+    BlockMasks masks;
+    masks.nul = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chars, _mm_setzero_si128()));
+    masks.digit = (uint32_t)_mm_movemask_epi8(digit);
+    masks.op = (uint32_t)_mm_movemask_epi8(op);
+    masks.open = (uint32_t)_mm_movemask_epi8(open);
+    masks.close = (uint32_t)_mm_movemask_epi8(close);
+    masks.valid = (uint32_t)_mm_movemask_epi8(valid);
+    return masks;
+}
+
+static inline uint64_t sse2NotSpace(__m128i chars)
+{
+    __m128i space = _mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8(' ')),
+        _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('\t' - 1)), _mm_cmplt_epi8(chars, _mm_set1_epi8('\r' + 1))));
+    return ~(uint64_t)(uint32_t)_mm_movemask_epi8(space) & lowBits(16);
+}
+
+SIMD_NO_SANITIZE static int validateSse2(const char* expression)
+{
+    ValidateState state;
+    const char* block = (const char*)((uintptr_t)expression & ~(uintptr_t)15);
+    uint64_t live = lowBits(16) & (~0ull << ((uintptr_t)expression & 15));
+    while (true) {
+        int code = validateBlock(state, block, 16, live, sse2Classify(_mm_load_si128((const __m128i*)block)));
+        if (code != SCAN_CONTINUE) return code == SCAN_END ? finishValidation(state) : code;
+        block += 16;
+        live = lowBits(16);
+    }
+}
+
+SIMD_NO_SANITIZE static const char* skipSpacesSse2(const char* cur)
+{
+    const char* block = (const char*)((uintptr_t)cur & ~(uintptr_t)15);
+    uint64_t live = lowBits(16) & (~0ull << ((uintptr_t)cur & 15));
+    while (true) {
+        uint64_t stop = sse2NotSpace(_mm_load_si128((const __m128i*)block)) & live;
+        if (stop) return block + lowestBit(stop);
+        block += 16;
+        live = lowBits(16);
+    }
+}
+
+static const char* skipSpacesSse2(const char* cur, const char* end)
+{
+    for (; end - cur >= 16; cur += 16) {
+        uint64_t stop = sse2NotSpace(_mm_loadu_si128((const __m128i*)cur));
+        if (stop) return cur + lowestBit(stop);
+    }
+    return skipSpacesScalar(cur, end);
+}
+
+#endif // SIMD_X86_64
+
+#ifdef SIMD_HAS_AVX2
+
+// AVX2 kernels: the SSE2 validation on 32 characters at a time. Whitespace runs are short, and
+// the 16 character skip is faster on them than a 32 character one, so AVX2 reuses it.
+
+#define SIMD_AVX2 __attribute__((target("avx2")))
+
+SIMD_AVX2 static inline BlockMasks avx2Classify(__m256i chars)
+{
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), chars));
+    __m256i op = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chars, _mm256_set1_epi8('+')), _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('-'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(chars, _mm256_set1_epi8('*')), _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('/'))));
+    __m256i open = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('('));
+    __m256i close = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(')'));
+    __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(chars, _mm256_set1_epi8(' ')),
+        _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('\t' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), chars)));
+    __m256i valid = _mm256_or_si256(_mm256_or_si256(digit, op), _mm256_or_si256(_mm256_or_si256(open, close), space));
+
+    BlockMasks masks;
+    masks.nul = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, _mm256_setzero_si256()));
+    masks.digit = (uint32_t)_mm256_movemask_epi8(digit);
+    masks.op = (uint32_t)_mm256_movemask_epi8(op);
+    masks.open = (uint32_t)_mm256_movemask_epi8(open);
+    masks.close = (uint32_t)_mm256_movemask_epi8(close);
+    masks.valid = (uint32_t)_mm256_movemask_epi8(valid);
+    return masks;
+}
+
+SIMD_AVX2 SIMD_NO_SANITIZE static int validateAvx2(const char* expression)
+{
+    ValidateState state;
+    const char* block = (const char*)((uintptr_t)expression & ~(uintptr_t)31);
+    uint64_t live = lowBits(32) & (~0ull << ((uintptr_t)expression & 31));
+    while (true) {
+        int code = validateBlock(state, block, 32, live, avx2Classify(_mm256_load_si256((const __m256i*)block)));
+        if (code != SCAN_CONTINUE) return code == SCAN_END ? finishValidation(state) : code;
+        block += 32;
+        live = lowBits(32);
+    }
+}
+
+#endif // SIMD_HAS_AVX2
+
+// The kernels of one level
+struct Kernels
+{
+    int (*validate)(const char*);
+    const char* (*skipSpaces)(const char*);
+    const char* (*skipSpacesBounded)(const char*, const char*);
+};
+
+// Kernels by level, a level that cannot be built here uses the one below it
+static const Kernels KERNELS[] = {
+    { validateScalar, skipSpacesScalar, skipSpacesScalar },
+    { validateSwar, skipSpacesSwar, skipSpacesSwar },
+#ifdef SIMD_X86_64
+    { validateSse2, skipSpacesSse2, skipSpacesSse2 },
+#else
+    { validateSwar, skipSpacesSwar, skipSpacesSwar },
+#endif
+#ifdef SIMD_HAS_AVX2
+    { validateAvx2, skipSpacesSse2, skipSpacesSse2 },
+#elif defined(SIMD_X86_64)
+    { validateSse2, skipSpacesSse2, skipSpacesSse2 },
+#else
+    { validateSwar, skipSpacesSwar, skipSpacesSwar },
+#endif
+};
+
+// The level in use, -1 until the first kernel call picks the best one
+static std::atomic<int> currentLevel(-1);
+
+// Returns the best level this processor supports
+static int bestSupportedLevel()
+{
+#if defined(SIMD_HAS_AVX2)
+    return __builtin_cpu_supports("avx2") ? SIMD_LEVEL::AVX2 : SIMD_LEVEL::SSE2;
+#elif defined(SIMD_X86_64)
+    return SIMD_LEVEL::SSE2;
+#elif defined(SIMD_BIG_ENDIAN)
+    return SIMD_LEVEL::SCALAR;
+#else
+    return SIMD_LEVEL::SWAR;
+#endif
+}
+
+// Returns the level in use, picking it on the first call
+static inline int activeLevel()
+{
+    int level = currentLevel.load(std::memory_order_relaxed);
+    if (level < 0) {
+        level = bestSupportedLevel();
+        currentLevel.store(level, std::memory_order_relaxed);
+    }
+    return level;
+}
+
+// Returns the level the kernels currently use.
+int getSimdLevel()
+{
+    return activeLevel();
+}
+
+// Forces the kernels to use a level, capped to what the processor supports.
+int setSimdLevel(int level)
+{
+    int best = bestSupportedLevel();
+    if (level > best) level = best;
+    if (level < SIMD_LEVEL::SCALAR) level = SIMD_LEVEL::SCALAR;
+    currentLevel.store(level, std::memory_order_relaxed);
+    return level;
+}
+
+// Returns the name of a level.
+const char* simdLevelName(int level)
+{
+    static const char* const names[] = { "scalar", "swar", "sse2", "avx2" };
+    return level >= SIMD_LEVEL::SCALAR && level <= SIMD_LEVEL::AVX2 ? names[level] : "unknown";
+}
+
+// Same checks and error codes as isValidExpression().
+int validateExpression(const char* expression)
+{
+    return KERNELS[activeLevel()].validate(expression);
+}
+
+// Returns the first character at or after 'cur' that is not whitespace.
+const char* skipSpacesRun(const char* cur)
+{
+    return KERNELS[activeLevel()].skipSpaces(cur);
+}
+
+// Same as skipSpacesRun(), but never looks at 'end' or beyond.
+const char* skipSpacesRun(const char* cur, const char* end)
+{
+    return KERNELS[activeLevel()].skipSpacesBounded(cur, end);
+}
+
+// Powers of ten up to the 8 digits converted at once
+static const uint32_t POWERS_OF_TEN[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+
+// Converts the first 'count' (1 to 8) digits of a word. The digits are moved to the top of the
+// word so the bytes below them read as leading zeros, then pairs, quads and the whole 8 digits
+// are combined with one multiplication each.
+static inline uint32_t swarDigits(uint64_t word, int count)
+{
+    word <<= 8 * (8 - count);
+    word = ((word & 0x0F0F0F0F0F0F0F0Full) * 2561) >> 8;
+    word = ((word & 0x00FF00FF00FF00FFull) * 6553601) >> 16;
+    return (uint32_t)(((word & 0x0000FFFF0000FFFFull) * 42949672960001ull) >> 32);
+}
+
+// Converts up to 8 digits at 'cur' from a word read there. Returns the number of digits.
+static inline int swarDigitRun(const char* cur, uint32_t& value)
+{
+    uint64_t word = swarLoad(cur);
+    uint64_t notDigit = ~swarRange(word, '0', '9') & SWAR_HIGH;
+    int count = notDigit ? lowestBit(notDigit) / 8 : 8;
+    if (count) value = value * POWERS_OF_TEN[count] + swarDigits(word, count);
+    return count;
+}
+
+// Converts the run of digits starting at 'cur' and moves 'cur' past it.
+// Unsigned arithmetic wraps modulo 2^32, which is what the scalar loop does on int.
+SIMD_NO_SANITIZE int parseDigits(const char*& cur)
+{
+    uint32_t value = 0;
+#ifndef SIMD_BIG_ENDIAN
+    if (activeLevel() != SIMD_LEVEL::SCALAR) {
+        // 8 bytes at a time, as long as the 8 bytes are on the same page
+        while (((uintptr_t)cur & (PAGE_SIZE - 1)) <= PAGE_SIZE - 8) {
+            int count = swarDigitRun(cur, value);
+            cur += count;
+            if (count < 8) return (int)value;
+        }
+    }
+#endif
+    while (*cur >= '0' && *cur <= '9') value = value * 10 + (uint32_t)(*cur++ - '0');
+    return (int)value;
+}
+
+// Same as parseDigits(), but never looks at 'end' or beyond.
+int parseDigits(const char*& cur, const char* end)
+{
+    uint32_t value = 0;
+#ifndef SIMD_BIG_ENDIAN
+    if (activeLevel() != SIMD_LEVEL::SCALAR) {
+        while (end - cur >= 8) {
+            int count = swarDigitRun(cur, value);
+            cur += count;
+            if (count < 8) return (int)value;
+        }
+    }
+#endif
+    while (cur < end && *cur >= '0' && *cur <= '9') value = value * 10 + (uint32_t)(*cur++ - '0');
+    return (int)value;
+}
@@ -0,0 +1,48 @@
+/*
+ * File: simdKernels.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of the vectorized scanning kernels.
+ * They look at 8, 16 or 32 characters at a time to validate expressions, skip whitespace and
+ * convert runs of digits. The best version for the processor is picked the first time a
+ * kernel is used, and every version gives exactly the same answers as the scalar code.
+ */
+
+#ifndef SIMD_KERNELS_HPP
+#define SIMD_KERNELS_HPP
+
+// Instruction sets the kernels can use
+namespace SIMD_LEVEL
+{
+	static const int SCALAR = 0; // One character at a time (the original loops)
+	static const int SWAR = 1;   // 8 characters at a time in a 64 bit register, on any processor
+	static const int SSE2 = 2;   // 16 characters at a time (x86-64)
+	static const int AVX2 = 3;   // 32 characters at a time (x86-64 processors that support it)
+}
+
+// Returns the level the kernels currently use.
+int getSimdLevel();
+
+// Forces the kernels to use a level, capped to what the processor supports.
+// It returns the level actually used. Meant for tests and benchmarks.
+int setSimdLevel(int level);
+
+// Returns the name of a level ("scalar", "swar", "sse2" or "avx2").
+const char* simdLevelName(int level);
+
+// Same checks and error codes as isValidExpression(), for a non empty NUL terminated expression.
+int validateExpression(const char* expression);
+
+// Returns the first character at or after 'cur' that is not whitespace (see skipSpaces()).
+const char* skipSpacesRun(const char* cur);
+
+// Same as skipSpacesRun(), but never looks at 'end' or beyond.
+const char* skipSpacesRun(const char* cur, const char* end);
+
+// Converts the run of digits starting at 'cur' (there must be at least one) and moves 'cur' past it.
+// The value wraps around exactly like 'val = val * 10 + digit' does in parseNext().
+int parseDigits(const char*& cur);
+
+// Same as parseDigits(), but never looks at 'end' or beyond.
+int parseDigits(const char*& cur, const char* end);
+
+#endif // SIMD_KERNELS_HPP
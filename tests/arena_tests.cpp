@@ -0,0 +1,188 @@
+/*
+ * File: arena_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for the arena allocator.
+ * The global operator new is replaced by one that counts its calls: once compile(), optimize(),
+ * run(), evaluate() and evaluateIterative() have seen the expressions a first time, running them
+ * again must not allocate at all.
+ */
+
+ // Include necessary headers
+#include "../arena.hpp"
+#include "../compiledExpression.hpp"
+#include "../optimizer.hpp"
+#include "../expressionEvaluator.hpp"
+#include "../iterativeEvaluator.hpp"
+#include "../constants.hpp"
+#include "testData.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Number of calls to the global operator new so far
+static size_t allocationCount = 0;
+
+// Counting replacements of the global operator new and delete
+void* operator new(size_t size)
+{
+    ++allocationCount;
+    void* memory = malloc(size ? size : 1);
+    if (!memory) throw bad_alloc();
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    free(memory);
+}
+
+// Checks allocation, alignment and rewinding of an arena
+int runArenaTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    Arena arena;
+    char* first = static_cast<char*>(arenaAllocate(arena, 1, 1));
+    void* aligned = arenaAllocate(arena, 8, 8);
+    if ((uintptr_t)aligned % 8 != 0) {
+        cout << "Memory was not aligned." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Memory allocated in a scope comes back when it ends, and scopes nest
+    ArenaMark outer = arenaMark(arena);
+    {
+        ArenaScope scope(arena);
+        arenaAllocate(arena, 100, 4);
+        {
+            ArenaScope inner(arena);
+            arenaAllocate(arena, 3 * ARENA_BLOCK_SIZE, 16); // A block of its own
+        }
+        arenaAllocate(arena, 100, 4);
+    }
+    ArenaMark after = arenaMark(arena);
+    if (after.block != outer.block || after.used != outer.used) {
+        cout << "A scope did not give its memory back." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // After a reset the same requests get the same memory, without new blocks
+    size_t blocks = arena.blocks.size();
+    resetArena(arena);
+    if (arenaAllocate(arena, 1, 1) != first || arenaAllocate(arena, 8, 8) != aligned) {
+        cout << "The arena did not reuse its memory after a reset." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    arenaAllocate(arena, 3 * ARENA_BLOCK_SIZE, 16);
+    if (arena.blocks.size() != blocks) {
+        cout << "The arena added a block it already had." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Containers free nothing themselves
+    resetArena(arena);
+    ArenaVector<int> values{ ArenaAllocator<int>(arena) };
+    for (int i = 0; i < 100000; ++i) values.push_back(i);
+    for (int i = 0; i < 100000; ++i) {
+        if (values[i] != i) {
+            cout << "An arena vector lost its values." << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+    cout << "The arena reused its memory after every rewind." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Compiles, optimizes and runs every expression once, and returns a checksum of the answers
+static unsigned runAll(const vector<string>& expressions, const VariableTable& variables, CompiledExpression& program) {
+    static const int values[] = { 3, -7, 11 };
+    unsigned checksum = 0;
+    for (const string& expression : expressions) {
+        int result = 0;
+        checksum += compile(expression.c_str(), variables, program);
+        optimize(program);
+        checksum += run(program, values, result) + result;
+        checksum += compile(expression.c_str(), program);
+        checksum += run(program, result) + result;
+        checksum += evaluate(expression.c_str(), result) + result;
+        checksum += evaluateIterative(expression.c_str(), result) + result;
+    }
+    return checksum;
+}
+
+// Checks that the hot path allocates nothing once it is warm
+int runSteadyStateTests(const char* title, int rounds) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    VariableTable variables;
+    declareVariable(variables, "x");
+    declareVariable(variables, "y");
+    declareVariable(variables, "a_rather_long_variable_name");
+
+    // The differential expressions, expressions with shared parts, and deep ones
+    vector<string> expressions;
+    for (size_t i = 0; i < testData::NUM_DIFFERENTIAL_EXPRESSIONS; ++i) expressions.push_back(testData::getDifferentialExpressions(i));
+    expressions.push_back("(x + y) * (x + y) - (x + y) / (a_rather_long_variable_name + 1)");
+    expressions.push_back("x * 0 + y * 1 - (2 + 3) * a_rather_long_variable_name");
+    expressions.push_back(string(5000, '(') + "x + 1" + string(5000, ')'));
+    string chain = "1";
+    for (int i = 0; i < 5000; ++i) chain += (i % 3 == 0) ? " + x" : " * 2 - y";
+    expressions.push_back(chain);
+
+    CompiledExpression program;
+    unsigned expected = runAll(expressions, variables, program);
+    for (int round = 0; round < rounds; ++round) {
+        size_t before = allocationCount;
+        unsigned checksum = runAll(expressions, variables, program);
+        if (allocationCount != before || checksum != expected) {
+            cout << "Round " << round << " made " << allocationCount - before << " allocations, checksum "
+                << checksum << " instead of " << expected << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+    cout << rounds << " rounds over " << expressions.size() << " expressions made no allocation." << endl;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running Arena Tests..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    // Tests of the arena itself
+    if (runArenaTests("Test Arena Rewind") == ERROR::SUCCESS) {
+        cout << "All arena tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some arena tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests of the hot path
+    if (runSteadyStateTests("Test Zero Allocation Steady State", 20) == ERROR::SUCCESS) {
+        cout << "All steady state tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some steady state tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * File: batchEvaluator_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for the batch evaluation API.
+ */
+
+ // Include necessary headers
+#include "../batchEvaluator.hpp"
+#include "../expressionEvaluator.hpp"
+#include "../threadPool.hpp"
+#include "../constants.hpp"
+#include "testData.hpp"
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Number of expressions in the test batch
+static const size_t BATCH_SIZE = 20000;
+
+// Builds a batch mixing the short test expressions with a few very long ones,
+// so the threads that get the long ones have to be helped by the others
+static void buildBatch(vector<string>& storage, vector<const char*>& batch) {
+    storage.clear();
+    for (size_t i = 0; i < BATCH_SIZE; ++i) {
+        if (i % 997 == 0) {
+            string longExpression = "1";
+            for (size_t term = 0; term < 5000 + i % 3000; ++term) longExpression += (term % 2) ? " - 2" : " + 3";
+            storage.push_back(longExpression);
+        }
+        else if (i % 2) storage.push_back(testData::getDifferentialExpressions(i % testData::NUM_DIFFERENTIAL_EXPRESSIONS));
+        else storage.push_back(testData::getInvalidExpressions(i % testData::NUM_TEST_EXPRESSIONS));
+    }
+    batch.clear();
+    for (const string& expression : storage) batch.push_back(expression.c_str());
+}
+
+// Runs evaluateBatch() with several thread counts and compares every item against evaluate()
+int runBatchTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    vector<string> storage;
+    vector<const char*> batch;
+    buildBatch(storage, batch);
+
+    // Expected answers, one expression at a time
+    vector<int> expectedResults(BATCH_SIZE), expectedErrors(BATCH_SIZE);
+    size_t expectedFailed = 0;
+    for (size_t i = 0; i < BATCH_SIZE; ++i) {
+        expectedErrors[i] = evaluate(batch[i], expectedResults[i]);
+        if (expectedErrors[i] != ERROR::SUCCESS) ++expectedFailed;
+    }
+
+    unsigned threadCounts[] = { 1, 2, 3, 4, 8, 0 };
+    for (unsigned threads : threadCounts) {
+        vector<int> results(BATCH_SIZE, -1), errors(BATCH_SIZE, -1);
+        size_t failed = evaluateBatch(batch.data(), BATCH_SIZE, results.data(), errors.data(), threads);
+        if (failed != expectedFailed || results != expectedResults || errors != expectedErrors) {
+            cout << "Batch with " << threads << " threads failed. Expected failures: " << expectedFailed
+                << ", Got: " << failed << endl;
+            return ERROR::PARSE_ERROR;
+        }
+        cout << "Batch with " << threads << " threads matches evaluate() (" << failed << " failures)." << endl;
+    }
+
+    // An empty batch does nothing
+    if (evaluateBatch(batch.data(), 0, 0, 0, 4) != 0) return ERROR::PARSE_ERROR;
+    return ERROR::SUCCESS;
+}
+
+// Checks that parallelFor() runs every item exactly once, including a nested call
+int runParallelForTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    const size_t count = 100000;
+    vector<atomic<int>> seen(count);
+    for (auto& item : seen) item = 0;
+    parallelFor(count, 8, 7, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) seen[i]++;
+
+        // A nested call runs on the calling thread instead of waiting for the busy pool
+        if (begin == 0) parallelFor(10, 4, 1, [&](size_t, size_t) {});
+    });
+    for (size_t i = 0; i < count; ++i) {
+        if (seen[i] != 1) {
+            cout << "Item " << i << " ran " << seen[i] << " times." << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+    cout << "Every item ran exactly once." << endl;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running Batch Evaluator Tests..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    // Tests for the thread pool
+    if (runParallelForTests("Test Parallel For") == ERROR::SUCCESS) {
+        cout << "All parallel for tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some parallel for tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests for the batch evaluation
+    if (runBatchTests("Test Evaluate Batch") == ERROR::SUCCESS) {
+        cout << "All batch tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some batch tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
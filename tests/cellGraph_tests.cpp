@@ -0,0 +1,251 @@
+/*
+ * File: cellGraph_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for the cell graph.
+ * Cells must get the same values as evaluate() on hand checked models, only the cells downstream
+ * of a change may be recomputed, cycles must be refused, and random edits recomputed incrementally
+ * (serially or in parallel) must end with the same cells as a graph built from scratch.
+ */
+
+ // Include necessary headers
+#include "../cellGraph.hpp"
+#include "../constants.hpp"
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Checks the value and error code of a cell. Returns true if they match.
+static bool checkCell(const CellGraph& graph, const char* name, int expectedError, int expectedValue) {
+    int value = 0;
+    int error = getCell(graph, name, value);
+    if (error == expectedError && value == expectedValue) return true;
+    cout << "Cell '" << name << "' failed. Expected error: " << expectedError << " and value: " << expectedValue
+        << ", Got error: " << error << " and value: " << value << endl;
+    return false;
+}
+
+// Checks the number of cells recomputed. Returns true if it matches.
+static bool checkRecompute(CellGraph& graph, size_t expected) {
+    size_t count = recompute(graph);
+    if (count == expected) return true;
+    cout << "Expected " << expected << " cells to be recomputed, got " << count << endl;
+    return false;
+}
+
+// Runs a small model by hand
+int runModelTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    CellGraph graph;
+    setValue(graph, "price", 20);
+    setValue(graph, "quantity", 3);
+    setFormula(graph, "subtotal", "price * quantity");
+    setFormula(graph, "total", "subtotal - discount");
+    setFormula(graph, "unrelated", "(1 + 2) * 4");
+    if (!checkRecompute(graph, 5)) return ERROR::PARSE_ERROR;
+
+    // 'discount' was named by a formula but never set
+    if (!checkCell(graph, "subtotal", ERROR::SUCCESS, 60)) return ERROR::PARSE_ERROR;
+    if (!checkCell(graph, "discount", ERROR::UNKNOWN_VARIABLE, 0)) return ERROR::PARSE_ERROR;
+    if (!checkCell(graph, "total", ERROR::UNKNOWN_VARIABLE, 0)) return ERROR::PARSE_ERROR;
+    if (!checkCell(graph, "unrelated", ERROR::SUCCESS, 12)) return ERROR::PARSE_ERROR;
+    if (!checkCell(graph, "missing", ERROR::UNKNOWN_VARIABLE, 0)) return ERROR::PARSE_ERROR;
+
+    // Only the changed cell and the cells downstream of it are recomputed
+    setValue(graph, "discount", 5);
+    if (!checkRecompute(graph, 2)) return ERROR::PARSE_ERROR;
+    if (!checkCell(graph, "total", ERROR::SUCCESS, 55)) return ERROR::PARSE_ERROR;
+    setValue(graph, "quantity", 4);
+    if (!checkRecompute(graph, 3)) return ERROR::PARSE_ERROR;
+    if (!checkCell(graph, "total", ERROR::SUCCESS, 75)) return ERROR::PARSE_ERROR;
+    if (!checkRecompute(graph, 0)) return ERROR::PARSE_ERROR;
+
+    // Formulas keep the quirks of evaluate(), and errors flow downstream
+    setFormula(graph, "subtotal", "price * quantity + 1");
+    recompute(graph);
+    if (!checkCell(graph, "subtotal", ERROR::SUCCESS, 85)) return ERROR::PARSE_ERROR;
+    setFormula(graph, "subtotal", "price / (quantity - 4)");
+    recompute(graph);
+    if (!checkCell(graph, "subtotal", ERROR::DIV_BY_ZERO, 0)) return ERROR::PARSE_ERROR;
+    if (!checkCell(graph, "total", ERROR::DIV_BY_ZERO, 0)) return ERROR::PARSE_ERROR;
+    setFormula(graph, "subtotal", "price + 1 2");
+    recompute(graph);
+    if (!checkCell(graph, "subtotal", ERROR::PARSE_ERROR, 21)) return ERROR::PARSE_ERROR;
+    if (!checkCell(graph, "total", ERROR::PARSE_ERROR, 0)) return ERROR::PARSE_ERROR;
+
+    // Redefining a formula drops the inputs it no longer reads
+    setFormula(graph, "subtotal", "100 - 1");
+    recompute(graph);
+    if (!checkCell(graph, "total", ERROR::SUCCESS, 94)) return ERROR::PARSE_ERROR;
+    setValue(graph, "price", 1);
+    if (!checkRecompute(graph, 1)) return ERROR::PARSE_ERROR;
+
+    // Invalid names
+    if (setValue(graph, "2x", 1) != ERROR::INVALID_CHARACTER || setFormula(graph, "", "1 + 1") != ERROR::INVALID_CHARACTER) {
+        cout << "An invalid cell name was accepted." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    cout << "The model gave the expected values." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Checks that cycles are refused and leave the graph as it was
+int runCycleTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    CellGraph graph;
+    setValue(graph, "a", 1);
+    setFormula(graph, "b", "a + 1");
+    setFormula(graph, "c", "b * 2");
+    setFormula(graph, "d", "c - a");
+    recompute(graph);
+
+    if (setFormula(graph, "self", "self + 1") != ERROR::CYCLE ||
+        setFormula(graph, "b", "b + 1") != ERROR::CYCLE ||
+        setFormula(graph, "a", "d + 1") != ERROR::CYCLE ||
+        setFormula(graph, "b", "(1 + c)") != ERROR::CYCLE) {
+        cout << "A cycle was accepted." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Nothing changed, and nothing waits to be recomputed
+    if (!checkRecompute(graph, 0)) return ERROR::PARSE_ERROR;
+    if (!checkCell(graph, "d", ERROR::SUCCESS, 3)) return ERROR::PARSE_ERROR;
+    if (!checkCell(graph, "self", ERROR::UNKNOWN_VARIABLE, 0)) return ERROR::PARSE_ERROR;
+
+    // Reading upstream cells, or cells on another branch, is not a cycle
+    if (setFormula(graph, "a", "5 + 5") != ERROR::SUCCESS || setFormula(graph, "e", "d + b") != ERROR::SUCCESS) {
+        cout << "A formula without a cycle was refused." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    recompute(graph);
+    if (!checkCell(graph, "d", ERROR::SUCCESS, 12)) return ERROR::PARSE_ERROR;
+    if (!checkCell(graph, "e", ERROR::SUCCESS, 23)) return ERROR::PARSE_ERROR;
+    cout << "Every cycle was refused." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Builds a random formula reading cells with a smaller index than 'index'
+static string randomFormula(mt19937& random, int index) {
+    string formula;
+    int terms = 1 + random() % 4;
+    for (int t = 0; t < terms; ++t) {
+        if (t > 0) formula += " +-*/"[1 + random() % 4];
+        if (index > 0 && random() % 3 != 0) formula += "c" + to_string(random() % index);
+        else formula += to_string(random() % 10);
+    }
+    return formula;
+}
+
+// Defines cell 'index' at random: a small value, or a formula reading cells with a smaller index
+static void randomCell(mt19937& random, CellGraph& graph, vector<string>& formulas, vector<int>& values, int index) {
+    string name = "c" + to_string(index);
+    if (random() % 3 == 0) {
+        formulas[index].clear();
+        values[index] = (int)(random() % 21) - 10;
+        setValue(graph, name.c_str(), values[index]);
+    }
+    else {
+        // Earlier edits may have made an earlier cell read this one, then the formula is refused
+        string formula = randomFormula(random, index);
+        if (setFormula(graph, name.c_str(), formula.c_str()) == ERROR::SUCCESS) formulas[index] = formula;
+    }
+}
+
+// Edits random graphs, then compares them with graphs built from scratch
+int runRandomTests(const char* title, int cells, int edits, unsigned threads) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    mt19937 random(1300 + threads);
+    CellGraph graph;
+    graph.threads = threads;
+    vector<string> formulas(cells);
+    vector<int> values(cells);
+    for (int i = 0; i < cells; ++i) randomCell(random, graph, formulas, values, i);
+    recompute(graph);
+
+    for (int e = 0; e < edits; ++e) {
+        // A few cells at a time, and sometimes an edit that would close a cycle
+        int changes = 1 + random() % 3;
+        for (int c = 0; c < changes; ++c) randomCell(random, graph, formulas, values, random() % cells);
+        int low = random() % cells, high = random() % cells;
+        string backwards = "c" + to_string(high) + " + 1";
+        int error = setFormula(graph, ("c" + to_string(low)).c_str(), backwards.c_str());
+        if (error == ERROR::SUCCESS) formulas[low] = backwards;
+        recompute(graph);
+    }
+
+    // The same cells, defined in order and computed at once
+    CellGraph fresh;
+    for (int i = 0; i < cells; ++i) {
+        string name = "c" + to_string(i);
+        if (formulas[i].empty()) setValue(fresh, name.c_str(), values[i]);
+        else if (setFormula(fresh, name.c_str(), formulas[i].c_str()) != ERROR::SUCCESS) {
+            cout << "Cell " << name << " could not be rebuilt from '" << formulas[i] << "'" << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+    recompute(fresh);
+    for (int i = 0; i < cells; ++i) {
+        string name = "c" + to_string(i);
+        int expectedValue = 0, value = 0;
+        int expectedError = getCell(fresh, name.c_str(), expectedValue);
+        int error = getCell(graph, name.c_str(), value);
+        if (error != expectedError || value != expectedValue) {
+            cout << "Cell " << name << " failed. Expected error: " << expectedError << " and value: " << expectedValue
+                << ", Got error: " << error << " and value: " << value << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+    cout << edits << " rounds of edits on " << cells << " cells matched a graph built from scratch." << endl;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running Cell Graph Tests..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    // Tests on a small model
+    if (runModelTests("Test Cell Model") == ERROR::SUCCESS) {
+        cout << "All cell model tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some cell model tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests on cycles
+    if (runCycleTests("Test Cell Cycles") == ERROR::SUCCESS) {
+        cout << "All cell cycle tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some cell cycle tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests on random graphs, recomputed on one thread and then in parallel
+    if (runRandomTests("Test Cell Random Edits", 300, 2000, 1) == ERROR::SUCCESS &&
+        runRandomTests("Test Cell Random Edits In Parallel", 3000, 200, 4) == ERROR::SUCCESS) {
+        cout << "All cell random tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some cell random tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * File: columnarEvaluator_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for the columnar evaluator.
+ * Every row of a column run must give the same error code and result as run() with the values of
+ * that row, whatever the number of rows, the block a row falls in, the threads and the instruction set.
+ */
+
+ // Include necessary headers
+#include "../columnarEvaluator.hpp"
+#include "../compiledExpression.hpp"
+#include "../optimizer.hpp"
+#include "../simdKernels.hpp"
+#include "../constants.hpp"
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Number of variables of the tests: a, b and c
+static const int NUM_COLUMNS = 3;
+
+// Runs the program over the first 'rows' rows of the columns and compares every row with run().
+// Returns the number of mismatches.
+static int compareColumns(const string& expression, const CompiledExpression& program, const vector<vector<int>>& columns, size_t rows, unsigned threads) {
+    const int* pointers[NUM_COLUMNS];
+    for (int s = 0; s < NUM_COLUMNS; ++s) pointers[s] = columns[s].data();
+    vector<int> results(rows + 1, 7);
+    vector<uint64_t> errorBits(columnBitmapWords(rows) + 1, ~0ull);
+    int errorCode = runColumns(program, pointers, rows, results.data(), errorBits.data(), threads);
+
+    int mismatches = 0;
+    size_t expectedFailures = 0;
+    for (size_t r = 0; r < rows; ++r) {
+        int values[NUM_COLUMNS] = { columns[0][r], columns[1][r], columns[2][r] };
+        int expectedResult = 0;
+        int expectedError = run(program, values, expectedResult);
+        expectedFailures += expectedError == ERROR::DIV_BY_ZERO && errorCode != ERROR::DIV_BY_ZERO;
+        int error = columnRowFailed(errorBits.data(), r) ? ERROR::DIV_BY_ZERO : errorCode;
+        if (error != expectedError || results[r] != expectedResult) {
+            if (mismatches++ < 3) {
+                cout << "'" << expression << "' row " << r << " of " << rows << " on " << threads << " threads failed. Expected error: "
+                    << expectedError << " and result: " << expectedResult << ", Got error: " << error << " and result: " << results[r] << endl;
+            }
+        }
+    }
+    if (errorCode != ERROR::DIV_BY_ZERO && countFailedRows(errorBits.data(), rows) != expectedFailures) {
+        cout << "'" << expression << "' counted " << countFailedRows(errorBits.data(), rows) << " failed rows instead of " << expectedFailures << endl;
+        mismatches++;
+    }
+    if (results[rows] != 7 || errorBits[columnBitmapWords(rows)] != ~0ull) {
+        cout << "'" << expression << "' wrote past " << rows << " rows." << endl;
+        mismatches++;
+    }
+    return mismatches;
+}
+
+// Compiles the expression as it is and optimized, and compares both on every row count and thread count
+static int compareExpression(const string& expression, const VariableTable& variables, const vector<vector<int>>& columns, const vector<size_t>& rowCounts) {
+    CompiledExpression program, optimized;
+    compile(expression.c_str(), variables, program);
+    optimized = program;
+    optimize(optimized);
+
+    int mismatches = 0;
+    for (const CompiledExpression* plan : { &program, &optimized }) {
+        for (size_t rows : rowCounts) {
+            for (unsigned threads : { 1u, 3u }) mismatches += compareColumns(expression, *plan, columns, rows, threads);
+        }
+    }
+    return mismatches;
+}
+
+// Fills the columns with small values, many of them 0 and -1
+static void fillColumns(mt19937& random, size_t rows, vector<vector<int>>& columns) {
+    columns.assign(NUM_COLUMNS, vector<int>(rows));
+    for (vector<int>& column : columns) {
+        for (int& value : column) {
+            int pick = random() % 8;
+            value = pick == 0 ? 0 : pick == 1 ? -1 : (int)(random() % 2001) - 1000;
+        }
+    }
+}
+
+// Compares the columnar evaluator with run() on fixed expressions, around the block boundaries
+int runFixedTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    VariableTable variables;
+    declareVariable(variables, "a");
+    declareVariable(variables, "b");
+    declareVariable(variables, "c");
+    mt19937 random(23);
+    vector<vector<int>> columns;
+    fillColumns(random, 3 * COLUMN_BLOCK + 17, columns);
+    vector<size_t> rowCounts = { 0, 1, 63, 64, 65, COLUMN_BLOCK - 1, COLUMN_BLOCK, COLUMN_BLOCK + 1, 3 * COLUMN_BLOCK + 17 };
+
+    // Quirks of parse(), constants on either side, divisions that can fail, and errors of the text
+    const char* expressions[] = { "a + b * c", "(a + b) * c - 1", "a * 3 + b", "2 * a / 3 + 4", "a / b", "a / b / c + 1",
+        "(a + 1) / (b - c) - a / c", "7 - a", "-(a - b) * -c", "1000 / a", "a / 0", "a / -1", "a / 2 * b - b", "3 + 4 * 5",
+        "1 / 0", "(a * b) + (a * b) * (a * b)", "a - -b - (-c) * 2 + 1", "a + 2 3", "a / b + 2 3", "a + (b", "a + b)",
+        "a + q", "12", "   ", "a", "-(a)", "a / (b / c)", "(a / b) * (a / b) - c / (a / b)" };
+
+    int mismatches = 0;
+    size_t count = 0;
+    for (int level : { SIMD_LEVEL::AVX2, SIMD_LEVEL::SSE2, SIMD_LEVEL::SCALAR }) {
+        setSimdLevel(level);
+        for (const char* expression : expressions) mismatches += compareExpression(expression, variables, columns, rowCounts);
+        count++;
+    }
+    setSimdLevel(SIMD_LEVEL::AVX2);
+
+    // INT_MIN / -1 of two constants, after every row already divided by zero, must not trap
+    vector<vector<int>> failing = { { 1, 2 }, { 0, 0 }, { 0, 0 } };
+    mismatches += compareExpression("(a / b) + ((0 - 2147483647 - 1) / (0 - 1))", variables, failing, { 2 });
+    if (mismatches) return ERROR::PARSE_ERROR;
+    cout << sizeof(expressions) / sizeof(expressions[0]) << " expressions matched run() on every row, at " << count << " instruction set levels." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Builds a random expression over a, b and c with nesting, signs and constants
+static void randomExpression(mt19937& random, int depth, string& out) {
+    size_t terms = 1 + random() % 5;
+    for (size_t t = 0; t < terms; ++t) {
+        if (t > 0) { out += ' '; out += "+-*/"[random() % 4]; out += ' '; }
+        if (random() % 6 == 0) out += '-';
+        int pick = random() % 8;
+        if (pick == 0 && depth < 3) { out += '('; randomExpression(random, depth + 1, out); out += ')'; }
+        else if (pick < 3) out += to_string(random() % 5 == 0 ? 0 : random() % 20);
+        else out += "abc"[random() % 3];
+    }
+}
+
+// Compares the columnar evaluator with run() on random expressions
+int runRandomTests(const char* title, int count) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    VariableTable variables;
+    declareVariable(variables, "a");
+    declareVariable(variables, "b");
+    declareVariable(variables, "c");
+    mt19937 random(230);
+    vector<vector<int>> columns;
+    fillColumns(random, 2 * COLUMN_BLOCK + 100, columns);
+    vector<size_t> rowCounts = { 2 * COLUMN_BLOCK + 100 };
+
+    int mismatches = 0;
+    for (int i = 0; i < count; ++i) {
+        string expression;
+        randomExpression(random, 0, expression);
+        mismatches += compareExpression(expression, variables, columns, rowCounts);
+    }
+    if (mismatches) return ERROR::PARSE_ERROR;
+    cout << count << " random expressions matched run() on every row." << endl;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running Columnar Evaluator Tests..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    // Tests of the fixed expressions
+    if (runFixedTests("Test Columnar Evaluator Fixed Expressions") == ERROR::SUCCESS) {
+        cout << "All columnar evaluator fixed tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some columnar evaluator fixed tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests of random expressions
+    if (runRandomTests("Test Columnar Evaluator Random Expressions", 300) == ERROR::SUCCESS) {
+        cout << "All columnar evaluator random tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some columnar evaluator random tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
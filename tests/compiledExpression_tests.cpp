@@ -0,0 +1,194 @@
+/*
+ * File: compiledExpression_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for the compiled expression API.
+ */
+
+ // Include necessary headers
+#include "../compiledExpression.hpp"
+#include "../expressionEvaluator.hpp"
+#include "../constants.hpp"
+#include "testData.hpp"
+#include <cctype>
+#include <iostream>
+#include <string>
+using namespace std;
+
+// Runs compile() and run() on the valid expressions and checks the expected results
+int runCompileTests(const char* title, size_t iter) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+    CompiledExpression program;
+    for (size_t i = 0; i < iter; ++i) {
+        const char* expression = testData::getValidExpressions(i);
+        int expectedResult = testData::getExpectedResults(i);
+        int result = 0;
+
+        // Check that the expression compiles and runs to the expected result, twice
+        if (compile(expression, program) == ERROR::SUCCESS && run(program, result) == ERROR::SUCCESS
+            && result == expectedResult && run(program, result) == ERROR::SUCCESS && result == expectedResult) {
+            cout << "Test " << i + 1 << ": '" << expression << "' compiled and ran with result: " << result << endl;
+        }
+        else {
+            cout << "Test " << i + 1 << ": '" << expression << "' failed. Expected: "
+                << expectedResult << ", Got: " << result << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+    return ERROR::SUCCESS;
+}
+
+// Runs compile() and run() on the invalid expressions and checks that they fail
+int runCompileInvalidTests(const char* title, size_t iter) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+    CompiledExpression program;
+    for (size_t i = 0; i < iter; ++i) {
+        const char* expression = testData::getInvalidExpressions(i);
+        int result = 0;
+        int compileError = compile(expression, program);
+        if (compileError != ERROR::SUCCESS && run(program, result) == compileError) {
+            cout << "Test " << i + 1 << ": '" << expression << "' is invalid as expected (" << compileError << ")." << endl;
+        }
+        else {
+            cout << "Test " << i + 1 << ": '" << expression << "' compiled, but it should be invalid." << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+    return ERROR::SUCCESS;
+}
+
+// Compares compile() and run() against evaluate() on the differential expressions
+int runCompileDifferentialTests(const char* title, size_t iter) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+    CompiledExpression program;
+    for (size_t i = 0; i < iter; ++i) {
+        const char* expression = testData::getDifferentialExpressions(i);
+        int expectedResult = 0, result = 0;
+        int expectedError = evaluate(expression, expectedResult);
+        compile(expression, program);
+        int error = run(program, result);
+        if (error == expectedError && result == expectedResult) {
+            cout << "Test " << i + 1 << ": '" << expression << "' matches evaluate() with error: "
+                << error << " and result: " << result << endl;
+        }
+        else {
+            cout << "Test " << i + 1 << ": '" << expression << "' failed. Expected error: " << expectedError
+                << " and result: " << expectedResult << ", Got error: " << error << " and result: " << result << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+    return ERROR::SUCCESS;
+}
+
+// Compiles the variable expressions and runs them against two rows of values
+int runVariableTests(const char* title, size_t iter) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    // Declare the variables, their slots follow the declaration order
+    VariableTable variables;
+    for (size_t v = 0; v < testData::NUM_VARIABLES; ++v) {
+        if (declareVariable(variables, testData::getVariableNames(v)) != (int)v) return ERROR::PARSE_ERROR;
+    }
+
+    // A second row where every value is doubled, bound by passing another pointer
+    int doubled[testData::NUM_VARIABLES];
+    for (size_t v = 0; v < testData::NUM_VARIABLES; ++v) doubled[v] = 2 * testData::getVariableValues()[v];
+
+    CompiledExpression program;
+    for (size_t i = 0; i < iter; ++i) {
+        const char* expression = testData::getVariableExpressions(i);
+        int expectedError = testData::getVariableExpectedErrors(i);
+        int expectedResult = testData::getVariableExpectedResults(i);
+
+        compile(expression, variables, program);
+        int result = 0, error = run(program, testData::getVariableValues(), result);
+        if (error != expectedError || result != expectedResult) {
+            cout << "Test " << i + 1 << ": '" << expression << "' failed. Expected error: " << expectedError
+                << " and result: " << expectedResult << ", Got error: " << error << " and result: " << result << endl;
+            return ERROR::PARSE_ERROR;
+        }
+
+        // On the second row, compare against evaluate() on the text with the values written in
+        if (expectedError == ERROR::SUCCESS) {
+            string text;
+            for (const char* ch = expression; *ch; ) {
+                if (isalpha((unsigned char)*ch) || *ch == '_') {
+                    const char* name = ch;
+                    while (isalnum((unsigned char)*ch) || *ch == '_') ++ch;
+                    text += to_string(doubled[findVariable(variables, name, ch - name)]);
+                }
+                else text += *ch++;
+            }
+            int expectedDoubled = 0;
+            evaluate(text.c_str(), expectedDoubled);
+            if (run(program, doubled, result) != ERROR::SUCCESS || result != expectedDoubled) {
+                cout << "Test " << i + 1 << ": '" << expression << "' failed on the second row. Expected: "
+                    << expectedDoubled << ", Got: " << result << endl;
+                return ERROR::PARSE_ERROR;
+            }
+        }
+        cout << "Test " << i + 1 << ": '" << expression << "' ran with error: " << error << " and result: " << expectedResult << endl;
+    }
+
+    // Without a variable table, names are invalid characters like in evaluate()
+    int result = 0;
+    if (compile("price + 1", program) != ERROR::INVALID_CHARACTER) return ERROR::PARSE_ERROR;
+    if (run(program, result) != ERROR::INVALID_CHARACTER) return ERROR::PARSE_ERROR;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running Compiled Expression Tests..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    // Tests for compiling and running valid expressions
+    if (runCompileTests("Test Compile Valid Expressions", testData::NUM_TEST_EXPRESSIONS) == ERROR::SUCCESS) {
+        cout << "All compile valid expression tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some compile valid expression tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests for compiling invalid expressions
+    if (runCompileInvalidTests("Test Compile Invalid Expressions", testData::NUM_TEST_EXPRESSIONS) == ERROR::SUCCESS) {
+        cout << "All compile invalid expression tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some compile invalid expression tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests comparing compiled programs against evaluate()
+    if (runCompileDifferentialTests("Test Compile Against Evaluate", testData::NUM_DIFFERENTIAL_EXPRESSIONS) == ERROR::SUCCESS) {
+        cout << "All compile differential tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some compile differential tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests for expressions with variables
+    if (runVariableTests("Test Compile Variable Expressions", testData::NUM_VARIABLE_EXPRESSIONS) == ERROR::SUCCESS) {
+        cout << "All variable expression tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some variable expression tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
@@ -0,0 +1,13 @@
+/*
+ * File: constexprEvaluator_fail.cpp
+ * Author: Alex Turner
+ * Description: This file must not compile: CONSTANT_EXPRESSION() on an invalid expression stops the
+ * build, and the compiler names the error code (ERROR::DIV_BY_ZERO, 4) in CheckedExpression<0, 4>.
+ */
+
+ // Include necessary headers
+#include "../constexprEvaluator.hpp"
+
+int main(int, char**) {
+    return CONSTANT_EXPRESSION("1 / (2 - 2)");
+}
@@ -0,0 +1,114 @@
+/*
+ * File: constexprEvaluator_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for the compile-time evaluator.
+ * The static_asserts are checked by the compiler, and the same function is then compared with
+ * evaluate() at run time on the differential expressions and on random text.
+ */
+
+ // Include necessary headers
+#include "../constexprEvaluator.hpp"
+#include "../expressionEvaluator.hpp"
+#include "../constants.hpp"
+#include "testData.hpp"
+#include <iostream>
+#include <random>
+#include <string>
+using namespace std;
+
+// Checked by the compiler: results, the quirks of evaluate() and every error code
+static_assert("1 + 2"_expr.value == 3 && "1 + 2"_expr.error == ERROR::SUCCESS, "sum");
+static_assert("1+3*4"_expr.value == 16, "evaluation is left to right");
+static_assert("2*3+4"_expr.value == 13, "a chain followed by + adds its last value again");
+static_assert("2*3-4"_expr.value == -1, "a chain followed by - subtracts its last value again");
+static_assert("-(2 + 3) * -2"_expr.value == 10, "signs");
+static_assert("2147483647 + 1"_expr.value == -2147483647 - 1, "wrap around");
+static_assert("7"_expr.error == ERROR::SUCCESS && "7"_expr.value == 7, "a single digit is valid");
+static_assert("12"_expr.error == ERROR::NO_OPERATOR, "two digits without an operator");
+static_assert(""_expr.error == ERROR::INVALID_CHARACTER, "empty");
+static_assert("   "_expr.error == ERROR::NO_NUM, "whitespace only");
+static_assert("1+2 3"_expr.error == ERROR::PARSE_ERROR && "1+2 3"_expr.value == 3, "the result is still stored");
+static_assert("(1 + 2"_expr.error == ERROR::UNMATCHED_PAREN, "unmatched parenthesis");
+static_assert("1 + a"_expr.error == ERROR::INVALID_CHARACTER, "invalid character");
+static_assert("4 / (2 - 2)"_expr.error == ERROR::DIV_BY_ZERO && "4 / (2 - 2)"_expr.value == 0, "division by zero");
+static_assert("(1 + 2 3)"_expr.error == ERROR::MISSING_PAREN, "missing parenthesis");
+static_assert("1 / 0 +"_expr.error == ERROR::DIV_BY_ZERO, "division by zero wins over a later syntax error");
+static_assert(evaluateConstant(std::string_view("1\0+2", 4)).error == ERROR::INVALID_CHARACTER, "NUL inside the text");
+static_assert(CONSTANT_EXPRESSION("(10 - 4) / 3") == 2, "checked value");
+
+// Nesting up to the limit, and one level more
+static_assert(evaluateConstant(std::string_view(
+    "((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((9))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))"
+)).value == 9, "64 levels");
+
+// Builds random text, mostly made of expression characters
+static string randomText(mt19937& random) {
+    static const char alphabet[] = "0123456789999+-*/()((  ))\t\nx";
+    string text;
+    size_t length = random() % 40;
+    for (size_t i = 0; i < length; ++i) text += alphabet[random() % (sizeof(alphabet) - 1)];
+    return text;
+}
+
+// Compares evaluateConstant() with evaluate() at run time. Returns true if they match.
+static bool matchesEvaluate(const string& text) {
+    int expectedResult = 0;
+    int expectedError = evaluate(string_view(text), expectedResult);
+    EvaluationResult answer = evaluateConstant(text);
+    if (answer.error == expectedError && answer.value == expectedResult) return true;
+    cout << "'" << text << "' failed. Expected error: " << expectedError << " and result: " << expectedResult
+        << ", Got error: " << answer.error << " and result: " << answer.value << endl;
+    return false;
+}
+
+// Runs the differential expressions and random text through both evaluators
+int runRuntimeTests(const char* title, size_t iter) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    for (size_t i = 0; i < testData::NUM_DIFFERENTIAL_EXPRESSIONS; ++i) {
+        if (!matchesEvaluate(testData::getDifferentialExpressions(i))) return ERROR::PARSE_ERROR;
+    }
+
+    mt19937 random(11);
+    for (size_t i = 0; i < iter; ++i) {
+        if (!matchesEvaluate(randomText(random))) return ERROR::PARSE_ERROR;
+    }
+
+    // One level deeper than the limit
+    string deep = string(CONSTEXPR_MAX_DEPTH + 1, '(') + "1" + string(CONSTEXPR_MAX_DEPTH + 1, ')');
+    if (evaluateConstant(deep).error != ERROR::DEPTH_EXCEEDED) {
+        cout << "Nesting deeper than " << CONSTEXPR_MAX_DEPTH << " was accepted." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    cout << testData::NUM_DIFFERENTIAL_EXPRESSIONS + iter << " expressions matched evaluate()." << endl;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running Constexpr Evaluator Tests..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    // The value is folded by the compiler
+    constexpr int folded = CONSTANT_EXPRESSION("2 * (3 + 4)");
+    cout << "CONSTANT_EXPRESSION(\"2 * (3 + 4)\") = " << folded << endl;
+
+    // Tests at run time
+    if (runRuntimeTests("Test Constexpr Against evaluate()", 200000) == ERROR::SUCCESS) {
+        cout << "All constexpr runtime tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some constexpr runtime tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
@@ -0,0 +1,348 @@
+/*
+ * File: evalServer_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for the evaluation server and its client.
+ * A server runs on a thread of the test. Whatever the clients send, and however many of them send it
+ * at once, every answer must be what evaluate() gives, in the order the requests were sent.
+ */
+
+ // Include necessary headers
+#include "../server/evalServer.hpp"
+#include "../server/evalClient.hpp"
+#include "../iterativeEvaluator.hpp"
+#include "../constants.hpp"
+#include "testData.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+using namespace std;
+
+// Compares the answers of the server with evaluateIterative(), which gives what evaluate() gives
+// without overflowing the stack on deep nesting. Returns the number of mismatches.
+static int compareAnswers(const vector<string>& expressions, const vector<int>& results, const vector<int>& errors) {
+    int mismatches = 0;
+    for (size_t i = 0; i < expressions.size(); ++i) {
+        int expectedResult = 0;
+        int expectedError = evaluateIterative(expressions[i].c_str(), expectedResult);
+        if (errors[i] != expectedError || results[i] != expectedResult) {
+            if (mismatches++ < 3) {
+                cout << "'" << expressions[i].substr(0, 80) << "' failed. Expected error: " << expectedError << " and result: "
+                    << expectedResult << ", Got error: " << errors[i] << " and result: " << results[i] << endl;
+            }
+        }
+    }
+    return mismatches;
+}
+
+// Sends the fixed expressions, one at a time and all at once, from one client
+int runFixedTests(const char* title, const char* socketPath) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    vector<string> expressions;
+    for (size_t i = 0; i < testData::NUM_DIFFERENTIAL_EXPRESSIONS; ++i) expressions.push_back(testData::getDifferentialExpressions(i));
+    for (size_t i = 0; i < testData::NUM_TEST_EXPRESSIONS; ++i) expressions.push_back(testData::getValidExpressions(i));
+    for (size_t i = 0; i < 10; ++i) expressions.push_back(testData::getInvalidExpressions(i));
+    const char* quirks[] = { "12", "", "   ", "1+2 3", "2 * 3 + 4", "1 / 0", "1 + a" };
+    for (const char* expression : quirks) expressions.push_back(expression);
+    expressions.push_back(string(100000, '(') + "1" + string(100000, ')')); // Deeper than a pool thread could recurse
+
+    EvalClient client;
+    if (connectEvalServer(client, socketPath) != EVAL_SERVER::SUCCESS) {
+        cout << "Could not connect to the server." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    vector<int> results(expressions.size()), errors(expressions.size());
+    for (size_t i = 0; i < expressions.size(); ++i) {
+        if (evaluateRemote(client, expressions[i].c_str(), errors[i], results[i]) != EVAL_SERVER::SUCCESS) return ERROR::PARSE_ERROR;
+    }
+    if (compareAnswers(expressions, results, errors)) return ERROR::PARSE_ERROR;
+
+    vector<const char*> pointers;
+    for (const string& expression : expressions) pointers.push_back(expression.c_str());
+    vector<int> batchResults(expressions.size(), 7), batchErrors(expressions.size(), 7);
+    if (evaluateRemoteBatch(client, pointers.data(), pointers.size(), batchResults.data(), batchErrors.data()) != EVAL_SERVER::SUCCESS ||
+        compareAnswers(expressions, batchResults, batchErrors)) {
+        return ERROR::PARSE_ERROR;
+    }
+
+    // A NUL inside a request is an invalid character, like in a buffer given to evaluate(), and the
+    // requests around it are still answered
+    string withNul("1 + 2\0junk", 10);
+    int errorCode = 7, result = 7;
+    queueRequest(client, withNul.data(), withNul.size());
+    if (receiveAnswers(client, 1, &result, &errorCode) != EVAL_SERVER::SUCCESS || errorCode != ERROR::INVALID_CHARACTER || result != 0 ||
+        evaluateRemote(client, "1 + 2", errorCode, result) != EVAL_SERVER::SUCCESS || errorCode != ERROR::SUCCESS || result != 3) {
+        cout << "A request holding a NUL gave error: " << errorCode << " and result: " << result << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    closeEvalClient(client);
+    cout << expressions.size() << " expressions matched evaluate(), one at a time and pipelined." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Sends random expressions from several clients at once, each with many requests in flight
+int runConcurrentTests(const char* title, const char* socketPath, unsigned clients, size_t requests) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    vector<int> mismatches(clients, 0);
+    vector<thread> threads;
+    for (unsigned c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c] {
+            mt19937 random(200 + c);
+            vector<string> expressions;
+            for (size_t i = 0; i < requests; ++i) {
+                string expression = to_string(random() % 100);
+                int terms = random() % 6;
+                for (int t = 0; t < terms; ++t) expression += string(" ") + "+-*/"[random() % 4] + " " + to_string(random() % 20);
+                expressions.push_back(expression);
+            }
+
+            // Queue everything, then read the answers back in uneven groups
+            EvalClient client;
+            if (connectEvalServer(client, socketPath) != EVAL_SERVER::SUCCESS) { mismatches[c] = 1; return; }
+            for (const string& expression : expressions) queueRequest(client, expression.data(), expression.size());
+            vector<int> results(requests), errors(requests);
+            for (size_t done = 0; done < requests;) {
+                size_t group = 1 + random() % 500;
+                if (group > requests - done) group = requests - done;
+                if (receiveAnswers(client, group, &results[done], &errors[done]) != EVAL_SERVER::SUCCESS) { mismatches[c] = 1; return; }
+                done += group;
+            }
+            closeEvalClient(client);
+            mismatches[c] = compareAnswers(expressions, results, errors);
+        });
+    }
+    for (thread& t : threads) t.join();
+    for (int count : mismatches) {
+        if (count) return ERROR::PARSE_ERROR;
+    }
+    cout << clients << " clients with " << requests << " requests each matched evaluate()." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Sends a request that is too long: the server closes that connection, and only that one
+int runProtocolTests(const char* title, const char* socketPath, EvalServer& server) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    EvalClient good, bad;
+    if (connectEvalServer(good, socketPath) != EVAL_SERVER::SUCCESS || connectEvalServer(bad, socketPath) != EVAL_SERVER::SUCCESS) {
+        return ERROR::PARSE_ERROR;
+    }
+    if (queueRequest(bad, "1", EVAL_MAX_REQUEST + 1) != EVAL_SERVER::PROTOCOL_ERROR) {
+        cout << "The client queued a request that is too long." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Write the length of a request that is too long by hand
+    size_t before = getEvalServerStats(server).protocolErrors;
+    bad.output.append("\xff\xff\xff\x7f", 4);
+    bad.inFlight++;
+    int errorCode = 0, result = 0;
+    int status = receiveAnswers(bad, 1, &result, &errorCode);
+    if (status != EVAL_SERVER::CLOSED && status != EVAL_SERVER::SOCKET_ERROR) {
+        cout << "The server answered a request that is too long." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    if (evaluateRemote(good, "6 * 7", errorCode, result) != EVAL_SERVER::SUCCESS || result != 42) {
+        cout << "The other connection was hurt." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    EvalServerStats stats = getEvalServerStats(server);
+    if (stats.protocolErrors != before + 1 || stats.requests == 0 || stats.batches == 0 || stats.cache.hits == 0) {
+        cout << "The counters are wrong: " << stats.protocolErrors << " protocol errors, " << stats.requests << " requests." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    closeEvalClient(good);
+    closeEvalClient(bad);
+    cout << stats.requests << " requests in " << stats.batches << " batches, the largest of " << stats.largestBatch << "." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Floods the server from one client, which keeps far more than a batch of requests in flight, while
+// another client sends one request at a time. The other client must be answered while the flood goes on.
+int runFairnessTests(const char* title, const char* socketPath) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    const size_t group = DEFAULT_SERVER_BATCH;
+    atomic<bool> quietDone{ false }, floodFailed{ false }, floodTimedOut{ false };
+    atomic<size_t> flooded{ 0 };
+    thread flood([&] {
+        EvalClient client;
+        if (connectEvalServer(client, socketPath) != EVAL_SERVER::SUCCESS) { floodFailed = true; return; }
+        vector<int> results(group), errors(group);
+        for (size_t i = 0; i < 4 * group; ++i) queueRequest(client, "1 + 1", 5);
+        auto start = chrono::steady_clock::now();
+        while (!quietDone) {
+            if (chrono::steady_clock::now() - start > chrono::seconds(20)) { floodTimedOut = true; break; }
+            for (size_t i = 0; i < group; ++i) queueRequest(client, "1 + 1", 5);
+            if (receiveAnswers(client, group, results.data(), errors.data()) != EVAL_SERVER::SUCCESS || results[group - 1] != 2) {
+                floodFailed = true;
+                break;
+            }
+            flooded += group;
+        }
+        closeEvalClient(client);
+    });
+
+    // Wait for the flood to be going before the other client connects
+    while (flooded < 4 * group && !floodFailed) this_thread::sleep_for(chrono::milliseconds(1));
+    EvalClient quiet;
+    int mismatches = connectEvalServer(quiet, socketPath) != EVAL_SERVER::SUCCESS;
+    for (int i = 0; i < 100 && !mismatches; ++i) {
+        int errorCode = 0, result = 0;
+        string expression = to_string(i) + " * 2";
+        mismatches += evaluateRemote(quiet, expression.c_str(), errorCode, result) != EVAL_SERVER::SUCCESS || result != i * 2;
+    }
+    quietDone = true;
+    flood.join();
+    closeEvalClient(quiet);
+    if (mismatches || floodFailed) return ERROR::PARSE_ERROR;
+    if (floodTimedOut) {
+        cout << "The other client was only answered once the flood stopped." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    cout << "100 requests answered while " << flooded << " requests flooded the server." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Writes requests from a client that never reads its answers. The server has to stop reading it
+// instead of buffering everything, and still answer every request once the client reads.
+int runBackpressureTests(const char* title, const char* socketPath, EvalServer& server) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    // Far more requests than the buffers of the server and of both sockets hold
+    const size_t requests = 400000;
+    EvalClient client;
+    if (connectEvalServer(client, socketPath) != EVAL_SERVER::SUCCESS) return ERROR::PARSE_ERROR;
+    for (size_t i = 0; i < requests; ++i) queueRequest(client, "1", 1);
+
+    // Write until the socket has taken nothing for a while, watching what the server holds
+    size_t limit = SERVER_BUFFERED_BATCHES * DEFAULT_SERVER_BATCH * EVAL_ANSWER_SIZE;
+    size_t bound = 2 * limit + SERVER_READ_SIZE + DEFAULT_SERVER_BATCH * EVAL_ANSWER_SIZE;
+    size_t mostBuffered = 0;
+    for (int idle = 0; idle < 50 && !client.output.empty();) {
+        size_t before = client.written;
+        if (flushEvalClient(client) != EVAL_SERVER::SUCCESS) return ERROR::PARSE_ERROR;
+        idle = client.written == before ? idle + 1 : 0;
+        mostBuffered = max(mostBuffered, getEvalServerStats(server).bufferedBytes);
+        this_thread::sleep_for(chrono::milliseconds(2));
+    }
+    if (client.output.empty()) {
+        cout << "The server read every request of a client that does not read its answers." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    if (mostBuffered > bound) {
+        cout << "The server buffered " << mostBuffered << " bytes for one client, more than " << bound << "." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Reading the answers lets the server go on with the rest
+    vector<int> results(requests), errors(requests);
+    if (receiveAnswers(client, requests, results.data(), errors.data()) != EVAL_SERVER::SUCCESS) return ERROR::PARSE_ERROR;
+    closeEvalClient(client);
+    for (size_t i = 0; i < requests; ++i) {
+        if (errors[i] != ERROR::SUCCESS || results[i] != 1) {
+            cout << "Request " << i << " was answered with error: " << errors[i] << " and result: " << results[i] << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+    cout << requests << " requests answered, at most " << mostBuffered << " bytes buffered while the client did not read." << endl;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running Evaluation Server Tests..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    signal(SIGPIPE, SIG_IGN);
+    string socketPath = "/tmp/evalServer_tests." + to_string(getpid()) + ".sock";
+    static EvalServer server;
+    EvalServerOptions options;
+    options.threads = 4;
+    if (startEvalServer(server, socketPath.c_str(), options) != EVAL_SERVER::SUCCESS) {
+        cout << "Could not start the server at " << socketPath << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    thread serverThread([] { runEvalServer(server); });
+
+    int status = ERROR::SUCCESS;
+
+    // Tests of the fixed expressions
+    if (runFixedTests("Test Evaluation Server Fixed Expressions", socketPath.c_str()) == ERROR::SUCCESS) {
+        cout << "All evaluation server fixed tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some evaluation server fixed tests failed." << endl;
+        status = ERROR::PARSE_ERROR;
+    }
+
+    // Tests of several clients at once
+    if (status == ERROR::SUCCESS && runConcurrentTests("Test Evaluation Server Concurrent Clients", socketPath.c_str(), 8, 20000) == ERROR::SUCCESS) {
+        cout << "All evaluation server concurrent tests passed successfully!" << endl;
+    }
+    else if (status == ERROR::SUCCESS) {
+        cout << "Some evaluation server concurrent tests failed." << endl;
+        status = ERROR::PARSE_ERROR;
+    }
+
+    // Tests of broken requests
+    if (status == ERROR::SUCCESS && runProtocolTests("Test Evaluation Server Protocol Errors", socketPath.c_str(), server) == ERROR::SUCCESS) {
+        cout << "All evaluation server protocol tests passed successfully!" << endl;
+    }
+    else if (status == ERROR::SUCCESS) {
+        cout << "Some evaluation server protocol tests failed." << endl;
+        status = ERROR::PARSE_ERROR;
+    }
+
+    // Tests of a client that floods the server next to another one
+    if (status == ERROR::SUCCESS && runFairnessTests("Test Evaluation Server Fairness", socketPath.c_str()) == ERROR::SUCCESS) {
+        cout << "All evaluation server fairness tests passed successfully!" << endl;
+    }
+    else if (status == ERROR::SUCCESS) {
+        cout << "Some evaluation server fairness tests failed." << endl;
+        status = ERROR::PARSE_ERROR;
+    }
+
+    // Tests of a client that does not read its answers
+    if (status == ERROR::SUCCESS && runBackpressureTests("Test Evaluation Server Backpressure", socketPath.c_str(), server) == ERROR::SUCCESS) {
+        cout << "All evaluation server backpressure tests passed successfully!" << endl;
+    }
+    else if (status == ERROR::SUCCESS) {
+        cout << "Some evaluation server backpressure tests failed." << endl;
+        status = ERROR::PARSE_ERROR;
+    }
+
+    // The server stops and removes its socket
+    stopEvalServer(server);
+    serverThread.join();
+    if (status == ERROR::SUCCESS && access(socketPath.c_str(), F_OK) == 0) {
+        cout << "The socket was left behind." << endl;
+        status = ERROR::PARSE_ERROR;
+    }
+    if (status != ERROR::SUCCESS) return status;
+
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
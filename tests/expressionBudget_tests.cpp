@@ -0,0 +1,248 @@
+/*
+ * File: expressionBudget_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for the cost estimation and the budgeted evaluation.
+ * Within its budget, evaluateBudgeted() must give the same error code and result as evaluate(), and past
+ * any of its limits it must stop with its own error code without reading the rest of the expression.
+ */
+
+ // Include necessary headers
+#include "../expressionBudget.hpp"
+#include "../iterativeEvaluator.hpp"
+#include "../expressionEvaluator.hpp"
+#include "../constants.hpp"
+#include "testData.hpp"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Checks the counts of a few expressions
+int runCostTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    struct CostCase { const char* expression; int errorCode; size_t bytes, tokens, numbers, operators, parens; int maxDepth; size_t operations; };
+    const CostCase cases[] = {
+        { "(1 + 23) * -4", ERROR::SUCCESS, 13, 8, 3, 3, 1, 1, 7 },
+        { "12", ERROR::NO_OPERATOR, 2, 1, 1, 0, 0, 0, 1 },
+        { "((7)) - (((8 / 2)))", ERROR::SUCCESS, 19, 15, 3, 2, 5, 3, 10 },
+        { "   ", ERROR::NO_NUM, 3, 0, 0, 0, 0, 0, 0 },
+        { "", ERROR::SUCCESS, 0, 0, 0, 0, 0, 0, 0 },
+        { "1 + 2 ) + (3", ERROR::UNMATCHED_PAREN, 7, 4, 2, 1, 0, 0, 3 },
+        { "4 * 5 + a + 6", ERROR::INVALID_CHARACTER, 9, 4, 2, 2, 0, 0, 4 },
+        { "((1 + 2)", ERROR::UNMATCHED_PAREN, 8, 6, 2, 1, 2, 2, 5 },
+    };
+    for (const CostCase& expected : cases) {
+        ExpressionCost cost;
+        int error = estimateCost(expected.expression, cost);
+        if (error != expected.errorCode || cost.bytes != expected.bytes || cost.tokens != expected.tokens
+            || cost.numbers != expected.numbers || cost.operators != expected.operators || cost.parens != expected.parens
+            || cost.maxDepth != expected.maxDepth || cost.operations != expected.operations) {
+            cout << "'" << expected.expression << "' gave error " << error << ", bytes " << cost.bytes << ", tokens " << cost.tokens
+                << ", numbers " << cost.numbers << ", operators " << cost.operators << ", parens " << cost.parens
+                << ", depth " << cost.maxDepth << ", operations " << cost.operations << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+    cout << sizeof(cases) / sizeof(cases[0]) << " expressions were measured as expected." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Compares evaluateBudgeted() with evaluate(), and estimateCost() with isValidExpression(), on one expression
+static bool matchesEvaluate(const string& expression, const EvaluationBudget& budget) {
+    int expectedResult = 0, result = 0;
+    int expectedError = evaluate(expression.c_str(), expectedResult);
+    int error = evaluateBudgeted(expression.c_str(), result, budget);
+    ExpressionCost cost;
+    int validError = estimateCost(expression.c_str(), cost);
+    int expectedValid = expression.empty() ? ERROR::SUCCESS : isValidExpression(expression.c_str());
+    if (error == expectedError && result == expectedResult && validError == expectedValid) return true;
+    cout << "'" << expression.substr(0, 80) << "' failed. Expected error: " << expectedError << " and result: " << expectedResult
+        << " (valid: " << expectedValid << "), Got error: " << error << " and result: " << result << " (valid: " << validError << ")" << endl;
+    return false;
+}
+
+// Builds a random expression with nesting, signs and, now and then, an error
+static void randomExpression(mt19937& random, int depth, string& out) {
+    size_t terms = 1 + random() % 6;
+    for (size_t t = 0; t < terms; ++t) {
+        if (t > 0) { out += ' '; out += "+-*/"[random() % 4]; out += ' '; }
+        if (random() % 6 == 0) out += '-';
+        if (random() % 4 == 0 && depth < 6) { out += '('; randomExpression(random, depth + 1, out); out += ')'; }
+        else out += to_string(random() % 5 == 0 ? 0 : random() % 1000);
+    }
+}
+
+// Within a generous budget, the budgeted evaluation is evaluate()
+int runDifferentialTests(const char* title, int count) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    EvaluationBudget budget;
+    budget.maxBytes = 1 << 20;
+    budget.maxOperations = 1 << 20;
+    budget.deadline = chrono::steady_clock::now() + chrono::hours(1);
+
+    vector<string> expressions;
+    for (size_t i = 0; i < testData::NUM_DIFFERENTIAL_EXPRESSIONS; ++i) expressions.push_back(testData::getDifferentialExpressions(i));
+    for (size_t i = 0; i < testData::NUM_TEST_EXPRESSIONS; ++i) {
+        expressions.push_back(testData::getValidExpressions(i));
+        expressions.push_back(testData::getInvalidExpressions(i));
+    }
+    const char* quirks[] = { "2 * 3 + 4", "1 + 2 3", "12", "   ", "", "1 + 2 + 3 +", "((1 2))", "7 / (3 - 3)",
+        "-(1 - 2) - -3 * -(4) - 5", "1 + 2 ) + ( 3", "(1 + 2", "99999999999 - 1" };
+    for (const char* expression : quirks) expressions.push_back(expression);
+
+    mt19937 random(22);
+    for (int i = 0; i < count; ++i) {
+        string expression;
+        randomExpression(random, 0, expression);
+        if (random() % 4 == 0) {
+            const char* errors[] = { " 7 ", ")", "(", "a", "+ *" };
+            expression.insert(random() % expression.size(), errors[random() % 5]);
+        }
+        expressions.push_back(expression);
+    }
+
+    for (const string& expression : expressions) {
+        if (!matchesEvaluate(expression, budget)) return ERROR::PARSE_ERROR;
+    }
+    cout << expressions.size() << " expressions matched evaluate() within their budget." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Checks one budgeted evaluation against the expected error code
+static bool expectBudget(const char* what, const string& expression, const EvaluationBudget& budget, int expectedError, ExpressionCost* cost = 0) {
+    int result = -1;
+    int error = evaluateBudgeted(expression.c_str(), result, budget, cost);
+    if (error == expectedError && (error == ERROR::SUCCESS || result == 0)) return true;
+    cout << what << " gave error: " << error << " and result: " << result << " instead of error: " << expectedError << endl;
+    return false;
+}
+
+// Passes each limit, and stops right at it
+int runLimitTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    // A long flat expression, two megabytes or so
+    string longExpression = "1";
+    while (longExpression.size() < (2u << 20)) longExpression += " + 12 * 3 - 45";
+    ExpressionCost full;
+    if (estimateCost(longExpression.c_str(), full) != ERROR::SUCCESS || full.bytes != longExpression.size()) {
+        cout << "The long expression was not measured." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Length: exactly the length is fine, one less stops after reading one more character
+    EvaluationBudget budget;
+    budget.maxBytes = longExpression.size();
+    if (!expectBudget("The long expression at its length", longExpression, budget, ERROR::SUCCESS)) return ERROR::PARSE_ERROR;
+    budget.maxBytes = 1000;
+    ExpressionCost cost;
+    if (!expectBudget("The long expression over 1000 bytes", longExpression, budget, ERROR::BUDGET_EXCEEDED, &cost)) return ERROR::PARSE_ERROR;
+    if (cost.bytes != 1001) {
+        cout << "The length budget read " << cost.bytes << " bytes instead of 1001." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Operations: checked between blocks, so a budget far below the cost stops in the first one
+    budget = EvaluationBudget();
+    budget.maxOperations = full.operations;
+    if (!expectBudget("The long expression at its operations", longExpression, budget, ERROR::SUCCESS)) return ERROR::PARSE_ERROR;
+    budget.maxOperations = full.operations - 1;
+    if (!expectBudget("The long expression one operation over", longExpression, budget, ERROR::BUDGET_EXCEEDED)) return ERROR::PARSE_ERROR;
+    budget.maxOperations = 100;
+    if (!expectBudget("The long expression over 100 operations", longExpression, budget, ERROR::BUDGET_EXCEEDED, &cost)) return ERROR::PARSE_ERROR;
+    if (cost.bytes > BUDGET_SCAN_BLOCK) {
+        cout << "The operation budget read " << cost.bytes << " bytes." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Depth: stops at the first parenthesis too deep, even if the expression is broken further on
+    string nested = string(5000, '(') + "1" + string(5000, ')');
+    budget = EvaluationBudget();
+    budget.maxDepth = 5000;
+    if (!expectBudget("Depth 5000 within 5000", nested, budget, ERROR::SUCCESS)) return ERROR::PARSE_ERROR;
+    budget.maxDepth = 4999;
+    if (!expectBudget("Depth 5000 within 4999", nested + " a", budget, ERROR::DEPTH_EXCEEDED, &cost)) return ERROR::PARSE_ERROR;
+    if (cost.bytes != 5000 || cost.maxDepth != 5000) {
+        cout << "The depth budget stopped at " << cost.bytes << " bytes and depth " << cost.maxDepth << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    budget.maxDepth = 0;
+    if (!expectBudget("Depth 5000 without a limit", nested, budget, ERROR::SUCCESS)) return ERROR::PARSE_ERROR;
+
+    // An error earlier in the text than the limit comes first
+    budget = EvaluationBudget();
+    budget.maxBytes = 100;
+    if (!expectBudget("An invalid character before the length", "1 + a" + longExpression, budget, ERROR::INVALID_CHARACTER)) return ERROR::PARSE_ERROR;
+
+    // Deadline: already passed, and passed while parsing
+    budget = EvaluationBudget();
+    budget.deadline = chrono::steady_clock::now() - chrono::seconds(1);
+    if (!expectBudget("A deadline already passed", "1 + 2", budget, ERROR::DEADLINE_EXCEEDED)) return ERROR::PARSE_ERROR;
+    ParseStack stack;
+    stack.deadline = budget.deadline;
+    for (const string& expression : { string("1 + 2"), longExpression }) {
+        int result = 0;
+        const char* cur = expression.c_str();
+        int error = parseIterative(cur, result, stack);
+        int expectedError = expression.size() < (size_t)DEADLINE_CHECK_INTERVAL ? ERROR::SUCCESS : ERROR::DEADLINE_EXCEEDED;
+        if (error != expectedError) {
+            cout << "Parsing " << expression.size() << " bytes past the deadline gave error: " << error << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+    budget.deadline = chrono::steady_clock::now() + chrono::hours(1);
+    if (!expectBudget("A deadline far away", longExpression, budget, ERROR::SUCCESS)) return ERROR::PARSE_ERROR;
+
+    cout << "Every limit stopped the evaluation with its error code." << endl;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running Expression Budget Tests..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    // Tests of the cost estimation
+    if (runCostTests("Test Expression Cost") == ERROR::SUCCESS) {
+        cout << "All expression cost tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some expression cost tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests against evaluate()
+    if (runDifferentialTests("Test Budgeted Evaluation Against evaluate()", 3000) == ERROR::SUCCESS) {
+        cout << "All budgeted evaluation differential tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some budgeted evaluation differential tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests of the limits
+    if (runLimitTests("Test Budget Limits") == ERROR::SUCCESS) {
+        cout << "All budget limit tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some budget limit tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
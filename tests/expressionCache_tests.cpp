@@ -0,0 +1,156 @@
+/*
+ * File: expressionCache_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for the expression cache.
+ */
+
+ // Include necessary headers
+#include "../expressionCache.hpp"
+#include "../expressionEvaluator.hpp"
+#include "../threadPool.hpp"
+#include "../constants.hpp"
+#include "testData.hpp"
+#include <atomic>
+#include <cctype>
+#include <iostream>
+#include <string>
+using namespace std;
+
+// Checks that the cache answers like evaluate(), and that whitespace variants share an entry
+int runCacheTests(const char* title, size_t iter) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    ExpressionCache cache;
+    initCache(cache, 1024, 4);
+    for (size_t i = 0; i < iter; ++i) {
+        const char* expression = testData::getDifferentialExpressions(i);
+        int expectedResult = 0, result = 0;
+        int expectedError = evaluate(expression, expectedResult);
+
+        // First call misses, the same text with extra whitespace around every token hits
+        string padded = *expression ? " " : "";
+        for (const char* ch = expression; *ch; ++ch) {
+            padded += *ch;
+            if (!isdigit((unsigned char)ch[0]) || !isdigit((unsigned char)ch[1])) padded += "\t ";
+        }
+        for (const string& text : { string(expression), padded }) {
+            int error = cachedEvaluate(cache, text.c_str(), result);
+            if (error != expectedError || result != expectedResult) {
+                cout << "Test " << i + 1 << ": '" << text << "' failed. Expected error: " << expectedError
+                    << " and result: " << expectedResult << ", Got error: " << error << " and result: " << result << endl;
+                return ERROR::PARSE_ERROR;
+            }
+        }
+        cout << "Test " << i + 1 << ": '" << expression << "' matches evaluate() with error: "
+            << expectedError << " and result: " << expectedResult << endl;
+    }
+
+    // Whitespace between digits is meaningful, so these must be different entries
+    int result = 0;
+    if (cachedEvaluate(cache, "1 2 + 3", result) != ERROR::PARSE_ERROR) return ERROR::PARSE_ERROR;
+    if (cachedEvaluate(cache, "12 + 3", result) != ERROR::SUCCESS || result != 15) return ERROR::PARSE_ERROR;
+
+    // Padding may have merged a few expressions with their originals, but every lookup was counted
+    CacheStats stats = getCacheStats(cache);
+    cout << "Hits: " << stats.hits << ", Misses: " << stats.misses << ", Size: " << stats.size << endl;
+    if (stats.hits + stats.misses != 2 * iter + 2 || stats.hits < iter - 2 || stats.evictions != 0) return ERROR::PARSE_ERROR;
+    return ERROR::SUCCESS;
+}
+
+// Checks that a full cache evicts entries, keeping those that are used
+int runEvictionTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    ExpressionCache cache;
+    initCache(cache, 8, 1);
+    int result = 0;
+
+    // Fill the cache and use the first entry, then push many new entries through it
+    for (int i = 0; i < 8; ++i) cachedEvaluate(cache, (to_string(i) + " + 1").c_str(), result);
+    for (int i = 100; i < 200; ++i) {
+        cachedEvaluate(cache, "0 + 1", result);
+        cachedEvaluate(cache, (to_string(i) + " + 1").c_str(), result);
+    }
+
+    CacheStats stats = getCacheStats(cache);
+    cout << "Hits: " << stats.hits << ", Misses: " << stats.misses << ", Evictions: " << stats.evictions
+        << ", Size: " << stats.size << endl;
+
+    // The hot entry survives every pass of the clock hand
+    if (stats.size != 8 || stats.evictions != 100 || stats.hits != 100) return ERROR::PARSE_ERROR;
+
+    clearCache(cache);
+    stats = getCacheStats(cache);
+    if (stats.size != 0 || stats.hits != 0 || stats.misses != 0) return ERROR::PARSE_ERROR;
+    return ERROR::SUCCESS;
+}
+
+// Checks that many threads can share the cache
+int runThreadedCacheTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    ExpressionCache cache;
+    initCache(cache, 64, 0);
+    const size_t lookups = 200000;
+    atomic<size_t> mismatches(0);
+    parallelFor(lookups, 8, 97, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const char* expression = testData::getDifferentialExpressions((i * 7919) % testData::NUM_DIFFERENTIAL_EXPRESSIONS);
+            string text = (i % 3) ? string(expression) : to_string(i % 500) + " * 2";
+            int expectedResult = 0, result = 0;
+            int expectedError = evaluate(text.c_str(), expectedResult);
+            if (cachedEvaluate(cache, text.c_str(), result) != expectedError || result != expectedResult) mismatches++;
+        }
+    });
+
+    CacheStats stats = getCacheStats(cache);
+    cout << "Hits: " << stats.hits << ", Misses: " << stats.misses << ", Evictions: " << stats.evictions << endl;
+    if (mismatches != 0 || stats.hits + stats.misses != lookups) return ERROR::PARSE_ERROR;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running Expression Cache Tests..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    // Tests for answers and whitespace handling
+    if (runCacheTests("Test Cached Evaluate", testData::NUM_DIFFERENTIAL_EXPRESSIONS) == ERROR::SUCCESS) {
+        cout << "All cached evaluate tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some cached evaluate tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests for eviction
+    if (runEvictionTests("Test Cache Eviction") == ERROR::SUCCESS) {
+        cout << "All cache eviction tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some cache eviction tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests for sharing the cache between threads
+    if (runThreadedCacheTests("Test Threaded Cache") == ERROR::SUCCESS) {
+        cout << "All threaded cache tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some threaded cache tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
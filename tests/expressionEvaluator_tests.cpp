@@ -9,6 +9,8 @@
 #include "../constants.hpp"
 #include "testData.hpp"
 #include <iostream>
+#include <string_view>
+#include <vector>
 using namespace std;
 
 // Function pointer type for the isValidExpression function
@@ -19,6 +21,8 @@ typedef int (*ParseFunction)(const char*&, int&);
 typedef void (*SkipSpacesFunction)(const char*&);
 // Function pointer type for the evaluate function
 typedef int (*EvaluateFunction)(const char*, int&);
+// Function pointer type for the length-aware evaluate function
+typedef int (*EvaluateViewFunction)(string_view, int&);
 
 // Overloaded runTests function for isValidExpression function
 int runTests(IsValidExpressionFunction func, char* title, int iter, bool isValidTest) {
@@ -125,6 +129,38 @@ int runTests(EvaluateFunction func, char* title, int iter) {
     return ERROR::SUCCESS;
 }
 
+// Overloaded runTests function for the length-aware evaluate function.
+// Every expression is copied into a buffer followed by garbage, so the function
+// must stop at the given length and must give the same answer as evaluate().
+int runTests(EvaluateViewFunction func, char* title, int iter) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+    for (size_t i = 0; i < iter; ++i) {
+        const char* expression = testData::getDifferentialExpressions(i);
+        size_t length = char_traits<char>::length(expression);
+
+        // Copy the expression without its terminating NUL character
+        vector<char> buffer(expression, expression + length);
+        buffer.push_back(')');
+        buffer.push_back('x');
+
+        int expectedResult = 0, result = 0;
+        int expectedError = evaluate(expression, expectedResult);
+        int error = func(string_view(buffer.data(), length), result);
+        if (error == expectedError && result == expectedResult) {
+            cout << "Test " << i + 1 << ": '" << expression << "' matches evaluate() with error: "
+                << error << " and result: " << result << endl;
+        }
+        else {
+            cout << "Test " << i + 1 << ": '" << expression << "' failed. Expected error: " << expectedError
+                << " and result: " << expectedResult << ", Got error: " << error << " and result: " << result << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+    return ERROR::SUCCESS;
+}
+
 // This is the main function that runs all the tests
 int main(int, char**) {  
 
@@ -170,13 +206,23 @@ int main(int, char**) {
     }
 
     // Tests for evaluate with valid expressions
-    if (runTests(evaluate, "Test Evaluate Valid Expressions", testData::NUM_TEST_EXPRESSIONS) == ERROR::SUCCESS) {
+    if (runTests(static_cast<EvaluateFunction>(evaluate), "Test Evaluate Valid Expressions", testData::NUM_TEST_EXPRESSIONS) == ERROR::SUCCESS) {
         cout << "All evaluate valid expressions tests passed successfully!" << endl;
     }
     else {
         cout << "Some evaluate valid expressions tests failed." << endl;
         return ERROR::PARSE_ERROR;
     }
+
+    // Tests for the length-aware evaluate against evaluate
+    if (runTests(static_cast<EvaluateViewFunction>(evaluate), "Test Evaluate Length-Aware Expressions",
+        testData::NUM_DIFFERENTIAL_EXPRESSIONS) == ERROR::SUCCESS) {
+        cout << "All evaluate length-aware expressions tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some evaluate length-aware expressions tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
     
     // Final message indicating all tests passed successfully
 	cout << endl;
@@ -0,0 +1,233 @@
+/*
+ * File: fusedExpression_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for fused expression sets.
+ * Every expression of a fused set must give the same error code and result as evaluate(), or as
+ * run() with the same variables, whatever the other expressions of the set share with it or fail on.
+ */
+
+ // Include necessary headers
+#include "../fusedExpression.hpp"
+#include "../expressionEvaluator.hpp"
+#include "../constants.hpp"
+#include "testData.hpp"
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Compares runFused() with run() of every expression compiled on its own, for one row of values.
+// Returns the number of mismatches.
+static int compareSet(const FusedExpression& fused, const vector<string>& expressions, const VariableTable& variables, const int* values) {
+    vector<int> results(expressions.size(), 7), errors(expressions.size(), 7);
+    size_t failures = runFused(fused, values, results.data(), errors.data());
+
+    int mismatches = 0;
+    size_t expectedFailures = 0;
+    for (size_t i = 0; i < expressions.size(); ++i) {
+        CompiledExpression program;
+        compile(expressions[i].c_str(), variables, program);
+        int expectedResult = 0;
+        int expectedError = run(program, values, expectedResult);
+        expectedFailures += expectedError != ERROR::SUCCESS;
+        if (errors[i] != expectedError || results[i] != expectedResult) {
+            if (mismatches++ < 3) {
+                cout << "'" << expressions[i] << "' failed. Expected error: " << expectedError << " and result: " << expectedResult
+                    << ", Got error: " << errors[i] << " and result: " << results[i] << endl;
+            }
+        }
+    }
+    if (failures != expectedFailures) {
+        cout << "The set counted " << failures << " failures instead of " << expectedFailures << endl;
+        mismatches++;
+    }
+    return mismatches;
+}
+
+// Compiles a set of expressions together, with the variables when there are some
+static void compileSet(const vector<string>& expressions, const VariableTable& variables, FusedExpression& fused) {
+    vector<const char*> pointers;
+    for (const string& expression : expressions) pointers.push_back(expression.c_str());
+    if (variables.names.empty()) compileFused(pointers.data(), pointers.size(), fused);
+    else compileFused(pointers.data(), pointers.size(), variables, fused);
+}
+
+// Compares a fused set of the fixed expressions with evaluate()
+int runFixedTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    vector<string> expressions;
+    for (size_t i = 0; i < testData::NUM_DIFFERENTIAL_EXPRESSIONS; ++i) expressions.push_back(testData::getDifferentialExpressions(i));
+    for (size_t i = 0; i < testData::NUM_TEST_EXPRESSIONS; ++i) expressions.push_back(testData::getValidExpressions(i));
+    for (size_t i = 0; i < 10; ++i) expressions.push_back(testData::getInvalidExpressions(i));
+    const char* quirks[] = { "12", "", "   ", "1+2 3", "2 * 3 + 4", "1 / 0 + (2", "0 / 0", "5 / (3 - 3)", "(5 / (3 - 3)) * 0",
+        "1 + 2 ) + ( 3", "1 + a", "99999999999 * 2", "(1 + 2) * (3 + 4)", "(1 + 2) * (3 + 4) - 5", "-(1 + 2) * (3 + 4)",
+        "1 / 0 + ((0 - 2147483647 - 1) / (0 - 1))" };
+    for (const char* expression : quirks) expressions.push_back(expression);
+
+    // Without variables the set gives what evaluate() gives
+    VariableTable variables;
+    FusedExpression fused;
+    compileSet(expressions, variables, fused);
+    vector<int> results(expressions.size()), errors(expressions.size());
+    runFused(fused, 0, results.data(), errors.data());
+    int mismatches = 0;
+    for (size_t i = 0; i < expressions.size(); ++i) {
+        int expectedResult = 0;
+        int expectedError = evaluate(expressions[i].c_str(), expectedResult);
+        if (errors[i] != expectedError || results[i] != expectedResult) {
+            if (mismatches++ < 3) {
+                cout << "'" << expressions[i] << "' failed. Expected error: " << expectedError << " and result: " << expectedResult
+                    << ", Got error: " << errors[i] << " and result: " << results[i] << endl;
+            }
+        }
+    }
+    if (mismatches) return ERROR::PARSE_ERROR;
+    cout << expressions.size() << " expressions in one set matched evaluate(), " << fused.stats.fallbacks << " of them run on their own." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Checks that a division by zero only fails the expressions that need it, and that sharing is counted
+int runSharingTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    VariableTable variables;
+    declareVariable(variables, "a");
+    declareVariable(variables, "b");
+    declareVariable(variables, "c");
+    vector<string> expressions = { "(a + b) * c", "(a + b) * c + a / b", "(a + b) * c - 1", "a / b", "c * (a + b)", "(a + b) * c * 0", "1 + x" };
+    FusedExpression fused;
+    compileSet(expressions, variables, fused);
+
+    // (a + b) * c is made once for four expressions, a / b once for two
+    const FusedStats& stats = fused.stats;
+    if (stats.expressions != expressions.size() || stats.fallbacks != 1 || stats.operationsFused >= stats.operationsSeparate ||
+        stats.operationsSaved != stats.operationsSeparate - stats.operationsFused || stats.shared == 0) {
+        cout << "The set made " << stats.operationsFused << " operations instead of " << stats.operationsSeparate << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    int rows[][3] = { { 6, 3, 2 }, { 6, 0, 2 }, { 0, 0, 0 }, { -7, 7, 5 }, { 2147483647, 1, 2 } };
+    int mismatches = 0;
+    for (const int* values : rows) mismatches += compareSet(fused, expressions, variables, values);
+    if (mismatches) return ERROR::PARSE_ERROR;
+
+    // With b = 0 only the expressions dividing by b fail ((6 + 0) * 2 - 1 is 12 - 2 - 1, see parse())
+    int results[7], errors[7];
+    runFused(fused, rows[1], results, errors);
+    if (errors[0] != ERROR::SUCCESS || errors[1] != ERROR::DIV_BY_ZERO || errors[3] != ERROR::DIV_BY_ZERO || results[2] != 9) {
+        cout << "A division by zero failed the wrong expressions." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    // INT_MIN / -1 after a division by zero, which run() never reaches, must not trap
+    vector<string> afterFailure = { "b / c + (a / b)", "a / b" };
+    FusedExpression failing;
+    compileSet(afterFailure, variables, failing);
+    int wrapRow[] = { -2147483647 - 1, -1, 0 };
+    int wrapResults[2], wrapErrors[2];
+    runFused(failing, wrapRow, wrapResults, wrapErrors);
+    if (wrapErrors[0] != ERROR::DIV_BY_ZERO || wrapErrors[1] != ERROR::SUCCESS || wrapResults[1] != -2147483647 - 1) {
+        cout << "INT_MIN / -1 after a division by zero was not handled." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    cout << stats.operationsSeparate << " operations one by one, " << stats.operationsOptimized << " optimized one by one, "
+        << stats.operationsFused << " fused." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Builds a random formula over the variables and a pool of common subexpressions
+static string randomFormula(mt19937& random, const vector<string>& pool, int depth) {
+    string out;
+    int terms = 1 + random() % 4;
+    for (int t = 0; t < terms; ++t) {
+        if (t > 0) { out += ' '; out += "+-*/"[random() % 4]; out += ' '; }
+        if (random() % 8 == 0) out += '-';
+        int pick = random() % 6;
+        if (pick < 2) out += "(" + pool[random() % pool.size()] + ")";
+        else if (pick == 2 && depth < 2) out += "(" + randomFormula(random, pool, depth + 1) + ")";
+        else if (pick == 3) out += to_string(random() % 10);
+        else out += "abcd"[random() % 4];
+    }
+    return out;
+}
+
+// Compares random sets of formulas sharing subexpressions with run(), on many rows
+int runRandomTests(const char* title, int sets, int rows) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    VariableTable variables;
+    for (const char* name : { "a", "b", "c", "d" }) declareVariable(variables, name);
+
+    mt19937 random(19);
+    size_t separate = 0, fusedOperations = 0;
+    for (int s = 0; s < sets; ++s) {
+        vector<string> pool;
+        for (int i = 0; i < 8; ++i) pool.push_back(randomFormula(random, { "a + b" }, 1));
+        vector<string> expressions;
+        int size = 50 + random() % 100;
+        for (int i = 0; i < size; ++i) expressions.push_back(randomFormula(random, pool, 0));
+
+        // Now and then a syntax error
+        if (random() % 2 == 0) expressions[random() % expressions.size()] += " )";
+        if (random() % 2 == 0) expressions[random() % expressions.size()] += " 7";
+
+        FusedExpression fused;
+        compileSet(expressions, variables, fused);
+        separate += fused.stats.operationsSeparate;
+        fusedOperations += fused.stats.operationsFused;
+        for (int r = 0; r < rows; ++r) {
+            int values[4];
+            for (int& value : values) value = random() % 4 == 0 ? 0 : (int)(random() % 41) - 20;
+            if (compareSet(fused, expressions, variables, values)) return ERROR::PARSE_ERROR;
+        }
+    }
+    cout << sets << " random sets matched run(), " << fusedOperations << " operations fused instead of " << separate << "." << endl;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running Fused Expression Tests..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    // Tests of the fixed expressions
+    if (runFixedTests("Test Fused Expression Fixed Expressions") == ERROR::SUCCESS) {
+        cout << "All fused expression fixed tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some fused expression fixed tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests of sharing and of divisions by zero
+    if (runSharingTests("Test Fused Expression Sharing") == ERROR::SUCCESS) {
+        cout << "All fused expression sharing tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some fused expression sharing tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests of random sets
+    if (runRandomTests("Test Fused Expression Random Sets", 100, 50) == ERROR::SUCCESS) {
+        cout << "All fused expression random tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some fused expression random tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
@@ -0,0 +1,181 @@
+/*
+ * File: instrumentation_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for the hot path counters.
+ * It is built with EVALUATOR_STATS defined, whatever the CMake option says. The counters must
+ * match what was evaluated exactly, and the counts of every thread, running or finished, must
+ * add up in a snapshot.
+ */
+
+ // Include necessary headers
+#include "../instrumentation.hpp"
+#include "../expressionEvaluator.hpp"
+#include "../constants.hpp"
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// Checks a counter. Returns true if it has the expected value.
+static bool checkCounter(const char* name, uint64_t value, uint64_t expected) {
+    if (value == expected) return true;
+    cout << "Counter " << name << " is " << value << " instead of " << expected << endl;
+    return false;
+}
+
+// Checks the counters of evaluate() on strings and buffers
+int runCounterTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    // Ten tokens: ( 1 + 2 ) * - ( 3 ), two parentheses, three calls to parse()
+    const string text = "(1 + 2) * -(3)";
+    int result = 0;
+    resetStats();
+    if (evaluate(text.c_str(), result) != ERROR::SUCCESS || result != -9) return ERROR::PARSE_ERROR;
+
+    EvaluatorStats stats;
+    getStatsSnapshot(stats);
+    if (!checkCounter("evaluateCalls", stats.evaluateCalls, 1) || !checkCounter("validateCalls", stats.validateCalls, 1) ||
+        !checkCounter("parseCalls", stats.parseCalls, 3) || !checkCounter("parenCalls", stats.parenCalls, 2) ||
+        !checkCounter("bytesScanned", stats.bytesScanned, text.size()) || !checkCounter("tokens", stats.tokens, 10) ||
+        !checkCounter("maxDepth", stats.maxDepth, 1) || !checkCounter("SUCCESS", stats.errorCounts[ERROR::SUCCESS], 1)) {
+        return ERROR::PARSE_ERROR;
+    }
+
+    // The single pass evaluate() counts the same tokens, without a call to isValidExpression()
+    resetStats();
+    evaluate(string_view(text), result);
+    evaluate(string_view("((((5))))"), result);
+    getStatsSnapshot(stats);
+    if (!checkCounter("evaluateCalls", stats.evaluateCalls, 2) || !checkCounter("validateCalls", stats.validateCalls, 0) ||
+        !checkCounter("tokens", stats.tokens, 10 + 9) || !checkCounter("maxDepth", stats.maxDepth, 4) ||
+        !checkCounter("bytesScanned", stats.bytesScanned, text.size() + 9)) {
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Every error path counts its code, and the depth comes back down after an error
+    resetStats();
+    const char* failing[] = { "1 / 0", "1 + a", "1+2 3", "(1 + 2", "(((1 2)) + 3)", "   ", "12", "" };
+    const int codes[] = { ERROR::DIV_BY_ZERO, ERROR::INVALID_CHARACTER, ERROR::PARSE_ERROR, ERROR::UNMATCHED_PAREN,
+        ERROR::MISSING_PAREN, ERROR::NO_NUM, ERROR::NO_OPERATOR, ERROR::INVALID_CHARACTER };
+    for (const char* expression : failing) evaluate(expression, result);
+    evaluate("(2)", result);
+    getStatsSnapshot(stats);
+    if (!checkCounter("maxDepth", stats.maxDepth, 3)) return ERROR::PARSE_ERROR;
+    uint64_t expected[STATS_ERROR_CODES] = {};
+    for (int code : codes) expected[code]++;
+    expected[ERROR::SUCCESS]++;
+    for (int i = 0; i < STATS_ERROR_CODES; ++i) {
+        if (!checkCounter(("errorCounts[" + to_string(i) + "]").c_str(), stats.errorCounts[i], expected[i])) return ERROR::PARSE_ERROR;
+    }
+
+    // Time is counted in every phase
+    for (int i = 0; i < 1000; ++i) {
+        evaluate("(1 + 2) * 3 - 4 / 2", result);
+        evaluate(string_view("(1 + 2) * 3 - 4 / 2"), result);
+    }
+    getStatsSnapshot(stats);
+    for (int i = 0; i < STATS_PHASE_COUNT; ++i) {
+        if (stats.phaseCycles[i] == 0) {
+            cout << "No time was counted in phase " << i << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+    cout << "Every counter matched what was evaluated." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Checks that the counts of every thread add up
+int runThreadTests(const char* title, int threads, int iterations) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    resetStats();
+
+    // Threads that have finished
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([iterations] {
+            int result = 0;
+            for (int i = 0; i < iterations; ++i) evaluate("1 + 2", result);
+        });
+    }
+    for (thread& worker : workers) worker.join();
+
+    // A thread that is still running
+    atomic<bool> counted{ false }, done{ false };
+    thread live([&] {
+        int result = 0;
+        for (int i = 0; i < iterations; ++i) evaluate("1 / 0", result);
+        counted = true;
+        while (!done) this_thread::yield();
+    });
+    while (!counted) this_thread::yield();
+
+    EvaluatorStats stats;
+    getStatsSnapshot(stats);
+    done = true;
+    live.join();
+
+    uint64_t total = (uint64_t)(threads + 1) * iterations;
+    if (!checkCounter("evaluateCalls", stats.evaluateCalls, total) ||
+        !checkCounter("SUCCESS", stats.errorCounts[ERROR::SUCCESS], total - iterations) ||
+        !checkCounter("DIV_BY_ZERO", stats.errorCounts[ERROR::DIV_BY_ZERO], iterations)) {
+        return ERROR::PARSE_ERROR;
+    }
+
+    // The JSON names every counter
+    string json;
+    writeStatsJson(stats, json);
+    const string expectedParts[] = { "{\"enabled\": 1, ", "\"evaluateCalls\": " + to_string(total) + ", ",
+        "\"DIV_BY_ZERO\": " + to_string(iterations) + ", ", "\"phaseCycles\": {\"validate\": " };
+    for (const string& part : expectedParts) {
+        if (json.find(part) == string::npos || json.back() != '}') {
+            cout << "The JSON " << json << " does not contain " << part << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+    cout << json << endl;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running Instrumentation Tests..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    if (!statsEnabled()) {
+        cout << "The counters were not compiled in." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests of the counters
+    if (runCounterTests("Test Instrumentation Counters") == ERROR::SUCCESS) {
+        cout << "All instrumentation counter tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some instrumentation counter tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests of the snapshot over threads
+    if (runThreadTests("Test Instrumentation Threads", 4, 10000) == ERROR::SUCCESS) {
+        cout << "All instrumentation thread tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some instrumentation thread tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
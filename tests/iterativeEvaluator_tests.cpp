@@ -0,0 +1,176 @@
+/*
+ * File: iterativeEvaluator_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for the iterative expression evaluator.
+ * It must give the same error codes and results as evaluate() on everything evaluate() can handle,
+ * and go much deeper than the native stack allows.
+ */
+
+ // Include necessary headers
+#include "../iterativeEvaluator.hpp"
+#include "../expressionEvaluator.hpp"
+#include "../constants.hpp"
+#include "testData.hpp"
+#include <iostream>
+#include <random>
+#include <string>
+using namespace std;
+
+// Compares evaluateIterative() with evaluate() on one expression. Returns true if they match.
+static bool matchesEvaluate(const string& expression, ParseStack& stack) {
+    int expectedResult = 0, result = 0;
+    int expectedError = evaluate(expression.c_str(), expectedResult);
+    int error = evaluateIterative(expression.c_str(), result, stack);
+    if (error == expectedError && result == expectedResult) return true;
+    cout << "'" << expression << "' failed. Expected error: " << expectedError << " and result: " << expectedResult
+        << ", Got error: " << error << " and result: " << result << endl;
+    return false;
+}
+
+// Runs the test expressions and the differential expressions through both evaluators
+int runFixedTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    ParseStack stack;
+    for (size_t i = 0; i < testData::NUM_TEST_EXPRESSIONS; ++i) {
+        if (!matchesEvaluate(testData::getValidExpressions(i), stack)) return ERROR::PARSE_ERROR;
+        if (!matchesEvaluate(testData::getInvalidExpressions(i), stack)) return ERROR::PARSE_ERROR;
+    }
+    for (size_t i = 0; i < testData::NUM_DIFFERENTIAL_EXPRESSIONS; ++i) {
+        if (!matchesEvaluate(testData::getDifferentialExpressions(i), stack)) return ERROR::PARSE_ERROR;
+    }
+    cout << 2 * testData::NUM_TEST_EXPRESSIONS + testData::NUM_DIFFERENTIAL_EXPRESSIONS << " expressions matched evaluate()." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Builds a random expression with signs, spaces and nesting, sometimes broken on purpose
+static void randomExpression(mt19937& random, int depth, string& out) {
+    int terms = 1 + random() % 5;
+    for (int t = 0; t < terms; ++t) {
+        if (t > 0) out += "+-*/"[random() % 4];
+        if (random() % 4 == 0) out += ' ';
+        if (random() % 5 == 0) out += '-';
+        int pick = random() % 10;
+        if (pick < 3 && depth < 6) { out += '('; randomExpression(random, depth + 1, out); out += ')'; }
+        else out += to_string(random() % 20);
+        if (random() % 30 == 0) out += "()x "[random() % 4];
+    }
+}
+
+// Compares both evaluators on random expressions, with one stack reused for all of them
+int runRandomTests(const char* title, size_t iter) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    mt19937 random(2024);
+    ParseStack stack;
+    for (size_t i = 0; i < iter; ++i) {
+        string expression;
+        randomExpression(random, 0, expression);
+        if (!matchesEvaluate(expression, stack)) return ERROR::PARSE_ERROR;
+    }
+    cout << iter << " random expressions matched evaluate()." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Checks nesting far deeper than the recursive parser can go, and the depth limit
+int runDepthTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    // 200000 nested parentheses around a sum
+    const int depth = 200000;
+    string deep = string(depth, '(') + "1 + 2" + string(depth, ')') + " * 3";
+
+    int result = 0;
+    int error = evaluateIterative(deep.c_str(), result);
+    if (error != ERROR::SUCCESS || result != 9) {
+        cout << "Deep expression gave error " << error << " and result " << result << ", expected 9" << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // A sign per level, an even number of them
+    string signs;
+    for (int i = 0; i < depth; ++i) signs += "-(";
+    signs += "7" + string(depth, ')');
+    error = evaluateIterative(signs.c_str(), result);
+    if (error != ERROR::SUCCESS || result != 7) {
+        cout << "Deep signed expression gave error " << error << " and result " << result << ", expected 7" << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    cout << "Nesting of " << depth << " levels evaluated." << endl;
+
+    // The limit: exactly maxDepth levels pass, one more fails
+    ParseStack stack;
+    stack.maxDepth = 3;
+    const struct { const char* expression; int error; int result; } cases[] = {
+        { "(((1)))", ERROR::SUCCESS, 1 },
+        { "((((1))))", ERROR::DEPTH_EXCEEDED, 0 },
+        { "(1) + ((2)) + (((3)))", ERROR::SUCCESS, 6 },
+        { "1 / 0 + ((((1))))", ERROR::DIV_BY_ZERO, 0 },      // The earlier error wins
+        { "((((1)))", ERROR::UNMATCHED_PAREN, 0 },           // Validation comes first
+        { "(((1))) + 2 3", ERROR::PARSE_ERROR, 3 },          // The result is still stored
+    };
+    for (const auto& test : cases) {
+        error = evaluateIterative(test.expression, result, stack);
+        if (error != test.error || result != test.result) {
+            cout << "'" << test.expression << "' with a depth of 3 gave error " << error << " and result " << result
+                << ", expected error " << test.error << " and result " << test.result << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+
+    // The stack is reused, it keeps the room of the deepest expression
+    size_t capacity = stack.frames.capacity();
+    for (const auto& test : cases) evaluateIterative(test.expression, result, stack);
+    if (stack.frames.capacity() != capacity) {
+        cout << "The stack grew on expressions it already handled." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    cout << "Depth limit and stack reuse checked." << endl;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running Iterative Evaluator Tests..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    // Tests on the fixed expressions
+    if (runFixedTests("Test Iterative Fixed Expressions") == ERROR::SUCCESS) {
+        cout << "All iterative fixed tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some iterative fixed tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests on random expressions
+    if (runRandomTests("Test Iterative Random Expressions", 50000) == ERROR::SUCCESS) {
+        cout << "All iterative random tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some iterative random tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests of deep nesting and of the depth limit
+    if (runDepthTests("Test Iterative Depth") == ERROR::SUCCESS) {
+        cout << "All iterative depth tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some iterative depth tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
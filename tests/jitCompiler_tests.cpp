@@ -0,0 +1,233 @@
+/*
+ * File: jitCompiler_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for the native code compiler.
+ * Native code must give the same error code and result as run() on the program it came from,
+ * for plain, variable and optimized programs, and tiered expressions must switch to it once hot.
+ */
+
+ // Include necessary headers
+#include "../jitCompiler.hpp"
+#include "../compiledExpression.hpp"
+#include "../optimizer.hpp"
+#include "../constants.hpp"
+#include "testData.hpp"
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Compares native code with run() on every row of the shared row values. Returns the number of mismatches.
+static int compareRows(const CompiledExpression& program, const string& expression) {
+    const int* values = testData::getRowValues();
+    const size_t count = testData::NUM_ROW_VALUES;
+    JitExpression jit;
+    if (!jitCompile(program, jit)) {
+        cout << "'" << expression << "' was not compiled to native code." << endl;
+        return 1;
+    }
+
+    int mismatches = 0;
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t j = 0; j < count; ++j) {
+            int row[] = { values[i], values[j], values[(i + j) % count] };
+            int expectedResult = 0, result = 0;
+            int expectedError = run(program, row, expectedResult);
+            int error = runJit(jit, row, result);
+            if (error != expectedError || result != expectedResult) {
+                if (mismatches++ == 0) {
+                    cout << "'" << expression << "' with a=" << row[0] << " b=" << row[1] << " c=" << row[2]
+                        << " failed. Expected error: " << expectedError << " and result: " << expectedResult
+                        << ", Got error: " << error << " and result: " << result << endl;
+                }
+            }
+        }
+    }
+    return mismatches;
+}
+
+// Compares native code with run() on the fixed expressions, plain and optimized
+int runFixedTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    VariableTable variables;
+    declareVariable(variables, "a");
+    declareVariable(variables, "b");
+    declareVariable(variables, "c");
+
+    CompiledExpression program;
+    size_t count = 0;
+    for (size_t i = 0; i < testData::NUM_DIFFERENTIAL_EXPRESSIONS; ++i) {
+        const char* expression = testData::getDifferentialExpressions(i);
+        compile(expression, variables, program);
+        if (compareRows(program, expression) != 0) return ERROR::PARSE_ERROR;
+        optimize(program);
+        if (compareRows(program, expression) != 0) return ERROR::PARSE_ERROR;
+        count += 2;
+    }
+
+    // Shared subexpressions use temporaries, and a long chain uses a deep stack
+    string chain;
+    for (int i = 0; i < 500; ++i) chain += "(a + ";
+    chain += "1" + string(500, ')');
+    const string expressions[] = { "(a + b) * (a + b) - (a + b) / (c + 1)", "a * b - c * 2 + 1", "2 * a / b - 4", chain };
+    for (const string& expression : expressions) {
+        compile(expression.c_str(), variables, program);
+        if (compareRows(program, expression) != 0) return ERROR::PARSE_ERROR;
+        optimize(program);
+        if (compareRows(program, expression) != 0) return ERROR::PARSE_ERROR;
+        count += 2;
+    }
+    cout << count << " programs matched run() on every row." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Compares native code with run() on random expressions
+int runRandomTests(const char* title, size_t iter) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    VariableTable variables;
+    declareVariable(variables, "a");
+    declareVariable(variables, "b");
+    declareVariable(variables, "c");
+
+    mt19937 random(4321);
+    CompiledExpression program;
+    for (size_t i = 0; i < iter; ++i) {
+        string expression;
+        testData::randomVariableExpression(random, 0, expression);
+        compile(expression.c_str(), variables, program);
+        if (compareRows(program, expression) != 0) return ERROR::PARSE_ERROR;
+        optimize(program);
+        if (compareRows(program, expression) != 0) return ERROR::PARSE_ERROR;
+    }
+    cout << iter << " random expressions matched run() on every row." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Compares a module of many programs in shared pages with run()
+int runModuleTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    // The differential expressions, and one program too deep for the native stack
+    vector<CompiledExpression> programs(testData::NUM_DIFFERENTIAL_EXPRESSIONS + 1);
+    for (size_t i = 0; i < testData::NUM_DIFFERENTIAL_EXPRESSIONS; ++i) compile(testData::getDifferentialExpressions(i), programs[i]);
+    string nested;
+    for (int i = 0; i < JIT_MAX_STACK; ++i) nested += "1+(";
+    nested += "1" + string(JIT_MAX_STACK, ')');
+    compile(nested.c_str(), programs.back());
+
+    JitModule module;
+    if (!jitCompile(programs.data(), programs.size(), module) || module.entries.back() != nullptr) {
+        cout << "The module was not compiled, or the deep program was compiled." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    for (size_t i = 0; i + 1 < programs.size(); ++i) {
+        int expectedResult = 0, result = 0;
+        int expectedError = run(programs[i], expectedResult);
+        int error = runJit(module, i, 0, result);
+        if (error != expectedError || result != expectedResult) {
+            cout << "'" << testData::getDifferentialExpressions(i) << "' failed. Expected error: " << expectedError
+                << " and result: " << expectedResult << ", Got error: " << error << " and result: " << result << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+    cout << programs.size() - 1 << " programs in shared pages matched run()." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Checks that a tiered expression is interpreted until it passes its threshold
+int runTieringTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    TieredExpression expression;
+    expression.threshold = 3;
+    compile("(1 + 2) * 4 / 2", expression.program);
+    for (int i = 1; i <= 5; ++i) {
+        int result = 0;
+        int error = runTiered(expression, result);
+        bool native = expression.native.load() != nullptr;
+        if (error != ERROR::SUCCESS || result != 6 || native != (i > 3)) {
+            cout << "Run " << i << " gave error " << error << " and result " << result << ", native code: " << native << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+
+    // Programs too deep for the native stack stay with the interpreter
+    TieredExpression deep;
+    deep.threshold = 0;
+    string nested;
+    for (int i = 0; i < JIT_MAX_STACK; ++i) nested += "1+(";
+    nested += "1" + string(JIT_MAX_STACK, ')');
+    compile(nested.c_str(), deep.program);
+    int result = 0;
+    if (runTiered(deep, result) != ERROR::SUCCESS || result != JIT_MAX_STACK + 1 || deep.native.load() != nullptr) {
+        cout << "A program deeper than JIT_MAX_STACK was compiled to native code." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    cout << "Tiering switched to native code after the threshold." << endl;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running JIT Compiler Tests..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    if (!jitSupported()) {
+        cout << "Native code is not supported on this platform, nothing to test." << endl;
+        return 0;
+    }
+
+    // Tests on fixed expressions
+    if (runFixedTests("Test JIT Fixed Expressions") == ERROR::SUCCESS) {
+        cout << "All JIT fixed tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some JIT fixed tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests on random expressions
+    if (runRandomTests("Test JIT Random Expressions", 5000) == ERROR::SUCCESS) {
+        cout << "All JIT random tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some JIT random tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests of modules
+    if (runModuleTests("Test JIT Modules") == ERROR::SUCCESS) {
+        cout << "All JIT module tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some JIT module tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests of the tiering policy
+    if (runTieringTests("Test JIT Tiering") == ERROR::SUCCESS) {
+        cout << "All JIT tiering tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some JIT tiering tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
@@ -0,0 +1,220 @@
+/*
+ * File: numericEvaluator_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for the evaluator generic over its value type.
+ * In int32_t with wrapping it must be evaluate(), quirk for quirk. In the other types and policies it must
+ * give the exact value whenever it fits, and overflow, saturate or wrap exactly where the value does not.
+ */
+
+ // Include necessary headers
+#include "../numericEvaluator.hpp"
+#include "../expressionEvaluator.hpp"
+#include "../constants.hpp"
+#include "testData.hpp"
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Prints a 128 bit integer
+static string toString(int128_t value) {
+    if (value == 0) return "0";
+    bool negative = value < 0;
+    string digits;
+    while (value != 0) {
+        int digit = (int)(value % 10);
+        digits.insert(digits.begin(), (char)('0' + (negative ? -digit : digit)));
+        value /= 10;
+    }
+    return negative ? "-" + digits : digits;
+}
+
+// Compares int32_t with wrapping to evaluate() on the fixed expressions and on random ones
+int runWrapTests(const char* title, int count) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    vector<string> expressions;
+    for (size_t i = 0; i < testData::NUM_DIFFERENTIAL_EXPRESSIONS; ++i) expressions.push_back(testData::getDifferentialExpressions(i));
+    for (size_t i = 0; i < testData::NUM_TEST_EXPRESSIONS; ++i) expressions.push_back(testData::getValidExpressions(i));
+    for (size_t i = 0; i < 10; ++i) expressions.push_back(testData::getInvalidExpressions(i));
+    const char* quirks[] = { "12", "", "   ", "1+2 3", "2 * 3 + 4", "1 / 0 + (2", "-(3 - 4) * 2 + 1", "99999999999 * 3 + 1",
+        "2147483647 + 1", "-2147483648 - 1", "65536 * 65536 + 7", "-(-2147483647 - 1) + 0" };
+    for (const char* expression : quirks) expressions.push_back(expression);
+
+    mt19937 random(21);
+    for (int i = 0; i < count; ++i) {
+        string expression;
+        int terms = 1 + random() % 8;
+        for (int t = 0; t < terms; ++t) {
+            if (t > 0) { expression += ' '; expression += "+-*/"[random() % 4]; expression += ' '; }
+            if (random() % 5 == 0) expression += '-';
+            if (random() % 6 == 0) expression += "(" + to_string(random() % 100000) + " * " + to_string(random() % 100000) + ")";
+            else expression += to_string(random() % 7 == 0 ? 0 : random() % 100000);
+        }
+        expressions.push_back(expression);
+    }
+
+    int mismatches = 0;
+    for (const string& expression : expressions) {
+        int expectedResult = 0, result = 0;
+        int expectedError = evaluate(expression.c_str(), expectedResult);
+        int error = evaluateNumeric<int32_t, WrapOverflow>(expression.c_str(), result);
+        if (error != expectedError || result != expectedResult) {
+            if (mismatches++ < 3) {
+                cout << "'" << expression << "' failed. Expected error: " << expectedError << " and result: " << expectedResult
+                    << ", Got error: " << error << " and result: " << result << endl;
+            }
+        }
+    }
+    if (mismatches) return ERROR::PARSE_ERROR;
+    cout << expressions.size() << " expressions matched evaluate()." << endl;
+    return ERROR::SUCCESS;
+}
+
+// One expression and what every type and policy gives for it
+struct OverflowCase
+{
+    const char* expression;
+    int error32; int64_t checked32, saturated32, wrapped32; // int32_t: checked error, then the three results
+    int error64; int64_t checked64;                         // int64_t, checked
+};
+
+// Checks the edges of every type and policy
+int runEdgeTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    const int S = ERROR::SUCCESS, O = ERROR::VALUE_OVERFLOW;
+    const int64_t MAX = 2147483647, MIN = -2147483647 - 1;
+    const OverflowCase cases[] = {
+        { "2147483647 + 1", O, 0, MAX, MIN, S, 2147483648 },
+        { "-2147483648 + 0", S, MIN, MIN, MIN, S, MIN },
+        { "-2147483648 - 1", O, 0, MIN, MAX, S, -2147483649 },
+        { "0 - 2147483648", O, 0, -MAX, MIN, S, -2147483648 }, // Saturated, the literal is MAX
+        { "(-2147483648) / -1", O, 0, MAX, MIN, S, 2147483648 },
+        { "-(-2147483648 + 0)", O, 0, MAX, MIN, S, 2147483648 },
+        { "3000000000 * 2", O, 0, MAX, (int32_t)(uint32_t)(3000000000u * 2u), S, 6000000000 },
+        { "-65536 * 65536", O, 0, MIN, 0, S, -4294967296 },
+        { "9223372036854775807 + 0", O, 0, MAX, -1, S, INT64_MAX },
+        { "9223372036854775807 + 1", O, 0, MAX, 0, O, 0 },
+        { "-9223372036854775808 * 1", O, 0, MIN, 0, S, INT64_MIN },
+        { "1 + 2 3", ERROR::PARSE_ERROR, 3, 3, 3, ERROR::PARSE_ERROR, 3 },
+        { "1 / 0", ERROR::DIV_BY_ZERO, 0, 0, 0, ERROR::DIV_BY_ZERO, 0 },
+    };
+
+    int failures = 0;
+    for (const OverflowCase& c : cases) {
+        int32_t checked32 = 7, saturated32 = 7, wrapped32 = 7;
+        int64_t checked64 = 7;
+        int error32 = evaluateNumeric<int32_t, CheckedOverflow>(c.expression, checked32);
+        evaluateNumeric<int32_t, SaturateOverflow>(c.expression, saturated32);
+        evaluateNumeric<int32_t, WrapOverflow>(c.expression, wrapped32);
+        int error64 = evaluateNumeric<int64_t, CheckedOverflow>(c.expression, checked64);
+        if (error32 != c.error32 || checked32 != c.checked32 || saturated32 != c.saturated32 || wrapped32 != c.wrapped32 ||
+            error64 != c.error64 || checked64 != c.checked64) {
+            cout << "'" << c.expression << "' gave " << error32 << ": " << checked32 << ", " << saturated32 << ", " << wrapped32
+                << " and " << error64 << ": " << checked64 << endl;
+            failures++;
+        }
+    }
+
+    // 128 bit integers hold what 64 bit ones cannot
+    int128_t wide = 0;
+    int error = evaluateNumeric<int128_t, CheckedOverflow>("9999999999 * 9999999999 * 9999999999 - 1", wide);
+    int128_t expected = (int128_t)9999999999 * 9999999999 * 9999999999 - 9999999999 - 1;
+    if (error != ERROR::SUCCESS || wide != expected) {
+        cout << "The 128 bit product gave " << error << ": " << toString(wide) << " instead of " << toString(expected) << endl;
+        failures++;
+    }
+    if (evaluateNumeric<int128_t, CheckedOverflow>("99999999999999999999 * 99999999999999999999", wide) != ERROR::VALUE_OVERFLOW ||
+        evaluateNumeric<int128_t, SaturateOverflow>("99999999999999999999 * 99999999999999999999", wide) != ERROR::SUCCESS ||
+        wide != NumericLimits<int128_t>::max()) {
+        cout << "The 128 bit overflow was missed." << endl;
+        failures++;
+    }
+    if (failures) return ERROR::PARSE_ERROR;
+    cout << sizeof(cases) / sizeof(cases[0]) + 2 << " edge cases gave the exact value, or overflowed where it does not fit." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Compares checked 64 bit evaluation with 128 bit evaluation, which never overflows on these expressions
+int runRandomTests(const char* title, int count) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    mt19937 random(210);
+    int mismatches = 0, overflows = 0;
+    for (int i = 0; i < count; ++i) {
+        string expression;
+        int terms = 1 + random() % 6;
+        for (int t = 0; t < terms; ++t) {
+            if (t > 0) { expression += ' '; expression += "+-*/"[random() % 4]; expression += ' '; }
+            if (random() % 5 == 0) expression += '-';
+            expression += to_string(random() % 4 == 0 ? random() % 10 : random() % 10000000);
+        }
+
+        int128_t exact = 0;
+        int64_t checked = 0, saturated = 0;
+        int exactError = evaluateNumeric<int128_t, CheckedOverflow>(expression.c_str(), exact);
+        int error = evaluateNumeric<int64_t, CheckedOverflow>(expression.c_str(), checked);
+        int saturatedError = evaluateNumeric<int64_t, SaturateOverflow>(expression.c_str(), saturated);
+        bool fits = exact >= INT64_MIN && exact <= INT64_MAX;
+        bool ok = exactError != ERROR::VALUE_OVERFLOW;
+        if (error == ERROR::VALUE_OVERFLOW) overflows++;
+        else ok = ok && error == exactError && checked == (int64_t)exact && saturatedError == error && saturated == checked;
+        if (!fits && error != ERROR::VALUE_OVERFLOW) ok = false;
+        if (!ok && mismatches++ < 3) {
+            cout << "'" << expression << "' gave " << error << ": " << checked << " in 64 bits and " << exactError << ": "
+                << toString(exact) << " in 128 bits" << endl;
+        }
+    }
+    if (mismatches) return ERROR::PARSE_ERROR;
+    cout << count << " random expressions matched 128 bit evaluation, " << overflows << " of them overflowed 64 bits." << endl;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running Numeric Evaluator Tests..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    // Tests of int32_t with wrapping against evaluate()
+    if (runWrapTests("Test Numeric Evaluator Wrapping Like evaluate()", 20000) == ERROR::SUCCESS) {
+        cout << "All numeric evaluator wrapping tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some numeric evaluator wrapping tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests of the edges of every type and policy
+    if (runEdgeTests("Test Numeric Evaluator Overflow Edges") == ERROR::SUCCESS) {
+        cout << "All numeric evaluator edge tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some numeric evaluator edge tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests of random expressions against 128 bit evaluation
+    if (runRandomTests("Test Numeric Evaluator Random Expressions", 20000) == ERROR::SUCCESS) {
+        cout << "All numeric evaluator random tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some numeric evaluator random tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * File: optimizer_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for the compiled expression optimizer.
+ * Every optimized program must give the same error code and the same result as the program
+ * it was made from, bit for bit, so most tests compare the two on many rows of values.
+ */
+
+ // Include necessary headers
+#include "../optimizer.hpp"
+#include "../compiledExpression.hpp"
+#include "../constants.hpp"
+#include "testData.hpp"
+#include <climits>
+#include <iostream>
+#include <random>
+#include <string>
+using namespace std;
+
+// Values bound to the variables, chosen to hit zero divisors, signs and wrap-around
+static const int ROW_VALUES[] = { 0, 1, -1, 2, -3, 7, 100, INT_MAX, INT_MIN + 1 };
+static const size_t NUM_ROW_VALUES = sizeof(ROW_VALUES) / sizeof(ROW_VALUES[0]);
+
+// Values bound to the variables of random expressions.
+// They stay small, so that no run of a random expression divides INT_MIN by -1 (which traps).
+static const int SMALL_ROW_VALUES[] = { 0, 1, -1, 2, -3, 7 };
+static const size_t NUM_SMALL_ROW_VALUES = sizeof(SMALL_ROW_VALUES) / sizeof(SMALL_ROW_VALUES[0]);
+
+// Compares an optimized program with the original on every combination of row values.
+// Returns the number of mismatches.
+static int compareRows(const CompiledExpression& original, const CompiledExpression& optimized, const string& expression,
+    const int* values = ROW_VALUES, size_t count = NUM_ROW_VALUES) {
+    int mismatches = 0;
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t j = 0; j < count; ++j) {
+            int row[] = { values[i], values[j], values[(i + j) % count] };
+            int expectedResult = 0, result = 0;
+            int expectedError = run(original, row, expectedResult);
+            int error = run(optimized, row, result);
+            if (error != expectedError || result != expectedResult) {
+                if (mismatches++ == 0) {
+                    cout << "'" << expression << "' with a=" << row[0] << " b=" << row[1] << " c=" << row[2]
+                        << " failed. Expected error: " << expectedError << " and result: " << expectedResult
+                        << ", Got error: " << error << " and result: " << result << endl;
+                }
+            }
+        }
+    }
+    return mismatches;
+}
+
+// Checks optimized programs against the originals on the differential and variable expressions
+int runFixedTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    VariableTable variables;
+    declareVariable(variables, "a");
+    declareVariable(variables, "b");
+    declareVariable(variables, "c");
+
+    CompiledExpression original, optimized;
+    for (size_t i = 0; i < testData::NUM_DIFFERENTIAL_EXPRESSIONS; ++i) {
+        const char* expression = testData::getDifferentialExpressions(i);
+        compile(expression, variables, original);
+        optimized = original;
+        optimize(optimized);
+        if (compareRows(original, optimized, expression) != 0) return ERROR::PARSE_ERROR;
+        cout << "Test " << i + 1 << ": '" << expression << "' optimized from " << original.code.size()
+            << " to " << optimized.code.size() << " instructions." << endl;
+    }
+    return ERROR::SUCCESS;
+}
+
+// Checks that the optimizations actually happen, and that failing operations are kept
+int runRewriteTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    VariableTable variables;
+    declareVariable(variables, "a");
+    declareVariable(variables, "b");
+    declareVariable(variables, "c");
+
+    // Expression, and the length of its optimized program
+    struct Case { const char* expression; size_t length; };
+    const Case cases[] = {
+        { "(2 * 3) + (4 / 2)", 2 },             // Folded to a constant
+        { "a * 1", 2 },                         // x * 1
+        { "(a + 0) - 0", 2 },                   // x + 0 and x - 0
+        { "a - a", 2 },                         // x - x
+        { "(a + b) * (a + b)", 7 },             // Shared: a b + store loadt * return
+        { "b * (a * 0)", 2 },                   // x * 0
+        { "(a / b) - (a / b)", 7 },             // Kept, a / b may divide by zero
+        { "(a / b) * 0", 6 },                   // Kept, a / b may divide by zero
+        { "a / 0", 4 },                         // Never folded
+        { "-(-a)", 2 },                          // Double negation
+    };
+
+    CompiledExpression original, optimized;
+    for (const Case& test : cases) {
+        compile(test.expression, variables, original);
+        optimized = original;
+        OptimizeStats stats;
+        optimize(optimized, &stats);
+        if (compareRows(original, optimized, test.expression) != 0) return ERROR::PARSE_ERROR;
+        if (optimized.code.size() != test.length) {
+            cout << "'" << test.expression << "' optimized to " << optimized.code.size()
+                << " instructions, expected " << test.length << endl;
+            return ERROR::PARSE_ERROR;
+        }
+        cout << "'" << test.expression << "' optimized from " << stats.instructionsBefore << " to "
+            << stats.instructionsAfter << " instructions (folded " << stats.folded << ", simplified "
+            << stats.simplified << ", shared " << stats.shared << ")." << endl;
+    }
+    return ERROR::SUCCESS;
+}
+
+// Checks optimized programs against the originals on many random expressions
+int runRandomTests(const char* title, size_t iter) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    VariableTable variables;
+    declareVariable(variables, "a");
+    declareVariable(variables, "b");
+    declareVariable(variables, "c");
+
+    mt19937 random(12345);
+    CompiledExpression original, optimized;
+    size_t before = 0, after = 0;
+    for (size_t i = 0; i < iter; ++i) {
+        string expression;
+        testData::randomVariableExpression(random, 0, expression);
+        compile(expression.c_str(), variables, original);
+        optimized = original;
+        optimize(optimized);
+        before += original.code.size();
+        after += optimized.code.size();
+        if (compareRows(original, optimized, expression, SMALL_ROW_VALUES, NUM_SMALL_ROW_VALUES) != 0) return ERROR::PARSE_ERROR;
+    }
+    cout << iter << " random expressions matched, " << before << " instructions optimized to " << after << "." << endl;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running Optimizer Tests..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    // Tests on the differential expressions
+    if (runFixedTests("Test Optimize Differential Expressions") == ERROR::SUCCESS) {
+        cout << "All optimize differential tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some optimize differential tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests for the rewrites themselves
+    if (runRewriteTests("Test Optimize Rewrites") == ERROR::SUCCESS) {
+        cout << "All optimize rewrite tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some optimize rewrite tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests on random expressions
+    if (runRandomTests("Test Optimize Random Expressions", 20000) == ERROR::SUCCESS) {
+        cout << "All optimize random tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some optimize random tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
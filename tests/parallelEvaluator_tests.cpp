@@ -0,0 +1,186 @@
+/*
+ * File: parallelEvaluator_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for the parallel evaluator.
+ * Cut into pieces of any size and run on any number of threads, an expression must give the same
+ * error code and result as evaluate(), wherever its errors and quirks fall against the cuts.
+ */
+
+ // Include necessary headers
+#include "../parallelEvaluator.hpp"
+#include "../expressionEvaluator.hpp"
+#include "../constants.hpp"
+#include "testData.hpp"
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Compares evaluateParallel() with evaluate() for every piece size in [1, maxChunk] and a few threads.
+// Returns the number of mismatches.
+static int compareExpression(const string& expression, size_t maxChunk) {
+    int expectedResult = 0;
+    int expectedError = evaluate(expression.c_str(), expectedResult);
+    int mismatches = 0;
+    for (size_t chunk = 1; chunk <= maxChunk; ++chunk) {
+        for (unsigned threads : { 2u, 3u }) {
+            int result = 0;
+            int error = evaluateParallel(expression.c_str(), result, threads, chunk);
+            if (error != expectedError || result != expectedResult) {
+                if (mismatches++ == 0) {
+                    cout << "'" << expression.substr(0, 80) << "' in pieces of " << chunk << " on " << threads
+                        << " threads failed. Expected error: " << expectedError << " and result: " << expectedResult
+                        << ", Got error: " << error << " and result: " << result << endl;
+                }
+            }
+        }
+    }
+    return mismatches;
+}
+
+// Compares the parallel evaluator with evaluate() on the fixed expressions, cut everywhere
+int runFixedTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    vector<string> expressions;
+    for (size_t i = 0; i < testData::NUM_DIFFERENTIAL_EXPRESSIONS; ++i) expressions.push_back(testData::getDifferentialExpressions(i));
+    for (size_t i = 0; i < testData::NUM_TEST_EXPRESSIONS; ++i) expressions.push_back(testData::getValidExpressions(i));
+    for (size_t i = 0; i < 10; ++i) expressions.push_back(testData::getInvalidExpressions(i));
+
+    // Quirks of parse() next to the cuts, and errors of every kind
+    const char* quirks[] = { "2 * 3 + 4", "20 * 3 - 5 + 1", "8 / 2 / 2 - 1 - 1", "1 + 2 3 + 4", "1 + 2 * 3 4 - 5",
+        "10 - -3 - (-4) * 2 + 1", "(1 + 2) * (3 - 4) - (5 * 6) / (7 - 9)", "1 + 1 / 0 + 1 2", "1 + 2 + (3 4) + 5",
+        "1 + 2 + 3 +", "1 + + 2 + 3", "1 + 2 ) + ( 3", "(((1 2)) + 3)", "1 + 2 + 3 + a", "12 + 34 / (5 - 5) * 6",
+        "7 + 2147483647 * 2 - 9", "   1 + 2   ", "99999999999 - 1 + 2", "-(1 - 2) - -3 * -(4) - 5", "1 - (2 - (3 - (4 - 5))) - 6" };
+    for (const char* expression : quirks) expressions.push_back(expression);
+
+    int mismatches = 0;
+    for (const string& expression : expressions) mismatches += compareExpression(expression, expression.size() + 1);
+    if (mismatches) return ERROR::PARSE_ERROR;
+    cout << expressions.size() << " expressions matched evaluate() cut in pieces of every size." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Builds a random expression: long top level chains with signs, nesting and, now and then, an error
+static void randomExpression(mt19937& random, int depth, size_t terms, string& out) {
+    for (size_t t = 0; t < terms; ++t) {
+        if (t > 0) { out += ' '; out += "+-*/+-"[random() % 6]; out += ' '; }
+        if (random() % 6 == 0) out += '-';
+        int pick = random() % 12;
+        if (pick == 0 && depth < 3) { out += '('; randomExpression(random, depth + 1, 1 + random() % 5, out); out += ')'; }
+        else out += to_string(random() % 7 == 0 ? 0 : random() % 100);
+    }
+}
+
+// Compares the parallel evaluator with evaluate() on random expressions
+int runRandomTests(const char* title, int count) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    mt19937 random(18);
+    int mismatches = 0, failures = 0;
+    for (int i = 0; i < count; ++i) {
+        string expression;
+        randomExpression(random, 0, 2 + random() % 40, expression);
+
+        // Now and then a syntax error somewhere
+        if (random() % 4 == 0) {
+            size_t at = random() % expression.size();
+            const char* errors[] = { " 7 ", ")", "(", "a", "+ *" };
+            expression.insert(at, errors[random() % 5]);
+        }
+        int result = 0;
+        failures += evaluate(expression.c_str(), result) != ERROR::SUCCESS;
+        mismatches += compareExpression(expression, 24);
+    }
+    if (mismatches) return ERROR::PARSE_ERROR;
+    cout << count << " random expressions matched evaluate(), " << failures << " of them fail." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Compares the parallel evaluator with evaluate() on an expression of a million terms
+int runLargeTests(const char* title, size_t terms) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    mt19937 random(180);
+    string expression;
+    for (size_t t = 0; t < terms; ++t) {
+        if (t > 0) expression += " +-*"[1 + random() % 3];
+        if (random() % 16 == 0) expression += "(" + to_string(1 + random() % 9) + " / " + to_string(1 + random() % 3) + ")";
+        else expression += to_string(random() % 1000);
+    }
+
+    for (unsigned threads : { 2u, 4u, 0u }) {
+        for (size_t chunk : { (size_t)4096, PARALLEL_CHUNK_SIZE }) {
+            int expectedResult = 0, result = 0;
+            int expectedError = evaluate(expression.c_str(), expectedResult);
+            int error = evaluateParallel(expression.c_str(), result, threads, chunk);
+            if (error != expectedError || result != expectedResult) {
+                cout << "The large expression on " << threads << " threads in pieces of " << chunk << " failed. Expected error: "
+                    << expectedError << " and result: " << expectedResult << ", Got error: " << error << " and result: " << result << endl;
+                return ERROR::PARSE_ERROR;
+            }
+        }
+    }
+
+    // A division by zero near the end and a syntax error near the start: the first one wins
+    string failing = expression + " + 1 / 0";
+    string stopped = "1 2 + " + failing;
+    for (const string& text : { failing, stopped }) {
+        int expectedResult = 0, result = 0;
+        int expectedError = evaluate(text.c_str(), expectedResult);
+        int error = evaluateParallel(text.c_str(), result, 4, 4096);
+        if (error != expectedError || result != expectedResult) {
+            cout << "The failing large expression gave error: " << error << " instead of " << expectedError << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+    cout << "An expression of " << expression.size() << " bytes matched evaluate()." << endl;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running Parallel Evaluator Tests..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    // Tests of the fixed expressions
+    if (runFixedTests("Test Parallel Evaluator Fixed Expressions") == ERROR::SUCCESS) {
+        cout << "All parallel evaluator fixed tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some parallel evaluator fixed tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests of random expressions
+    if (runRandomTests("Test Parallel Evaluator Random Expressions", 2000) == ERROR::SUCCESS) {
+        cout << "All parallel evaluator random tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some parallel evaluator random tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests of a large expression
+    if (runLargeTests("Test Parallel Evaluator Large Expression", 1000000) == ERROR::SUCCESS) {
+        cout << "All parallel evaluator large tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some parallel evaluator large tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
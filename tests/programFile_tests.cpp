@@ -0,0 +1,253 @@
+/*
+ * File: programFile_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for the compiled program file format.
+ * A program run from a loaded file must give the same error code and result as run() on the
+ * program that was written, and a damaged file must be refused before anything is run.
+ */
+
+ // Include necessary headers
+#include "../programFile.hpp"
+#include "../compiledExpression.hpp"
+#include "../optimizer.hpp"
+#include "../constants.hpp"
+#include "testData.hpp"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Builds the programs written by the tests: every differential expression, plain and optimized,
+// and a few with variables
+static void buildPrograms(VariableTable& variables, vector<CompiledExpression>& programs) {
+    declareVariable(variables, "a");
+    declareVariable(variables, "b");
+    declareVariable(variables, "price");
+    for (size_t i = 0; i < testData::NUM_DIFFERENTIAL_EXPRESSIONS; ++i) {
+        CompiledExpression program;
+        compile(testData::getDifferentialExpressions(i), variables, program);
+        programs.push_back(program);
+        optimize(program);
+        programs.push_back(program);
+    }
+    const char* withVariables[] = { "a + b * 2", "(price * 3) - 5", "a / (b - 1)", "-(a - price) * b + 1", "a b", "zz + 1" };
+    for (const char* expression : withVariables) {
+        CompiledExpression program;
+        compile(expression, variables, program);
+        programs.push_back(program);
+        optimize(program);
+        programs.push_back(program);
+    }
+}
+
+// Writes programs, loads them back and runs them from the file
+int runRoundTripTests(const char* title, const char* path) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    VariableTable variables;
+    vector<CompiledExpression> programs;
+    buildPrograms(variables, programs);
+    if (writeProgramFile(path, programs.data(), programs.size(), &variables) != PROGRAM_FILE::SUCCESS) {
+        cout << "The file " << path << " could not be written." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    ProgramFile file;
+    int status = loadProgramFile(path, file);
+    if (status != PROGRAM_FILE::SUCCESS || programCount(file) != programs.size()) {
+        cout << "The file was refused with " << status << " or has " << programCount(file) << " programs." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Every program on every row of the shared row values
+    const int* values = testData::getRowValues();
+    const size_t count = testData::NUM_ROW_VALUES;
+    int mismatches = 0;
+    for (size_t p = 0; p < programs.size(); ++p) {
+        for (size_t i = 0; i < count; ++i) {
+            int row[] = { values[i], values[(i + 3) % count], values[(i + 5) % count] };
+            int expectedResult = 0, result = 0;
+            int expectedError = run(programs[p], row, expectedResult);
+            int error = runProgram(file, p, row, result);
+            if (error != expectedError || result != expectedResult) {
+                if (mismatches++ == 0) {
+                    cout << "Program " << p << " failed. Expected error: " << expectedError << " and result: " << expectedResult
+                        << ", Got error: " << error << " and result: " << result << endl;
+                }
+            }
+        }
+    }
+    if (mismatches) return ERROR::PARSE_ERROR;
+
+    // Names come back in their slots, and a missing program is an error
+    int result = 1;
+    if (findProgramVariable(file, "a") != 0 || findProgramVariable(file, "price") != 2 || findProgramVariable(file, "zz") != -1 ||
+        runProgram(file, programs.size(), values, result) != ERROR::PARSE_ERROR || result != 0) {
+        cout << "Names or a missing program were not handled." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // A file without programs or names is valid too
+    if (writeProgramFile(path, 0, 0, 0) != PROGRAM_FILE::SUCCESS || loadProgramFile(path, file) != PROGRAM_FILE::SUCCESS ||
+        programCount(file) != 0 || findProgramVariable(file, "a") != -1) {
+        cout << "An empty file was not handled." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    remove(path);
+    cout << programs.size() << " programs matched run() from the loaded file." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Checks that a damaged image is refused with the expected reason
+static bool checkRefused(const char* what, vector<unsigned char> image, int expected) {
+    vector<uint64_t> aligned((image.size() + 7) / 8);
+    if (!image.empty()) memcpy(aligned.data(), image.data(), image.size());
+    ProgramFile file;
+    int status = openProgramImage(aligned.data(), image.size(), file);
+    if (status == expected && (status == PROGRAM_FILE::SUCCESS || programCount(file) == 0)) return true;
+    cout << "A file with " << what << " gave " << status << " instead of " << expected << endl;
+    return false;
+}
+
+// Writes a new checksum into an image that was changed on purpose
+static void resealImage(vector<unsigned char>& image) {
+    ProgramFileHeader header;
+    memcpy(&header, image.data(), sizeof(header));
+    header.checksum = 0;
+    memcpy(image.data(), &header, sizeof(header));
+    uint64_t hash = programChecksum(image.data(), sizeof(header), 0);
+    header.checksum = programChecksum(image.data() + sizeof(header), image.size() - sizeof(header), hash);
+    memcpy(image.data(), &header, sizeof(header));
+}
+
+// Damages files in every way the loader must notice
+int runCorruptionTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    VariableTable variables;
+    vector<CompiledExpression> programs;
+    buildPrograms(variables, programs);
+    vector<unsigned char> image;
+    serializePrograms(programs.data(), programs.size(), &variables, image);
+    if (!checkRefused("nothing wrong", image, PROGRAM_FILE::SUCCESS)) return ERROR::PARSE_ERROR;
+
+    // Any flipped bit after the header is caught by the checksum
+    mt19937 random(16);
+    for (int i = 0; i < 200; ++i) {
+        vector<unsigned char> damaged = image;
+        damaged[sizeof(ProgramFileHeader) + random() % (image.size() - sizeof(ProgramFileHeader))] ^= (unsigned char)(1 << random() % 8);
+        if (!checkRefused("a flipped bit", damaged, PROGRAM_FILE::BAD_CHECKSUM)) return ERROR::PARSE_ERROR;
+    }
+
+    // The header fields
+    vector<unsigned char> damaged = image;
+    damaged[0] = 'X';
+    if (!checkRefused("a bad magic", damaged, PROGRAM_FILE::BAD_MAGIC)) return ERROR::PARSE_ERROR;
+    if (!checkRefused("too few bytes for a header", vector<unsigned char>(image.begin(), image.begin() + 20), PROGRAM_FILE::BAD_MAGIC)) {
+        return ERROR::PARSE_ERROR;
+    }
+    ProgramFileHeader header;
+    memcpy(&header, image.data(), sizeof(header));
+    ProgramFileHeader changed = header;
+    changed.version = PROGRAM_FILE_VERSION + 1;
+    memcpy(damaged.data(), &changed, sizeof(changed));
+    if (!checkRefused("another version", damaged, PROGRAM_FILE::BAD_VERSION)) return ERROR::PARSE_ERROR;
+    changed = header;
+    changed.byteOrder = 0x04030201;
+    memcpy(damaged.data(), &changed, sizeof(changed));
+    if (!checkRefused("another byte order", damaged, PROGRAM_FILE::BAD_VERSION)) return ERROR::PARSE_ERROR;
+    changed = header;
+    changed.checksum ^= 1;
+    memcpy(damaged.data(), &changed, sizeof(changed));
+    if (!checkRefused("a bad checksum", damaged, PROGRAM_FILE::BAD_CHECKSUM)) return ERROR::PARSE_ERROR;
+    if (!checkRefused("a truncated file", vector<unsigned char>(image.begin(), image.end() - 8), PROGRAM_FILE::MALFORMED)) {
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Offsets that point outside the file, with a checksum that matches
+    damaged = image;
+    changed = header;
+    changed.namesOffset = (uint32_t)image.size() + 8;
+    memcpy(damaged.data(), &changed, sizeof(changed));
+    resealImage(damaged);
+    if (!checkRefused("names past the end", damaged, PROGRAM_FILE::MALFORMED)) return ERROR::PARSE_ERROR;
+    damaged = image;
+    ProgramEntry entry;
+    memcpy(&entry, &damaged[header.entriesOffset], sizeof(entry));
+    entry.codeLength = 1 << 20;
+    memcpy(&damaged[header.entriesOffset], &entry, sizeof(entry));
+    resealImage(damaged);
+    if (!checkRefused("code past the end", damaged, PROGRAM_FILE::MALFORMED)) return ERROR::PARSE_ERROR;
+
+    // Programs that would read outside their stack, temporaries or values, with a checksum that matches
+    struct BadProgram { const char* what; vector<Instruction> code; int maxStack; int tempCount; int variableCount; };
+    const BadProgram bad[] = {
+        { "a stack underflow", { { OPCODE::PUSH, 1 }, { OPCODE::ADD, 0 }, { OPCODE::RETURN, 0 } }, 1, 0, 0 },
+        { "a stack overflow", { { OPCODE::PUSH, 1 }, { OPCODE::PUSH, 2 }, { OPCODE::ADD, 0 }, { OPCODE::RETURN, 0 } }, 1, 0, 0 },
+        { "a variable out of range", { { OPCODE::LOAD, 3 }, { OPCODE::RETURN, 0 } }, 1, 0, 3 },
+        { "more variables than names", { { OPCODE::LOAD, 0 }, { OPCODE::RETURN, 0 } }, 1, 0, 4 },
+        { "a temporary out of range", { { OPCODE::PUSH, 1 }, { OPCODE::STORE, 1 }, { OPCODE::RETURN, 0 } }, 1, 1, 0 },
+        { "an unknown opcode", { { OPCODE::PUSH, 1 }, { 99, 0 }, { OPCODE::RETURN, 0 } }, 1, 0, 0 },
+        { "no return at the end", { { OPCODE::PUSH, 1 }, { OPCODE::NEG, 0 } }, 1, 0, 0 },
+        { "a huge stack", { { OPCODE::PUSH, 1 }, { OPCODE::RETURN, 0 } }, 1 << 30, 0, 0 },
+        { "no code", {}, 0, 0, 0 },
+    };
+    for (const BadProgram& program : bad) {
+        CompiledExpression compiled;
+        compiled.code = program.code;
+        compiled.maxStack = program.maxStack;
+        compiled.tempCount = program.tempCount;
+        compiled.variableCount = program.variableCount;
+        vector<CompiledExpression> withBad = programs;
+        withBad.push_back(compiled);
+        serializePrograms(withBad.data(), withBad.size(), &variables, damaged);
+        if (!checkRefused(program.what, damaged, PROGRAM_FILE::MALFORMED)) return ERROR::PARSE_ERROR;
+    }
+
+    // A file that does not exist
+    ProgramFile file;
+    if (loadProgramFile("no such directory/no such file.prog", file) != PROGRAM_FILE::IO_ERROR) {
+        cout << "A missing file was not reported." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    cout << "Every damaged file was refused." << endl;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running Program File Tests..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    // Tests of writing and loading
+    if (runRoundTripTests("Test Program File Round Trip", "programFile_tests.prog") == ERROR::SUCCESS) {
+        cout << "All program file round trip tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some program file round trip tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests of damaged files
+    if (runCorruptionTests("Test Program File Corruption") == ERROR::SUCCESS) {
+        cout << "All program file corruption tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some program file corruption tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
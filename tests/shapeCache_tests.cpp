@@ -0,0 +1,206 @@
+/*
+ * File: shapeCache_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for the shape cache.
+ * Evaluating with the plan of a shape, one expression at a time or in lanes, must give the same
+ * error code and result as evaluate(), for every shape and every set of numbers.
+ */
+
+ // Include necessary headers
+#include "../shapeCache.hpp"
+#include "../expressionEvaluator.hpp"
+#include "../constants.hpp"
+#include "testData.hpp"
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Compares shapeEvaluate() and shapeEvaluateBatch() with evaluate() on a set of expressions.
+// Returns the number of mismatches.
+static int compareExpressions(ShapeCache& cache, const vector<string>& expressions) {
+    vector<const char*> pointers;
+    for (const string& expression : expressions) pointers.push_back(expression.c_str());
+    vector<int> results(expressions.size(), 7), errors(expressions.size(), 7);
+    size_t failures = shapeEvaluateBatch(cache, pointers.data(), pointers.size(), results.data(), errors.data());
+
+    int mismatches = 0;
+    size_t expectedFailures = 0;
+    for (size_t i = 0; i < expressions.size(); ++i) {
+        int expectedResult = 0, result = 0;
+        int expectedError = evaluate(pointers[i], expectedResult);
+        int error = shapeEvaluate(cache, pointers[i], result);
+        expectedFailures += expectedError != ERROR::SUCCESS;
+        if (error != expectedError || result != expectedResult || errors[i] != expectedError || results[i] != expectedResult) {
+            if (mismatches++ < 3) {
+                cout << "'" << expressions[i] << "' failed. Expected error: " << expectedError << " and result: " << expectedResult
+                    << ", Got error: " << error << " and result: " << result << ", in lanes error: " << errors[i]
+                    << " and result: " << results[i] << endl;
+            }
+        }
+    }
+    if (failures != expectedFailures) {
+        cout << "The batch counted " << failures << " failures instead of " << expectedFailures << endl;
+        mismatches++;
+    }
+    return mismatches;
+}
+
+// Compares the cache with evaluate() on the fixed expressions and the quirks of the evaluator
+int runFixedTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    vector<string> expressions;
+    for (size_t i = 0; i < testData::NUM_DIFFERENTIAL_EXPRESSIONS; ++i) expressions.push_back(testData::getDifferentialExpressions(i));
+    for (size_t i = 0; i < testData::NUM_TEST_EXPRESSIONS; ++i) expressions.push_back(testData::getValidExpressions(i));
+    for (size_t i = 0; i < 10; ++i) expressions.push_back(testData::getInvalidExpressions(i));
+
+    // Shapes whose answer depends on more than their shape, and numbers that overflow
+    const char* quirks[] = { "12", "1 2", "(12)", "((1 2))", "", "   ", "-", "()", "1+2 3", "20 +", "(((1 2)))", "(((1 2)) + 3)",
+        "2(3)", "1 + a", "1 _0", "2147483648 + 0", "-2147483648 + 1", "99999999999 * 2", "1 / 0 + (2", "0 / 0", "5 / (3 - 3)" };
+    for (const char* expression : quirks) expressions.push_back(expression);
+
+    ShapeCache cache;
+    int mismatches = compareExpressions(cache, expressions);
+    if (mismatches) return ERROR::PARSE_ERROR;
+
+    // The same shapes again are all hits
+    ShapeCacheStats before = getShapeCacheStats(cache);
+    compareExpressions(cache, expressions);
+    ShapeCacheStats after = getShapeCacheStats(cache);
+    if (after.misses != before.misses || after.compiles != before.compiles || after.shapes != before.shapes || after.bypassed == before.bypassed) {
+        cout << "Known shapes were compiled again." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // A partial group: the unused lanes compute on ones, (1 + 1)^31 is INT_MIN and 1 - 1 - 1 is -1,
+    // which must not trap in a lane no row uses
+    string padded;
+    for (int i = 0; i < 31; ++i) padded += i ? " * (1 + 2)" : "(1 + 2)";
+    padded += " / (5 - 1 - 1)";
+    ShapeCache paddedCache;
+    if (compareExpressions(paddedCache, { padded, padded })) return ERROR::PARSE_ERROR;
+
+    // Shapes and numbers
+    string shape;
+    vector<int> literals;
+    if (!expressionShape(" (12 * 13) +\t(14 / 15)", shape, literals) || shape != "(#*#)+(#/#)" || literals != vector<int>{ 12, 13, 14, 15 } ||
+        !expressionShape("1 2 - 3", shape, literals) || shape != "##-#" || expressionShape("(12)", shape, literals) ||
+        expressionShape("1 + x", shape, literals)) {
+        cout << "The shape '" << shape << "' is wrong." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    cout << after.shapes << " shapes matched evaluate(), " << after.bypassed << " expressions were bypassed." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Builds an expression of a random shape: the numbers are placeholders filled in by fillShape()
+static void randomShape(mt19937& random, int depth, string& out) {
+    int terms = 1 + random() % 4;
+    for (int t = 0; t < terms; ++t) {
+        if (t > 0) { out += ' '; out += "+-*/"[random() % 4]; out += ' '; }
+        if (random() % 6 == 0) out += '-';
+        if (random() % 4 == 0 && depth < 3) { out += '('; randomShape(random, depth + 1, out); out += ')'; }
+        else out += '#';
+    }
+}
+
+// Fills the placeholders of a shape with small numbers, zero often enough to divide by it
+static string fillShape(mt19937& random, const string& shape) {
+    string out;
+    for (char ch : shape) {
+        if (ch == '#') out += to_string(random() % 5 == 0 ? 0 : random() % 50);
+        else out += ch;
+    }
+    return out;
+}
+
+// Compares the cache with evaluate() on many expressions of a few random shapes
+int runRandomTests(const char* title, int shapes, int perShape) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    mt19937 random(17);
+    vector<string> expressions;
+    for (int s = 0; s < shapes; ++s) {
+        string shape;
+        randomShape(random, 0, shape);
+        for (int i = 0; i < perShape; ++i) expressions.push_back(fillShape(random, shape));
+    }
+    shuffle(expressions.begin(), expressions.end(), random);
+
+    // A small cache drops its plans often, and must still give the same answers
+    ShapeCache cache;
+    initShapeCache(cache, shapes / 4);
+    if (compareExpressions(cache, expressions)) return ERROR::PARSE_ERROR;
+    ShapeCacheStats stats = getShapeCacheStats(cache);
+    if (stats.evictions == 0) {
+        cout << "The cache was never full." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Shapes seen only once never fill the plans, and must not pile up either
+    ShapeCache small;
+    initShapeCache(small, 8);
+    string chain = "1";
+    for (int i = 0; i < 200; ++i) {
+        chain += " + 1";
+        int result = 0;
+        if (shapeEvaluate(small, chain.c_str(), result) != ERROR::SUCCESS || result != i + 2) {
+            cout << "A chain of " << i + 2 << " ones gave " << result << endl;
+            return ERROR::PARSE_ERROR;
+        }
+        if (small.seen.size() > 8) {
+            cout << small.seen.size() << " shapes seen once are kept by a cache of 8." << endl;
+            return ERROR::PARSE_ERROR;
+        }
+    }
+
+    // A cache large enough for every shape compiles each one once
+    initShapeCache(cache, 0);
+    if (compareExpressions(cache, expressions)) return ERROR::PARSE_ERROR;
+    stats = getShapeCacheStats(cache);
+    if (stats.evictions != 0 || stats.compiles > (size_t)shapes) {
+        cout << "Shapes were compiled " << stats.compiles << " times for " << shapes << " shapes." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+    cout << expressions.size() << " expressions of " << shapes << " shapes matched evaluate(), "
+        << stats.hits << " hits and " << stats.compiles << " plans compiled." << endl;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running Shape Cache Tests..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    // Tests of the fixed expressions
+    if (runFixedTests("Test Shape Cache Fixed Expressions") == ERROR::SUCCESS) {
+        cout << "All shape cache fixed tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some shape cache fixed tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests of random shapes
+    if (runRandomTests("Test Shape Cache Random Shapes", 200, 50) == ERROR::SUCCESS) {
+        cout << "All shape cache random tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some shape cache random tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
@@ -0,0 +1,258 @@
+/*
+ * File: simdKernels_tests.cpp
+ * Author: Alex Turner
+ * Description: This file contains the functional unit tests for the vectorized scanning kernels.
+ * Every level the processor supports is compared with the scalar level, at every alignment,
+ * on the differential expressions, on random text and right before an unreadable page.
+ */
+
+ // Include necessary headers
+#include "../simdKernels.hpp"
+#include "../expressionEvaluator.hpp"
+#include "../constants.hpp"
+#include "testData.hpp"
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// What the kernels and the evaluator answer for one text
+struct Answers
+{
+    int valid = 0;           // isValidExpression()
+    int error = 0;           // evaluate()
+    int result = 0;          // Result of evaluate()
+    int viewError = 0;       // evaluate() on a buffer without NUL
+    int viewResult = 0;      // Result of evaluate() on a buffer without NUL
+    size_t skipped = 0;      // Characters skipped by skipSpacesRun()
+    size_t skippedView = 0;  // Characters skipped by the bounded skipSpacesRun()
+
+    bool operator==(const Answers& other) const {
+        return valid == other.valid && error == other.error && result == other.result && viewError == other.viewError &&
+            viewResult == other.viewResult && skipped == other.skipped && skippedView == other.skippedView;
+    }
+};
+
+// Runs everything on a NUL terminated text stored at 'text', with its length
+static Answers answer(const char* text, size_t length) {
+    Answers answers;
+    answers.valid = isValidExpression(text);
+    answers.error = evaluate(text, answers.result);
+    answers.viewError = evaluate(text, length, answers.viewResult);
+    answers.skipped = skipSpacesRun(text) - text;
+    answers.skippedView = skipSpacesRun(text, text + length) - text;
+    return answers;
+}
+
+// Compares every supported level with the scalar level for one text, placed at every offset of
+// a 64 byte aligned buffer. Returns the number of mismatches.
+static int compareLevels(const string& text) {
+    alignas(64) static char buffer[64 + 4096 + 1];
+    if (text.size() > 4096) return 0;
+
+    setSimdLevel(SIMD_LEVEL::SCALAR);
+    memcpy(buffer, text.c_str(), text.size() + 1);
+    Answers expected = answer(buffer, text.size());
+
+    int mismatches = 0;
+    for (int level = SIMD_LEVEL::SWAR; level <= SIMD_LEVEL::AVX2; ++level) {
+        if (setSimdLevel(level) != level) break;
+        for (size_t offset = 0; offset < 64; ++offset) {
+            // Fill around the text with characters the kernels must not look at
+            memset(buffer, '+', sizeof(buffer));
+            memcpy(buffer + offset, text.c_str(), text.size() + 1);
+            if (answer(buffer + offset, text.size()) == expected) continue;
+            if (mismatches++ == 0) {
+                cout << "'" << text << "' at offset " << offset << " differs with " << simdLevelName(level) << endl;
+            }
+        }
+    }
+    return mismatches;
+}
+
+// Builds random text, mostly made of expression characters
+static string randomText(mt19937& random) {
+    static const char alphabet[] = "0123456789999+-*/()((  ))\t\n\r\f\v     a.\x80\xff";
+    string text;
+    size_t length = random() % 120;
+    for (size_t i = 0; i < length; ++i) text += alphabet[random() % (sizeof(alphabet) - 1)];
+    return text;
+}
+
+// Compares the levels on the differential expressions and some long runs
+int runFixedTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    vector<string> texts;
+    for (size_t i = 0; i < testData::NUM_DIFFERENTIAL_EXPRESSIONS; ++i) texts.push_back(testData::getDifferentialExpressions(i));
+
+    // Long whitespace runs, long numbers (which wrap around) and parentheses across blocks
+    texts.push_back(string(100, ' ') + "1 +" + string(70, '\t') + "2" + string(40, '\n'));
+    texts.push_back("12345678 + 123456789012 - 98765432109876543210");
+    texts.push_back("4294967295 * 1 + 2147483648 - 00000000000000000007");
+    texts.push_back(string(50, '(') + "1" + string(50, ')') + " + 2");
+    texts.push_back(string(40, '(') + "1" + string(41, ')'));
+    texts.push_back("1 + 2" + string(70, ' ') + ")");
+    texts.push_back(string(33, '9'));
+
+    for (const string& text : texts) {
+        if (compareLevels(text) != 0) return ERROR::PARSE_ERROR;
+    }
+    cout << texts.size() << " texts matched the scalar level at every offset." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Compares the levels on random text
+int runRandomTests(const char* title, size_t iter) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    mt19937 random(9);
+    for (size_t i = 0; i < iter; ++i) {
+        if (compareLevels(randomText(random)) != 0) return ERROR::PARSE_ERROR;
+    }
+    cout << iter << " random texts matched the scalar level at every offset." << endl;
+    return ERROR::SUCCESS;
+}
+
+// Runs the kernels on texts that end right before an unreadable page, which would crash if a
+// kernel read past the NUL (or past the end of the buffer) across the page boundary
+int runPageBoundaryTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+#ifdef _WIN32
+    cout << "Skipped, no mprotect on this platform." << endl;
+    return ERROR::SUCCESS;
+#else
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    char* pages = (char*)mmap(0, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pages == MAP_FAILED || mprotect(pages + page, page, PROT_NONE) != 0) {
+        cout << "Could not map a guard page." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    const char* texts[] = { "1 + 2", "12345678901", "   ", "7", "(1+2)*3      ", "2 * 3 - 4 / 5 + 66666" };
+    int checks = 0;
+    for (int level = SIMD_LEVEL::SCALAR; level <= SIMD_LEVEL::AVX2; ++level) {
+        if (setSimdLevel(level) != level) break;
+        for (const char* text : texts) {
+            size_t length = strlen(text);
+
+            // NUL terminated, the NUL is the last readable byte
+            char* copy = pages + page - length - 1;
+            memcpy(copy, text, length + 1);
+            int result = 0;
+            isValidExpression(copy);
+            evaluate(copy, result);
+            skipSpacesRun(copy);
+
+            // Not NUL terminated, the last character is the last readable byte
+            copy = pages + page - length;
+            memcpy(copy, text, length);
+            evaluate(copy, length, result);
+            skipSpacesRun(copy, copy + length);
+            ++checks;
+        }
+    }
+    munmap(pages, 2 * page);
+    cout << checks << " texts evaluated against a guard page." << endl;
+    return ERROR::SUCCESS;
+#endif
+}
+
+// Checks parseDigits() against the one digit at a time loop, including wrap-around
+int runDigitTests(const char* title) {
+    cout << endl << "----------------------------------------" << endl;
+    cout << "Running test: " << title << endl;
+    cout << "----------------------------------------" << endl;
+
+    mt19937 random(10);
+    for (int level = SIMD_LEVEL::SCALAR; level <= SIMD_LEVEL::AVX2; ++level) {
+        if (setSimdLevel(level) != level) break;
+        for (int i = 0; i < 20000; ++i) {
+            string digits;
+            size_t length = 1 + random() % 30;
+            for (size_t d = 0; d < length; ++d) digits += (char)('0' + random() % 10);
+            string text = digits + " + 1";
+
+            unsigned expected = 0;
+            for (char ch : digits) expected = expected * 10 + (unsigned)(ch - '0');
+
+            const char* cur = text.c_str();
+            int value = parseDigits(cur);
+            const char* bounded = text.c_str();
+            int boundedValue = parseDigits(bounded, text.c_str() + length);
+            if (value != (int)expected || cur != text.c_str() + length || boundedValue != (int)expected ||
+                bounded != text.c_str() + length) {
+                cout << "'" << digits << "' converted to " << value << ", expected " << (int)expected
+                    << " with " << simdLevelName(level) << endl;
+                return ERROR::PARSE_ERROR;
+            }
+        }
+    }
+    cout << "Digit runs matched the scalar conversion." << endl;
+    return ERROR::SUCCESS;
+}
+
+// This is the main function that runs all the tests
+int main(int, char**) {
+
+    int best = getSimdLevel();
+    cout << endl;
+    cout << "----------------------------------------" << endl;
+    cout << "Running SIMD Kernel Tests (best level: " << simdLevelName(best) << ")..." << endl;
+    cout << "----------------------------------------" << endl;
+
+    // Tests on fixed texts
+    if (runFixedTests("Test Kernels Fixed Texts") == ERROR::SUCCESS) {
+        cout << "All kernel fixed tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some kernel fixed tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests on random texts
+    if (runRandomTests("Test Kernels Random Texts", 5000) == ERROR::SUCCESS) {
+        cout << "All kernel random tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some kernel random tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests at the end of a page
+    if (runPageBoundaryTests("Test Kernels Page Boundary") == ERROR::SUCCESS) {
+        cout << "All kernel page boundary tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some kernel page boundary tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    // Tests of the digit conversion
+    if (runDigitTests("Test Kernels Digit Runs") == ERROR::SUCCESS) {
+        cout << "All kernel digit tests passed successfully!" << endl;
+    }
+    else {
+        cout << "Some kernel digit tests failed." << endl;
+        return ERROR::PARSE_ERROR;
+    }
+
+    setSimdLevel(best);
+    cout << endl;
+    cout << "All tests passed successfully!" << endl;
+    return 0;
+}
@@ -6,7 +6,10 @@
 
 #ifndef TEST_DATA_HPP  
 #define TEST_DATA_HPP  
-#endif  
+
+#include <cstddef>
+#include <random>
+#include <string>
 
 // Constants for test data used in the expression evaluator tests
 namespace testData {  
@@ -75,4 +78,122 @@ namespace testData {
         };
         return expectedSpaces[index];
 	}
-}
\ No newline at end of file
+
+	// Number of expressions used to compare alternative evaluators against evaluate()
+	static const size_t NUM_DIFFERENTIAL_EXPRESSIONS = 40;
+
+	// Function to get an expression used to compare alternative evaluators against evaluate().
+	// These cover the corners of parse(): left to right evaluation, operator chains, signs,
+	// trailing characters and every error code, including errors that happen at run time.
+    static const char* getDifferentialExpressions(size_t index) {
+        static const char* expressions[] = {
+            "1 + 3 * 4",                    // Left to right evaluation
+            "2 * 3 + 4",                    // Chain followed by '+'
+            "2 * 3 - 4",                    // Chain followed by '-'
+            "1 - 2 * 3",                    // Subtraction followed by a chain
+            "2 * 3 * 4 / 5 + 6 - 7",        // Long chain followed by '+'
+            "8 / 2 / 2",                    // Chain of divisions
+            "(2) * (3) + (1)",              // Chain of parentheses
+            "-(4 * 5) - -(6 / 2)",          // Signed parentheses
+            "- ( - 3 )",                    // Nested signs
+            "((((7))))",                    // Deep nesting
+            "7 / -2",                       // Truncating division
+            "-7 / 2 * 3 + 1",               // Truncating division in a chain
+            "100 * (2 + 3 * 4) / 7 - 9",    // Mixed
+            "\t 12 *\n 13 \r+ \f14 \v",     // Every whitespace character
+            "2147483647 + 1",               // Wraps around
+            "1 + 2 3",                      // Trailing number (PARSE_ERROR with result)
+            "(1 + 2) 3",                    // Trailing number after parenthesis
+            "(1)(2)",                       // Two numbers without an operator
+            "12",                           // Single number with more than one digit
+            "",                             // Empty expression
+            "   ",                          // Only whitespace
+            "1 / 0",                        // Division by zero
+            "1 / (2 - 2) + 3",              // Division by zero in a chain
+            "5 / 0 + + 1",                  // Division by zero before a syntax error
+            "1 + + 2 / 0",                  // Syntax error before a division by zero
+            "1 + (2 * 3",                   // Unmatched parenthesis
+            "(1 + 2))",                     // Unmatched closing parenthesis
+            "(1 + ) 2",                     // Closing parenthesis where a number is expected
+            "(1 2)",                        // Missing closing parenthesis
+            "1 + a",                        // Invalid character
+            "+ 1",                          // Unary plus is not supported
+            "- - 1",                        // Double sign is not supported
+            "1 -",                          // Missing right-hand side
+            "1 *",                          // Missing right-hand side in a chain
+            "()",                           // Empty parentheses
+            "-",                            // Operator only
+            "0 * 0 / 1",                    // Zero dividend
+            "3 * (4 + 5 * 6) - (7 / (8 - 1)) * 2 + 1", // Everything together
+            "1 + (2 / 0) 3",                // Division by zero before trailing characters
+            "9 - 3 / 3 + 2 * 2 - 1"         // Alternating chains
+        };
+        return expressions[index];
+    }
+
+	// Number of expressions that use variables
+	static const size_t NUM_VARIABLE_EXPRESSIONS = 10;
+
+	// Variable names, and the values bound to them, used by the variable expressions
+	static const size_t NUM_VARIABLES = 4;
+	static const char* getVariableNames(size_t index) {
+		static const char* names[] = { "price", "qty", "discount", "x_1" };
+		return names[index];
+	}
+	static const int* getVariableValues() {
+		static const int values[] = { 10, 3, 5, 0 };
+		return values;
+	}
+
+	// Function to get an expression that uses variables by index
+    static const char* getVariableExpressions(size_t index) {
+        static const char* expressions[] = {
+            "price * qty - discount",       // Chain followed by '-' (30 - 3 - 5)
+            "price + qty * discount",       // Left to right evaluation
+            "(price - discount) / qty",     // Parenthesis and truncating division
+            "-price + -(qty)",              // Signed variables
+            "x_1",                          // Single variable
+            "price / x_1",                  // Division by zero
+            "price + unknown",              // Unknown variable
+            "price qty",                    // Two names without an operator
+            "2price",                       // Number followed by a name
+            "price * (qty + 1) - x_1"       // Mixed with literals
+        };
+        return expressions[index];
+    }
+
+	// Function to get the expected error code of a variable expression by index
+    static const int getVariableExpectedErrors(size_t index) {
+        static const int expectedErrors[] = { 0, 0, 0, 0, 0, 4, 8, 7, 7, 0 };
+        return expectedErrors[index];
+    }
+
+	// Function to get the expected result of a variable expression by index
+    static const int getVariableExpectedResults(size_t index) {
+        static const int expectedResults[] = { 22, 65, 1, -13, 0, 0, 0, 0, 0, 36 };
+        return expectedResults[index];
+    }
+
+	// Values bound to the variables a, b and c of the compiled expression tests, hitting zero divisors and signs.
+	// They stay small, so that no random variable expression divides INT_MIN by -1 (which traps).
+	static const size_t NUM_ROW_VALUES = 7;
+	static const int* getRowValues() {
+		static const int values[] = { 0, 1, -1, 2, -3, 7, 100 };
+		return values;
+	}
+
+	// Builds a random expression over a, b, c and small literals, with signs and nesting
+	static void randomVariableExpression(std::mt19937& random, int depth, std::string& out) {
+		int terms = 1 + random() % 4;
+		for (int t = 0; t < terms; ++t) {
+			if (t > 0) out += " +-*/"[1 + random() % 4];
+			if (random() % 5 == 0) out += '-';
+			int pick = random() % 10;
+			if (pick < 2 && depth < 4) { out += '('; randomVariableExpression(random, depth + 1, out); out += ')'; }
+			else if (pick < 6) out += "abc"[random() % 3];
+			else out += std::to_string(random() % 4);
+		}
+	}
+}
+
+#endif // TEST_DATA_HPP
@@ -0,0 +1,185 @@
+/*
+ * File: threadPool.cpp
+ * Author: Alex Turner
+ * Description: This file contains the implementation of the work stealing thread pool.
+ * The worker threads are created on first use and sleep between calls to parallelFor().
+ */
+
+// Include necessary headers
+#include "threadPool.hpp"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// The range of items a thread still has to run.
+// Each range sits on its own cache line, so threads taking items do not slow each other down.
+struct alignas(64) WorkRange
+{
+    std::mutex lock;  // Protects begin and end
+    size_t begin = 0; // First item left
+    size_t end = 0;   // One past the last item left
+};
+
+// The process wide pool used by parallelFor()
+struct ThreadPool
+{
+    std::mutex busy;                        // Held while a call to parallelFor() uses the pool
+    std::mutex lock;                        // Protects the fields below
+    std::condition_variable wake;           // Signals the workers that a new job is ready
+    std::condition_variable done;           // Signals the caller that the workers are finished
+    std::vector<std::thread> workers;       // Worker threads, the caller is thread 0
+    std::unique_ptr<WorkRange[]> ranges;    // One range per thread of the current job
+    unsigned rangeCount = 0;                // Size of 'ranges'
+    const std::function<void(size_t, size_t)>* body = 0; // Work of the current job
+    size_t grain = 1;                       // Items taken at a time
+    unsigned active = 0;                    // Threads taking part in the current job
+    unsigned generation = 0;                // Incremented for every job
+    unsigned running = 0;                   // Workers still busy with the current job
+    bool stopping = false;                  // Set when the process exits
+
+    ~ThreadPool();
+};
+
+// Takes the next 'grain' items of a range, returns false if it is empty
+static bool takeItems(WorkRange& range, size_t grain, size_t& begin, size_t& end)
+{
+    std::lock_guard<std::mutex> guard(range.lock);
+    if (range.begin >= range.end) return false;
+    begin = range.begin;
+    end = (range.end - range.begin > grain) ? range.begin + grain : range.end;
+    range.begin = end;
+    return true;
+}
+
+// Steals half of the items left in the range of another thread and makes them our own.
+// Returns false when every other range is empty.
+static bool stealItems(ThreadPool& pool, unsigned self)
+{
+    for (unsigned k = 1; k < pool.active; ++k) {
+        WorkRange& victim = pool.ranges[(self + k) % pool.active];
+        size_t begin = 0, end = 0;
+        {
+            std::lock_guard<std::mutex> guard(victim.lock);
+            size_t remaining = victim.end > victim.begin ? victim.end - victim.begin : 0;
+            if (remaining == 0) continue;
+
+            // Take the upper half, the victim keeps working on the lower half
+            begin = victim.end - (remaining + 1) / 2;
+            end = victim.end;
+            victim.end = begin;
+        }
+
+        // Only one lock is ever held at a time, so threads cannot deadlock
+        WorkRange& own = pool.ranges[self];
+        std::lock_guard<std::mutex> guard(own.lock);
+        own.begin = begin;
+        own.end = end;
+        return true;
+    }
+    return false;
+}
+
+// Runs items until no thread has any left
+static void runWorker(ThreadPool& pool, unsigned self)
+{
+    size_t begin = 0, end = 0;
+    while (true) {
+        if (takeItems(pool.ranges[self], pool.grain, begin, end)) (*pool.body)(begin, end);
+        else if (!stealItems(pool, self)) break;
+    }
+}
+
+// Main loop of a worker thread, it sleeps until a job needs it
+static void workerLoop(ThreadPool& pool, unsigned self)
+{
+    unsigned seen = 0;
+    std::unique_lock<std::mutex> guard(pool.lock);
+    while (true) {
+        pool.wake.wait(guard, [&] { return pool.stopping || pool.generation != seen; });
+        if (pool.stopping) return;
+        seen = pool.generation;
+        if (self >= pool.active) continue; // Not needed for this job
+
+        guard.unlock();
+        runWorker(pool, self);
+        guard.lock();
+        if (--pool.running == 0) pool.done.notify_one();
+    }
+}
+
+// Stops and joins the workers when the process exits
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+// Returns the process wide pool
+static ThreadPool& getPool()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+// Returns the number of threads used when 0 is passed to parallelFor().
+unsigned defaultThreadCount()
+{
+    unsigned count = std::thread::hardware_concurrency();
+    return count ? count : 1;
+}
+
+// Runs body(begin, end) over the items [0, count) on up to 'threads' threads.
+void parallelFor(size_t count, unsigned threads, size_t grain, const std::function<void(size_t, size_t)>& body)
+{
+    if (count == 0) return;
+    if (threads == 0) threads = defaultThreadCount();
+    if (grain == 0) grain = 1;
+
+    // No point in waking more threads than there are items
+    if (threads > count) threads = (unsigned)count;
+
+    ThreadPool& pool = getPool();
+    std::unique_lock<std::mutex> busy(pool.busy, std::try_to_lock);
+    if (threads == 1 || !busy.owns_lock()) {
+        // Single thread, or the pool is used by another call: run everything here
+        for (size_t begin = 0; begin < count; begin += grain) body(begin, begin + grain < count ? begin + grain : count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(pool.lock);
+
+        // The workers are idle here, so the ranges and the thread list can grow safely
+        if (pool.rangeCount < threads) {
+            pool.ranges.reset(new WorkRange[threads]);
+            pool.rangeCount = threads;
+        }
+        while (pool.workers.size() + 1 < threads) {
+            unsigned self = (unsigned)pool.workers.size() + 1;
+            pool.workers.emplace_back(workerLoop, std::ref(pool), self);
+        }
+
+        // Give every thread an equal share of the items
+        for (unsigned t = 0; t < threads; ++t) {
+            pool.ranges[t].begin = count * t / threads;
+            pool.ranges[t].end = count * (t + 1) / threads;
+        }
+        pool.body = &body;
+        pool.grain = grain;
+        pool.active = threads;
+        pool.running = threads - 1;
+        ++pool.generation;
+    }
+    pool.wake.notify_all();
+
+    // The calling thread works too, then waits for the others
+    runWorker(pool, 0);
+    std::unique_lock<std::mutex> guard(pool.lock);
+    pool.done.wait(guard, [&] { return pool.running == 0; });
+}
@@ -0,0 +1,26 @@
+/*
+ * File: threadPool.hpp
+ * Author: Alex Turner
+ * Description: This file contains the declarations of the work stealing thread pool.
+ * It is used to spread batches of independent work items over several cores.
+ */
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <cstddef>
+#include <functional>
+
+// Runs body(begin, end) over the items [0, count) on up to 'threads' threads.
+// Every thread starts with an equal share of the items and takes them 'grain' at a time;
+// a thread that runs out of items steals half of the remaining items of another thread,
+// so short and very long items balance across cores.
+// The calling thread takes part in the work and the call returns when every item is done.
+// 'threads' equal to 0 uses one thread per hardware core.
+// If the pool is already busy (for example a nested call), the items run on the calling thread.
+void parallelFor(size_t count, unsigned threads, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+// Returns the number of threads used when 0 is passed to parallelFor().
+unsigned defaultThreadCount();
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,131 @@
+/*
+ * File: exprCompile.cpp
+ * Author: Alex Turner
+ * Description: This file contains the exprCompile command line tool.
+ * It compiles a file with one expression per line into a program file (see programFile.hpp),
+ * one program per line, that exprEval -p then runs without parsing a single expression.
+ * Lines are split exactly like exprEval splits them, so both give the same answer for a line.
+ */
+
+// Include necessary headers
+#include "../programFile.hpp"
+#include "../compiledExpression.hpp"
+#include "../expressionEvaluator.hpp"
+#include "../optimizer.hpp"
+#include "../constants.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Options given on the command line
+struct Options
+{
+    const char* input = 0;     // Input file, null or "-" for standard input
+    const char* output = 0;    // Program file to write
+    const char* variables = 0; // Comma separated variable names, null for none
+    bool optimize = false;     // Optimize every program
+};
+
+// Prints how to use the tool
+static void printUsage()
+{
+    fprintf(stderr,
+        "Usage: exprCompile [-O] [-v names] -o output [input]\n"
+        "Compiles one expression per line of 'input' (standard input when missing or '-') into a program file.\n"
+        "  -O          optimize every program\n"
+        "  -v names    comma separated variable names the expressions may use, in slot order\n"
+        "  -o output   the program file to write\n"
+        "Run the file with: exprEval -p output\n");
+}
+
+// Reads a whole stream
+static bool readAll(FILE* in, std::string& text)
+{
+    char block[1 << 16];
+    size_t read;
+    while ((read = fread(block, 1, sizeof(block), in)) > 0) text.append(block, read);
+    return ferror(in) == 0;
+}
+
+// Compiles one line. A line holding a NUL cannot be handed to compile(), which stops at the NUL,
+// so its answer is worked out now and the program just returns it.
+static void compileLine(const char* begin, size_t length, const VariableTable& variables, bool optimizeIt,
+    std::string& line, CompiledExpression& program)
+{
+    if (memchr(begin, '\0', length)) {
+        int result = 0;
+        int errorCode = evaluate(begin, length, result);
+        program = CompiledExpression();
+        program.code.push_back({ OPCODE::PUSH, result });
+        program.code.push_back({ OPCODE::RETURN, errorCode });
+        program.maxStack = 1;
+        program.errorCode = errorCode;
+        return;
+    }
+    line.assign(begin, length);
+    compile(line.c_str(), variables, program);
+    if (optimizeIt) optimize(program);
+}
+
+// Entry point of the tool
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-O") == 0) options.optimize = true;
+        else if (strcmp(argv[i], "-v") == 0 && i + 1 < argc) options.variables = argv[++i];
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) options.output = argv[++i];
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) { printUsage(); return 0; }
+        else if (argv[i][0] == '-' && argv[i][1] != '\0') { printUsage(); return 2; }
+        else if (!options.input) options.input = argv[i];
+        else { printUsage(); return 2; }
+    }
+    if (!options.output) { printUsage(); return 2; }
+
+    // Variable names, in slot order
+    VariableTable variables;
+    if (options.variables) {
+        std::string names = options.variables;
+        size_t start = 0;
+        while (start <= names.size()) {
+            size_t comma = names.find(',', start);
+            if (comma == std::string::npos) comma = names.size();
+            std::string name = names.substr(start, comma - start);
+            if (!name.empty()) declareVariable(variables, name.c_str());
+            start = comma + 1;
+        }
+    }
+
+    // The whole input
+    std::string text;
+    bool ok;
+    if (!options.input || strcmp(options.input, "-") == 0) ok = readAll(stdin, text);
+    else {
+        FILE* in = fopen(options.input, "rb");
+        if (!in) { perror(options.input); return 1; }
+        ok = readAll(in, text);
+        fclose(in);
+    }
+    if (!ok) { perror(options.input ? options.input : "stdin"); return 1; }
+
+    // One program per line, the last line may not end with a newline
+    std::vector<CompiledExpression> programs;
+    std::string line;
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    while (begin < end) {
+        const char* newline = (const char*)memchr(begin, '\n', end - begin);
+        const char* lineEnd = newline ? newline : end;
+        programs.emplace_back();
+        compileLine(begin, (size_t)(lineEnd - begin), variables, options.optimize, line, programs.back());
+        begin = newline ? newline + 1 : end;
+    }
+
+    if (writeProgramFile(options.output, programs.data(), programs.size(), &variables) != PROGRAM_FILE::SUCCESS) {
+        perror(options.output);
+        return 1;
+    }
+    return 0;
+}
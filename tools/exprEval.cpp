@@ -0,0 +1,295 @@
+/*
+ * File: exprEval.cpp
+ * Author: Alex Turner
+ * Description: This file contains the exprEval command line tool.
+ * It evaluates a file with one expression per line and writes one answer per line.
+ * Files are memory mapped and the lines are evaluated where they are, without copying them;
+ * standard input is read in large blocks. Lines can be evaluated on several threads, and the
+ * answers are always written in the order of the lines. With -p the input is a program file
+ * written by exprCompile, whose programs are run straight from the mapped file.
+ */
+
+// Include necessary headers
+#include "../expressionEvaluator.hpp"
+#include "../programFile.hpp"
+#include "../threadPool.hpp"
+#include "../constants.hpp"
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Size of the blocks read from standard input
+static const size_t READ_BLOCK_SIZE = 16 << 20;
+
+// Size of the pieces of input evaluated by one thread at a time
+static const size_t CHUNK_SIZE = 1 << 20;
+
+// Options given on the command line
+struct Options
+{
+    const char* input = 0;  // Input file, null or "-" for standard input
+    const char* output = 0; // Output file, null for standard output
+    bool binary = false;    // Write binary records instead of text
+    bool programs = false;  // The input is a program file written by exprCompile
+    unsigned threads = 1;   // Threads evaluating lines (0 = one per core)
+};
+
+// Prints how to use the tool
+static void printUsage()
+{
+    fprintf(stderr,
+        "Usage: exprEval [-b] [-p] [-j threads] [-o output] [input]\n"
+        "Evaluates one expression per line of 'input' (standard input when missing or '-').\n"
+        "  -b          binary output: two little endian 32 bit integers per line (error code, result)\n"
+        "  -j threads  evaluate on this many threads, 0 for one per core (default 1)\n"
+        "  -o output   write to this file instead of standard output\n"
+        "  -p          'input' is a program file written by exprCompile, one program per line; variables are 0\n"
+        "Text output is one line per input line: the result, or 'E' followed by the error code.\n");
+}
+
+// Appends the answer for one line to the output buffer
+static void appendAnswer(std::string& out, int errorCode, int result, bool binary)
+{
+    if (binary) {
+        unsigned char record[8];
+        uint32_t fields[2] = { (uint32_t)errorCode, (uint32_t)result };
+        for (int f = 0; f < 2; ++f) {
+            for (int b = 0; b < 4; ++b) record[f * 4 + b] = (unsigned char)(fields[f] >> (8 * b));
+        }
+        out.append((const char*)record, sizeof(record));
+        return;
+    }
+
+    char text[16];
+    char* end = text;
+    if (errorCode != ERROR::SUCCESS) { *end++ = 'E'; result = errorCode; }
+    end = std::to_chars(end, text + sizeof(text) - 1, result).ptr;
+    *end++ = '\n';
+    out.append(text, end - text);
+}
+
+// Evaluates every line in [begin, end) and appends the answers to 'out'.
+// 'end' is either the end of the input or just after a newline.
+static void evaluateLines(const char* begin, const char* end, bool binary, std::string& out)
+{
+    while (begin < end) {
+        const char* newline = (const char*)memchr(begin, '\n', end - begin);
+        const char* lineEnd = newline ? newline : end;
+
+        // The line is evaluated in place, a '\r' before the newline is whitespace to the evaluator
+        int result = 0;
+        int errorCode = evaluate(begin, (size_t)(lineEnd - begin), result);
+        appendAnswer(out, errorCode, result, binary);
+
+        begin = newline ? newline + 1 : end;
+    }
+}
+
+// Evaluates all the complete lines of a buffer and writes the answers in order.
+// The buffer is cut into chunks that end on a newline, and a group of chunks is evaluated
+// in parallel into separate output buffers that are then written one after the other.
+static bool evaluateBuffer(const char* data, size_t size, const Options& options, FILE* out)
+{
+    unsigned threads = options.threads ? options.threads : defaultThreadCount();
+    size_t group = threads > 1 ? (size_t)threads * 4 : 1;
+
+    static std::vector<std::string> outputs;
+    std::vector<const char*> bounds;
+    if (outputs.size() < group) outputs.resize(group);
+    const char* end = data + size;
+
+    const char* cur = data;
+    while (cur < end) {
+        // Cut the next group of chunks, each ending just after a newline (or at the end)
+        bounds.clear();
+        bounds.push_back(cur);
+        while (bounds.size() <= group && cur < end) {
+            const char* cut = (size_t)(end - cur) > CHUNK_SIZE ? cur + CHUNK_SIZE : end;
+            if (cut < end) {
+                const char* newline = (const char*)memchr(cut, '\n', end - cut);
+                cut = newline ? newline + 1 : end;
+            }
+            cur = cut;
+            bounds.push_back(cur);
+        }
+
+        size_t chunks = bounds.size() - 1;
+        parallelFor(chunks, threads, 1, [&](size_t first, size_t last) {
+            for (size_t c = first; c < last; ++c) {
+                outputs[c].clear();
+                evaluateLines(bounds[c], bounds[c + 1], options.binary, outputs[c]);
+            }
+        });
+
+        for (size_t c = 0; c < chunks; ++c) {
+            if (fwrite(outputs[c].data(), 1, outputs[c].size(), out) != outputs[c].size()) return false;
+        }
+    }
+    return true;
+}
+
+// Evaluates a stream read in large blocks, keeping an incomplete last line for the next block
+static bool evaluateStream(FILE* in, const Options& options, FILE* out)
+{
+    std::vector<char> buffer(READ_BLOCK_SIZE);
+    size_t kept = 0;
+    while (true) {
+        // Grow the buffer if a single line does not fit in it
+        if (kept == buffer.size()) buffer.resize(buffer.size() * 2);
+
+        size_t read = fread(buffer.data() + kept, 1, buffer.size() - kept, in);
+        size_t size = kept + read;
+        if (read == 0) {
+            // The last line may not end with a newline
+            return size == 0 || evaluateBuffer(buffer.data(), size, options, out);
+        }
+
+        // Evaluate up to the last newline, keep the rest
+        const char* last = 0;
+        for (size_t i = size; i > 0; --i) {
+            if (buffer[i - 1] == '\n') { last = buffer.data() + i; break; }
+        }
+        if (!last) { kept = size; continue; }
+
+        size_t complete = last - buffer.data();
+        if (!evaluateBuffer(buffer.data(), complete, options, out)) return false;
+        kept = size - complete;
+        memmove(buffer.data(), last, kept);
+    }
+}
+
+// Evaluates a file, memory mapped when possible
+static bool evaluateFile(const char* path, const Options& options, FILE* out)
+{
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { perror(path); return false; }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+        if (info.st_size == 0) { close(fd); return true; }
+        void* data = mmap(0, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            // The whole file is read once from front to back
+            madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+            bool ok = evaluateBuffer((const char*)data, (size_t)info.st_size, options, out);
+            munmap(data, (size_t)info.st_size);
+            close(fd);
+            return ok;
+        }
+    }
+    close(fd);
+#endif
+
+    // Not a regular file (a pipe for example), or no mmap on this platform: stream it
+    FILE* in = fopen(path, "rb");
+    if (!in) { perror(path); return false; }
+    bool ok = evaluateStream(in, options, out);
+    fclose(in);
+    return ok;
+}
+
+// Runs every program of a program file and writes the answers in order, like the lines they came from
+static bool runProgramFile(const char* path, const Options& options, FILE* out)
+{
+    ProgramFile file;
+    int status = loadProgramFile(path, file);
+    if (status != PROGRAM_FILE::SUCCESS) {
+        fprintf(stderr, "%s: not a valid program file (%d)\n", path, status);
+        return false;
+    }
+
+    // Programs only read the variables they were compiled with, none of which has a value here
+    std::vector<int> values(file.header->nameCount, 0);
+    unsigned threads = options.threads ? options.threads : defaultThreadCount();
+    size_t count = programCount(file);
+    size_t chunk = CHUNK_SIZE / 16;
+    size_t chunks = (count + chunk - 1) / chunk;
+    size_t group = threads > 1 ? (size_t)threads * 4 : 1;
+    std::vector<std::string> outputs(group);
+
+    for (size_t first = 0; first < chunks; first += group) {
+        size_t last = first + group < chunks ? first + group : chunks;
+        parallelFor(last - first, threads, 1, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; ++c) {
+                std::string& output = outputs[c];
+                output.clear();
+                size_t stop = (first + c + 1) * chunk < count ? (first + c + 1) * chunk : count;
+                for (size_t p = (first + c) * chunk; p < stop; ++p) {
+                    int result = 0;
+                    int errorCode = runProgram(file, p, values.data(), result);
+                    appendAnswer(output, errorCode, result, options.binary);
+                }
+            }
+        });
+        for (size_t c = 0; c < last - first; ++c) {
+            if (fwrite(outputs[c].data(), 1, outputs[c].size(), out) != outputs[c].size()) return false;
+        }
+    }
+    return true;
+}
+
+// Reads the number of threads of -j, 0 meaning one per core.
+// Returns false for anything but digits, so a sign or a typo is not taken as some other count.
+static bool parseThreads(const char* text, unsigned& threads)
+{
+    if (*text < '0' || *text > '9') return false;
+    char* end = 0;
+    errno = 0;
+    unsigned long value = strtoul(text, &end, 10);
+    if (*end != '\0' || errno == ERANGE || value > UINT_MAX) return false;
+    threads = (unsigned)value;
+    return true;
+}
+
+// Entry point of the tool
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-b") == 0) options.binary = true;
+        else if (strcmp(argv[i], "-p") == 0) options.programs = true;
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            if (!parseThreads(argv[++i], options.threads)) { printUsage(); return 2; }
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) options.output = argv[++i];
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) { printUsage(); return 0; }
+        else if (argv[i][0] == '-' && argv[i][1] != '\0') { printUsage(); return 2; }
+        else if (!options.input) options.input = argv[i];
+        else { printUsage(); return 2; }
+    }
+
+    FILE* out = stdout;
+    if (options.output) {
+        out = fopen(options.output, "wb");
+        if (!out) { perror(options.output); return 1; }
+    }
+
+    // Large output buffer, the answers are much smaller than the input anyway
+    static char outBuffer[1 << 20];
+    setvbuf(out, outBuffer, _IOFBF, sizeof(outBuffer));
+
+    bool ok;
+    if (options.programs) {
+        if (!options.input || strcmp(options.input, "-") == 0) { printUsage(); return 2; }
+        ok = runProgramFile(options.input, options, out);
+    }
+    else if (!options.input || strcmp(options.input, "-") == 0) ok = evaluateStream(stdin, options, out);
+    else ok = evaluateFile(options.input, options, out);
+
+    if (fflush(out) != 0) ok = false;
+    if (out != stdout) fclose(out);
+    return ok ? 0 : 1;
+}